@@ -9,6 +9,11 @@ try:
     from shmem import PyShmemClient
 except:
     pass
+try:
+    # only needed with the drp
+    import posix_ipc
+except:
+    pass
 from psana import dgram
 from psana.event import Event
 from psana.detector import detectors
@@ -60,6 +65,9 @@ class DgramManager(object):
         self.shm_res = None
         self.shm_inp_mv = None
         self.shm_res_mv = None
+        self.ring = None
+        self.ring_slot = 0
+        self._ring_request = False
         self.shm_size = None
         self.shmem_kwargs = {'index':-1,'size':0,'cli_cptr':None}
         self.configs = []
@@ -157,12 +165,15 @@ class DgramManager(object):
 
     def _connect_drp(self):
         # TODO: Add docstring
-        self.shm_inp_mv = mmap.mmap(self.ipc.shm_inp.fd, self.ipc.shm_inp.size)
-        self.shm_res_mv = mmap.mmap(self.ipc.shm_res.fd, self.ipc.shm_res.size)
+        self.shm_inp = mmap.mmap(self.ipc.shm_inp.fd, self.ipc.shm_inp.size)
+        self.shm_res = mmap.mmap(self.ipc.shm_res.fd, self.ipc.shm_res.size)
+        self.shm_inp_mv = self.shm_inp
+        self.shm_res_mv = self.shm_res
         self.mq_inp = self.ipc.mq_inp
         self.mq_res = self.ipc.mq_res
+        self.ring = getattr(self.ipc, 'ring', None)
         self.mq_res.send(b"r\n")
-        message, priority = self.mq_inp.receive()
+        message = self._drp_receive()
         if message != b"g":
             raise RuntimeError("[Python - Worker {self.tag.worker_num}] Drp Python expected 'g' message, "
                                f"got: {message}")
@@ -172,6 +183,36 @@ class DgramManager(object):
         self._stop_iteration = False
         return view
 
+    def _drp_receive(self):
+        """ Waits for the next message from the drp.  With the rings, the
+        dgram is in a slot of the shared memory and shm_inp_mv and shm_res_mv
+        are pointed at it.  Resets still come through the message queue, so
+        it is checked whenever the rings are idle."""
+        if self.ring is None:
+            message, priority = self.mq_inp.receive()
+            return message
+        while True:
+            request = self.ring.recv(timeout=0.01)
+            if request is not None:
+                message, self.ring_slot, size = request
+                self.shm_inp_mv = self.ring.slot(self.shm_inp, self.ring_slot)
+                self.shm_res_mv = self.ring.slot(self.shm_res, self.ring_slot)
+                self._ring_request = True
+                return message.encode()
+            try:
+                message, priority = self.mq_inp.receive(timeout=0)
+                self._ring_request = False
+                return message
+            except posix_ipc.BusyError:
+                pass
+
+    def _drp_reply(self, message):
+        """ Answers the last message from the drp the way it came"""
+        if self._ring_request:
+            self.ring.send(message, self.ring_slot)
+        else:
+            self.mq_res.send(message.encode() + b"\n")
+
     def set_configs(self, dgrams):
         """Save and setup given dgrams class configs."""
         self.configs = dgrams
@@ -381,8 +422,8 @@ class DgramManager(object):
         elif self.mq_inp:
             if self._stop_iteration:
                 raise StopIteration
-            self.mq_res.send(b"g\n")
-            message, priority = self.mq_inp.receive()
+            self._drp_reply("g")
+            message = self._drp_receive()
             if message == b"g":
                 # use the most recent configure datagram
                 d = dgram.Dgram(config=self.configs[-1], view=self.shm_inp_mv)
@@ -390,7 +431,7 @@ class DgramManager(object):
             elif message == b"s":
                 self._stop_iteration = True
                 self.shm_res_mv[:] = self.shm_inp_mv[:]
-                self.mq_res.send(b"s\n")                
+                self._drp_reply("s")
                 raise StopIteration
             else:
                 raise RuntimeError("[Python - Worker {self.tag.worker_num}] Drp Python expected 'g' or "
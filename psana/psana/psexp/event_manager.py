@@ -155,12 +155,12 @@ class EventManager(object):
                 self.services[i_evt] = d.service()
 
                 # For L1 with bigdata files, store offset and size found in smd dgrams.
-                # For Enable, store new chunk id (if found). 
+                # For Enable, or a SlowUpdate marking a chunk rollover, store new chunk id (if found).
                 if d.service() == TransitionId.L1Accept and self.dm.n_files > 0:
                     if i_first_L1 == -1:
                         i_first_L1 = i_evt
                     self._get_bd_offset_and_size(d, current_bd_offsets, current_bd_chunk_sizes, i_evt, i_smd, i_first_L1)
-                elif d.service() == TransitionId.Enable and hasattr(d, 'chunkinfo'):
+                elif d.service() in (TransitionId.Enable, TransitionId.SlowUpdate) and hasattr(d, 'chunkinfo'):
                     # We only support chunking on bigdata
                     if self.dm.n_files > 0: 
                         _chunk_ids = [getattr(d.chunkinfo[seg_id].chunkinfo, 'chunkid') for seg_id in d.chunkinfo]
@@ -263,7 +263,7 @@ static PyObject* createEnum(const char* enumname, PyDgramObject* pyDgram, DescDa
 
         if (name.type() == Name::ENUMVAL) {
             if (strncmp(enumname,varName,TMPSTRINGSIZE)==0) {
-                const auto tempVal = descdata.get_value<uint32_t>(varName);
+                const auto tempVal = descdata.get_value<uint32_t>(i);
                 PyObject* newobj = Py_BuildValue("i", tempVal);
                 PyObject_SetAttrString(parent, "value", newobj);
             }
@@ -276,7 +276,7 @@ static PyObject* createEnum(const char* enumname, PyDgramObject* pyDgram, DescDa
                 // eliminate the enum type from the name by
                 // inserting the null character
                 enumtype_dict[-1]='\0';
-                const auto tempVal = descdata.get_value<uint32_t>(varName);
+                const auto tempVal = descdata.get_value<uint32_t>(i);
                 PyObject* pyint = Py_BuildValue("i", tempVal);
                 // I believe this will return NULL if the string is invalid
                 PyObject* enumstr = Py_BuildValue("s", tempName);
@@ -306,54 +306,54 @@ static void dictAssign(PyDgramObject* pyDgram, DescData& descdata, Xtc* myXtc)
         if (name.rank() == 0 || name.type()==Name::CHARSTR) {
             switch (name.type()) {
             case Name::UINT8: {
-                const auto tempVal = descdata.get_value<uint8_t>(varName);
+                const auto tempVal = descdata.get_value<uint8_t>(i);
                 newobj = Py_BuildValue("B", tempVal);
                 break;
             }
             case Name::UINT16: {
-                const auto tempVal = descdata.get_value<uint16_t>(varName);
+                const auto tempVal = descdata.get_value<uint16_t>(i);
                 newobj = Py_BuildValue("H", tempVal);
                 break;
             }
             case Name::UINT32: {
-                const auto tempVal = descdata.get_value<uint32_t>(varName);
+                const auto tempVal = descdata.get_value<uint32_t>(i);
                 newobj = Py_BuildValue("I", tempVal);
                 break;
             }
             case Name::UINT64: {
-                const auto tempVal = descdata.get_value<uint64_t>(varName);
+                const auto tempVal = descdata.get_value<uint64_t>(i);
                 newobj = Py_BuildValue("K", tempVal);
                 break;
             }
             case Name::INT8: {
-                const auto tempVal = descdata.get_value<int8_t>(varName);
+                const auto tempVal = descdata.get_value<int8_t>(i);
                 newobj = Py_BuildValue("b", tempVal);
                 break;
             }
             case Name::INT16: {
-                const auto tempVal = descdata.get_value<int16_t>(varName);
+                const auto tempVal = descdata.get_value<int16_t>(i);
                 newobj = Py_BuildValue("h", tempVal);
                 break;
             }
             case Name::INT32: {
-                const auto tempVal = descdata.get_value<int32_t>(varName);
+                const auto tempVal = descdata.get_value<int32_t>(i);
                 // cpo: thought that "l" (long int) would work here
                 // as well, but empirically it doesn't.
                 newobj = Py_BuildValue("i", tempVal);
                 break;
             }
             case Name::INT64: {
-                const auto tempVal = descdata.get_value<int64_t>(varName);
+                const auto tempVal = descdata.get_value<int64_t>(i);
                 newobj = Py_BuildValue("L", tempVal);
                 break;
             }
             case Name::FLOAT: {
-                const auto tempVal = descdata.get_value<float>(varName);
+                const auto tempVal = descdata.get_value<float>(i);
                 newobj = Py_BuildValue("f", tempVal);
                 break;
             }
             case Name::DOUBLE: {
-                const auto tempVal = descdata.get_value<double>(varName);
+                const auto tempVal = descdata.get_value<double>(i);
                 newobj = Py_BuildValue("d", tempVal);
                 break;
             }
@@ -371,7 +371,7 @@ Bld::Bld(unsigned mcaddr,
          uint64_t timestampCorr) :
   m_timestampPos(timestampPos), m_pulseIdPos(pulseIdPos),
   m_headerSize(headerSize), m_payloadSize(payloadSize),
-  m_bufferSize(0), m_position(0),  m_buffer(Bld::MTU), m_payload(m_buffer.data()),
+  m_bufferSize(0), m_position(0),  m_buffer(Bld::MTU), m_data(m_buffer.data()), m_payload(m_buffer.data()),
   m_timestampCorr(timestampCorr), m_pulseId(0), m_pulseIdJump(0)
 {
     logging::info("Bld listening for %x.%d with payload size %u",mcaddr,port,payloadSize);
@@ -419,9 +419,35 @@ Bld::Bld(const Bld& o) :
 
 Bld::~Bld()
 {
+    m_ingest.reset();                   // Stop receiving before closing the socket
     close(m_sockfd);
 }
 
+void Bld::startIngest(const BldIngest::Params& params, const std::string& name)
+{
+    m_ingest = std::make_unique<BldIngest>(m_sockfd, params, name);
+}
+
+//  Get the next packet from the ingest ring, or from the socket without one
+bool Bld::_receive()
+{
+    if (m_ingest) {
+        BldIngest::Packet packet;
+        if (!m_ingest->pop(packet))
+            return false;
+        m_data       = packet.data;
+        m_bufferSize = packet.size;
+        return true;
+    }
+    ssize_t bytes = recv(m_sockfd, m_buffer.data(), Bld::MTU, MSG_DONTWAIT);
+    if (bytes <= 0)
+        return false; // Check only for EWOULDBLOCK and EAGAIN?
+    // To do: Handle partial reads?
+    m_data       = m_buffer.data();
+    m_bufferSize = bytes;
+    return true;
+}
+
 /*
 memory layout for bld packet
 header:
@@ -452,18 +478,15 @@ void     Bld::clear(uint64_t ts)
     while(1) {
         // get new multicast if buffer is empty
         if ((m_position + m_payloadSize + 4) > m_bufferSize) {
-            ssize_t bytes = recv(m_sockfd, m_buffer.data(), Bld::MTU, MSG_DONTWAIT);
-            if (bytes <= 0)
+            if (!_receive())
                 break;
-            //printf("*** 1 pos %u,  pay %u, bufSz %d, bytes %zd\n", m_position, m_payloadSize, m_bufferSize, bytes);
-            m_bufferSize = bytes;
             timestamp    = headerTimestamp();
             if (timestamp >= ts) {
                 m_position = 0;
                 break;
             }
             pulseId      = headerPulseId  ();
-            m_payload    = &m_buffer[m_headerSize];
+            m_payload    = &m_data[m_headerSize];
             m_position   = m_headerSize + m_payloadSize;
             //printf("*** 1 pid %014lx\n", pulseId);
             timespec ts;
@@ -475,17 +498,17 @@ void     Bld::clear(uint64_t ts)
             if (timestamp >= ts)
                 break;
             pulseId      = headerPulseId  ();
-            m_payload    = &m_buffer[m_headerSize];
+            m_payload    = &m_data[m_headerSize];
             m_position   = m_headerSize + m_payloadSize;
         }
         else {
-            uint32_t timestampOffset = *reinterpret_cast<uint32_t*>(m_buffer.data() + m_position)&0xfffff;
+            uint32_t timestampOffset = *reinterpret_cast<uint32_t*>(m_data + m_position)&0xfffff;
             timestamp   = headerTimestamp() + timestampOffset;
             if (timestamp >= ts)
                 break;
-            uint32_t pulseIdOffset   = (*reinterpret_cast<uint32_t*>(m_buffer.data() + m_position)>>20)&0xfff;
+            uint32_t pulseIdOffset   = (*reinterpret_cast<uint32_t*>(m_data + m_position)>>20)&0xfff;
             pulseId     = headerPulseId  () + pulseIdOffset;
-            m_payload   = &m_buffer[m_position + 4];
+            m_payload   = &m_data[m_position + 4];
             m_position += 4 + m_payloadSize;
         }
 
@@ -505,15 +528,11 @@ uint64_t Bld::next()
     uint64_t pulseId  (0L);
     // get new multicast if buffer is empty
     if ((m_position + m_payloadSize + 4) > m_bufferSize) {
-        ssize_t bytes = recv(m_sockfd, m_buffer.data(), Bld::MTU, MSG_DONTWAIT);
-        if (bytes <= 0)
-            return timestamp; // Check only for EWOULDBLOCK and EAGAIN?
-        //printf("*** 2 pos %u,  pay %u, bufSz %d, bytes %zd\n", m_position, m_payloadSize, m_bufferSize, bytes);
-        // To do: Handle partial reads?
-        m_bufferSize = bytes;
+        if (!_receive())
+            return timestamp;
         timestamp    = headerTimestamp();
         pulseId      = headerPulseId  ();
-        m_payload    = &m_buffer[m_headerSize];
+        m_payload    = &m_data[m_headerSize];
         m_position   = m_headerSize + m_payloadSize;
         timespec ts;
         clock_gettime(CLOCK_REALTIME,&ts);
@@ -522,16 +541,16 @@ uint64_t Bld::next()
     else if (m_position==0) {
         timestamp    = headerTimestamp();
         pulseId      = headerPulseId  ();
-        m_payload    = &m_buffer[m_headerSize];
+        m_payload    = &m_data[m_headerSize];
         m_position   = m_headerSize + m_payloadSize;
         //printf("*** 2b pid %014lx\n", pulseId);
     }
     else {
-        uint32_t timestampOffset = *reinterpret_cast<uint32_t*>(m_buffer.data() + m_position)&0xfffff;
+        uint32_t timestampOffset = *reinterpret_cast<uint32_t*>(m_data + m_position)&0xfffff;
         timestamp   = headerTimestamp() + timestampOffset;
-        uint32_t pulseIdOffset   = (*reinterpret_cast<uint32_t*>(m_buffer.data() + m_position)>>20)&0xfff;
+        uint32_t pulseIdOffset   = (*reinterpret_cast<uint32_t*>(m_data + m_position)>>20)&0xfff;
         pulseId     = headerPulseId  () + pulseIdOffset;
-        m_payload   = &m_buffer[m_position + 4];
+        m_payload   = &m_data[m_position + 4];
         m_position += 4 + m_payloadSize;
         //printf("*** 2c pid %014lx, pidOs %u\n", pulseId, pulseIdOffset);
     }
@@ -745,6 +764,33 @@ void Pgp::worker(std::shared_ptr<Pds::MetricExporter> exporter)
     for(unsigned i=0; i<bldPva.size(); i++)
         m_config.push_back(std::make_shared<BldFactory>(*bldPva[i].get()));
 
+    //
+    //  Receive each source's packets on a thread of its own
+    //
+    BldIngest::Params ingestParams(m_para);
+    if (ingestParams.enabled) {
+        for(unsigned i=0; i<m_config.size(); i++) {
+            const std::string& name = m_config[i]->detName();
+            Bld& bld = m_config[i]->handler();
+            bld.startIngest(ingestParams, name);
+
+            const BldIngest* ingest = bld.ingest();
+            exporter->add("bld_packet_rate_"+name, labels, Pds::MetricType::Rate,
+                          [ingest](){return ingest->nPackets();});
+            exporter->add("bld_drop_count_"+name, labels, Pds::MetricType::Counter,
+                          [ingest](){return ingest->nDrops();});
+            exporter->add("bld_ring_full_count_"+name, labels, Pds::MetricType::Counter,
+                          [ingest](){return ingest->nRingFull();});
+            exporter->add("bld_rx_batch_"+name, labels, Pds::MetricType::Gauge,
+                          [ingest](){return ingest->batchSize();});
+            exporter->add("bld_ring_occupancy_"+name, labels, Pds::MetricType::Gauge,
+                          [ingest](){return ingest->occupancy();});
+            if (ingestParams.rxTimestamps)
+                exporter->add("bld_rx_latency_"+name, labels, Pds::MetricType::Gauge,
+                              [ingest](){return ingest->rxLatency();});
+        }
+    }
+
     uint64_t nextId = -1UL;
     uint64_t timestamp[m_config.size()];
     memset(timestamp,0,sizeof(timestamp));
@@ -1132,6 +1178,11 @@ void BldApp::handlePhase1(const json& msg)
     reply(answer);
 }
 
+void BldApp::handleChunkRollover(const json& msg)
+{
+    m_drp.chunkRollover(msg, m_det, [this](const json& warning) { reply(warning); });
+}
+
 void BldApp::handleReset(const nlohmann::json& msg)
 {
     unsubscribePartition();    // ZMQ_UNSUBSCRIBE
@@ -1247,9 +1298,20 @@ int main(int argc, char* argv[])
         if (kwargs.first == "pebbleBufSize")  continue;  // DrpBase
         if (kwargs.first == "pebbleBufCount") continue;  // DrpBase
         if (kwargs.first == "batching")       continue;  // DrpBase
+        if (kwargs.first == "batchLatency")   continue;  // TebContributor
+        if (kwargs.first == "pebbleHugePages") continue;  // Placement
+        if (kwargs.first == "numaNode")       continue;  // Placement
+        if (kwargs.first == "pinEbReceiver")  continue;  // Placement
         if (kwargs.first == "directIO")       continue;  // DrpBase
+        if (kwargs.first == "recordUring")    continue;  // DrpBase
+        if (kwargs.first == "xtcIndex")       continue;  // DrpBase
         if (kwargs.first == "pva_addr")       continue;  // DrpBase
         if (kwargs.first == "interface")      continue;
+        if (kwargs.first == "bldIngest")      continue;  // BldIngest
+        if (kwargs.first == "bldRing")        continue;  // BldIngest
+        if (kwargs.first == "bldBatch")       continue;  // BldIngest
+        if (kwargs.first == "bldBusyPoll")    continue;  // BldIngest
+        if (kwargs.first == "bldRxTimestamps") continue; // BldIngest
         logging::critical("Unrecognized kwarg '%s=%s'\n",
                           kwargs.first.c_str(), kwargs.second.c_str());
         return 1;
@@ -5,6 +5,7 @@
 #include <string>
 #include "DrpBase.hh"
 #include "XpmDetector.hh"
+#include "BldIngest.hh"
 #include "psdaq/service/Collection.hh"
 #include "psdaq/service/fast_monotonic_clock.hh"
 #include "psdaq/epicstools/PVBase.hh"
@@ -45,9 +46,12 @@ public:
     uint8_t* payload    () const { return m_payload; }
     unsigned payloadSize() const { return m_payloadSize; }
     unsigned fd         () const { return m_sockfd; }
+    void     startIngest(const BldIngest::Params& params, const std::string& name);
+    const BldIngest* ingest() const { return m_ingest.get(); }
 private:
-    uint64_t headerTimestamp  () const {return *reinterpret_cast<const uint64_t*>(m_buffer.data()+m_timestampPos) - m_timestampCorr;}
-    uint64_t headerPulseId    () const {return *reinterpret_cast<const uint64_t*>(m_buffer.data()+m_pulseIdPos);}
+    bool     _receive   ();
+    uint64_t headerTimestamp  () const {return *reinterpret_cast<const uint64_t*>(m_data+m_timestampPos) - m_timestampCorr;}
+    uint64_t headerPulseId    () const {return *reinterpret_cast<const uint64_t*>(m_data+m_pulseIdPos);}
     int      m_timestampPos;
     int      m_pulseIdPos;
     int      m_headerSize;
@@ -56,10 +60,12 @@ private:
     int      m_bufferSize;
     int      m_position;
     std::vector<uint8_t> m_buffer;
+    uint8_t* m_data;                    // The packet, in m_buffer or in the ingest ring
     uint8_t* m_payload;
     uint64_t m_timestampCorr;
     uint64_t m_pulseId;
     unsigned m_pulseIdJump;
+    std::unique_ptr<BldIngest> m_ingest;
 };
 
 class BldPVA
@@ -100,6 +106,7 @@ public:
     ~BldFactory();
 public:
     Bld&               handler   ();
+    const std::string& detName   () const { return _detName; }
     XtcData::NameIndex addToXtc  (XtcData::Xtc&,
                                   const void* bufEnd,
                                   const XtcData::NamesId&);
@@ -165,6 +172,7 @@ private:
     void handleConnect(const nlohmann::json& msg) override;
     void handleDisconnect(const nlohmann::json& msg) override;
     void handlePhase1(const nlohmann::json& msg) override;
+    void handleChunkRollover(const nlohmann::json& msg) override;
     void _unconfigure();
     void _disconnect();
     void _error(const std::string& which, const nlohmann::json& msg, const std::string& errorMsg);
@@ -1087,6 +1087,11 @@ void BldApp::handlePhase1(const json& msg)
     reply(answer);
 }
 
+void BldApp::handleChunkRollover(const json& msg)
+{
+    m_drp.chunkRollover(msg, m_det, [this](const json& warning) { reply(warning); });
+}
+
 void BldApp::handleReset(const nlohmann::json& msg)
 {
     unsubscribePartition();    // ZMQ_UNSUBSCRIBE
@@ -1202,7 +1207,13 @@ int main(int argc, char* argv[])
         if (kwargs.first == "pebbleBufSize")  continue;  // DrpBase
         if (kwargs.first == "pebbleBufCount") continue;  // DrpBase
         if (kwargs.first == "batching")       continue;  // DrpBase
+        if (kwargs.first == "batchLatency")   continue;  // TebContributor
+        if (kwargs.first == "pebbleHugePages") continue;  // Placement
+        if (kwargs.first == "numaNode")       continue;  // Placement
+        if (kwargs.first == "pinEbReceiver")  continue;  // Placement
         if (kwargs.first == "directIO")       continue;  // DrpBase
+        if (kwargs.first == "recordUring")    continue;  // DrpBase
+        if (kwargs.first == "xtcIndex")       continue;  // DrpBase
         if (kwargs.first == "pva_addr")       continue;  // DrpBase
         if (kwargs.first == "interface")      continue;
         if (kwargs.first == "timeout")        continue;
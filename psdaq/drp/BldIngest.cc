@@ -0,0 +1,178 @@
+#include "BldIngest.hh"
+#include "drp.hh"
+#include "psalg/utils/SysLog.hh"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <time.h>
+#include <unistd.h>
+
+using logging = psalg::SysLog;
+
+using namespace Drp;
+
+static const unsigned MTU = 9000;       // As for Bld
+static const unsigned ControlSize = CMSG_SPACE(sizeof(timespec)) + CMSG_SPACE(sizeof(uint32_t));
+
+static std::string kwarg(const Parameters& para, const char* key, const char* dflt)
+{
+    auto it = para.kwargs.find(key);
+    return it != para.kwargs.end() ? it->second : dflt;
+}
+
+BldIngest::Params::Params(const Parameters& para) :
+    enabled     (std::stoul(kwarg(para, "bldIngest",       "1")) != 0),
+    ringSize    (std::stoul(kwarg(para, "bldRing",         "1024"))),
+    batch       (std::stoul(kwarg(para, "bldBatch",        "64"))),
+    busyPollUs  (std::stoi (kwarg(para, "bldBusyPoll",     "0"))),
+    rxTimestamps(std::stoul(kwarg(para, "bldRxTimestamps", "0")) != 0)
+{
+    if (ringSize == 0 || (ringSize & (ringSize - 1)) != 0) {
+        logging::critical("bldRing must be a power of 2, got %u", ringSize);
+        throw "Invalid bldRing kwarg";
+    }
+    if (batch == 0 || batch > ringSize)  batch = ringSize;
+}
+
+BldIngest::BldIngest(int fd, const Params& params, const std::string& name) :
+    m_fd        (fd),
+    m_name      (name),
+    m_ringSize  (params.ringSize),
+    m_ringMask  (params.ringSize - 1),
+    m_batch     (params.batch),
+    m_buffers   (size_t(params.ringSize) * MTU),
+    m_packets   (params.ringSize),
+    m_msgs      (params.batch),
+    m_iovs      (params.batch),
+    m_controls  (size_t(params.batch) * ControlSize),
+    m_writeIndex(0),
+    m_readIndex (0),
+    m_writeCache(0),
+    m_held      (false),
+    m_nPackets  (0),
+    m_nDrops    (0),
+    m_nRingFull (0),
+    m_batchSize (0),
+    m_rxLatency (0),
+    m_terminate (false)
+{
+    for (unsigned i = 0; i < m_ringSize; ++i) {
+        m_packets[i] = {&m_buffers[size_t(i) * MTU], 0, 0};
+    }
+
+    // Block in recvmmsg() for a while at most, so the thread sees m_terminate
+    timeval tmo = {0, 100000};
+    if (setsockopt(m_fd, SOL_SOCKET, SO_RCVTIMEO, &tmo, sizeof(tmo)) == -1) {
+        logging::error("%s: setsockopt(SO_RCVTIMEO) failed: %m", m_name.c_str());
+    }
+
+    int one = 1;
+    if (setsockopt(m_fd, SOL_SOCKET, SO_RXQ_OVFL, &one, sizeof(one)) == -1) {
+        logging::warning("%s: setsockopt(SO_RXQ_OVFL) failed, drops are not counted: %m", m_name.c_str());
+    }
+    if (params.rxTimestamps &&
+        setsockopt(m_fd, SOL_SOCKET, SO_TIMESTAMPNS, &one, sizeof(one)) == -1) {
+        logging::warning("%s: setsockopt(SO_TIMESTAMPNS) failed: %m", m_name.c_str());
+    }
+    if (params.busyPollUs > 0 &&
+        setsockopt(m_fd, SOL_SOCKET, SO_BUSY_POLL, &params.busyPollUs, sizeof(params.busyPollUs)) == -1) {
+        logging::warning("%s: setsockopt(SO_BUSY_POLL, %d) failed: %m", m_name.c_str(), params.busyPollUs);
+    }
+
+    logging::info("%s: receiving into a ring of %u packets, up to %u per recvmmsg",
+                  m_name.c_str(), m_ringSize, m_batch);
+
+    m_thread = std::thread(&BldIngest::_receive, this);
+}
+
+BldIngest::~BldIngest()
+{
+    m_terminate.store(true, std::memory_order_release);
+    if (m_thread.joinable())  m_thread.join();
+}
+
+void BldIngest::_receive()
+{
+    logging::info("%s ingest thread is starting", m_name.c_str());
+
+    while (!m_terminate.load(std::memory_order_acquire)) {
+        uint32_t write = m_writeIndex.load(std::memory_order_relaxed);
+        uint32_t room  = m_ringSize - (write - m_readIndex.load(std::memory_order_acquire));
+        if (room == 0) {
+            // Let the socket buffer take up the slack while the worker catches up
+            m_nRingFull.fetch_add(1, std::memory_order_relaxed);
+            usleep(100);
+            continue;
+        }
+
+        // Receive into the free slots up to the end of the ring
+        unsigned first = write & m_ringMask;
+        unsigned count = std::min(std::min(room, m_batch), m_ringSize - first);
+        for (unsigned i = 0; i < count; ++i) {
+            m_iovs[i]                    = {m_packets[first + i].data, MTU};
+            m_msgs[i].msg_hdr            = {};
+            m_msgs[i].msg_hdr.msg_iov    = &m_iovs[i];
+            m_msgs[i].msg_hdr.msg_iovlen = 1;
+            m_msgs[i].msg_hdr.msg_control    = &m_controls[size_t(i) * ControlSize];
+            m_msgs[i].msg_hdr.msg_controllen = ControlSize;
+        }
+
+        int n = recvmmsg(m_fd, m_msgs.data(), count, MSG_WAITFORONE, nullptr);
+        if (n <= 0) {
+            if (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+                logging::error("%s: recvmmsg failed: %m", m_name.c_str());
+                usleep(10000);
+            }
+            continue;
+        }
+
+        for (int i = 0; i < n; ++i) {
+            Packet& packet = m_packets[first + i];
+            packet.size    = m_msgs[i].msg_len;
+            packet.rxTime  = 0;
+            for (cmsghdr* cmsg = CMSG_FIRSTHDR(&m_msgs[i].msg_hdr); cmsg;
+                 cmsg = CMSG_NXTHDR(&m_msgs[i].msg_hdr, cmsg)) {
+                if (cmsg->cmsg_level != SOL_SOCKET)  continue;
+                if (cmsg->cmsg_type == SO_TIMESTAMPNS) {
+                    timespec ts;
+                    memcpy(&ts, CMSG_DATA(cmsg), sizeof(ts));
+                    packet.rxTime = uint64_t(ts.tv_sec) * 1000000000ul + ts.tv_nsec;
+                } else if (cmsg->cmsg_type == SO_RXQ_OVFL) {
+                    uint32_t drops;     // The socket's running total
+                    memcpy(&drops, CMSG_DATA(cmsg), sizeof(drops));
+                    m_nDrops.store(drops, std::memory_order_relaxed);
+                }
+            }
+        }
+        m_writeIndex.store(write + n, std::memory_order_release);
+        m_nPackets.fetch_add(n, std::memory_order_relaxed);
+        m_batchSize.store(n, std::memory_order_relaxed);
+    }
+
+    logging::info("%s ingest thread is exiting", m_name.c_str());
+}
+
+bool BldIngest::pop(Packet& packet)
+{
+    uint32_t read = m_readIndex.load(std::memory_order_relaxed) + (m_held ? 1 : 0);
+    if (read == m_writeCache) {
+        m_writeCache = m_writeIndex.load(std::memory_order_acquire);
+        if (read == m_writeCache)  return false;
+    }
+
+    // Give back the slot of the packet handed out last time only now, as
+    // the caller's payload pointer may still refer to it until then
+    if (m_held)  m_readIndex.store(read, std::memory_order_release);
+
+    packet = m_packets[read & m_ringMask];
+    m_held = true;
+
+    if (packet.rxTime) {
+        timespec now;
+        clock_gettime(CLOCK_REALTIME, &now);
+        int64_t latency = uint64_t(now.tv_sec) * 1000000000ul + now.tv_nsec - packet.rxTime;
+        m_rxLatency.store(latency, std::memory_order_relaxed);
+    }
+    return true;
+}
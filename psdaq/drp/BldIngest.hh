@@ -0,0 +1,80 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sys/socket.h>
+
+namespace Drp {
+
+struct Parameters;
+
+// Receives the multicast packets of a BLD source on a thread of its own,
+// with recvmmsg() into a preallocated ring of packet buffers, so that the
+// thread matching BLD to timing data takes them from the ring without
+// making any system calls.  The kernel's count of packets dropped for lack
+// of socket buffer space and, optionally, the kernel's receive timestamps
+// come along with the packets.
+class BldIngest
+{
+public:
+    struct Params
+    {
+        Params(const Parameters& para);
+        bool     enabled;               // bldIngest=0 receives on the worker thread instead
+        unsigned ringSize;              // bldRing=<packets>, a power of 2
+        unsigned batch;                 // bldBatch=<most packets per recvmmsg>
+        int      busyPollUs;            // bldBusyPoll=<us> sets SO_BUSY_POLL
+        bool     rxTimestamps;          // bldRxTimestamps=1 sets SO_TIMESTAMPNS
+    };
+    struct Packet
+    {
+        uint8_t* data;
+        uint32_t size;
+        uint64_t rxTime;                // Kernel receive time in ns since 1970, or 0
+    };
+public:
+    BldIngest(int fd, const Params& params, const std::string& name);
+    ~BldIngest();
+    // Takes the next packet, if any, which stays valid until the next call
+    bool     pop(Packet& packet);
+public:
+    uint64_t nPackets() const  { return m_nPackets.load(std::memory_order_relaxed); }
+    uint64_t nDrops() const    { return m_nDrops.load(std::memory_order_relaxed); }
+    uint64_t nRingFull() const { return m_nRingFull.load(std::memory_order_relaxed); }
+    unsigned batchSize() const { return m_batchSize.load(std::memory_order_relaxed); }
+    int64_t  rxLatency() const { return m_rxLatency.load(std::memory_order_relaxed); }
+    unsigned occupancy() const { return m_writeIndex.load(std::memory_order_relaxed) -
+                                        m_readIndex.load(std::memory_order_relaxed); }
+private:
+    void     _receive();
+private:
+    int                       m_fd;
+    std::string               m_name;
+    unsigned                  m_ringSize;
+    unsigned                  m_ringMask;
+    unsigned                  m_batch;
+    std::vector<uint8_t>      m_buffers;
+    std::vector<Packet>       m_packets;
+    std::vector<mmsghdr>      m_msgs;
+    std::vector<iovec>        m_iovs;
+    std::vector<uint8_t>      m_controls;
+    char                      _pad0[64];
+    std::atomic<uint32_t>     m_writeIndex;  // Ingest thread's
+    char                      _pad1[64];
+    std::atomic<uint32_t>     m_readIndex;   // Worker thread's
+    uint32_t                  m_writeCache;  // Last m_writeIndex the worker saw
+    bool                      m_held;        // Worker holds the packet at m_readIndex
+    char                      _pad2[64];
+    std::atomic<uint64_t>     m_nPackets;
+    std::atomic<uint64_t>     m_nDrops;
+    std::atomic<uint64_t>     m_nRingFull;
+    std::atomic<unsigned>     m_batchSize;
+    std::atomic<int64_t>      m_rxLatency;
+    std::atomic<bool>         m_terminate;
+    std::thread               m_thread;
+};
+
+}
@@ -0,0 +1,298 @@
+#include "DmaEmulator.hh"
+#include "drp.hh"
+#include "DataDriver.h"
+#include "psdaq/service/EbDgram.hh"
+#include "xtcdata/xtc/XtcFileIterator.hh"
+#include "psalg/utils/SysLog.hh"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+
+#ifndef POSIX_TIME_AT_EPICS_EPOCH
+#define POSIX_TIME_AT_EPICS_EPOCH 631152000u
+#endif
+
+using logging = psalg::SysLog;
+using ms_t    = std::chrono::milliseconds;
+
+namespace {
+
+// The layout of Pds::TimingHeader, which can't be constructed
+struct EmuTimingHeader
+{
+    uint64_t           pulseIdAndControl;
+    XtcData::TimeStamp time;
+    uint32_t           env;
+    uint32_t           evtCounter;
+    uint32_t           opaque[2];
+};
+
+static_assert(sizeof(EmuTimingHeader) == sizeof(Pds::TimingHeader), "EmuTimingHeader must match Pds::TimingHeader");
+
+const uint64_t PulseRate = 928571;      // Hz, 1.3 GHz / 1400
+
+}
+
+using namespace Drp;
+
+static std::string kwarg(const Parameters& para, const char* key, const char* dflt)
+{
+    auto it = para.kwargs.find(key);
+    return it != para.kwargs.end() ? it->second : dflt;
+}
+
+DmaEmulator::DmaEmulator(const Parameters& para) :
+    m_dmaCount   (std::stoul(kwarg(para, "emuDmaCount", "1024"))),
+    m_dmaSize    (std::stoul(kwarg(para, "emuDmaSize",  "0x10000"), nullptr, 0)),
+    m_payloadSize(std::stoul(kwarg(para, "emuPayload",  "1024"))),
+    m_rate       (std::stod (kwarg(para, "emuRate",     "0"))),
+    m_env        (1 << para.partition),
+    m_nextPayload(0),
+    m_pulseId    (0),
+    m_pulseIdStep(m_rate > 0 ? std::max(uint64_t(1), uint64_t(PulseRate / m_rate)) : 1),
+    m_evtCounter (0),
+    m_enabled    (false),
+    m_terminate  (false)
+{
+    // One less than the buffer size, which PgpReader takes as an overflow
+    uint32_t maxPayload = m_dmaSize - sizeof(EmuTimingHeader) - 4;
+    if (m_payloadSize > maxPayload) {
+        logging::warning("emuPayload %u truncated to %u to fit emuDmaSize", m_payloadSize, maxPayload);
+        m_payloadSize = maxPayload;
+    }
+
+    std::string fileName = kwarg(para, "emuFile", "");
+    if (!fileName.empty())  _loadFile(fileName);
+
+    // Fill the payloads with a ramp once, since only the headers change
+    m_memory.resize(size_t(m_dmaCount) * m_dmaSize);
+    for (uint32_t i = 0; i < m_dmaCount; ++i) {
+        uint8_t* buffer = &m_memory[size_t(i) * m_dmaSize];
+        m_buffers.push_back(buffer);
+        uint16_t* payload = reinterpret_cast<uint16_t*>(buffer + sizeof(EmuTimingHeader));
+        for (uint32_t j = 0; j < maxPayload / sizeof(*payload); ++j)  payload[j] = j;
+        m_free.push_back(i);
+    }
+
+    // Start the pulse IDs at the current time, as if the accelerator had been running
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    m_pulseId = (uint64_t(ts.tv_sec - POSIX_TIME_AT_EPICS_EPOCH) * PulseRate) & 0x00ffffffffffffffull;
+
+    logging::info("DMA emulator: %u buffers of %u bytes, %u byte payloads at %s",
+                  m_dmaCount, m_dmaSize, m_payloadSize,
+                  m_rate > 0 ? (std::to_string(m_rate) + " Hz").c_str() : "full rate");
+
+    m_thread = std::thread(&DmaEmulator::_generator, this);
+}
+
+DmaEmulator::~DmaEmulator()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        m_terminate.store(true, std::memory_order_release);
+    }
+    m_freeCv.notify_all();
+    m_readyCv.notify_all();
+    if (m_thread.joinable())  m_thread.join();
+}
+
+void DmaEmulator::_loadFile(const std::string& fileName)
+{
+    int fd = open(fileName.c_str(), O_RDONLY);
+    if (fd < 0) {
+        logging::critical("Error opening %s: %m", fileName.c_str());
+        throw "Error opening DMA emulator file " + fileName;
+    }
+
+    // Keep a bounded number of events, which are replayed in a loop
+    const size_t maxEvents = 1024;
+    uint32_t maxPayload = m_dmaSize - sizeof(EmuTimingHeader) - 4;
+    XtcData::XtcFileIterator iter(fd, 0x4000000);
+    XtcData::Dgram* dg;
+    while ((dg = iter.next()) && m_payloads.size() < maxEvents) {
+        if (dg->service() != XtcData::TransitionId::L1Accept)  continue;
+        const uint8_t* payload = reinterpret_cast<const uint8_t*>(dg->xtc.payload());
+        uint32_t size = std::min(uint32_t(dg->xtc.sizeofPayload()), maxPayload);
+        m_payloads.emplace_back(payload, payload + size);
+    }
+    close(fd);
+
+    if (m_payloads.empty()) {
+        logging::critical("No L1Accepts found in %s", fileName.c_str());
+        throw "No L1Accepts found in DMA emulator file " + fileName;
+    }
+    logging::info("DMA emulator replays %zu L1Accepts of %s", m_payloads.size(), fileName.c_str());
+}
+
+void** DmaEmulator::mapDma(uint32_t* count, uint32_t* size)
+{
+    *count = m_dmaCount;
+    *size  = m_dmaSize;
+    return m_buffers.data();
+}
+
+int32_t DmaEmulator::readBulkIndex(uint32_t maxCnt, int32_t* ret, uint32_t* index,
+                                   uint32_t* flags, uint32_t* errors, uint32_t* dest)
+{
+    std::unique_lock<std::mutex> lock(m_lock);
+
+    // Wait a little rather than returning at once, which would keep the reader spinning
+    if (m_ready.empty()) {
+        m_readyCv.wait_for(lock, ms_t(1));
+    }
+
+    uint32_t n = std::min(maxCnt, uint32_t(m_ready.size()));
+    for (uint32_t i = 0; i < n; ++i) {
+        const Dma& dma = m_ready.front();
+        ret[i]   = dma.size;
+        index[i] = dma.index;
+        if (flags)   flags[i]  = 0;
+        if (errors)  errors[i] = 0;
+        if (dest)    dest[i]   = dma.dest;
+        m_ready.pop_front();
+    }
+    return n;
+}
+
+int32_t DmaEmulator::retIndexes(uint32_t count, const uint32_t* indices)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        m_free.insert(m_free.end(), indices, indices + count);
+    }
+    m_freeCv.notify_one();
+    return 0;
+}
+
+int DmaEmulator::setMaskBytes(const uint8_t* mask)
+{
+    std::lock_guard<std::mutex> lock(m_lock);
+    m_dests.clear();
+    for (uint32_t dest = 0; dest < DMA_MASK_SIZE * 8; ++dest) {
+        if (mask[dest / 8] & (1 << (dest % 8)))  m_dests.push_back(dest);
+    }
+    return 0;
+}
+
+void DmaEmulator::transition(XtcData::TransitionId::Value transitionId)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        m_transitions.push_back(transitionId);
+    }
+    m_freeCv.notify_one();
+}
+
+void DmaEmulator::_generator()
+{
+    auto     tEnable = std::chrono::steady_clock::now();
+    uint64_t nL1     = 0;
+
+    while (!m_terminate.load(std::memory_order_acquire)) {
+        XtcData::TransitionId::Value transitionId;
+        {
+            std::unique_lock<std::mutex> lock(m_lock);
+            if (!m_transitions.empty()) {
+                transitionId = m_transitions.front();
+                m_transitions.pop_front();
+                if (transitionId == XtcData::TransitionId::Disable)  m_enabled = false;
+            } else if (m_enabled && !m_dests.empty()) {
+                transitionId = XtcData::TransitionId::L1Accept;
+            } else {
+                m_freeCv.wait_for(lock, ms_t(10));
+                continue;
+            }
+        }
+
+        if (transitionId == XtcData::TransitionId::L1Accept && m_rate > 0) {
+            // Generate the events that are due, and sleep a while when none are
+            auto     elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - tEnable).count();
+            uint64_t due     = uint64_t(elapsed * m_rate);
+            if (nL1 >= due) {
+                auto wait = std::min(std::chrono::duration<double>((nL1 + 1 - due) / m_rate), std::chrono::duration<double>(0.001));
+                std::this_thread::sleep_for(wait);
+                continue;
+            }
+        }
+
+        if (!_send(transitionId))  break;
+
+        if (transitionId == XtcData::TransitionId::L1Accept) {
+            ++nL1;
+        } else if (transitionId == XtcData::TransitionId::Enable) {
+            std::lock_guard<std::mutex> lock(m_lock);
+            m_enabled = true;
+            tEnable   = std::chrono::steady_clock::now();
+            nL1       = 0;
+        }
+    }
+}
+
+bool DmaEmulator::_send(XtcData::TransitionId::Value transitionId)
+{
+    std::vector<uint32_t> indices;
+    std::vector<uint32_t> dests;
+    {
+        std::unique_lock<std::mutex> lock(m_lock);
+        dests = m_dests;
+        if (dests.empty()) {
+            logging::error("DMA emulator has no lanes enabled for %s", XtcData::TransitionId::name(transitionId));
+            return true;
+        }
+        m_freeCv.wait(lock, [&] { return m_free.size() >= dests.size() ||
+                                         m_terminate.load(std::memory_order_acquire); });
+        if (m_terminate.load(std::memory_order_acquire))  return false;
+        for (size_t i = 0; i < dests.size(); ++i) {
+            indices.push_back(m_free.front());
+            m_free.pop_front();
+        }
+    }
+
+    // The hardware counts events from Configure and BeginRun, see PgpReader::resetEventCounter()
+    if (transitionId == XtcData::TransitionId::Configure ||
+        transitionId == XtcData::TransitionId::BeginRun) {
+        m_evtCounter = 1;
+    } else {
+        m_evtCounter = (m_evtCounter + 1) & 0xffffff;
+    }
+    m_pulseId = (m_pulseId + m_pulseIdStep) & 0x00ffffffffffffffull;
+
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+
+    const std::vector<uint8_t>* payload = nullptr;
+    uint32_t payloadSize = 0;
+    if (transitionId == XtcData::TransitionId::L1Accept) {
+        if (!m_payloads.empty()) {
+            payload     = &m_payloads[m_nextPayload++ % m_payloads.size()];
+            payloadSize = payload->size();
+        } else {
+            payloadSize = m_payloadSize;
+        }
+    }
+
+    std::vector<Dma> dmas;
+    for (size_t i = 0; i < dests.size(); ++i) {
+        auto th = static_cast<EmuTimingHeader*>(m_buffers[indices[i]]);
+        th->pulseIdAndControl = m_pulseId | (uint64_t(transitionId) << 56);
+        th->time              = XtcData::TimeStamp(unsigned(ts.tv_sec - POSIX_TIME_AT_EPICS_EPOCH),
+                                                   unsigned(ts.tv_nsec));
+        th->env               = m_env;
+        th->evtCounter        = m_evtCounter;
+        th->opaque[0]         = 0;
+        th->opaque[1]         = 0;
+        if (payload)  memcpy((void*)(th + 1), payload->data(), payloadSize);
+        dmas.push_back({indices[i], uint32_t(sizeof(*th) + payloadSize), dests[i]});
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        m_ready.insert(m_ready.end(), dmas.begin(), dmas.end());
+    }
+    m_readyCv.notify_one();
+    return true;
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "xtcdata/xtc/TransitionId.hh"
+
+namespace Drp {
+
+struct Parameters;
+
+// A user-space stand-in for the DMA engine of the PGP card, for running and
+// profiling the DRP without the hardware, selected with "-d emu".  It
+// implements the subset of the DataDriver calls that MemPool and PgpReader
+// use: the DMA buffers are ordinary memory, and a generator thread fills
+// them with a TimingHeader and a payload for each lane enabled by
+// setMaskBytes().  L1Accepts are generated between Enable and Disable at
+// emuRate Hz (0, the default, is as fast as buffers are returned) with
+// emuPayload bytes of payload, or with the payloads of the L1Accepts of
+// emuFile, replayed in a loop.  The other transitions are sent when the
+// application calls transition(), as the XPM would once phase 1 is done.
+// Other kwargs: emuDmaCount and emuDmaSize, the number and size of the
+// DMA buffers.
+class DmaEmulator
+{
+public:
+    DmaEmulator(const Parameters& para);
+    ~DmaEmulator();
+
+    // Counterparts of the DataDriver functions of the same names
+    void**  mapDma(uint32_t* count, uint32_t* size);
+    int32_t readBulkIndex(uint32_t maxCnt, int32_t* ret, uint32_t* index,
+                          uint32_t* flags, uint32_t* errors, uint32_t* dest);
+    int32_t retIndexes(uint32_t count, const uint32_t* indices);
+    int     setMaskBytes(const uint8_t* mask);
+
+    void transition(XtcData::TransitionId::Value transitionId);
+private:
+    struct Dma
+    {
+        uint32_t index;
+        uint32_t size;
+        uint32_t dest;
+    };
+    void _loadFile(const std::string& fileName);
+    void _generator();
+    bool _send(XtcData::TransitionId::Value transitionId);
+private:
+    uint32_t                  m_dmaCount;
+    uint32_t                  m_dmaSize;
+    uint32_t                  m_payloadSize;
+    double                    m_rate;
+    uint32_t                  m_env;
+    std::vector<uint8_t>      m_memory;
+    std::vector<void*>        m_buffers;
+    std::vector<std::vector<uint8_t> > m_payloads; // Replayed from emuFile
+    size_t                    m_nextPayload;
+    std::vector<uint32_t>     m_dests;
+    uint64_t                  m_pulseId;
+    uint64_t                  m_pulseIdStep;
+    uint32_t                  m_evtCounter;
+    bool                      m_enabled;
+    std::deque<XtcData::TransitionId::Value> m_transitions;
+    std::deque<uint32_t>      m_free;
+    std::deque<Dma>           m_ready;
+    std::mutex                m_lock;
+    std::condition_variable   m_freeCv;         // For the generator
+    std::condition_variable   m_readyCv;        // For readBulkIndex()
+    std::atomic<bool>         m_terminate;
+    std::thread               m_thread;
+};
+
+}
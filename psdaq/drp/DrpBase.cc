@@ -12,6 +12,7 @@
 #include "psdaq/service/EbDgram.hh"
 #include <DmaDriver.h>
 #include "DrpBase.hh"
+#include "DmaEmulator.hh"
 #include "RunInfoDef.hh"
 #include "psalg/utils/SysLog.hh"
 #include "xtcdata/xtc/Smd.hh"
@@ -35,7 +36,7 @@ static json createFileReportMsg(std::string path, std::string absolute_path,
                                 timespec create_time, timespec modify_time,
                                 unsigned run_num, std::string hostname);
 static json createPulseIdMsg(uint64_t pulseId);
-static json createChunkRequestMsg();
+static json createChunkRequestMsg(uint64_t pulseId);
 
 namespace Drp {
 
@@ -55,6 +56,21 @@ static long readInfinibandCounter(const std::string& counter)
     }
 }
 
+// Whether to record with io_uring straight from the pebble (kwarg recordUring=1)
+static bool recordUring(const Parameters& para)
+{
+    auto it = para.kwargs.find("recordUring");
+    return it != para.kwargs.end() && it->second == "1";
+}
+
+// Whether to write the .xtc2.idx offset index beside each data file (kwarg
+// xtcIndex=0 turns it off)
+static bool xtcIndex(const Parameters& para)
+{
+    auto it = para.kwargs.find("xtcIndex");
+    return it == para.kwargs.end() || it->second != "0";
+}
+
 static unsigned nextPowerOf2(unsigned n)
 {
     unsigned count = 0;
@@ -82,37 +98,44 @@ int64_t latency(const TimeStamp& time)
 }
 
 
-void Pebble::create(unsigned nL1Buffers, size_t l1BufSize, unsigned nTrBuffers, size_t trBufSize)
+void Pebble::create(unsigned nL1Buffers, size_t l1BufSize, unsigned nTrBuffers, size_t trBufSize,
+                    Placement& placement)
 {
     size_t algnSz = 16;                    // For cache boundaries
     m_bufferSize  = algnSz * ((l1BufSize + algnSz - 1) / algnSz);
 
-    size_t pgSz   = sysconf(_SC_PAGESIZE); // For shmem/MMU
+    // Rounded up to the page size, which may be a hugepage, for shmem/MMU
     m_size        = nL1Buffers*m_bufferSize + nTrBuffers*trBufSize;
-    m_size        = pgSz * ((m_size + pgSz - 1) / pgSz);
-    m_buffer      = nullptr;
-    int    ret    = posix_memalign((void**)&m_buffer, pgSz, m_size);
-    if (ret) {
-        logging::critical("Pebble creation of size %zu failed: %s\n", m_size, strerror(ret));
+    m_buffer      = static_cast<uint8_t*>(placement.allocate(m_size));
+    if (!m_buffer) {
+        logging::critical("Pebble creation of size %zu failed: %m\n", m_size);
         throw "Pebble creation failed";
     }
 }
 
 MemPool::MemPool(Parameters& para) :
+    m_placement(para),
     m_transitionBuffers(nextPowerOf2(Pds::Eb::TEB_TR_BUFFERS)), // See eb.hh
     m_dmaAllocs(0),
     m_dmaFrees(0),
     m_allocs(0),
     m_frees(0)
 {
-    m_fd = open(para.device.c_str(), O_RDWR);
-    if (m_fd < 0) {
-        logging::critical("Error opening %s: %s", para.device.c_str(), strerror(errno));
-        throw "Error opening kcu1500!!";
-    }
-
     uint32_t dmaCount;
-    dmaBuffers = dmaMapDma(m_fd, &dmaCount, &m_dmaSize);
+    if (para.device == "emu") {
+        // No card: the detectors' register accesses go nowhere
+        m_emulator = std::make_unique<DmaEmulator>(para);
+        m_fd = open("/dev/null", O_RDWR);
+        dmaBuffers = m_emulator->mapDma(&dmaCount, &m_dmaSize);
+    } else {
+        m_fd = open(para.device.c_str(), O_RDWR);
+        if (m_fd < 0) {
+            logging::critical("Error opening %s: %s", para.device.c_str(), strerror(errno));
+            throw "Error opening kcu1500!!";
+        }
+
+        dmaBuffers = dmaMapDma(m_fd, &dmaCount, &m_dmaSize);
+    }
     if (dmaBuffers == NULL ) {
         logging::critical("Failed to map dma buffers: %s", strerror(errno));
         abort();
@@ -131,6 +154,10 @@ MemPool::MemPool(Parameters& para) :
     size_t maxL1ASize = para.kwargs.find("pebbleBufSize") == para.kwargs.end() // Allow overriding the Pebble size
                       ? __builtin_popcount(para.laneMask) * m_dmaSize
                       : std::stoul(para.kwargs["pebbleBufSize"]);
+    // Recording straight from the pebble needs block aligned buffers with
+    // room to pad the datagrams out to a whole number of blocks
+    if (recordUring(para))
+        maxL1ASize = UringFileWriter::slotSize(maxL1ASize);
     m_nbuffers        = para.kwargs.find("pebbleBufCount") == para.kwargs.end() // Allow overriding the Pebble count
                       ? m_nDmaBuffers
                       : std::stoul(para.kwargs["pebbleBufCount"]);
@@ -140,7 +167,7 @@ MemPool::MemPool(Parameters& para) :
       abort();
     }
     auto nTrBuffers = m_transitionBuffers.size();
-    pebble.create(m_nbuffers, maxL1ASize, nTrBuffers, para.maxTrSize);
+    pebble.create(m_nbuffers, maxL1ASize, nTrBuffers, para.maxTrSize, m_placement);
     logging::info("nL1Buffers %u,  pebble buffer size %zu", m_nbuffers, pebble.bufferSize());
     logging::info("nTrBuffers %u,  transition buffer size %zu", nTrBuffers, para.maxTrSize);
 
@@ -188,7 +215,8 @@ unsigned MemPool::allocate()
 
 void MemPool::freeDma(std::vector<uint32_t>& indices, unsigned count)
 {
-    dmaRetIndexes(m_fd, count, indices.data());
+    if (m_emulator)  m_emulator->retIndexes(count, indices.data());
+    else             dmaRetIndexes(m_fd, count, indices.data());
 
     m_dmaFrees.fetch_add(count, std::memory_order_acq_rel);
 }
@@ -245,7 +273,7 @@ int MemPool::setMaskBytes(uint8_t laneMask, unsigned virtChan)
                 dmaAddMaskBytes(mask, dest);
             }
         }
-        if (dmaSetMaskBytes(m_fd, mask)) {
+        if (m_emulator ? m_emulator->setMaskBytes(mask) : dmaSetMaskBytes(m_fd, mask)) {
             retval = 1; // error
         } else {
             m_setMaskBytesDone = true;
@@ -254,6 +282,8 @@ int MemPool::setMaskBytes(uint8_t laneMask, unsigned virtChan)
     return retval;
 }
 
+static std::atomic<uint64_t> s_pgpReaderSerial(0);
+
 PgpReader::PgpReader(const Parameters& para, MemPool& pool, unsigned maxRetCnt, unsigned dmaFreeCnt) :
     m_para        (para),
     m_pool        (pool),
@@ -264,7 +294,7 @@ PgpReader::PgpReader(const Parameters& para, MemPool& pool, unsigned maxRetCnt,
     dmaErrors     (maxRetCnt),
     m_lastComplete(0),
     m_lastTid     (XtcData::TransitionId::Reset),
-    m_dmaIndices  (dmaFreeCnt),
+    m_dmaIndices  (pool.nDmaBuffers()),
     m_count       (0),
     m_dmaBytes    (0),
     m_dmaSize     (0),
@@ -275,20 +305,39 @@ PgpReader::PgpReader(const Parameters& para, MemPool& pool, unsigned maxRetCnt,
     m_nMissingRoGs(0),
     m_nTmgHdrError(0),
     m_nPgpJumps   (0),
-    m_nNoTrDgrams (0)
+    m_nNoTrDgrams (0),
+    m_serial      (++s_pgpReaderSerial),
+    m_nRetRings   (0),
+    m_dmaFreeCnt  (dmaFreeCnt),
+    m_dmaRetBatch (0),
+    m_dmaRetLatency(0)
 {
+    for (auto& ring : m_retRings)  ring.store(nullptr, std::memory_order_relaxed);
+
     pool.resetCounters();
 }
 
+PgpReader::~PgpReader()
+{
+    for (auto& ring : m_retRings)  delete ring.load(std::memory_order_acquire);
+}
+
 int32_t PgpReader::read()
 {
+  _returnDma();
+
+  if (m_pool.emulator())
+    return m_pool.emulator()->readBulkIndex(dmaRet.size(), dmaRet.data(), dmaIndex.data(), dmaFlags.data(), dmaErrors.data(), dest.data());
   return dmaReadBulkIndex(m_pool.fd(), dmaRet.size(), dmaRet.data(), dmaIndex.data(), dmaFlags.data(), dmaErrors.data(), dest.data());
 }
 
 void PgpReader::flush()
 {
   int32_t ret = read();
-  if (ret > 0)  dmaRetIndexes(m_pool.fd(), ret, dmaIndex.data());
+  if (ret > 0) {
+    if (m_pool.emulator())  m_pool.emulator()->retIndexes(ret, dmaIndex.data());
+    else                    dmaRetIndexes(m_pool.fd(), ret, dmaIndex.data());
+  }
 }
 
 const Pds::TimingHeader* PgpReader::handle(Detector* det, unsigned current)
@@ -454,33 +503,81 @@ const Pds::TimingHeader* PgpReader::handle(Detector* det, unsigned current)
     return timingHeader;
 }
 
+PgpReader::DmaRetRing& PgpReader::_retRing()
+{
+    // Each thread keeps the ring it was given by the PgpReader it last freed to
+    static thread_local uint64_t    serial = 0;
+    static thread_local DmaRetRing* ring   = nullptr;
+
+    if (serial != m_serial) {
+        unsigned n = m_nRetRings.fetch_add(1, std::memory_order_relaxed);
+        if (n >= MaxRetRings) {
+            logging::critical("More than %u threads free DMA buffers", MaxRetRings);
+            abort();
+        }
+        unsigned capacity = 1;
+        while (capacity < m_pool.nDmaBuffers())  capacity <<= 1;
+        ring   = new DmaRetRing(capacity);
+        serial = m_serial;
+        m_retRings[n].store(ring, std::memory_order_release);
+    }
+    return *ring;
+}
+
+// Called by the reader only, so that the driver sees one dmaRetIndexes() for
+// everything freed since the last call, no matter which threads freed it
+void PgpReader::_returnDma()
+{
+    unsigned nRings = std::min(m_nRetRings.load(std::memory_order_acquire), MaxRetRings);
+    for (unsigned i = 0; i < nRings; i++) {
+        DmaRetRing* ring = m_retRings[i].load(std::memory_order_acquire);
+        if (!ring)  continue;           // Not published yet
+        uint64_t tail = ring->tail.load(std::memory_order_relaxed);
+        uint64_t head = ring->head.load(std::memory_order_acquire);
+        for (; tail != head; ++tail) {
+            const auto& entry = ring->entries[tail & ring->mask];
+            if (m_count == 0 || entry.t < m_tOldest)  m_tOldest = entry.t;
+            m_dmaIndices[m_count++] = entry.index;
+        }
+        ring->tail.store(tail, std::memory_order_release);
+    }
+
+    if (m_count >= m_dmaFreeCnt) {
+        // Return buffers.  An index could be reused as soon as dmaRetIndexes() completes
+        m_pool.freeDma(m_dmaIndices, m_count);
+        auto now = Pds::fast_monotonic_clock::now(CLOCK_MONOTONIC);
+        m_dmaRetBatch   = m_count;
+        m_dmaRetLatency = std::chrono::duration_cast<std::chrono::microseconds>(now - m_tOldest).count();
+        m_count = 0;
+    }
+}
+
 void PgpReader::freeDma(PGPEvent* event)
 {
-    // DMA buffers must be freeable from multiple threads
-    std::lock_guard<std::mutex> lock(m_lock);
+    // DMA buffers are freed from multiple threads, each into a ring of its
+    // own, and are returned to the driver by the reader thread in read()
+    DmaRetRing& ring = _retRing();
+    auto t = Pds::fast_monotonic_clock::now(CLOCK_MONOTONIC);
 
-    // Return buffers and reset event.  Careful with order here!
+    // Reset event before the reader can see the index.  Careful with order here!
     // index could be reused as soon as dmaRetIndexes() completes
+    uint64_t head = ring.head.load(std::memory_order_relaxed);
     for (int i=0; i<PGP_MAX_LANES; i++) {
         if (event->mask &  (1 << i)) {
             event->mask ^= (1 << i);    // Zero out mask before dmaRetIndexes()
-            m_dmaIndices[m_count++] = event->buffers[i].index;
-            if (m_count == m_dmaIndices.size()) {
-                // Return buffers.  An index could be reused as soon as dmaRetIndexes() completes
-                m_pool.freeDma(m_dmaIndices, m_count);
-                m_count = 0;
-            }
+            ring.entries[head++ & ring.mask] = {event->buffers[i].index, t};
         }
     }
+    ring.head.store(head, std::memory_order_release);
 }
 
-std::string Drp::FileParameters::runName()
+std::string Drp::FileParameters::runName(unsigned chunkId)
 {
     std::ostringstream ss;
     ss << m_experimentName <<
           "-r" << std::setfill('0') << std::setw(4) << m_runNumber <<
           "-s" << std::setw(3) << m_nodeId <<
-          "-c" << std::setw(3) << m_chunkId;
+          "-c" << std::setw(3) << chunkId;
     return ss.str();
 }
 
@@ -494,12 +591,18 @@ EbReceiver::EbReceiver(Parameters& para, Pds::Eb::TebCtrbParams& tPrms,
   m_mon(mon),
   m_fileWriter(std::max(pool.pebble.bufferSize(), para.maxTrSize), DIRECT_IO),
   m_smdWriter(std::max(pool.pebble.bufferSize(), para.maxTrSize)),
+  m_idxWriter(0x100000),
+  m_xtcIndex(xtcIndex(para)),
   m_writing(false),
   m_inprocSend(inprocSend),
+  m_lastPid(0),
   m_offset(0),
   m_chunkOffset(0),
   m_chunkRequest(false),
   m_chunkPending(false),
+  m_rolloverPid(0),
+  m_rolloverNames(nullptr),
+  m_chunkInfoBuffer(0x1000),
   m_configureBuffer(para.maxTrSize),
   m_damage(0),
   m_evtSize(0),
@@ -523,6 +626,33 @@ EbReceiver::EbReceiver(Parameters& para, Pds::Eb::TebCtrbParams& tPrms,
     exporter->add("DRP_bufPendBlk",   labels, Pds::MetricType::Gauge,   [&](){ return m_fileWriter.pendBlocked(); });
     exporter->add("DRP_evtSize",      labels, Pds::MetricType::Gauge,   [&](){ return m_evtSize; });
     exporter->add("DRP_evtLatency",   labels, Pds::MetricType::Gauge,   [&](){ return m_latency; });
+
+    if (recordUring(para)) {
+        if (UringFileWriter::available()) {
+            m_uringWriter = std::make_unique<UringFileWriter>(std::max(pool.bufferSize(), para.maxTrSize),
+                                                              sizeof(Pds::PulseId), pool.nbuffers(),
+                                                              [&pool]() { pool.freePebble(); });
+            m_uringWriter->registerRegion(pool.pebble[0], pool.pebble.size());
+            logging::info("Recording with io_uring from the pebble");
+
+            exporter->add("DRP_recordInFlight", labels, Pds::MetricType::Gauge,   [&](){ return m_uringWriter->inFlight(); });
+            exporter->add("DRP_recordDirect",   labels, Pds::MetricType::Counter, [&](){ return m_uringWriter->nDirect(); });
+            exporter->add("DRP_recordBounced",  labels, Pds::MetricType::Counter, [&](){ return m_uringWriter->nBounced(); });
+        } else {
+            logging::warning("io_uring is not available: recording with copies");
+        }
+    }
+}
+
+int EbReceiver::_openData(const std::string& fileName)
+{
+    return m_uringWriter ? m_uringWriter->open(fileName) : m_fileWriter.open(fileName);
+}
+
+void EbReceiver::_closeData()
+{
+    if (m_uringWriter)  m_uringWriter->close();
+    else                m_fileWriter.close();
 }
 
 std::string EbReceiver::openFiles(const Parameters& para, const RunInfo& runInfo, std::string hostname, unsigned nodeId)
@@ -548,13 +678,21 @@ std::string EbReceiver::openFiles(const Parameters& para, const RunInfo& runInfo
         // and this print statement may speed up debugging significantly.
         std::cout << "Opening file " << absolute_path << std::endl;
         logging::info("Opening file '%s'", absolute_path.c_str());
-        if (m_fileWriter.open(absolute_path) == 0) {
+        if (_openData(absolute_path) == 0) {
             timespec tt; clock_gettime(CLOCK_REALTIME,&tt);
             json msg = createFileReportMsg(path, absolute_path, tt, tt, runInfo.runNumber, hostname);
             m_inprocSend.send(msg.dump());
         } else if (retVal.empty()) {
             retVal = {"Failed to open file '" + absolute_path + "'"};
         }
+        // offset index of the data file
+        if (m_xtcIndex) {
+            std::string index_path = XtcData::XtcIndex::sidecarName(absolute_path);
+            logging::info("Opening file '%s'", index_path.c_str());
+            if (m_idxWriter.open(index_path) != 0 && retVal.empty()) {
+                retVal = {"Failed to open file '" + index_path + "'"};
+            }
+        }
         // smalldata
         std::string smalldataDir = {para.outputDir + "/" + para.instrument + "/" + runInfo.experimentName + "/xtc/smalldata"};
         local_mkdir(smalldataDir.c_str());
@@ -583,7 +721,8 @@ bool EbReceiver::advanceChunkId()
 {
     bool status = false;
 //  m_chunkPending_sem.take();
-    if (!m_chunkPending) {
+    // Not while a chunk prepared by prepareChunk() is waiting to start
+    if (!m_chunkPending && !m_rolloverPid.load(std::memory_order_acquire)) {
         logging::debug("%s: m_fileParameters.advanceChunkId()", __PRETTY_FUNCTION__);
         m_fileParameters.advanceChunkId();
         logging::debug("%s: m_chunkPending = true  chunkId = %u", __PRETTY_FUNCTION__, m_fileParameters.chunkId());
@@ -612,8 +751,9 @@ std::string EbReceiver::reopenFiles()
     m_chunkOffset = m_offset;
 
     // close data file (for old chunk)
-    logging::debug("%s: calling m_fileWriter.close()...", __PRETTY_FUNCTION__);
-    m_fileWriter.close();
+    logging::debug("%s: calling _closeData()...", __PRETTY_FUNCTION__);
+    _closeData();
+    if (m_xtcIndex)  m_idxWriter.close();
 
     // open data file (for new chunk)
     std::string runName = m_fileParameters.runName();
@@ -628,7 +768,7 @@ std::string EbReceiver::reopenFiles()
     // and this print statement may speed up debugging significantly.
     std::cout << "Opening file " << absolute_path << std::endl;
     logging::info("%s: Opening file '%s'", __PRETTY_FUNCTION__, absolute_path.c_str());
-    if (m_fileWriter.open(absolute_path) == 0) {
+    if (_openData(absolute_path) == 0) {
         timespec tt; clock_gettime(CLOCK_REALTIME,&tt);
         json msg = createFileReportMsg(path, absolute_path, tt, tt, runNumber, hostname);
         m_inprocSend.send(msg.dump());
@@ -637,19 +777,123 @@ std::string EbReceiver::reopenFiles()
     } else if (retVal.empty()) {
         retVal = {"Failed to open file '" + absolute_path + "'"};
     }
+    if (m_xtcIndex) {
+        std::string index_path = XtcData::XtcIndex::sidecarName(absolute_path);
+        logging::info("%s: Opening file '%s'", __PRETTY_FUNCTION__, index_path.c_str());
+        if (m_idxWriter.open(index_path) != 0 && retVal.empty()) {
+            retVal = {"Failed to open file '" + index_path + "'"};
+        }
+    }
 
     return retVal;
 }
 
+// Opens the next chunk's files ahead of the first event at or after pulseId,
+// where process() switches to them without waiting on the filesystem.  This
+// runs on the collection thread: the chunk's state is handed to the
+// EbReceiver thread by the store to m_rolloverPid, and only that thread
+// advances the chunkId, in _rollover().  The EbReceiver thread may also end
+// the run meanwhile: m_chunkLock keeps closeFiles() from closing the files
+// while the next ones are opened, and from missing those it must drop
+std::string EbReceiver::prepareChunk(uint64_t pulseId, XtcData::NamesLookup& namesLookup)
+{
+    std::lock_guard<std::mutex> lock(m_chunkLock);
+    if (!m_writing)  return std::string{};
+    if (m_rolloverPid.load(std::memory_order_acquire) || m_chunkPending) {
+        return std::string("A new chunk is already pending");
+    }
+    uint64_t lastPid = m_lastPid.load();
+    if (lastPid >= pulseId) {
+        char msg[128];
+        snprintf(msg, sizeof(msg), "Chunk start pulseId %014lx has already passed (at %014lx)", pulseId, lastPid);
+        return std::string(msg);
+    }
+
+    std::string outputDir = m_fileParameters.outputDir();
+    std::string instrument = m_fileParameters.instrument();
+    std::string experimentName = m_fileParameters.experimentName();
+    std::string runName = m_fileParameters.runName(m_fileParameters.chunkId() + 1);
+    std::string path = {"/" + instrument + "/" + experimentName + "/xtc/" + runName + ".xtc2"};
+    std::string absolute_path = {outputDir + path};
+    std::string index_path = XtcData::XtcIndex::sidecarName(absolute_path);
+    logging::info("Opening file '%s' for the chunk starting at pulseId %014lx", absolute_path.c_str(), pulseId);
+    int rc = m_uringWriter ? m_uringWriter->prepare(absolute_path) : m_fileWriter.prepare(absolute_path);
+    if (rc != 0 || (m_xtcIndex && m_idxWriter.prepare(index_path) != 0)) {
+        m_chunkRequest = false;         // Leave it to the next request
+        return std::string("Failed to open file '" + absolute_path + "' or its index");
+    }
+
+    m_rolloverPath = path;
+    m_rolloverNames = &namesLookup;
+    m_rolloverPid.store(pulseId);
+
+    // The EbReceiver may have gone past pulseId while the files were opened.
+    // If so, it didn't see the store above at that event, so take the chunk
+    // back unless it has already claimed it.  The sequentially consistent
+    // stores and loads of m_lastPid and m_rolloverPid make sure that one of
+    // the two threads sees the other's store.
+    lastPid = m_lastPid.load();
+    uint64_t expected = pulseId;
+    if (lastPid >= pulseId && m_rolloverPid.compare_exchange_strong(expected, 0)) {
+        unlink(absolute_path.c_str());
+        if (m_xtcIndex)  unlink(index_path.c_str());
+        char msg[128];
+        snprintf(msg, sizeof(msg), "Chunk start pulseId %014lx has already passed (at %014lx)", pulseId, lastPid);
+        return std::string(msg);
+    }
+    return std::string{};
+}
+
+// Marks the end of the chunk with a SlowUpdate just before the event that
+// starts the next, carrying the next one's chunkinfo to the smalldata as well,
+// and continues in the files prepareChunk() opened
+void EbReceiver::_rollover(const Pds::EbDgram* dgram)
+{
+    XtcData::TimeStamp time;
+    time.from_ns(dgram->time.to_ns() - 1);
+    XtcData::Transition tr(dgram->type(), XtcData::TransitionId::SlowUpdate, time, dgram->readoutGroups());
+    XtcData::Xtc xtc(XtcData::TypeId(XtcData::TypeId::Parent, 0), dgram->xtc.src);
+    auto record = new(m_chunkInfoBuffer.data()) XtcData::Dgram(tr, xtc);
+    const void* bufEnd = m_chunkInfoBuffer.data() + m_chunkInfoBuffer.size();
+    m_fileParameters.advanceChunkId();
+    ChunkInfo chunkInfo;
+    chunkInfo.filename = {m_fileParameters.runName() + ".xtc2"};
+    chunkInfo.chunkId = m_fileParameters.chunkId();
+    DrpBase::chunkInfoData(record->xtc, bufEnd, *m_rolloverNames, chunkInfo);
+    _writeDgram(record);
+
+    logging::info("Switching to file '%s' at pulseId %014lx", chunkInfo.filename.c_str(), dgram->pulseId());
+    if (m_uringWriter)  m_uringWriter->rollover();
+    else                m_fileWriter.rollover();
+    if (m_xtcIndex)     m_idxWriter.rollover();
+    m_chunkOffset = m_offset;
+    m_chunkRequest = false;
+    m_rolloverPid.store(0, std::memory_order_release);
+
+    std::string absolute_path = {m_fileParameters.outputDir() + m_rolloverPath};
+    timespec tt; clock_gettime(CLOCK_REALTIME,&tt);
+    json msg = createFileReportMsg(m_rolloverPath, absolute_path, tt, tt,
+                                   m_fileParameters.runNumber(), m_fileParameters.hostname());
+    m_inprocSend.send(msg.dump());
+}
+
 std::string EbReceiver::closeFiles()
 {
+    std::lock_guard<std::mutex> lock(m_chunkLock);
     logging::debug("%s: m_writing is %s", __PRETTY_FUNCTION__, m_writing ? "true" : "false");
     if (m_writing) {
         m_writing = false;
         logging::debug("calling m_smdWriter.close()...");
         m_smdWriter.close();
-        logging::debug("calling m_fileWriter.close()...");
-        m_fileWriter.close();
+        logging::debug("calling _closeData()...");
+        _closeData();
+        if (m_xtcIndex)  m_idxWriter.close();
+        if (m_rolloverPid.exchange(0)) {
+            // The run ended before the next chunk began: drop its empty files
+            std::string absolute_path = {m_fileParameters.outputDir() + m_rolloverPath};
+            unlink(absolute_path.c_str());
+            if (m_xtcIndex)  unlink(XtcData::XtcIndex::sidecarName(absolute_path).c_str());
+        }
     }
     return std::string{};
 }
@@ -693,10 +937,16 @@ void EbReceiver::resetCounters(bool all = false)
     m_latency = 0;
 }
 
-void EbReceiver::_writeDgram(XtcData::Dgram* dgram)
+void EbReceiver::_writeDgram(XtcData::Dgram* dgram, uint8_t* slot)
 {
+    if (m_uringWriter) {
+        // The datagram as written, with its padding, is what the index and
+        // smalldata describe
+        dgram = m_uringWriter->writeEvent(dgram, slot, m_pool.bufferSize());
+    }
     size_t size = sizeof(*dgram) + dgram->xtc.sizeofPayload();
-    m_fileWriter.writeEvent(dgram, size, dgram->time);
+    if (!m_uringWriter)  m_fileWriter.writeEvent(dgram, size, dgram->time);
+    if (m_xtcIndex)  m_idxWriter.add(*dgram, chunkSize());
 
     // small data writing
     Smd smd;
@@ -751,12 +1001,12 @@ void EbReceiver::process(const Pds::Eb::ResultDgram& result, unsigned index)
 
     if (error) {
         logging::critical("idx     %8u, pid     %014lx, tid     %s, env     %08x", index, pulseId, XtcData::TransitionId::name(transitionId), dgram->env);
-        logging::critical("lastIdx %8u, lastPid %014lx, lastTid %s, lastEnv %08x", m_lastIndex, m_lastPid, XtcData::TransitionId::name(m_lastTid));
+        logging::critical("lastIdx %8u, lastPid %014lx, lastTid %s, lastEnv %08x", m_lastIndex, m_lastPid.load(), XtcData::TransitionId::name(m_lastTid));
         abort();
     }
 
     m_lastIndex = index;
-    m_lastPid = pulseId;
+    m_lastPid.store(pulseId);           // Before m_rolloverPid is looked at, see prepareChunk()
     m_lastTid = transitionId;
 
     // Transfer Result damage to the datagram
@@ -809,7 +1059,7 @@ void EbReceiver::process(const Pds::Eb::ResultDgram& result, unsigned index)
             // request chunking opportunity
             chunkRequestSet();
             logging::debug("%s: sending chunk request (chunkSize() > DefaultChunkThresh)", __PRETTY_FUNCTION__);
-            json msg = createChunkRequestMsg();
+            json msg = createChunkRequestMsg(pulseId);
             m_inprocSend.send(msg.dump());
         }
     }
@@ -817,10 +1067,23 @@ void EbReceiver::process(const Pds::Eb::ResultDgram& result, unsigned index)
     // To write/monitor event, require the primary readout group to have triggered
     // Events for which the primary RoG didn't trigger are counted as bypass events
     if (dgram->readoutGroups() & (1 << m_partition)) {
+        m_evtSize = sizeof(*dgram) + dgram->xtc.sizeofPayload();
+
         if (m_writing) {                    // Won't ever be true for Configure
+            if (transitionId == XtcData::TransitionId::L1Accept) {
+                // Start the next chunk at the pulseId the collection chose for every DRP,
+                // unless prepareChunk() has taken it back because this DRP had passed it
+                uint64_t rolloverPid = m_rolloverPid.load();
+                if (rolloverPid && (pulseId >= rolloverPid) &&
+                    m_rolloverPid.compare_exchange_strong(rolloverPid, RolloverBusy)) {
+                    _rollover(dgram);
+                }
+            }
+
             // write event to file if it passes event builder or if it's a transition
             if (result.persist() || result.prescale()) {
-                _writeDgram(dgram);
+                // L1Accepts may be recorded from their pebble buffer
+                _writeDgram(dgram, dgram->isEvent() ? m_pool.pebble[index] : nullptr);
             }
             else if (transitionId != XtcData::TransitionId::L1Accept) {
                 if (transitionId == XtcData::TransitionId::BeginRun) {
@@ -838,8 +1101,6 @@ void EbReceiver::process(const Pds::Eb::ResultDgram& result, unsigned index)
             }
         }
 
-        m_evtSize = sizeof(*dgram) + dgram->xtc.sizeofPayload();
-
         // Measure latency before sending dgram for monitoring
         if (!dgram->isEvent() || (dgram->pulseId() - m_latPid > 13000000/14)) {
             m_latency = Drp::latency(dgram->time);
@@ -886,8 +1147,9 @@ void EbReceiver::process(const Pds::Eb::ResultDgram& result, unsigned index)
         m_pool.freeTr(dgram);
     }
 
-    // Free the pebble datagram buffer
-    m_pool.freePebble();
+    // Free the pebble datagram buffer, once it has been recorded
+    if (m_uringWriter)  m_uringWriter->release();
+    else                m_pool.freePebble();
 }
 
 
@@ -953,7 +1215,7 @@ DrpBase::DrpBase(Parameters& para, ZmqContext& context) :
     m_tPrms.detSegment = para.detSegment;
     m_tPrms.maxEntries = Pds::Eb::MAX_ENTRIES; // Batching is always enabled; set to 1 to disable
     m_tPrms.core[0]    = -1;
-    m_tPrms.core[1]    = -1;
+    m_tPrms.core[1]    = pool.placement().cpu(Placement::EbReceiver);
     m_tPrms.verbose    = para.verbose;
     m_tPrms.kwargs     = para.kwargs;
     m_tebContributor = std::make_unique<Pds::Eb::TebContributor>(m_tPrms, pool.nbuffers(), m_exporter);
@@ -1176,6 +1438,22 @@ void DrpBase::chunkInfoData(Xtc& xtc, const void* bufEnd, NamesLookup& namesLook
     chunkinfo.set_value(ChunkInfoDef::CHUNKID, chunkInfo.chunkId);
 }
 
+// Handles the collection's chunkRollover message for the apps, which pass
+// their reply() so that a failure is reported with an async warning
+void DrpBase::chunkRollover(const json& msg, Detector* det,
+                            const std::function<void(const json&)>& reply)
+{
+    if (!det)  return;
+    uint64_t pulseId = msg["body"]["pulseId"];
+    logging::debug("%s: pulseId %014lx", __PRETTY_FUNCTION__, pulseId);
+    std::string errorMsg = m_ebRecv->prepareChunk(pulseId, det->namesLookup());
+    if (!errorMsg.empty()) {
+        logging::warning(("chunkRollover: " + errorMsg).c_str());
+        json warning = createAsyncWarnMsg(m_para.alias, errorMsg);
+        reply(warning);
+    }
+}
+
 std::string DrpBase::endrun(const json& phase1Info)
 {
     return std::string{};
@@ -1483,10 +1761,11 @@ static json createPulseIdMsg(uint64_t pulseId)
     return msg;
 }
 
-static json createChunkRequestMsg()
+static json createChunkRequestMsg(uint64_t pulseId)
 {
     json msg, body;
     msg["key"] = "chunkRequest";
+    body["pulseId"] = pulseId;
     msg["body"] = body;
     return msg;
 }
@@ -2,6 +2,7 @@
 
 #include "drp.hh"
 #include "FileWriter.hh"
+#include "UringFileWriter.hh"
 #include "Detector.hh"
 #include "psdaq/trigger/TriggerPrimitive.hh"
 #include "psdaq/trigger/utilities.hh"
@@ -14,6 +15,12 @@
 #include "psdaq/service/MetricExporter.hh"
 #include "xtcdata/xtc/NamesLookup.hh"
 #include "xtcdata/xtc/TransitionId.hh"
+#include "psdaq/service/fast_monotonic_clock.hh"
+
+#include <array>
+#include <atomic>
+#include <functional>
+#include <mutex>
 
 namespace Pds {
     class TimingHeader;
@@ -77,7 +84,8 @@ public:
     std::string hostname()          { return m_hostname; }
     unsigned nodeId()               { return m_nodeId; }
     unsigned chunkId()              { return m_chunkId; }
-    std::string runName();
+    std::string runName()           { return runName(m_chunkId); }
+    std::string runName(unsigned chunkId);
 };
 
 int64_t latency(const XtcData::TimeStamp&);
@@ -97,6 +105,7 @@ public:
     bool advanceChunkId();
     std::string reopenFiles();
     std::string closeFiles();
+    std::string prepareChunk(uint64_t pulseId, XtcData::NamesLookup& namesLookup);
     uint64_t chunkSize();
     bool chunkPending();
     void chunkRequestSet();
@@ -105,24 +114,36 @@ public:
     static const uint64_t DefaultChunkThresh = 500ull * 1024ull * 1024ull * 1024ull;    // 500 GB
     FileParameters *fileParameters()    { return &m_fileParameters; }
 private:
-    void _writeDgram(XtcData::Dgram* dgram);
+    void _writeDgram(XtcData::Dgram* dgram, uint8_t* slot = nullptr);
+    int  _openData(const std::string& fileName);
+    void _closeData();
+    void _rollover(const Pds::EbDgram* dgram);
 private:
     MemPool& m_pool;
     Detector* m_det;
     unsigned m_tsId;
     Pds::Eb::MebContributor& m_mon;
     BufferedFileWriterMT m_fileWriter;
+    std::unique_ptr<UringFileWriter> m_uringWriter; // Records from the pebble when set
     SmdWriter m_smdWriter;
-    bool m_writing;
+    IndexWriter m_idxWriter;
+    bool m_xtcIndex;                        // Whether m_idxWriter is used
+    std::atomic<bool> m_writing;
     ZmqSocket& m_inprocSend;
     uint32_t m_lastIndex;
     uint32_t m_lastEvtCounter;
-    uint64_t m_lastPid;
+    std::atomic<uint64_t> m_lastPid;        // Read by prepareChunk()
     XtcData::TransitionId::Value m_lastTid;
     uint64_t m_offset;
     uint64_t m_chunkOffset;
-    bool m_chunkRequest;
-    bool m_chunkPending;
+    std::atomic<bool> m_chunkRequest;
+    std::atomic<bool> m_chunkPending;
+    std::atomic<uint64_t> m_rolloverPid;    // The chunk prepared starts here, when not 0
+    static const uint64_t RolloverBusy = ~0ull; // m_rolloverPid while process() switches to it
+    std::mutex m_chunkLock;                 // Keeps prepareChunk() and closeFiles() apart
+    std::string m_rolloverPath;
+    XtcData::NamesLookup* m_rolloverNames;
+    std::vector<uint8_t> m_chunkInfoBuffer;
     std::vector<uint8_t> m_configureBuffer;
     uint64_t m_damage;
     uint64_t m_evtSize;
@@ -139,7 +160,7 @@ class PgpReader
 {
 public:
     PgpReader(const Parameters& para, MemPool& pool, unsigned maxRetCnt, unsigned dmaFreeCnt);
-    virtual ~PgpReader() {};
+    virtual ~PgpReader();
     int32_t read();
     void flush();
     const Pds::TimingHeader* handle(Detector* det, unsigned current);
@@ -155,6 +176,32 @@ public:
     const uint64_t nTmgHdrError() const { return m_nTmgHdrError; }
     const uint64_t nPgpJumps()    const { return m_nPgpJumps; }
     const uint64_t nNoTrDgrams()  const { return m_nNoTrDgrams; }
+    const uint64_t dmaRetBatch()  const { return m_dmaRetBatch; }
+    const int64_t  dmaRetLatency() const { return m_dmaRetLatency; }
+private:
+    // The indices of the DMA buffers freed by one thread, which only the
+    // reader takes out to return them to the driver.  It is sized for all
+    // the DMA buffers, so it can't fill.
+    struct DmaRetRing
+    {
+        struct Entry
+        {
+            uint32_t index;
+            Pds::fast_monotonic_clock::time_point t; // When the buffer was freed
+        };
+        DmaRetRing(unsigned capacity) : entries(capacity), mask(capacity - 1), head(0), tail(0) {}
+        std::vector<Entry> entries;
+        uint64_t mask;
+        // Padded apart rather than aligned, since new doesn't align to 64 in C++14
+        char _pad0[64];
+        std::atomic<uint64_t> head;     // Written by the freeing thread
+        char _pad1[64 - sizeof(std::atomic<uint64_t>)];
+        std::atomic<uint64_t> tail;     // Written by the reader
+        char _pad2[64 - sizeof(std::atomic<uint64_t>)];
+    };
+    static constexpr unsigned MaxRetRings = 8;
+    DmaRetRing& _retRing();
+    void _returnDma();
 protected:
     const Parameters& m_para;
     MemPool& m_pool;
@@ -178,7 +225,14 @@ protected:
     uint64_t m_nTmgHdrError;
     uint64_t m_nPgpJumps;
     uint64_t m_nNoTrDgrams;
-    std::mutex m_lock;
+private:
+    uint64_t m_serial;                  // Tells the rings of one PgpReader from the next's
+    std::array<std::atomic<DmaRetRing*>, MaxRetRings> m_retRings;
+    std::atomic<unsigned> m_nRetRings;
+    unsigned m_dmaFreeCnt;
+    Pds::fast_monotonic_clock::time_point m_tOldest;
+    uint64_t m_dmaRetBatch;
+    int64_t m_dmaRetLatency;
 };
 
 class PV;
@@ -194,12 +248,14 @@ public:
     std::string beginrun(const nlohmann::json& phase1Info, RunInfo& runInfo);
     std::string endrun(const nlohmann::json& phase1Info);
     std::string enable(const nlohmann::json& phase1Info, bool& chunkRequest, ChunkInfo& chunkInfo);
+    void chunkRollover(const nlohmann::json& msg, Detector* det,
+                       const std::function<void(const nlohmann::json&)>& reply);
     void unconfigure();
     void disconnect();
     void runInfoSupport  (XtcData::Xtc& xtc, const void* bufEnd, XtcData::NamesLookup& namesLookup);
     void runInfoData     (XtcData::Xtc& xtc, const void* bufEnd, XtcData::NamesLookup& namesLookup, const RunInfo& runInfo);
     void chunkInfoSupport(XtcData::Xtc& xtc, const void* bufEnd, XtcData::NamesLookup& namesLookup);
-    void chunkInfoData   (XtcData::Xtc& xtc, const void* bufEnd, XtcData::NamesLookup& namesLookup, const ChunkInfo& chunkInfo);
+    static void chunkInfoData(XtcData::Xtc& xtc, const void* bufEnd, XtcData::NamesLookup& namesLookup, const ChunkInfo& chunkInfo);
     Pds::Eb::TebContributor& tebContributor() {return *m_tebContributor;}
     EbReceiver& ebReceiver() {return *m_ebRecv;}
     Pds::Trg::TriggerPrimitive* triggerPrimitive() const {return m_triggerPrimitive;}
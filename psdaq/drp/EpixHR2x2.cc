@@ -174,7 +174,7 @@ unsigned EpixHR2x2::_configure(XtcData::Xtc& xtc, const void* bufEnd, XtcData::C
         for(unsigned i=0; i< names.num(); i++) {
             XtcData::Name& name = names.get(i);
             if (strcmp(name.name(),"user.asic_enable")==0)
-                m_asics = descdata.get_value<uint32_t>(name.name());
+                m_asics = descdata.get_value<uint32_t>(i);
         }
     }
 
@@ -30,8 +30,39 @@ static inline ssize_t _write(int fd, const void* buffer, size_t count)
 }
 
 
+int openLocked(const std::string& fileName, bool dio)
+{
+    struct flock flk;
+    flk.l_type   = F_WRLCK;
+    flk.l_whence = SEEK_SET;
+    flk.l_start  = 0;
+    flk.l_len    = 0;
+
+    auto oFlags = O_WRONLY | O_CREAT | O_TRUNC;
+    if (dio)  oFlags |= O_DIRECT;
+    int fd = ::open(fileName.c_str(), oFlags, S_IRUSR | S_IRGRP);
+    if (fd == -1) {
+        // %m will be replaced by the string strerror(errno)
+        logging::error("Error creating file %s: %m", fileName.c_str());
+        return -1;
+    }
+    // establish write lock on the file
+    int rc;
+    do {
+        rc = fcntl(fd, F_SETLKW, &flk);
+    } while (rc<0 && errno==EINTR);
+    if (rc<0) {
+        // %m will be replaced by the string strerror(errno)
+        logging::error("Error locking file %s: %m", fileName.c_str());
+        ::close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+
 BufferedFileWriter::BufferedFileWriter(size_t bufferSize) :
-    m_count(0), m_batch_starttime(0,0), m_buffer(bufferSize), m_writing(0)
+    m_nextFd(0), m_count(0), m_batch_starttime(0,0), m_buffer(bufferSize), m_writing(0)
 {
 }
 
@@ -45,31 +76,23 @@ BufferedFileWriter::~BufferedFileWriter()
 
 int BufferedFileWriter::open(const std::string& fileName)
 {
-    int rv = -1;
-    struct flock flk;
-    flk.l_type   = F_WRLCK;
-    flk.l_whence = SEEK_SET;
-    flk.l_start  = 0;
-    flk.l_len    = 0;
+    m_fd = openLocked(fileName, false);
+    return m_fd == -1 ? -1 : 0;
+}
 
-    m_fd = ::open(fileName.c_str(), O_WRONLY | O_CREAT | O_TRUNC, S_IRUSR | S_IRGRP);
-    if (m_fd == -1) {
-        // %m will be replaced by the string strerror(errno)
-        logging::error("Error creating file %s: %m", fileName.c_str());
-    } else {
-        // establish write lock on the file
-        int rc;
-        do {
-            rc = fcntl(m_fd, F_SETLKW, &flk);
-        } while (rc<0 && errno==EINTR);
-        if (rc<0) {
-            // %m will be replaced by the string strerror(errno)
-            logging::error("Error locking file %s: %m", fileName.c_str());
-        } else {
-            rv = 0;     // return OK
-        }
-    }
-    return rv;
+int BufferedFileWriter::prepare(const std::string& fileName)
+{
+    if (m_nextFd > 0)  ::close(m_nextFd);   // Prepared before but not rolled over to
+    m_nextFd = openLocked(fileName, false);
+    return m_nextFd == -1 ? -1 : 0;
+}
+
+void BufferedFileWriter::rollover()
+{
+    int fd = m_nextFd;
+    m_nextFd = 0;
+    close();
+    m_fd = fd;
 }
 
 int BufferedFileWriter::close()
@@ -87,6 +110,10 @@ int BufferedFileWriter::close()
     } else {
         logging::warning("No file to close (m_fd=%d)", m_fd);
     }
+    if (m_nextFd > 0) {                 // Prepared but not rolled over to
+        ::close(m_nextFd);
+        m_nextFd = 0;
+    }
     if (rv == -1) {
         // %m will be replaced by the string strerror(errno)
         logging::error("Error closing fd %d: %m", m_fd);
@@ -140,6 +167,7 @@ static size_t roundUpSize(size_t bufSize, size_t quantum)
 
 BufferedFileWriterMT::BufferedFileWriterMT(size_t bufferSize) :
     m_fd(0),
+    m_nextFd(0),
     m_batch_starttime(0,0),
     m_free(FIFO_DEPTH),
     m_pend(FIFO_DEPTH),
@@ -157,6 +185,7 @@ BufferedFileWriterMT::BufferedFileWriterMT(size_t bufferSize) :
 
 BufferedFileWriterMT::BufferedFileWriterMT(size_t bufferSize, bool dio) :
     m_fd(0),
+    m_nextFd(0),
     m_batch_starttime(0,0),
     m_free(dio ? FIFO_DEPTH_DIO : FIFO_DEPTH),
     m_pend(dio ? FIFO_DEPTH_DIO : FIFO_DEPTH),
@@ -188,6 +217,8 @@ void BufferedFileWriterMT::_initialize(size_t bufferSize)
 {
     Buffer b;
     b.count = 0;
+    b.fd    = 0;
+    b.last  = false;
     if (m_dio)  bufferSize = roundUpSize(FIFO_MIN_SIZE, bufferSize); // N buffers >= FIFO_MIN_SIZE
     m_bufferSize = roundUpSize(bufferSize, sysconf(_SC_PAGESIZE));   // N pages
     for (unsigned i=0; i<m_free.size(); i++) {
@@ -201,33 +232,32 @@ void BufferedFileWriterMT::_initialize(size_t bufferSize)
 
 int BufferedFileWriterMT::open(const std::string& fileName)
 {
-    int rv = -1;
-    struct flock flk;
-    flk.l_type   = F_WRLCK;
-    flk.l_whence = SEEK_SET;
-    flk.l_start  = 0;
-    flk.l_len    = 0;
+    m_fd = openLocked(fileName, m_dio);
+    return m_fd == -1 ? -1 : 0;
+}
 
-    auto oFlags = O_WRONLY | O_CREAT | O_TRUNC;
-    if (m_dio)  oFlags |= O_DIRECT;
-    m_fd = ::open(fileName.c_str(), oFlags, S_IRUSR | S_IRGRP);
-    if (m_fd == -1) {
-        // %m will be replaced by the string strerror(errno)
-        logging::error("Error creating file %s: %m", fileName.c_str());
-    } else {
-        // establish write lock on the file
-        int rc;
-        do {
-            rc = fcntl(m_fd, F_SETLKW, &flk);
-        } while (rc<0 && errno==EINTR);
-        if (rc<0) {
-            // %m will be replaced by the string strerror(errno)
-            logging::error("Error locking file %s: %m", fileName.c_str());
-        } else {
-            rv = 0;     // return OK
-        }
-    }
-    return rv;
+int BufferedFileWriterMT::prepare(const std::string& fileName)
+{
+    if (m_nextFd > 0)  ::close(m_nextFd);   // Prepared before but not rolled over to
+    m_nextFd = openLocked(fileName, m_dio);
+    return m_nextFd == -1 ? -1 : 0;
+}
+
+void BufferedFileWriterMT::rollover()
+{
+    ++m_freeBlocked;
+    m_free.pend();
+    --m_freeBlocked;
+    Buffer b = m_free.front();
+    m_free.pop(b);
+    b.fd   = m_fd;
+    b.last = true;
+    logging::debug("Rolling over from fd %d with %zu bytes to fd %d", m_fd, b.count, m_nextFd);
+    m_pend.push(b);
+    m_depth = m_free.count();
+    m_batch_starttime = XtcData::TimeStamp(0,0);
+    m_fd = m_nextFd;
+    m_nextFd = 0;
 }
 
 int BufferedFileWriterMT::close()
@@ -240,6 +270,10 @@ int BufferedFileWriterMT::close()
     } else {
         logging::warning("No file to close (m_fd=%d)", m_fd);
     }
+    if (m_nextFd > 0) {                 // Prepared but not rolled over to
+        ::close(m_nextFd);
+        m_nextFd = 0;
+    }
     if (rv == -1) {
         // %m will be replaced by the string strerror(errno)
         logging::error("Error closing fd %d: %m", m_fd);
@@ -255,6 +289,7 @@ void BufferedFileWriterMT::flush()
         Buffer b;
         m_free.pop(b);
         logging::debug("Flushing %zu bytes to fd %d", b.count, m_fd);
+        b.fd = m_fd;
         m_pend.push(b);
         m_depth = m_free.count();
         m_batch_starttime = XtcData::TimeStamp(0,0);
@@ -284,6 +319,7 @@ void BufferedFileWriterMT::writeEvent(const void* data, size_t size, XtcData::Ti
     if ((size > (m_bufferSize - m_free.front().count)) || age_seconds>2) {
         Buffer b = m_free.front();
         m_free.pop(b);
+        b.fd = m_fd;
         m_pend.push(b);
         m_depth = m_free.count();
         // reset these to prepare for the new batch
@@ -318,12 +354,20 @@ void BufferedFileWriterMT::run()
         }
         Buffer& b = m_pend.front();
         ++m_writing;
-        if (_write(m_fd, b.p, b.count) == -1) {
+        if (_write(b.fd, b.p, b.count) == -1) {
             throw "File writing failed";
         }
         --m_writing;
+        if (b.last) {
+            logging::debug("Closing fd %d", b.fd);
+            if (::close(b.fd) == -1) {
+                // %m will be replaced by the string strerror(errno)
+                logging::error("Error closing fd %d: %m", b.fd);
+            }
+        }
         m_pend.pop(b);
         b.count = 0;
+        b.last  = false;
         m_free.push(b);
         m_depth = m_free.count();
     }
@@ -399,4 +443,31 @@ void SmdWriter::addNames(XtcData::Xtc& parent, const void* bufEnd, unsigned node
     namesLookup[namesId] = XtcData::NameIndex(offsetNames);
 }
 
+IndexWriter::IndexWriter(size_t bufferSize) : BufferedFileWriter(bufferSize)
+{
+}
+
+int IndexWriter::open(const std::string& fileName)
+{
+    int rv = BufferedFileWriter::open(fileName);
+    if (rv == 0) {
+        XtcData::XtcIndex::Header header;
+        writeEvent(&header, sizeof(header), XtcData::TimeStamp(0,0));
+    }
+    return rv;
+}
+
+void IndexWriter::rollover()
+{
+    BufferedFileWriter::rollover();
+    XtcData::XtcIndex::Header header;
+    writeEvent(&header, sizeof(header), XtcData::TimeStamp(0,0));
+}
+
+void IndexWriter::add(const XtcData::Dgram& dgram, uint64_t offset)
+{
+    XtcData::XtcIndex::Entry entry(dgram, offset);
+    writeEvent(&entry, sizeof(entry), dgram.time);
+}
+
 }
@@ -9,9 +9,13 @@
 #include "xtcdata/xtc/VarDef.hh"
 #include "xtcdata/xtc/DescData.hh"
 #include "xtcdata/xtc/TimeStamp.hh"
+#include "xtcdata/xtc/XtcIndex.hh"
 
 namespace Drp {
 
+// Creates a file for writing and locks it, returning its fd or -1
+int openLocked(const std::string& fileName, bool dio);
+
 class BufferedFileWriter
 {
 public:
@@ -19,10 +23,15 @@ public:
     ~BufferedFileWriter();
     int open(const std::string& fileName);
     int close();
+    // Opens the file that rollover() switches to, ahead of time
+    int prepare(const std::string& fileName);
+    // Writes out and closes the current file and continues in the prepared one
+    void rollover();
     void writeEvent(const void* data, size_t size, XtcData::TimeStamp ts);
     const uint64_t writing() const { return m_writing; }
 private:
     int m_fd;
+    int m_nextFd;
     size_t m_count;
     XtcData::TimeStamp m_batch_starttime;
     std::vector<uint8_t> m_buffer;
@@ -37,6 +46,11 @@ public:
     ~BufferedFileWriterMT();
     int open(const std::string& fileName);
     int close();
+    // Opens the file that rollover() switches to, ahead of time
+    int prepare(const std::string& fileName);
+    // Continues in the prepared file, leaving the writing thread to finish
+    // writing and close the current one
+    void rollover();
     void flush();
     void writeEvent(const void* data, size_t size, XtcData::TimeStamp ts);
     void run();
@@ -50,11 +64,14 @@ private:
 private:
     size_t m_bufferSize;
     int m_fd;
+    int m_nextFd;
     XtcData::TimeStamp m_batch_starttime;
     class Buffer {
     public:
         uint8_t* p;
         size_t   count;
+        int      fd;                    // The file it goes to
+        bool     last;                  // Close the file after writing it
     };
     Pds::FifoW<Buffer> m_free;
     Pds::FifoW<Buffer> m_pend;
@@ -111,4 +128,14 @@ public:
     XtcData::NamesLookup namesLookup;
 };
 
+// Writes the sidecar index (see XtcData::XtcIndex) of a data file
+class IndexWriter : public BufferedFileWriter
+{
+public:
+    IndexWriter(size_t bufferSize);
+    int open(const std::string& fileName);
+    void rollover();
+    void add(const XtcData::Dgram& dgram, uint64_t offset);
+};
+
 }
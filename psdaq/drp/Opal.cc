@@ -667,7 +667,7 @@ unsigned OpalTTSimL2::configure(XtcData::Xtc& xtc, const void* bufEnd, XtcData::
     FIND_CONFIG(m_timiter,m_timinput);
 
 #define DUMP_NAMES(input)                                               \
-    for(std::unordered_map<unsigned,NameIndex>::iterator it=input.namesLookup.begin(); \
+    for(NamesLookup::iterator it=input.namesLookup.begin();                  \
         it!=input.namesLookup.end(); it++) {                            \
         printf("namesid 0x%x\n",it->first);                             \
         Names& names = it->second.names();                              \
@@ -589,10 +589,10 @@ void OpalTTFex::_monitor_ref_sig (std::vector<double>& ref)
 */
 void read_roi(Roi& roi, DescData& descdata, const char* name, unsigned columns, unsigned rows)
 {
-  roi.x0 = descdata.get_value<unsigned>((std::string(name)+=".x0").c_str());
-  roi.y0 = descdata.get_value<unsigned>((std::string(name)+=".y0").c_str());
-  roi.x1 = descdata.get_value<unsigned>((std::string(name)+=".x1").c_str());
-  roi.y1 = descdata.get_value<unsigned>((std::string(name)+=".y1").c_str());
+  roi.x0 = descdata.get_value<unsigned>(name, ".x0");
+  roi.y0 = descdata.get_value<unsigned>(name, ".y0");
+  roi.x1 = descdata.get_value<unsigned>(name, ".x1");
+  roi.y1 = descdata.get_value<unsigned>(name, ".y1");
 
   std::string msg;
 
@@ -1,5 +1,6 @@
 #include <iostream>
 #include <atomic>
+#include <deque>
 #include <limits.h>
 #include <fcntl.h>
 #include <sys/msg.h>
@@ -30,6 +31,14 @@ using namespace Drp;
 using namespace Pds;
 using namespace Pds::Ipc;
 
+// The batch rings are indexed with a mask, but pebbleBufCount may be any value
+static unsigned batchRingSize(unsigned nbuffers)
+{
+    unsigned size = 1;
+    while (size < nbuffers)  size <<= 1;
+    return size;
+}
+
 bool checkPulseIds(const Detector* det, PGPEvent* event)
 {
     uint64_t pulseId = 0;
@@ -93,13 +102,53 @@ static int drpSendReceive(int inpMqId, int resMqId, XtcData::TransitionId::Value
     return rc;
 }
 
+static int drpRingSend(DrpRing* drpRing, unsigned slot, const XtcData::Dgram* dg,
+                       XtcData::TransitionId::Value transitionId, unsigned threadNum)
+{
+    DrpRingMsg msg;
+    if (transitionId == XtcData::TransitionId::Unconfigure) {
+        logging::debug("[Thread %u] Unconfigure transition. Send stop message to Drp Python", threadNum);
+        msg.type = 's';
+    } else {
+        msg.type = 'g';
+    }
+    msg.slot = slot;
+    msg.size = sizeof(*dg) + dg->xtc.sizeofPayload();
+    msg.reserved = 0;
+
+    int rc = drpRing->send(msg);
+    if (rc) {
+        logging::error("[Thread %u] Error sending message %c to Drp python: %m", threadNum, msg.type);
+    }
+    return rc;
+}
+
+static int drpRingReceive(DrpRing* drpRing, unsigned slot, unsigned threadNum)
+{
+    DrpRingMsg msg;
+    int rc = drpRing->recv(msg, 15000);
+    if (rc) {
+        logging::error("[Thread %u] Response message from Drp python not received: %m", threadNum);
+        return rc;    // Return rather than abort so that teardown can happen
+    }
+    if (msg.slot != slot) {
+        logging::error("[Thread %u] Drp python answered for slot %u instead of %u", threadNum, msg.slot, slot);
+        return -1;
+    }
+    return 0;
+}
+
 
 void workerFunc(const Parameters& para, DrpBase& drp, Detector* det,
-                SPSCQueue<Batch>& inputQueue, SPSCQueue<Batch>& outputQueue, bool pythonDrp,
-                int inpMqId, int resMqId, int inpShmId, int resShmId, size_t shmemSize,
-                unsigned threadNum, std::atomic<int>& threadCountPush, std::atomic<int>& threadCountWrite,
+                SPSCQueue<Batch>& inputQueue, SPSCQueue<Batch>& outputQueue,
+                MPMCQueue<Batch>* sharedInputQueue, MPMCQueue<Batch>* sharedOutputQueue,
+                WorkerStats& stats, bool pythonDrp,
+                int inpMqId, int resMqId, int inpShmId, int resShmId, DrpRing* drpRing,
+                size_t shmemSize, unsigned threadNum, std::atomic<int>& threadCountPush, std::atomic<int>& threadCountWrite,
                 int64_t& pythonTime)
 {
+    drp.pool.placement().pin(Placement::Worker, threadNum);
+
     Batch batch;
     MemPool& pool = drp.pool;
     const unsigned bufferMask = pool.nDmaBuffers() - 1;
@@ -111,6 +160,65 @@ void workerFunc(const Parameters& para, DrpBase& drp, Detector* det,
     bool transition;
     bool error = false;
 
+    // With the rings the shared memory is divided into slots and up to
+    // nSlots L1Accepts are left in flight in Drp Python, to be finished in
+    // order as its results come back.  Otherwise each dgram goes through
+    // the message queues and the start of the shared memory.
+    struct InFlight
+    {
+        Pds::EbDgram* dgram;
+        unsigned      pebbleIndex;
+        unsigned      slot;
+        fast_monotonic_clock::time_point t0;
+    };
+    std::deque<InFlight> inFlight;
+    const unsigned nSlots   = drpRing ? drpRing->nSlots()   : 1;
+    const size_t   slotSize = drpRing ? drpRing->slotSize() : shmemSize;
+    auto inpSlot = [&](unsigned slot) { return (char*)inpData + slot * slotSize; };
+    auto resSlot = [&](unsigned slot) { return (char*)resData + slot * slotSize; };
+
+    // Prepare the trigger primitive with whatever input is needed for the TEB to make trigger decisions
+    auto l1Trigger = [&](Pds::EbDgram* dgram, unsigned pebbleIndex) {
+        auto l3InpBuf = tebContributor.fetch(pebbleIndex);
+        Pds::EbDgram* l3InpDg = new(l3InpBuf) Pds::EbDgram(*dgram);
+
+        if (triggerPrimitive) { // else this DRP doesn't provide input
+            const void* l3BufEnd = (char*)l3InpDg + sizeof(*l3InpDg) + triggerPrimitive->size();
+            triggerPrimitive->event(pool, pebbleIndex, dgram->xtc, l3InpDg->xtc, l3BufEnd);
+        }
+    };
+
+    // Waits for the oldest L1Accept in flight and finishes it
+    auto pyComplete = [&]() {
+        const InFlight& ev = inFlight.front();
+        if (!error && drpRingReceive(drpRing, ev.slot, threadNum))  error = true;
+        auto t1{fast_monotonic_clock::now(CLOCK_MONOTONIC)};
+        pythonTime = std::chrono::duration_cast<ns_t>(t1 - ev.t0).count();
+        if (!error) {
+            XtcData::Dgram* resDg = (XtcData::Dgram*)resSlot(ev.slot);
+            memcpy((void*)ev.dgram, (void*)resDg, sizeof(*resDg) + resDg->xtc.sizeofPayload());
+        }
+        l1Trigger(ev.dgram, ev.pebbleIndex);
+        inFlight.pop_front();
+    };
+
+    // Passes a dgram to Drp Python after the L1Accepts in flight and
+    // returns the result, which is left in the result shared memory
+    auto pySendReceive = [&](XtcData::Dgram* inpDg, XtcData::TransitionId::Value transitionId) {
+        while (!inFlight.empty())  pyComplete();
+        int rc;
+        if (drpRing) {
+            memcpy(inpSlot(0), (void*)inpDg, sizeof(*inpDg) + inpDg->xtc.sizeofPayload());
+            rc = drpRingSend(drpRing, 0, inpDg, transitionId, threadNum);
+            if (!rc)  rc = drpRingReceive(drpRing, 0, threadNum);
+        } else {
+            memcpy(inpData, (void*)inpDg, sizeof(*inpDg) + inpDg->xtc.sizeofPayload());
+            rc = drpSendReceive(inpMqId, resMqId, transitionId, threadNum);
+        }
+        if (rc)  error = true;
+        return (XtcData::Dgram*)resSlot(0);
+    };
+
     if (pythonDrp) {
 
         std::string keyBase = "p" + std::to_string(para.partition) + "_" + para.detName + "_" + std::to_string(para.detSegment);
@@ -154,12 +262,14 @@ void workerFunc(const Parameters& para, DrpBase& drp, Detector* det,
 
     pythonTime = 0ll;
 
+    WorkerInput input(inputQueue, sharedInputQueue, para.nworkers, threadNum, stats.steals);
     while (true) {
 
-        if (!inputQueue.pop(batch)) {
+        if (!input.pop(batch)) {
             break;
         }
 
+        auto tBatch = fast_monotonic_clock::now(CLOCK_MONOTONIC);
         transition=false;
 
         for (unsigned i=0; i<batch.size; i++) {
@@ -187,26 +297,26 @@ void workerFunc(const Parameters& para, DrpBase& drp, Detector* det,
                 const void* bufEnd = (char*)dgram + pool.bufferSize();
                 det->event(*dgram, bufEnd, event);
 
-                if ( pythonDrp) {
+                if (pythonDrp && drpRing) {
+                    if (inFlight.size() == nSlots)  pyComplete();
+                    unsigned slot = inFlight.empty() ? 0 : (inFlight.back().slot + 1) % nSlots;
+                    memcpy(inpSlot(slot), (void*)dgram, sizeof(*dgram) + dgram->xtc.sizeofPayload());
+                    auto t0{fast_monotonic_clock::now(CLOCK_MONOTONIC)};
+                    if (!drpRingSend(drpRing, slot, dgram, transitionId, threadNum)) {
+                        inFlight.push_back({dgram, pebbleIndex, slot, t0});
+                        continue;       // Finished by pyComplete()
+                    }
+                    error = true;
+                } else if (pythonDrp) {
                     XtcData::Dgram* inpDg = dgram;
-                    memcpy(inpData, (void*)inpDg, sizeof(*inpDg) + inpDg->xtc.sizeofPayload());
                     auto t0{fast_monotonic_clock::now(CLOCK_MONOTONIC)};
-                    auto rc = drpSendReceive(inpMqId, resMqId, transitionId, threadNum);
+                    XtcData::Dgram* resDg = pySendReceive(inpDg, transitionId);
                     auto t1{fast_monotonic_clock::now(CLOCK_MONOTONIC)};
                     pythonTime = std::chrono::duration_cast<ns_t>(t1 - t0).count();
-                    if (rc)  error = true;
-                    XtcData::Dgram* resDg = (XtcData::Dgram*)resData;
-                    memcpy((void*)inpDg, resData, sizeof(*resDg) + resDg->xtc.sizeofPayload());
+                    memcpy((void*)inpDg, (void*)resDg, sizeof(*resDg) + resDg->xtc.sizeofPayload());
                 }
 
-                // Prepare the trigger primitive with whatever input is needed for the TEB to make trigger decisions
-                auto l3InpBuf = tebContributor.fetch(pebbleIndex);
-                Pds::EbDgram* l3InpDg = new(l3InpBuf) Pds::EbDgram(*dgram);
-
-                if (triggerPrimitive) { // else this DRP doesn't provide input
-                    const void* l3BufEnd = (char*)l3InpDg + sizeof(*l3InpDg) + triggerPrimitive->size();
-                    triggerPrimitive->event(pool, pebbleIndex, dgram->xtc, l3InpDg->xtc, l3BufEnd);
-                }
+                l1Trigger(dgram, pebbleIndex);
             // slow data
             } else if (transitionId == XtcData::TransitionId::SlowUpdate) {
                 // make new dgram in the pebble
@@ -227,11 +337,8 @@ void workerFunc(const Parameters& para, DrpBase& drp, Detector* det,
 
                 if (pythonDrp) {
                     XtcData::Dgram* inpDg = trDgram;
-                    memcpy(inpData, (void*)inpDg, sizeof(*inpDg) + inpDg->xtc.sizeofPayload());
-                    auto rc = drpSendReceive(inpMqId, resMqId, transitionId, threadNum);
-                    if (rc)  error = true;
-                    XtcData::Dgram* resDg = (XtcData::Dgram*)(resData);
-                    memcpy((void*)inpDg, resData, sizeof(*resDg) + resDg->xtc.sizeofPayload());
+                    XtcData::Dgram* resDg = pySendReceive(inpDg, transitionId);
+                    memcpy((void*)inpDg, (void*)resDg, sizeof(*resDg) + resDg->xtc.sizeofPayload());
                 }
 
                 // Prepare the trigger primitive with whatever input is needed for the TEB to meke trigger decisions
@@ -243,18 +350,18 @@ void workerFunc(const Parameters& para, DrpBase& drp, Detector* det,
                 Pds::EbDgram* trDgram = pool.transitionDgrams[pebbleIndex];
                 if (pythonDrp) {
                     XtcData::Dgram* inpDg = trDgram;
-                    memcpy(inpData, (void*)inpDg, sizeof(*inpDg) + inpDg->xtc.sizeofPayload());
-                    auto rc = drpSendReceive(inpMqId, resMqId, transitionId, threadNum);
-                    if (rc)  error = true;
+                    XtcData::Dgram* resDg = pySendReceive(inpDg, transitionId);
                     // TODO: Add comment explaining how this works
                     if (!error && threadCountWrite.fetch_sub(1) == 1) {
-                        XtcData::Dgram* resDg = (XtcData::Dgram*)(resData);
-                        memcpy((void*)inpDg, resData, sizeof(*resDg) + resDg->xtc.sizeofPayload());
+                        memcpy((void*)inpDg, (void*)resDg, sizeof(*resDg) + resDg->xtc.sizeofPayload());
                     }
                 }
             }
         }
 
+        while (!inFlight.empty())  pyComplete();
+
+        bool copy = false;
         if (pythonDrp) {
             // TODO: Comment
             // All but the last worker to get here set the batch size to 0.
@@ -262,10 +369,21 @@ void workerFunc(const Parameters& para, DrpBase& drp, Detector* det,
             // other than advancing to the next worker.
             if (transition && threadCountPush.fetch_sub(1) != 1) {
                 batch.size = 0;
+                copy = true;
             }
         }
 
-        if (!error)  outputQueue.push(batch);
+        auto tDone = fast_monotonic_clock::now(CLOCK_MONOTONIC);
+        stats.busyTime.fetch_add(std::chrono::duration_cast<ns_t>(tDone - tBatch).count(),
+                                 std::memory_order_relaxed);
+
+        if (sharedOutputQueue) {
+            // The reorder buffer expects each batch exactly once, so the
+            // copies of a broadcast are dropped and a failed batch is passed
+            // on empty rather than left out
+            if (error)  batch.size = 0;
+            if (!copy)  sharedOutputQueue->push(batch);
+        } else if (!error)  outputQueue.push(batch);
     }
 
     if (pythonDrp) {
@@ -292,8 +410,11 @@ void workerFunc(const Parameters& para, DrpBase& drp, Detector* det,
 
 PGPDetector::PGPDetector(const Parameters& para, DrpBase& drp, Detector* det,
                          bool pythonDrp, int* inpMqId, int* resMqId, int* inpShmId, int* resShmId,
-                         size_t shmemSize) :
-    PgpReader(para, drp.pool, MAX_RET_CNT_C, para.batchSize), m_terminate(false),
+                         DrpRing** drpRings, size_t shmemSize) :
+    PgpReader(para, drp.pool, MAX_RET_CNT_C, para.batchSize),
+    m_workerStats(para.nworkers),
+    m_batchSeq(0),
+    m_terminate(false),
     m_flushTmo(1.1 * drp.tebPrms().maxEntries * 14/13),
     m_shmemSize(shmemSize),
     m_pyAppTime(0),
@@ -312,6 +433,12 @@ PGPDetector::PGPDetector(const Parameters& para, DrpBase& drp, Detector* det,
         abort();
     }
 
+    // Don't hold partial batches for longer than the batch latency budget
+    unsigned budget = drp.tebContributor().batchController().budget();
+    if (budget && budget < m_flushTmo) {
+        m_flushTmo = budget;
+    }
+
     if (pythonDrp) {
         auto kwargs_it = para.kwargs.find("pythonScript");
 
@@ -334,6 +461,15 @@ PGPDetector::PGPDetector(const Parameters& para, DrpBase& drp, Detector* det,
         m_workerOutputQueues.emplace_back(SPSCQueue<Batch>(drp.pool.nbuffers()));
     }
 
+    // Idle workers take the next batch instead of waiting for their turn,
+    // so that one slow batch doesn't hold up the batches queued behind it
+    auto kwargs_it = para.kwargs.find("workStealing");
+    if (kwargs_it != para.kwargs.end() && kwargs_it->second == "yes") {
+        logging::info("Workers steal batches from a shared queue");
+        m_sharedInputQueue  = std::make_unique<MPMCQueue<Batch> >(batchRingSize(drp.pool.nbuffers()));
+        m_sharedOutputQueue = std::make_unique<MPMCQueue<Batch> >(batchRingSize(drp.pool.nbuffers()));
+    }
+
     for (unsigned i = 0; i < para.nworkers; i++) {
         m_workerThreads.emplace_back(workerFunc,
                                      std::ref(para),
@@ -341,11 +477,15 @@ PGPDetector::PGPDetector(const Parameters& para, DrpBase& drp, Detector* det,
                                      det,
                                      std::ref(m_workerInputQueues[i]),
                                      std::ref(m_workerOutputQueues[i]),
+                                     m_sharedInputQueue.get(),
+                                     m_sharedOutputQueue.get(),
+                                     std::ref(m_workerStats[i]),
                                      pythonDrp,
                                      m_inpMqId[i],
                                      m_resMqId[i],
                                      m_inpShmId[i],
                                      m_resShmId[i],
+                                     drpRings ? drpRings[i] : nullptr,
                                      m_shmemSize,
                                      i,
                                      std::ref(threadCountPush),
@@ -364,6 +504,7 @@ PGPDetector::~PGPDetector()
 void PGPDetector::reader(std::shared_ptr<Pds::MetricExporter> exporter, Detector* det,
                          Pds::Eb::TebContributor& tebContributor)
 {
+    m_pool.placement().pin(Placement::Reader);
 
     // setup monitoring
     uint64_t nevents = 0L;
@@ -392,6 +533,21 @@ void PGPDetector::reader(std::shared_ptr<Pds::MetricExporter> exporter, Detector
     exporter->add("drp_worker_output_queue", labels, Pds::MetricType::Gauge,
                   [&](){return queueLength(m_workerOutputQueues);});
 
+    if (m_sharedInputQueue) {
+        exporter->add("drp_worker_shared_input_queue", labels, Pds::MetricType::Gauge,
+                      [&](){return m_sharedInputQueue->guess_size();});
+        exporter->add("drp_worker_shared_output_queue", labels, Pds::MetricType::Gauge,
+                      [&](){return m_sharedOutputQueue->guess_size();});
+    }
+    for (unsigned i = 0; i < m_para.nworkers; i++) {
+        // Busy time is counted in units of 10 ms, so that its rate is in percent
+        auto& stats = m_workerStats[i];
+        exporter->add("drp_worker_busy_" + std::to_string(i), labels, Pds::MetricType::Rate,
+                      [&stats](){return stats.busyTime.load(std::memory_order_relaxed) / 10000000;});
+        exporter->add("drp_worker_steals_" + std::to_string(i), labels, Pds::MetricType::Counter,
+                      [&stats](){return stats.steals.load(std::memory_order_relaxed);});
+    }
+
     uint64_t nDmaRet = 0L;
     exporter->add("drp_num_dma_ret", labels, Pds::MetricType::Gauge,
                   [&](){return nDmaRet;});
@@ -413,6 +569,24 @@ void PGPDetector::reader(std::shared_ptr<Pds::MetricExporter> exporter, Detector
                   [&](){return nPgpJumps();});
     exporter->add("drp_num_no_tr_dgram", labels, Pds::MetricType::Gauge,
                   [&](){return nNoTrDgrams();});
+    exporter->add("drp_dma_ret_batch", labels, Pds::MetricType::Gauge,
+                  [&](){return dmaRetBatch();});
+    exporter->add("drp_dma_ret_latency", labels, Pds::MetricType::Gauge,
+                  [&](){return dmaRetLatency();});
+
+    const auto& placement = m_pool.placement();
+    exporter->add("drp_page_faults_minor", labels, Pds::MetricType::Counter,
+                  [&](){return Placement::minorFaults();});
+    exporter->add("drp_page_faults_major", labels, Pds::MetricType::Counter,
+                  [&](){return Placement::majorFaults();});
+    if (placement.numaNode() >= 0) {
+        exporter->add("drp_numa_miss", labels, Pds::MetricType::Counter,
+                      [&](){return placement.numaMiss();});
+        exporter->add("drp_numa_other_node", labels, Pds::MetricType::Counter,
+                      [&](){return placement.numaOtherNode();});
+        exporter->add("drp_pebble_remote_pages", labels, Pds::MetricType::Gauge,
+                      [&](){return placement.remotePages();});
+    }
 
     if (pythonDrp) {
         exporter->add("drp_py_app_time", labels, Pds::MetricType::Gauge,
@@ -423,6 +597,8 @@ void PGPDetector::reader(std::shared_ptr<Pds::MetricExporter> exporter, Detector
     uint64_t batchId = 0L;
     resetEventCounter();
 
+    const auto& batchCtl = tebContributor.batchController();
+
     enum TmoState { None, Started, Finished };
     TmoState tmoState(TmoState::None);
     const std::chrono::microseconds tmo(m_flushTmo);
@@ -442,8 +618,7 @@ void PGPDetector::reader(std::shared_ptr<Pds::MetricExporter> exporter, Detector
                 if (Pds::fast_monotonic_clock::now(CLOCK_MONOTONIC) - tInitial > tmo) {
                     // Time out partial DRP batches
                     if (m_batch.size != 0) {
-                        m_workerInputQueues[worker % m_para.nworkers].push(m_batch);
-                        worker++;
+                        _sendBatch(worker);
                         m_batch.start += m_batch.size;
                         m_batch.size = 0;
                         batchId += m_para.batchSize;
@@ -466,14 +641,17 @@ void PGPDetector::reader(std::shared_ptr<Pds::MetricExporter> exporter, Detector
             bool stateTransition = (transitionId != XtcData::TransitionId::L1Accept) &&
                                    (transitionId != XtcData::TransitionId::SlowUpdate);
 
+            // Also close the batch early when it holds as many events as
+            // the TEB contributor will batch within the latency budget
+            bool full = batchCtl.enabled() && batchCtl.full(m_batch.size);
+
             // send batch to worker if batch is full or if it's a transition
-            if (((batchId ^ timingHeader->pulseId()) & ~(m_para.batchSize - 1)) || stateTransition) {
+            if (((batchId ^ timingHeader->pulseId()) & ~(m_para.batchSize - 1)) || stateTransition || full) {
 
                 if ( stateTransition) {
                     if (m_batch.size > 1) {
                         m_batch.size--;
-                        m_workerInputQueues[worker % m_para.nworkers].push(m_batch);
-                        worker++;
+                        _sendBatch(worker);
                         m_batch.start += m_batch.size;
                         m_batch.size = 1;
                     }
@@ -516,13 +694,10 @@ void PGPDetector::reader(std::shared_ptr<Pds::MetricExporter> exporter, Detector
 
                     unsigned numWorkers = pythonDrp ? m_para.nworkers : 1;
 
-                    for (unsigned w=0; w < numWorkers; w++) {
-                        m_workerInputQueues[worker % m_para.nworkers].push(m_batch);
-                        worker++;
-                    }
+                    if (numWorkers == 1)  _sendBatch(worker);
+                    else                  _broadcastBatch(worker, numWorkers);
                 } else {
-                    m_workerInputQueues[worker % m_para.nworkers].push(m_batch);
-                    worker++;
+                    _sendBatch(worker);
                 }
 
                 m_batch.start = timingHeader->evtCounter + 1;
@@ -534,8 +709,78 @@ void PGPDetector::reader(std::shared_ptr<Pds::MetricExporter> exporter, Detector
     logging::info("PGPReader is exiting");
 }
 
+void PGPDetector::_sendBatch(int64_t& worker)
+{
+    m_batch.seq = m_batchSeq++;
+    if (m_sharedInputQueue)  m_sharedInputQueue->push(m_batch);
+    else                     m_workerInputQueues[worker % m_para.nworkers].push(m_batch);
+    worker++;
+}
+
+// Every worker gets a copy of the batch, all with the same sequence number
+void PGPDetector::_broadcastBatch(int64_t& worker, unsigned numWorkers)
+{
+    m_batch.seq = m_batchSeq++;
+    for (unsigned w=0; w < numWorkers; w++) {
+        m_workerInputQueues[worker % m_para.nworkers].push(m_batch);
+        worker++;
+    }
+    // Workers blocked on the shared queue need to look at their own
+    if (m_sharedInputQueue)  m_sharedInputQueue->wakeAll();
+}
+
+// Batches arrive in the order in which workers finish them and are passed
+// on in the order in which the reader sent them
+void PGPDetector::_collectInOrder(Pds::Eb::TebContributor& tebContributor)
+{
+    const unsigned bufferMask = m_pool.nDmaBuffers() - 1;
+    // no more batches than buffers can be in flight
+    const unsigned reorderSize = batchRingSize(m_pool.nbuffers());
+    std::vector<Batch> reorder(reorderSize);
+    std::vector<uint8_t> pending(reorderSize, 0);
+    const uint32_t reorderMask = reorderSize - 1;
+    uint32_t next = 0;
+    Batch batch;
+    bool rc = m_sharedOutputQueue->pop(batch);
+    while (rc) {
+        unsigned slot = batch.seq & reorderMask;
+        reorder[slot] = batch;
+        pending[slot] = 1;
+        while (pending[slot = next & reorderMask]) {
+            pending[slot] = 0;
+            const Batch& ready = reorder[slot];
+            for (unsigned i=0; i<ready.size; i++) {
+                unsigned index = (ready.start + i) & bufferMask;
+                PGPEvent* event = &m_pool.pgpEvents[index];
+                if (event->mask == 0)
+                    continue;               // Skip broken event
+                unsigned pebbleIndex = event->pebbleIndex;
+                freeDma(event);
+                tebContributor.process(pebbleIndex);
+            }
+            next++;
+        }
+
+        // Time out batches for the TEB
+        while (!m_sharedOutputQueue->try_pop(batch)) { // Poll
+            if (tebContributor.timeout()) {            // After batch is timed out
+                rc = m_sharedOutputQueue->pop(batch);  // pend
+                break;
+            }
+        }
+    }
+}
+
 void PGPDetector::collector(Pds::Eb::TebContributor& tebContributor)
 {
+    m_pool.placement().pin(Placement::Collector);
+
+    if (m_sharedOutputQueue) {
+        _collectInOrder(tebContributor);
+        logging::info("PGPCollector is exiting");
+        return;
+    }
+
     int64_t worker = 0L;
     Batch batch;
     const unsigned bufferMask = m_pool.nDmaBuffers() - 1;
@@ -581,6 +826,7 @@ void PGPDetector::shutdown()
         return;                         // Already shut down
     m_terminate.store(true, std::memory_order_release);
     logging::info("shutting down PGPReader");
+    if (m_sharedInputQueue)  m_sharedInputQueue->shutdown();
     for (unsigned i = 0; i < m_para.nworkers; i++) {
         m_workerInputQueues[i].shutdown();
         if (m_workerThreads[i].joinable()) {
@@ -591,6 +837,7 @@ void PGPDetector::shutdown()
     for (unsigned i = 0; i < m_para.nworkers; i++) {
         m_workerOutputQueues[i].shutdown();
     }
+    if (m_sharedOutputQueue)  m_sharedOutputQueue->shutdown();
 
     // Flush the DMA buffers
     flush();
@@ -3,21 +3,27 @@
 #include <vector>
 #include <thread>
 #include <atomic>
+#include <memory>
 #include "Detector.hh"
 #include "drp.hh"
 #include "spscqueue.hh"
+#include "mpmcqueue.hh"
+#include "workerinput.hh"
 
 namespace Pds {
     class MetricExporter;
     namespace Eb { class TebContributor;}
+    namespace Ipc { class DrpRing; }
 };
 
 namespace Drp {
 
-struct Batch
+// Per worker counters, exported as metrics
+struct WorkerStats
 {
-    uint32_t start;
-    uint32_t size;
+    alignas(64) std::atomic<uint64_t> busyTime; // ns spent on batches
+    std::atomic<uint64_t> steals;               // batches round-robin would have sent elsewhere
+    WorkerStats() : busyTime(0), steals(0) {}
 };
 
 class DrpBase;
@@ -26,17 +32,28 @@ class PGPDetector : public PgpReader
 {
 public:
     PGPDetector(const Parameters& para, DrpBase& drp, Detector* det, bool pythonDrp,
-                int* inpMqId, int* resMqId, int* inpShmId, int* resShmId, size_t shemeSize);
+                int* inpMqId, int* resMqId, int* inpShmId, int* resShmId,
+                Pds::Ipc::DrpRing** drpRings, size_t shemeSize);
     virtual ~PGPDetector();
     void reader(std::shared_ptr<Pds::MetricExporter> exporter, Detector* det, Pds::Eb::TebContributor& tebContributor);
     void collector(Pds::Eb::TebContributor& tebContributor);
     virtual void handleBrokenEvent(const PGPEvent& event) override;
     virtual void resetEventCounter() override;
     void shutdown();
+private:
+    void _sendBatch(int64_t& worker);
+    void _broadcastBatch(int64_t& worker, unsigned numWorkers);
+    void _collectInOrder(Pds::Eb::TebContributor& tebContributor);
 private:
     static const int MAX_RET_CNT_C = 1000;
     std::vector<SPSCQueue<Batch> > m_workerInputQueues;
     std::vector<SPSCQueue<Batch> > m_workerOutputQueues;
+    // With work stealing, batches go through shared queues instead, apart
+    // from the transitions broadcast to all Python workers
+    std::unique_ptr<MPMCQueue<Batch> > m_sharedInputQueue;
+    std::unique_ptr<MPMCQueue<Batch> > m_sharedOutputQueue;
+    std::vector<WorkerStats> m_workerStats;
+    uint32_t m_batchSeq;
     std::vector<std::thread> m_workerThreads;
     std::atomic<bool> m_terminate;
     Batch m_batch;
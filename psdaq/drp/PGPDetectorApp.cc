@@ -2,6 +2,7 @@
 #include <iomanip>
 #include <string>
 #include <future>
+#include <algorithm>
 #include <thread>
 #include <cstdio>
 #include "drp.hh"
@@ -25,6 +26,7 @@
 #include "psalg/utils/SysLog.hh"
 #include "RunInfoDef.hh"
 #include "psdaq/service/IpcUtils.hh"
+#include "DmaEmulator.hh"
 
 
 #define PY_RELEASE_GIL    PyEval_SaveThread()
@@ -118,11 +120,28 @@ static json _getscanvalues(const json& stepInfo, const char* detname, const char
 namespace Drp {
 
 static int cleanupDrpPython(std::string keyBase, int* inpMqId, int* resMqId, int* inpShmId, int* resShmId,
-                            unsigned numWorkers)
+                            int* ringShmId, DrpRing** drpRings, unsigned numWorkers)
 {
     int rcSave = 0;
     for (unsigned workerNum=0; workerNum<numWorkers; workerNum++) {
         int rc;
+        if (drpRings[workerNum]) {
+            void* data = drpRings[workerNum];
+            rc = detachDrpShMem(data, sizeof(DrpRing));
+            if (rc) {
+                logging::error("Error detaching from Rings Shared Memory for worker %d: %m", workerNum);
+                rcSave = rc;
+            }
+            drpRings[workerNum] = nullptr;
+        }
+        if (ringShmId[workerNum]) {
+            rc = cleanupDrpShmMem("/shmring_" + keyBase + "_" + std::to_string(workerNum), ringShmId[workerNum]);
+            if (rc) {
+                logging::error("Error cleaning up Rings Shared Memory for worker %d: %m", workerNum);
+                rcSave = rc;
+            }
+            ringShmId[workerNum] = 0;
+        }
         if (inpShmId[workerNum]) {
             rc = cleanupDrpShmMem("/shminp_" + keyBase + "_" + std::to_string(workerNum), inpShmId[workerNum]);
             if (rc) {
@@ -207,6 +226,21 @@ int PGPDetectorApp::setupDrpPython() {
     long pageSize = sysconf(_SC_PAGESIZE);
     m_shmemSize = (m_shmemSize + pageSize - 1) & ~(pageSize - 1);
 
+    // With pyRingSlots, the dgrams are passed through rings of messages in
+    // shared memory instead of the message queues, and the shared memory
+    // holds that many of them so that Drp Python can be kept busy
+    size_t slotSize = m_shmemSize;
+    unsigned nSlots = 0;
+    auto kwargs_it = m_para.kwargs.find("pyRingSlots");
+    if (kwargs_it != m_para.kwargs.end()) {
+        nSlots = std::stoul(kwargs_it->second);
+        if (nSlots > DrpRing::Depth / 2) {
+            logging::error("pyRingSlots must be at most %u, got %u", DrpRing::Depth / 2, nSlots);
+            return -1;
+        }
+        if (nSlots)  m_shmemSize *= nSlots;
+    }
+
     keyBase = "p" + std::to_string(m_para.partition) + "_" + m_para.detName + "_" + std::to_string(m_para.detSegment);
     std::vector<std::thread> drpPythonThreads;
 
@@ -219,13 +253,15 @@ int PGPDetectorApp::setupDrpPython() {
         std::remove(("/dev/mqueue/mqres_" + keyBase + "_" + std::to_string(workerNum)).c_str());
         std::remove(("/dev/shm/shminp_" + keyBase + "_" + std::to_string(workerNum)).c_str());
         std::remove(("/dev/shm/shmres_" + keyBase + "_" + std::to_string(workerNum)).c_str());
+        std::remove(("/dev/shm/shmring_" + keyBase + "_" + std::to_string(workerNum)).c_str());
 
         // Creating message queues
         std::string key = "/mqinp_" + keyBase + "_" + std::to_string(workerNum);
         int rc = setupDrpMsgQueue(key, mqSize, m_inpMqId[workerNum], true);
         if (rc) {
             logging::error("[Thread %u] Error in creating Drp %s message queue with key %s: %m", workerNum, "Inputs", key.c_str());
-            cleanupDrpPython(keyBase, m_inpMqId, m_resMqId, m_inpShmId, m_resShmId, m_para.nworkers);
+            cleanupDrpPython(keyBase, m_inpMqId, m_resMqId, m_inpShmId, m_resShmId,
+                             m_ringShmId, m_drpRings, m_para.nworkers);
             return rc;
         }
         logging::debug("[Thread %u] Created Drp msg queue %s for key %s", workerNum, "Inputs", key.c_str());
@@ -233,25 +269,22 @@ int PGPDetectorApp::setupDrpPython() {
         rc = setupDrpMsgQueue(key, mqSize, m_resMqId[workerNum], false);
         if (rc) {
             logging::error("[Thread %u] Error in creating Drp %s message queue with key %s: %m", workerNum, "Inputs", key.c_str());
-            cleanupDrpPython(keyBase, m_inpMqId, m_resMqId, m_inpShmId, m_resShmId, m_para.nworkers);
+            cleanupDrpPython(keyBase, m_inpMqId, m_resMqId, m_inpShmId, m_resShmId,
+                             m_ringShmId, m_drpRings, m_para.nworkers);
             return rc;
         }
         logging::debug("[Thread %u] Created Drp msg queue %s for key %s", workerNum, "Results", key.c_str());
 
         // Creating shared memory
-        size_t shmemSize = m_drp.pool.pebble.bufferSize();
-        if (m_para.maxTrSize > shmemSize) shmemSize=m_para.maxTrSize;
-
-        // Round up to an integral number of pages
-        long pageSize = sysconf(_SC_PAGESIZE);
-        shmemSize = (shmemSize + pageSize - 1) & ~(pageSize - 1);
+        size_t shmemSize = m_shmemSize;
 
         key = "/shminp_" + keyBase + "_" + std::to_string(workerNum);
         rc = setupDrpShMem(key, shmemSize, m_inpShmId[workerNum]);
         if (rc) {
             logging::error("[Thread %u] Error in creating Drp %s shared memory for key %s: %m (open step)",
                               workerNum, "Inputs", key.c_str());
-            cleanupDrpPython(keyBase, m_inpMqId, m_resMqId, m_inpShmId, m_resShmId, m_para.nworkers);
+            cleanupDrpPython(keyBase, m_inpMqId, m_resMqId, m_inpShmId, m_resShmId,
+                             m_ringShmId, m_drpRings, m_para.nworkers);
             return rc;
         }
         logging::debug("[Thread %u] Created Drp shared memory %s for key %s", workerNum, "Inputs", key.c_str());
@@ -261,11 +294,28 @@ int PGPDetectorApp::setupDrpPython() {
         if (rc) {
             logging::error("[Thread %u] Error in creating Drp %s shared memory for key %s: %m (open step)",
                               workerNum, "Results", key.c_str());
-            cleanupDrpPython(keyBase, m_inpMqId, m_resMqId, m_inpShmId, m_resShmId, m_para.nworkers);
+            cleanupDrpPython(keyBase, m_inpMqId, m_resMqId, m_inpShmId, m_resShmId,
+                             m_ringShmId, m_drpRings, m_para.nworkers);
             return rc;
         }
         logging::debug("[Thread %u] Created Drp shared memory %s for key %s", workerNum, "Results", key.c_str());
 
+        if (nSlots) {
+            key = "/shmring_" + keyBase  + "_" + std::to_string(workerNum);
+            rc = setupDrpShMem(key, sizeof(DrpRing), m_ringShmId[workerNum]);
+            void* data = nullptr;
+            if (!rc)  rc = attachDrpShMem(key, m_ringShmId[workerNum], sizeof(DrpRing), data, true);
+            if (rc) {
+                logging::error("[Thread %u] Error in creating Drp %s shared memory for key %s: %m",
+                               workerNum, "Rings", key.c_str());
+                cleanupDrpPython(keyBase, m_inpMqId, m_resMqId, m_inpShmId, m_resShmId,
+                                 m_ringShmId, m_drpRings, m_para.nworkers);
+                return rc;
+            }
+            m_drpRings[workerNum] = new(data) DrpRing(nSlots, slotSize);
+            logging::debug("[Thread %u] Created Drp shared memory %s for key %s", workerNum, "Rings", key.c_str());
+        }
+
         logging::debug("IPC set up for worker %d", workerNum);
 
         startDrpPython(m_drpPids[workerNum], workerNum, shmemSize, m_para, m_drp);
@@ -343,6 +393,8 @@ void PGPDetectorApp::initialize()
     m_resMqId = new int[m_para.nworkers]();
     m_inpShmId = new int[m_para.nworkers]();
     m_resShmId = new int[m_para.nworkers]();
+    m_ringShmId = new int[m_para.nworkers]();
+    m_drpRings = new DrpRing*[m_para.nworkers]();
     m_drpPids = new pid_t[m_para.nworkers]();
 
     keyBase = "";
@@ -374,10 +426,13 @@ PGPDetectorApp::~PGPDetectorApp()
 
     if (m_pythonDrp) {
         logging::info("Cleaning up DrpPython");
-        cleanupDrpPython(keyBase, m_inpMqId, m_resMqId, m_inpShmId, m_resShmId, m_para.nworkers);
+        cleanupDrpPython(keyBase, m_inpMqId, m_resMqId, m_inpShmId, m_resShmId,
+                             m_ringShmId, m_drpRings, m_para.nworkers);
     }
 
     if (m_drpPids)   delete [] m_drpPids;
+    if (m_drpRings)  delete [] m_drpRings;
+    if (m_ringShmId) delete [] m_ringShmId;
     if (m_resShmId)  delete [] m_resShmId;
     if (m_inpShmId)  delete [] m_inpShmId;
     if (m_resMqId)   delete [] m_resMqId;
@@ -534,7 +589,8 @@ void PGPDetectorApp::handlePhase1(const json& msg)
             bool pythonDrp = config_alias != "CALIB" ? m_pythonDrp : false;
 
             m_pgpDetector = std::make_unique<PGPDetector>(m_para, m_drp, m_det, pythonDrp, m_inpMqId,
-                                                          m_resMqId, m_inpShmId, m_resShmId, m_shmemSize);
+                                                          m_resMqId, m_inpShmId, m_resShmId, m_drpRings,
+                                                          m_shmemSize);
             m_exporter = std::make_shared<Pds::MetricExporter>();
             if (m_drp.exposer()) {
                 m_drp.exposer()->RegisterCollectable(m_exporter);
@@ -662,9 +718,26 @@ void PGPDetectorApp::handlePhase1(const json& msg)
     json answer = createMsg(key, msg["header"]["msg_id"], getId(), body);
     reply(answer);
 
+    // With the DMA emulator, there's no XPM to follow phase 1 with the transition
+    if (m_drp.pool.emulator() && body.find("err_info") == body.end()) {
+        for (unsigned tid = 0; tid < XtcData::TransitionId::NumberOf; ++tid) {
+            std::string name = XtcData::TransitionId::name(XtcData::TransitionId::Value(tid));
+            std::transform(name.begin(), name.end(), name.begin(), ::tolower);
+            if (name == key) {
+                m_drp.pool.emulator()->transition(XtcData::TransitionId::Value(tid));
+                break;
+            }
+        }
+    }
+
     logging::debug("handlePhase1 complete");
 }
 
+void PGPDetectorApp::handleChunkRollover(const json& msg)
+{
+    m_drp.chunkRollover(msg, m_det, [this](const json& warning) { reply(warning); });
+}
+
 void PGPDetectorApp::handleReset(const json& msg)
 {
     PY_ACQUIRE_GIL_GUARD(m_pysave);  // Py_END_ALLOW_THREADS
@@ -748,6 +821,12 @@ int PGPDetectorApp::resetDrpPython()
             logging::error("Error receiving reset message from Drp python worker %u: %m",
                            workerNum);
             rcSave = rc;
+            continue;
+        }
+        // Once the worker has acknowledged, it has left the script and is
+        // waiting on the message queue, so the rings are no longer in use
+        if (m_drpRings[workerNum]) {
+            m_drpRings[workerNum]->reset();
         }
     }
 
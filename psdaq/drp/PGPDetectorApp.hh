@@ -23,6 +23,7 @@ private:
     void handleConnect(const nlohmann::json& msg) override;
     void handleDisconnect(const nlohmann::json& msg) override;
     void handlePhase1(const nlohmann::json& msg) override;
+    void handleChunkRollover(const nlohmann::json& msg) override;
     int setupDrpPython();
     void unconfigure();
     void disconnect();
@@ -41,6 +42,8 @@ private:
     int* m_resMqId;
     int* m_inpShmId;
     int* m_resShmId;
+    int* m_ringShmId;
+    Pds::Ipc::DrpRing** m_drpRings;
     std::string keyBase;
     pid_t* m_drpPids;
     size_t m_shmemSize;
@@ -496,8 +496,8 @@ void Piranha4TTFex::_monitor_ref_sig (std::vector<double>& ref)
 */
 void read_roi(Roi& roi, DescData& descdata, const char* name, unsigned pixels)
 {
-  roi.x0 = descdata.get_value<unsigned>((std::string(name)+=".x0").c_str());
-  roi.x1 = descdata.get_value<unsigned>((std::string(name)+=".x1").c_str());
+  roi.x0 = descdata.get_value<unsigned>(name, ".x0");
+  roi.x1 = descdata.get_value<unsigned>(name, ".x1");
 
   std::string msg;
 
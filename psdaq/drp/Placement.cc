@@ -0,0 +1,217 @@
+#include "Placement.hh"
+#include "drp.hh"
+#include "psalg/utils/SysLog.hh"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <linux/mempolicy.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/sysmacros.h>
+#include <unistd.h>
+
+using logging = psalg::SysLog;
+
+using namespace Drp;
+
+static const char* const roleNames[] = { "Reader", "Worker", "Collector", "EbReceiver" };
+static const char* const roleKwargs[] = { "pinReader", "pinWorkers", "pinCollector", "pinEbReceiver" };
+
+static_assert(sizeof(roleNames) / sizeof(*roleNames) == Placement::NumRoles, "roleNames must match Role");
+
+// Parses cpu lists like 6-13 or 6:8:10; commas separate kwargs, so can't be used
+static std::vector<int> parseCpus(const std::string& value)
+{
+    std::vector<int> cpus;
+    std::istringstream ss(value);
+    std::string item;
+    while (getline(ss, item, ':')) {
+        auto dash = item.find('-');
+        int first = std::stoi(item.substr(0, dash));
+        int last  = dash == std::string::npos ? first : std::stoi(item.substr(dash + 1));
+        for (int cpu = first; cpu <= last; ++cpu)  cpus.push_back(cpu);
+    }
+    return cpus;
+}
+
+// The NUMA node the character device is attached to, or -1 if not known
+static int deviceNumaNode(const std::string& device)
+{
+    struct stat st;
+    if (stat(device.c_str(), &st) || !S_ISCHR(st.st_mode))  return -1;
+
+    std::ostringstream path;
+    path << "/sys/dev/char/" << major(st.st_rdev) << ":" << minor(st.st_rdev) << "/device/numa_node";
+    std::ifstream in(path.str());
+    int node = -1;
+    if (!(in >> node))  return -1;
+    return node;                        // -1 too when the platform has no NUMA
+}
+
+Placement::Placement(const Parameters& para) :
+    m_hugePageSize(0),
+    m_thp         (false),
+    m_numaNode    (-1),
+    m_cpus        (NumRoles),
+    m_remotePages (0)
+{
+    auto it = para.kwargs.find("pebbleHugePages");
+    if (it != para.kwargs.end()) {
+        if      (it->second == "2M")   m_hugePageSize = 2ul << 20;
+        else if (it->second == "1G")   m_hugePageSize = 1ul << 30;
+        else if (it->second == "thp")  m_thp = true;
+        else {
+            logging::critical("pebbleHugePages must be 2M, 1G or thp, got '%s'", it->second.c_str());
+            throw "Invalid pebbleHugePages kwarg";
+        }
+    }
+
+    it = para.kwargs.find("numaNode");
+    if (it != para.kwargs.end()) {
+        if (it->second == "device") {
+            m_numaNode = deviceNumaNode(para.device);
+            if (m_numaNode < 0) {
+                logging::warning("NUMA node of %s is not known: memory is not placed", para.device.c_str());
+            }
+        } else {
+            m_numaNode = std::stoi(it->second);
+        }
+    }
+
+    for (unsigned role = 0; role < NumRoles; ++role) {
+        it = para.kwargs.find(roleKwargs[role]);
+        if (it != para.kwargs.end())  m_cpus[role] = parseCpus(it->second);
+    }
+}
+
+void* Placement::allocate(size_t& size)
+{
+    void* buffer = MAP_FAILED;
+    if (m_hugePageSize) {
+        size_t hpSize = m_hugePageSize * ((size + m_hugePageSize - 1) / m_hugePageSize);
+        int    flags  = MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB |
+                        ((__builtin_ctzl(m_hugePageSize)) << MAP_HUGE_SHIFT);
+        buffer = mmap(nullptr, hpSize, PROT_READ | PROT_WRITE, flags, -1, 0);
+        if (buffer != MAP_FAILED) {
+            size = hpSize;
+            logging::info("Pebble of %zu bytes is on %zu MB hugepages", size, m_hugePageSize >> 20);
+        } else {
+            logging::warning("No %zu MB hugepages for the pebble (%m): using transparent hugepages",
+                             m_hugePageSize >> 20);
+        }
+    }
+    if (buffer == MAP_FAILED) {
+        size_t pgSz = sysconf(_SC_PAGESIZE);
+        size   = pgSz * ((size + pgSz - 1) / pgSz);
+        buffer = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (buffer == MAP_FAILED)  return nullptr;
+        if ((m_thp || m_hugePageSize) && madvise(buffer, size, MADV_HUGEPAGE)) {
+            logging::warning("madvise(MADV_HUGEPAGE) of the pebble failed: %m");
+        }
+    }
+
+    if (m_numaNode >= 0) {
+        // Preferred rather than bound, so running short on the node isn't fatal
+        unsigned long nodeMask[16] = {};
+        nodeMask[m_numaNode / (8 * sizeof(long))] = 1ul << (m_numaNode % (8 * sizeof(long)));
+        if (syscall(SYS_mbind, buffer, size, MPOL_PREFERRED, nodeMask, 8 * sizeof(nodeMask), 0)) {
+            logging::warning("Placing the pebble on NUMA node %d failed: %m", m_numaNode);
+        }
+    }
+
+    // Fault the pages in now, on the chosen node, rather than while taking data
+    if (m_numaNode >= 0 || m_hugePageSize || m_thp) {
+        memset(buffer, 0, size);
+        _countRemotePages(buffer, size);
+    }
+    return buffer;
+}
+
+void Placement::release(void* buffer, size_t size)
+{
+    if (buffer)  munmap(buffer, size);
+}
+
+// Samples where the pages ended up, to tell whether the placement worked
+void Placement::_countRemotePages(void* buffer, size_t size)
+{
+    if (m_numaNode < 0)  return;
+
+    const size_t pgSz   = sysconf(_SC_PAGESIZE);
+    const size_t nPages = size / pgSz;
+    const size_t nSamples = std::min(nPages, size_t(1024));
+    std::vector<void*> pages(nSamples);
+    std::vector<int>   status(nSamples);
+    for (size_t i = 0; i < nSamples; ++i) {
+        pages[i] = (char*)buffer + (i * nPages / nSamples) * pgSz;
+    }
+    if (syscall(SYS_move_pages, 0, nSamples, pages.data(), nullptr, status.data(), 0)) {
+        logging::warning("Querying the NUMA nodes of the pebble failed: %m");
+        return;
+    }
+    size_t remote = 0;
+    for (auto node : status) {
+        if (node >= 0 && node != m_numaNode)  ++remote;
+    }
+    m_remotePages = remote * nPages / nSamples;
+    if (remote) {
+        logging::warning("About %lu of %zu pebble pages are not on NUMA node %d",
+                         m_remotePages, nPages, m_numaNode);
+    }
+}
+
+int Placement::cpu(Role role, unsigned instance) const
+{
+    const auto& cpus = m_cpus[role];
+    return cpus.empty() ? -1 : cpus[instance % cpus.size()];
+}
+
+int Placement::pin(Role role, unsigned instance) const
+{
+    int core = cpu(role, instance);
+    if (core < 0)  return 0;
+
+    cpu_set_t cpuset;
+    CPU_ZERO(&cpuset);
+    CPU_SET(core, &cpuset);
+    int rc = pthread_setaffinity_np(pthread_self(), sizeof(cpuset), &cpuset);
+    if (rc) {
+        logging::error("Failed to pin %s %u to cpu %d: %s", roleNames[role], instance, core, strerror(rc));
+    } else {
+        logging::debug("Pinned %s %u to cpu %d", roleNames[role], instance, core);
+    }
+    return rc;
+}
+
+uint64_t Placement::minorFaults()
+{
+    struct rusage usage;
+    return getrusage(RUSAGE_SELF, &usage) ? 0 : usage.ru_minflt;
+}
+
+uint64_t Placement::majorFaults()
+{
+    struct rusage usage;
+    return getrusage(RUSAGE_SELF, &usage) ? 0 : usage.ru_majflt;
+}
+
+// The kernel's counters for the placement node, which count all processes
+uint64_t Placement::_numastat(const char* name) const
+{
+    if (m_numaNode < 0)  return 0;
+
+    std::ifstream in("/sys/devices/system/node/node" + std::to_string(m_numaNode) + "/numastat");
+    std::string key;
+    uint64_t    value;
+    while (in >> key >> value) {
+        if (key == name)  return value;
+    }
+    return 0;
+}
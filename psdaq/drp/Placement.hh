@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace Drp {
+
+struct Parameters;
+
+// Where the DRP puts its memory and its threads, from these kwargs:
+//   pebbleHugePages=2M|1G|thp  Back the pebble with 2 MB or 1 GB hugetlbfs
+//                              pages, which must have been reserved, or ask
+//                              for transparent hugepages.  Falls back to
+//                              transparent hugepages when no hugetlbfs pages
+//                              are available.
+//   numaNode=device|<n>        Place the pebble on the NUMA node of the PGP
+//                              card (-d) or on node n.  The memory is
+//                              faulted in at allocation so that it lands
+//                              there rather than wherever a thread first
+//                              touches it.
+//   pinReader=<cpu>, pinCollector=<cpu>, pinEbReceiver=<cpu>
+//   pinWorkers=<cpus>          Pin the threads of each role.  Workers take
+//                              the cpus of a list such as 6-13 or 6:8:10 in
+//                              turn.
+// Without them the pebble is ordinary page aligned memory and no threads are
+// pinned, as before.
+class Placement
+{
+public:
+    enum Role { Reader, Worker, Collector, EbReceiver, NumRoles };
+public:
+    Placement(const Parameters& para);
+    void*    allocate(size_t& size);
+    static void release(void* buffer, size_t size);
+    int      pin(Role role, unsigned instance = 0) const;
+    int      cpu(Role role, unsigned instance = 0) const;
+    int      numaNode() const { return m_numaNode; }
+public:
+    // Counters for the metrics
+    static uint64_t minorFaults();
+    static uint64_t majorFaults();
+    uint64_t numaMiss() const      { return _numastat("numa_miss"); }
+    uint64_t numaOtherNode() const { return _numastat("other_node"); }
+    uint64_t remotePages() const   { return m_remotePages; }
+private:
+    uint64_t _numastat(const char* name) const;
+    void     _countRemotePages(void* buffer, size_t size);
+private:
+    size_t                        m_hugePageSize;
+    bool                          m_thp;
+    int                           m_numaNode;
+    std::vector<std::vector<int>> m_cpus;   // Indexed by Role
+    uint64_t                      m_remotePages;
+};
+
+}
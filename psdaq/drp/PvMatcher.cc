@@ -0,0 +1,60 @@
+#include "PvMatcher.hh"
+#include "psalg/utils/SysLog.hh"
+#include <algorithm>
+
+using namespace XtcData;
+using namespace Drp;
+using logging = psalg::SysLog;
+
+PvMatcher::PvMatcher(unsigned capacity) :
+    m_events   (capacity),
+    m_eventMask(capacity - 1),
+    m_head     (0),
+    m_tail     (0),
+    m_nIdle    (2 * capacity),          // Room for the slot past a full ring
+    m_idleMask (2 * capacity - 1)
+{
+    if (capacity == 0 || (capacity & (capacity - 1)) != 0) {
+        logging::critical("PvMatcher capacity must be a power of 2, got %u", capacity);
+        throw "PvMatcher capacity must be a power of 2";
+    }
+}
+
+void PvMatcher::startup(unsigned nMonitors)
+{
+    m_head = 0;
+    m_tail = 0;
+    std::fill(m_nIdle.begin(), m_nIdle.end(), 0);
+    m_monitors.assign(nMonitors, {Idle, 0});
+    m_holding = std::priority_queue<Held>();
+    m_active.clear();
+    m_active.reserve(nMonitors);
+    m_ready = std::vector<std::atomic<uint8_t>>(nMonitors);
+    for (auto& flag : m_ready)  flag.store(0, std::memory_order_relaxed);
+
+    // Every monitor starts out waiting for its first update
+    _idle(0) = nMonitors;
+}
+
+void PvMatcher::ready(unsigned id)
+{
+    m_ready[id].store(1, std::memory_order_release);
+}
+
+void PvMatcher::push(uint32_t index, const TimeStamp& time, bool isL1Accept)
+{
+    // The ring is sized for all the pebble buffers, so it can't overflow
+    _event(m_tail) = {time, index, 0, isL1Accept};
+    ++m_tail;
+}
+
+void PvMatcher::_activate(unsigned id)
+{
+    Monitor& monitor = m_monitors[id];
+    if (monitor.state == Idle) {
+        --_idle(std::max(monitor.cursor, m_head));
+    }
+    monitor.state = Active;
+    m_active.push_back(id);
+}
+
@@ -0,0 +1,237 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <queue>
+#include <vector>
+#include "xtcdata/xtc/TimeStamp.hh"
+
+namespace Drp {
+
+// Matches the timing system's events to the updates of any number of PVs by
+// timestamp, for PvDetector.  Both arrive in time order, so each monitor
+// needs to be looked at only when it has something new to resolve:
+// - An Idle monitor has no PV update queued and waits at the oldest event it
+//   hasn't resolved, which can't be released until the monitor gets one.
+//   The number waiting at each event is kept, so releasing an event is O(1).
+// - A Holding monitor's oldest update is newer than all the events queued,
+//   so all of them are younger than the PV, i.e. without data from it.  The
+//   monitors are kept in a min-heap on the update's timestamp, and come off
+//   it when an event at least as new as the update shows up.
+// - An Active monitor walks the events from where it left off: updates
+//   older than the event are discarded, an update matching the event is
+//   added to it, and when the update is newer it skips by binary search to
+//   the first event that isn't older than the update.
+// Monitors become Active when notified of an update with ready(), which the
+// PV threads may call, or when they come off the heap, so that the work per
+// call is proportional to the number of updates rather than to the number of
+// events times the number of monitors.
+// ready() is a plain store of a flag per monitor, as it's called for every
+// update.  match() and expire() are templates on the client, so that the
+// calls to a final client are resolved at compile time and can be inlined.
+class PvMatcher
+{
+public:
+    // What the matcher needs from the detector, which should be final
+    class Client
+    {
+    public:
+        virtual ~Client() {}
+        // <0, 0 or >0 as the event is older than, matches or is newer than
+        // the PV update.  Must not decrease as the PV time increases.
+        virtual int  compare(const XtcData::TimeStamp& evtTime, const XtcData::TimeStamp& pvTime) = 0;
+        // The time of the oldest update queued for monitor id, if any
+        virtual bool pvTime(unsigned id, XtcData::TimeStamp& time) = 0;
+        // Add the oldest update of monitor id to the event and consume it
+        virtual void tEvtEqPv(unsigned id, uint32_t index) = 0;
+        // Discard the oldest update of monitor id, which is older than the event
+        virtual void tEvtGtPv(unsigned id, uint32_t index) = 0;
+        // Discard the oldest update of monitor id if it is not newer than timeout
+        virtual void pvTimeout(unsigned id, const XtcData::TimeStamp& timeout) = 0;
+        // The event is done with, with nYounger monitors having had an update
+        // newer than it rather than a matching one
+        virtual void release(uint32_t index, unsigned nYounger, bool timedOut) = 0;
+    };
+public:
+    PvMatcher(unsigned capacity);
+    void     startup(unsigned nMonitors);
+    void     ready(unsigned id);        // May be called from any thread
+    void     push(uint32_t index, const XtcData::TimeStamp& time, bool isL1Accept);
+    template <class C> void match(C& client);
+    template <class C> void expire(C& client, const XtcData::TimeStamp& timeout);
+    unsigned size()     const { return m_tail - m_head; }
+    unsigned capacity() const { return m_events.size(); }
+    unsigned nHolding() const { return m_holding.size(); }
+private:
+    enum State { Idle, Holding, Active };
+    struct Event
+    {
+        XtcData::TimeStamp time;
+        uint32_t           index;
+        uint32_t           nMatched;
+        bool               isL1Accept;
+    };
+    struct Monitor
+    {
+        State    state;
+        uint64_t cursor;                // Oldest event not yet resolved
+    };
+    struct Held
+    {
+        XtcData::TimeStamp time;
+        unsigned           id;
+        bool operator<(const Held& rhs) const { return time > rhs.time; } // Oldest on top
+    };
+private:
+    void     _activate(unsigned id);
+    template <class C> void     _advance(C& client, unsigned id);
+    template <class C> uint64_t _search(C& client, uint64_t seq, const XtcData::TimeStamp& pvTime);
+    template <class C> void     _release(C& client, bool timedOut);
+    Event&   _event(uint64_t seq)  { return m_events[seq & m_eventMask]; }
+    uint32_t& _idle(uint64_t seq)  { return m_nIdle[seq & m_idleMask]; }
+private:
+    std::vector<Event>                 m_events;
+    uint64_t                           m_eventMask;
+    uint64_t                           m_head;
+    uint64_t                           m_tail;
+    std::vector<uint32_t>              m_nIdle;   // Idle monitors waiting at each event
+    uint64_t                           m_idleMask;
+    std::vector<Monitor>               m_monitors;
+    std::priority_queue<Held>          m_holding;
+    std::vector<unsigned>              m_active;
+    std::vector<std::atomic<uint8_t>>  m_ready;   // Flag per monitor with new updates
+};
+
+template <class C>
+void PvMatcher::match(C& client)
+{
+    // Monitors that were waiting for an update and may have one now; a flag
+    // set again after it is cleared is seen on the next call
+    for (unsigned id = 0; id < m_ready.size(); ++id) {
+        if (m_ready[id].load(std::memory_order_relaxed) &&
+            m_ready[id].exchange(0, std::memory_order_acquire) &&
+            m_monitors[id].state == Idle)  _activate(id);
+    }
+
+    // Monitors whose update the newest event has caught up with
+    if (m_tail != m_head) {
+        const XtcData::TimeStamp& newest = _event(m_tail - 1).time;
+        while (!m_holding.empty() && client.compare(newest, m_holding.top().time) >= 0) {
+            unsigned id = m_holding.top().id;
+            m_holding.pop();
+            _activate(id);
+        }
+    }
+
+    for (auto id : m_active) {
+        _advance(client, id);
+    }
+    m_active.clear();
+
+    _release(client, false);
+}
+
+template <class C>
+void PvMatcher::_advance(C& client, unsigned id)
+{
+    Monitor& monitor = m_monitors[id];
+    uint64_t seq = std::max(monitor.cursor, m_head);
+    XtcData::TimeStamp pvTime;
+    while (true) {
+        while (seq != m_tail && !_event(seq).isL1Accept)  ++seq;  // Transitions take no PV data
+
+        if (!client.pvTime(id, pvTime)) {
+            monitor.state  = Idle;
+            monitor.cursor = seq;
+            ++_idle(seq);
+            return;
+        }
+        if (seq == m_tail) {
+            monitor.state  = Holding;
+            monitor.cursor = seq;
+            m_holding.push({pvTime, id});
+            return;
+        }
+
+        Event& event = _event(seq);
+        int result = client.compare(event.time, pvTime);
+        if (result > 0) {
+            client.tEvtGtPv(id, event.index);
+        } else if (result == 0) {
+            client.tEvtEqPv(id, event.index);
+            ++event.nMatched;
+            ++seq;
+        } else {
+            // Events older than the update won't get data from this monitor
+            seq = _search(client, seq + 1, pvTime);
+        }
+    }
+}
+
+// Finds the first event from seq on that isn't older than the PV update.
+// It's usually close by, so gallop out from seq before searching.
+template <class C>
+uint64_t PvMatcher::_search(C& client, uint64_t seq, const XtcData::TimeStamp& pvTime)
+{
+    uint64_t end  = seq;
+    uint64_t step = 1;
+    while (end < m_tail && client.compare(_event(end).time, pvTime) < 0) {
+        seq   = end + 1;
+        end  += step;
+        step *= 2;
+    }
+    if (end > m_tail)  end = m_tail;
+    while (seq < end) {
+        uint64_t mid = seq + (end - seq) / 2;
+        if (client.compare(_event(mid).time, pvTime) < 0)  seq = mid + 1;
+        else                                               end = mid;
+    }
+    return seq;
+}
+
+template <class C>
+void PvMatcher::_release(C& client, bool timedOut)
+{
+    const unsigned nMonitors = m_monitors.size();
+    while (m_head != m_tail) {
+        Event&    event = _event(m_head);
+        uint32_t& nIdle = _idle(m_head);
+        if (event.isL1Accept && nIdle && !timedOut)  break;
+
+        // Monitors neither waiting here nor matched had an update newer than the event
+        client.release(event.index,
+                       event.isL1Accept ? nMonitors - event.nMatched - nIdle : 0,
+                       timedOut && event.isL1Accept);
+
+        // Those still waiting move on to the next event
+        _idle(m_head + 1) += nIdle;
+        nIdle = 0;
+        ++m_head;
+
+        if (timedOut)  break;
+    }
+}
+
+template <class C>
+void PvMatcher::expire(C& client, const XtcData::TimeStamp& timeout)
+{
+    // Discard updates that are older than the timeout, which happens when no
+    // events come along to be matched with them
+    while (!m_holding.empty() && !(m_holding.top().time > timeout)) {
+        unsigned id = m_holding.top().id;
+        m_holding.pop();
+        client.pvTimeout(id, timeout);
+        _activate(id);
+        _advance(client, id);
+        m_active.clear();
+    }
+
+    // Give up on events that are older than the timeout
+    while (m_head != m_tail && !(_event(m_head).time > timeout)) {
+        _release(client, true);
+        _release(client, false);
+    }
+}
+
+}
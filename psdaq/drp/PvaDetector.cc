@@ -142,13 +142,15 @@ PvMonitor::PvMonitor(const PvParameters& para,
                      const std::string&  field,
                      unsigned            id,
                      size_t              nBuffers,
-                     uint32_t            firstDim) :
+                     uint32_t            firstDim,
+                     PvMatcher&          matcher) :
     Pds_Epics::PvMonitorBase(pvName, provider, request, field),
     m_para                  (para),
     m_state                 (NotReady),
     m_id                    (id),
     m_firstDimOverride      (firstDim),
     m_alias                 (alias),
+    m_matcher               (matcher),
     pvQueue                 (nBuffers),
     bufferFreelist          (pvQueue.size()),
     m_notifySocket          {&m_context, ZMQ_PUSH},
@@ -278,6 +280,7 @@ void PvMonitor::updated()
                 payload->shape[0] = m_firstDimOverride;
             }
             pvQueue.push(dgram);
+            m_matcher.ready(m_id);
         }
         else {
             ++m_nMissed;                     // Else count it as missed
@@ -328,6 +331,7 @@ public:
     }
 
     EbDgram* next(uint32_t& evtIndex);
+    bool pending() const { return m_current < m_available; }
     const uint64_t nDmaRet() { return m_nDmaRet; }
 private:
     EbDgram* _handle(uint32_t& evtIndex);
@@ -385,7 +389,7 @@ PvDetector::PvDetector(PvParameters& para,
     XpmDetector      (&para, &drp.pool),
     m_para           (para),
     m_drp            (drp),
-    m_evtQueue       (drp.pool.nbuffers()),
+    m_matcher        (drp.pool.nbuffers()),
     m_terminate      (false),
     m_running        (false)
 {
@@ -439,7 +443,8 @@ unsigned PvDetector::connect(std::string& msg)
 
             auto pvMonitor = std::make_shared<PvMonitor>(m_para,
                                                          alias, pvName, provider, request, field,
-                                                         id++, m_evtQueue.size(), firstDim);
+                                                         id++, m_matcher.capacity(), firstDim,
+                                                         m_matcher);
             m_pvMonitors.push_back(pvMonitor);
         }
         catch(std::string& error) {
@@ -516,7 +521,7 @@ unsigned PvDetector::configure(const std::string& config_alias, Xtc& xtc, const
     cd.set_string(InfoDef::detName, str.substr(0, str.length()-1).c_str());
 
     // (Re)initialize the queues
-    m_evtQueue.startup();
+    m_matcher.startup(m_pvMonitors.size());
     for (auto& pvMonitor : m_pvMonitors) {
         pvMonitor->startup();
     }
@@ -537,7 +542,6 @@ unsigned PvDetector::unconfigure()
     if (m_workerThread.joinable()) {
         m_workerThread.join();
     }
-    m_evtQueue.shutdown();
     for (auto& pvMonitor : m_pvMonitors) {
         pvMonitor->shutdown();
     }
@@ -602,8 +606,10 @@ void PvDetector::_worker()
                     [&](){return m_timeDiff;});
 
     m_exporter->add("drp_worker_input_queue", labels, MetricType::Gauge,
-                    [&](){return m_evtQueue.guess_size();});
-    m_exporter->constant("drp_worker_queue_depth", labels, m_evtQueue.size());
+                    [&](){return m_matcher.size();});
+    m_exporter->constant("drp_worker_queue_depth", labels, m_matcher.capacity());
+    m_exporter->add("drp_pv_holding", labels, MetricType::Gauge,
+                    [&](){return m_matcher.nHolding();});
 
     // Borrow this for awhile
     m_exporter->add("drp_worker_output_queue", labels, MetricType::Gauge,
@@ -632,8 +638,6 @@ void PvDetector::_worker()
     m_exporter->add("drp_num_no_tr_dgram", labels, MetricType::Gauge,
                     [&](){return pgp.nNoTrDgrams();});
 
-    uint32_t contract = (1 << m_pvMonitors.size()) - 1;
-
     const uint64_t nsTmo = (m_para.kwargs.find("match_tmo_ms") != m_para.kwargs.end() ?
                             std::stoul(Detector::m_para->kwargs["match_tmo_ms"])      :
                             1500) * 1000000;
@@ -644,22 +648,25 @@ void PvDetector::_worker()
         }
 
         uint32_t index;
-        if (pgp.next(index)) {
-            m_nEvents++;
-
-            m_evtQueue.push({index, contract});
-
-            _matchUp();
+        EbDgram* dgram = pgp.next(index);
+        if (dgram) {
+            // Match all the events of the DMA batch at once
+            do {
+                m_nEvents++;
+                m_matcher.push(index, dgram->time, dgram->service() == TransitionId::L1Accept);
+            } while (pgp.pending() && (dgram = pgp.next(index)));
+
+            m_matcher.match(*this);
         }
         else {
             // If there are any PGP datagrams stacked up, try to match them
             // up with any PV updates that may have arrived
-            _matchUp();
+            m_matcher.match(*this);
 
             // Generate a timestamp in the past for timing out PVs and PGP events
             TimeStamp timestamp(0, nsTmo);
             auto ns = _deltaT<ns_t>(timestamp);
-            _timeout(timestamp.from_ns(ns));
+            m_matcher.expire(*this, timestamp.from_ns(ns));
 
             // Time out batches for the TEB
             m_drp.tebContributor().timeout();
@@ -672,54 +679,72 @@ void PvDetector::_worker()
     logging::info("Worker thread finished");
 }
 
-void PvDetector::_matchUp()
+int PvDetector::compare(const TimeStamp& evtTime, const TimeStamp& pvTime)
 {
-    while (true) {
-        if (m_evtQueue.is_empty())  break;
-        Event& evt = m_evtQueue.front();
+    m_timeDiff = evtTime.to_ns() - pvTime.to_ns();
 
-        EbDgram* evtDg = reinterpret_cast<EbDgram*>(m_pool->pebble[evt.index]);
-        TransitionId::Value service = evtDg->service();
-        if (service == TransitionId::L1Accept) {
-            unsigned remaining = evt.remaining;
-            while (remaining) {
-                unsigned id = __builtin_ffsl(remaining) - 1;
-                remaining &= ~(1 << id);
+    int result = _compare(evtTime, pvTime);
 
-                auto& pvMonitor = m_pvMonitors[id];
+    logging::debug("PGP: %u.%09d, PV: %u.%09d, PGP - PV: %12ld ns, compare %c, latency %ld ms",
+                   evtTime.seconds(), evtTime.nanoseconds(),
+                   pvTime.seconds(), pvTime.nanoseconds(),
+                   m_timeDiff, result == 0 ? '=' : (result < 0 ? '<' : '>'), _deltaT<ms_t>(evtTime));
 
-                Dgram* pvDg;
-                if (!pvMonitor->pvQueue.peek(pvDg))  continue;
+    return result;
+}
 
-                m_timeDiff = evtDg->time.to_ns() - pvDg->time.to_ns();
+bool PvDetector::pvTime(unsigned id, TimeStamp& time)
+{
+    Dgram* pvDg;
+    if (!m_pvMonitors[id]->pvQueue.peek(pvDg))  return false;
+    time = pvDg->time;
+    return true;
+}
 
-                int result = _compare(evtDg->time, pvDg->time);
+void PvDetector::tEvtEqPv(unsigned id, uint32_t index)
+{
+    Dgram* pvDg;
+    m_pvMonitors[id]->pvQueue.peek(pvDg);
+    _tEvtEqPv(m_pvMonitors[id], *reinterpret_cast<EbDgram*>(m_pool->pebble[index]), *pvDg);
+}
 
-                logging::debug("PGP: %u.%09d, PV: %u.%09d, PGP - PV: %12ld ns, pid %014lx, svc %2d, compare %c, latency %ld ms",
-                               evtDg->time.seconds(), evtDg->time.nanoseconds(),
-                               pvDg->time.seconds(), pvDg->time.nanoseconds(),
-                               m_timeDiff, evtDg->pulseId(), evtDg->service(),
-                               result == 0 ? '=' : (result < 0 ? '<' : '>'), _deltaT<ms_t>(evtDg->time));
+void PvDetector::tEvtGtPv(unsigned id, uint32_t index)
+{
+    Dgram* pvDg;
+    m_pvMonitors[id]->pvQueue.peek(pvDg);
+    _tEvtGtPv(m_pvMonitors[id], *reinterpret_cast<EbDgram*>(m_pool->pebble[index]), *pvDg);
+}
 
-                if      (result == 0) { _tEvtEqPv(pvMonitor, *evtDg, *pvDg);  evt.remaining &= ~(1 << id); }
-                else if (result  < 0) { _tEvtLtPv(pvMonitor, *evtDg, *pvDg);  evt.remaining &= ~(1 << id); }
-                else                  { _tEvtGtPv(pvMonitor, *evtDg, *pvDg); }
-            }
-            if (evt.remaining)  break;  // Break so the timeout routine can run
-        }
-        else {
-          // Find the transition dgram in the pool
-          EbDgram* trDg = m_pool->transitionDgrams[evt.index];
-          if (trDg)                     // nullptr can happen during shutdown
-              _handleTransition(*evtDg, *trDg);
-        }
+void PvDetector::pvTimeout(unsigned id, const TimeStamp& timeout)
+{
+    m_pvMonitors[id]->timeout(timeout);
+}
 
-        Event event;
-        m_evtQueue.try_pop(event);      // Actually consume the element
-        assert(event.index == evt.index);
+void PvDetector::release(uint32_t index, unsigned nYounger, bool timedOut)
+{
+    EbDgram& dgram = *reinterpret_cast<EbDgram*>(m_pool->pebble[index]);
+    if (dgram.service() == TransitionId::L1Accept) {
+        if (nYounger)  _tEvtLtPv(dgram, nYounger);
 
-        _sendToTeb(*evtDg, evt.index);
+        if (timedOut) {
+            // No PV data so mark event as damaged
+            dgram.xtc.damage.increase(Damage::TimedOut);
+            ++m_nTimedOut;
+            logging::debug("Event timed out!! "
+                           "TimeStamp:  %u.%09u [0x%08x%04x.%05x], age %ld ms",
+                           dgram.time.seconds(), dgram.time.nanoseconds(),
+                           dgram.time.seconds(), (dgram.time.nanoseconds()>>16)&0xfffe, dgram.time.nanoseconds()&0x1ffff,
+                           _deltaT<ms_t>(dgram.time));
+        }
     }
+    else {
+        // Find the transition dgram in the pool
+        EbDgram* trDg = m_pool->transitionDgrams[index];
+        if (trDg)                       // nullptr can happen during shutdown
+            _handleTransition(dgram, *trDg);
+    }
+
+    _sendToTeb(dgram, index);
 }
 
 void PvDetector::_handleTransition(EbDgram& evtDg, EbDgram& trDg)
@@ -762,7 +787,7 @@ void PvDetector::_tEvtEqPv(std::shared_ptr<PvMonitor>& pvMonitor, EbDgram& evtDg
     pvMonitor->bufferFreelist.push(dgram); // Return buffer to freelist
 }
 
-void PvDetector::_tEvtLtPv(std::shared_ptr<PvMonitor>& pvMonitor, EbDgram& evtDg, const Dgram& pvDg)
+void PvDetector::_tEvtLtPv(EbDgram& evtDg, unsigned nYounger)
 {
     // Because PVs show up in time order, when the most recent PV is younger
     // than the PGP event (t(PV) > t(PGP)), we know that no older PV will show
@@ -770,11 +795,10 @@ void PvDetector::_tEvtLtPv(std::shared_ptr<PvMonitor>& pvMonitor, EbDgram& evtDg
     // leave the PV on the queue to perhaps be matched with a newer PGP event.
     evtDg.xtc.damage.increase(Damage::MissingData);
 
-    ++m_nEmpty;
+    m_nEmpty += nYounger;
     logging::debug("PV too young!!    "
-                   "TimeStamps: PGP %u.%09u < PV %u.%09u",
-                   evtDg.time.seconds(), evtDg.time.nanoseconds(),
-                   pvDg.time.seconds(), pvDg.time.nanoseconds());
+                   "TimeStamp: PGP %u.%09u < PV for %u PVs",
+                   evtDg.time.seconds(), evtDg.time.nanoseconds(), nYounger);
 }
 
 void PvDetector::_tEvtGtPv(std::shared_ptr<PvMonitor>& pvMonitor, EbDgram& evtDg, const Dgram& pvDg)
@@ -796,38 +820,6 @@ void PvDetector::_tEvtGtPv(std::shared_ptr<PvMonitor>& pvMonitor, EbDgram& evtDg
     pvMonitor->bufferFreelist.push(dgram); // Return buffer to freelist
 }
 
-void PvDetector::_timeout(const TimeStamp& timeout)
-{
-    // Time out older PV updates
-    for (auto& pvMonitor : m_pvMonitors) {
-        pvMonitor->timeout(timeout);
-    }
-
-    // Time out older pending PGP datagrams
-    Event event;
-    if (!m_evtQueue.peek(event))  return;
-
-    EbDgram& dgram = *reinterpret_cast<EbDgram*>(m_pool->pebble[event.index]);
-    if (dgram.time > timeout)  return;  // dgram is newer than the timeout timestamp
-
-    Event evt;
-    m_evtQueue.try_pop(evt);            // Actually consume the element
-    assert(evt.index == event.index);
-
-    if (dgram.service() == TransitionId::L1Accept) {
-        // No PV data so mark event as damaged
-        dgram.xtc.damage.increase(Damage::TimedOut);
-        ++m_nTimedOut;
-        logging::debug("Event timed out!! "
-                       "TimeStamp:  %u.%09u [0x%08x%04x.%05x], age %ld ms",
-                       dgram.time.seconds(), dgram.time.nanoseconds(),
-                       dgram.time.seconds(), (dgram.time.nanoseconds()>>16)&0xfffe, dgram.time.nanoseconds()&0x1ffff,
-                       _deltaT<ms_t>(dgram.time));
-    }
-
-    _sendToTeb(dgram, event.index);
-}
-
 void PvDetector::_sendToTeb(const EbDgram& dgram, uint32_t index)
 {
     // Make sure the datagram didn't get too big
@@ -1049,6 +1041,11 @@ void PvApp::handlePhase1(const json& msg)
     reply(answer);
 }
 
+void PvApp::handleChunkRollover(const json& msg)
+{
+    m_drp.chunkRollover(msg, m_det, [this](const json& warning) { reply(warning); });
+}
+
 void PvApp::handleReset(const nlohmann::json& msg)
 {
     unsubscribePartition();    // ZMQ_UNSUBSCRIBE
@@ -1188,7 +1185,13 @@ int main(int argc, char* argv[])
             if (kwargs.first == "pebbleBufSize")  continue;  // DrpBase
             if (kwargs.first == "pebbleBufCount") continue;  // DrpBase
             if (kwargs.first == "batching")       continue;  // DrpBase
+            if (kwargs.first == "batchLatency")   continue;  // TebContributor
+            if (kwargs.first == "pebbleHugePages") continue;  // Placement
+            if (kwargs.first == "numaNode")       continue;  // Placement
+            if (kwargs.first == "pinEbReceiver")  continue;  // Placement
             if (kwargs.first == "directIO")       continue;  // DrpBase
+            if (kwargs.first == "recordUring")    continue;  // DrpBase
+            if (kwargs.first == "xtcIndex")       continue;  // DrpBase
             if (kwargs.first == "pva_addr")       continue;  // DrpBase
             if (kwargs.first == "firstdim")       continue;
             if (kwargs.first == "match_tmo_ms")   continue;
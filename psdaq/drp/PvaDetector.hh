@@ -8,6 +8,7 @@
 #include "DrpBase.hh"
 #include "XpmDetector.hh"
 #include "spscqueue.hh"
+#include "PvMatcher.hh"
 #include "psdaq/epicstools/PvMonitorBase.hh"
 #include "psdaq/service/Collection.hh"
 
@@ -28,7 +29,8 @@ public:
               const std::string&  field,
               unsigned            id,
               size_t              nBuffers,
-              uint32_t            firstDim);
+              uint32_t            firstDim,
+              PvMatcher&          matcher);
 public:
     void onConnect()    override;
     void onDisconnect() override;
@@ -56,6 +58,7 @@ private:
     unsigned                        m_id;
     uint32_t                        m_firstDimOverride;
     std::string                     m_alias;
+    PvMatcher&                      m_matcher;
 public:
     SPSCQueue<XtcData::Dgram*>      pvQueue;
     SPSCQueue<XtcData::Dgram*>      bufferFreelist;
@@ -68,8 +71,9 @@ private:
 };
 
 
-class PvDetector : public XpmDetector
+class PvDetector final : public XpmDetector, private PvMatcher::Client
 {
+    friend class PvMatcher;
 public:
     PvDetector(PvParameters& para, DrpBase& drp);
     unsigned connect(std::string& msg);
@@ -81,26 +85,25 @@ public:
     unsigned unconfigure();
 private:
     void _worker();
-    void _timeout(const XtcData::TimeStamp& timestamp);
-    void _matchUp();
     void _handleTransition(Pds::EbDgram& evtDg, Pds::EbDgram& trDg);
     void _tEvtEqPv(std::shared_ptr<PvMonitor>&, Pds::EbDgram& evtDg, const XtcData::Dgram& pvDg);
-    void _tEvtLtPv(std::shared_ptr<PvMonitor>&, Pds::EbDgram& evtDg, const XtcData::Dgram& pvDg);
+    void _tEvtLtPv(Pds::EbDgram& evtDg, unsigned nYounger);
     void _tEvtGtPv(std::shared_ptr<PvMonitor>&, Pds::EbDgram& evtDg, const XtcData::Dgram& pvDg);
     void _sendToTeb(const Pds::EbDgram& dgram, uint32_t index);
-private:
-    struct Event
-    {
-      uint32_t index;
-      uint32_t remaining;
-    };
+private:                                // PvMatcher::Client
+    int  compare(const XtcData::TimeStamp& evtTime, const XtcData::TimeStamp& pvTime) override;
+    bool pvTime(unsigned id, XtcData::TimeStamp& time) override;
+    void tEvtEqPv(unsigned id, uint32_t index) override;
+    void tEvtGtPv(unsigned id, uint32_t index) override;
+    void pvTimeout(unsigned id, const XtcData::TimeStamp& timeout) override;
+    void release(uint32_t index, unsigned nYounger, bool timedOut) override;
 private:
     enum {RawNamesIndex = NamesIndex::BASE, InfoNamesIndex};
     PvParameters& m_para;
     DrpBase& m_drp;
     std::vector< std::shared_ptr<PvMonitor> > m_pvMonitors;
     std::thread m_workerThread;
-    SPSCQueue<Event> m_evtQueue;
+    PvMatcher m_matcher;
     std::atomic<bool> m_terminate;
     std::atomic<bool> m_running;
     std::shared_ptr<Pds::MetricExporter> m_exporter;
@@ -127,6 +130,7 @@ private:
     void handleConnect(const nlohmann::json& msg) override;
     void handleDisconnect(const nlohmann::json& msg) override;
     void handlePhase1(const nlohmann::json& msg) override;
+    void handleChunkRollover(const nlohmann::json& msg) override;
     void _unconfigure();
     void _disconnect();
     void _error(const std::string& which, const nlohmann::json& msg, const std::string& errorMsg);
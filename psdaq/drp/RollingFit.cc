@@ -0,0 +1,163 @@
+#include "RollingFit.hh"
+#include "psalg/utils/SysLog.hh"
+
+#include <cmath>
+#include <utility>
+
+using logging = psalg::SysLog;
+
+using namespace Drp;
+
+RollingFit::RollingFit(unsigned window, unsigned order) :
+    m_window(window),
+    m_order (order),
+    m_times (window),
+    m_values(window),
+    m_sumX  (2 * order + 1),
+    m_sumXV (order + 1),
+    m_coeff (order + 1)
+{
+    if (window < order + 1) {
+        logging::critical("RollingFit window of %u is too small for order %u", window, order);
+        throw "RollingFit window too small";
+    }
+    reset();
+}
+
+void RollingFit::reset()
+{
+    m_next           = 0;
+    m_count          = 0;
+    m_sinceRecompute = 0;
+    m_ref            = 0;
+    m_span           = 1.0;
+    m_meanX = m_meanV = m_cXX = m_cXV = 0.0;
+    std::fill(m_sumX.begin(),  m_sumX.end(),  0.0);
+    std::fill(m_sumXV.begin(), m_sumXV.end(), 0.0);
+    std::fill(m_coeff.begin(), m_coeff.end(), 0.0);
+}
+
+// Adds (sign = 1) or removes (sign = -1) a sample from the running sums
+void RollingFit::_include(double x, double v, double sign)
+{
+    if (m_order == 1) {
+        // m_count already includes an added sample and excludes a removed one
+        if (m_count == 0) {
+            m_meanX = m_meanV = m_cXX = m_cXV = 0.0;
+            return;
+        }
+        // The deviation from the mean with the sample times that from the
+        // mean without it, whichever way round the update goes
+        double dx = x - m_meanX;
+        double dv = v - m_meanV;
+        m_meanX += sign * dx / m_count;
+        m_meanV += sign * dv / m_count;
+        if (sign > 0) {
+            m_cXX += dx * (x - m_meanX);
+            m_cXV += dx * (v - m_meanV);
+        } else {
+            m_cXX -= (x - m_meanX) * dx;
+            m_cXV -= (x - m_meanX) * dv;
+        }
+        return;
+    }
+
+    double p = sign;
+    for (unsigned k = 0; k < m_sumX.size(); ++k) {
+        m_sumX[k] += p;
+        if (k < m_sumXV.size())  m_sumXV[k] += p * v;
+        p *= x;
+    }
+}
+
+void RollingFit::_recompute()
+{
+    unsigned oldest = (m_next + m_window - m_count) % m_window;
+    unsigned newest = (m_next + m_window - 1) % m_window;
+    m_ref  = m_times[oldest];
+    m_span = (m_times[newest] - m_ref) * 1.e-9;
+    if (!(m_span > 0.0))  m_span = 1.0;
+
+    unsigned count = m_count;
+    m_meanX = m_meanV = m_cXX = m_cXV = 0.0;
+    std::fill(m_sumX.begin(),  m_sumX.end(),  0.0);
+    std::fill(m_sumXV.begin(), m_sumXV.end(), 0.0);
+    m_count = 0;
+    for (unsigned i = 0; i < count; ++i) {
+        unsigned j = (oldest + i) % m_window;
+        ++m_count;
+        _include(_x(m_times[j]), m_values[j], 1.0);
+    }
+    m_sinceRecompute = 0;
+}
+
+void RollingFit::add(const XtcData::TimeStamp& time, double value)
+{
+    if (m_count == m_window) {          // Drop the oldest sample
+        --m_count;
+        _include(_x(m_times[m_next]), m_values[m_next], -1.0);
+    }
+
+    m_times [m_next] = time.to_ns();
+    m_values[m_next] = value;
+    m_next = (m_next + 1) % m_window;
+    ++m_count;
+
+    if (m_count == 1 || ++m_sinceRecompute >= m_window) {
+        _recompute();
+    } else {
+        unsigned newest = (m_next + m_window - 1) % m_window;
+        _include(_x(m_times[newest]), value, 1.0);
+    }
+
+    if (m_count > m_order)  _solve();
+}
+
+// Solves the normal equations for the coefficients
+void RollingFit::_solve()
+{
+    if (m_order == 1) {
+        double slope = m_cXX > 0.0 ? m_cXV / m_cXX : 0.0;
+        m_coeff[0] = m_meanV - slope * m_meanX;
+        m_coeff[1] = slope;
+        return;
+    }
+
+    // Gaussian elimination with partial pivoting of the (order+1)^2 system
+    const unsigned n = m_order + 1;
+    std::vector<double> a(n * (n + 1));
+    for (unsigned i = 0; i < n; ++i) {
+        for (unsigned j = 0; j < n; ++j)  a[i * (n + 1) + j] = m_sumX[i + j];
+        a[i * (n + 1) + n] = m_sumXV[i];
+    }
+    for (unsigned col = 0; col < n; ++col) {
+        unsigned pivot = col;
+        for (unsigned row = col + 1; row < n; ++row) {
+            if (std::fabs(a[row * (n + 1) + col]) > std::fabs(a[pivot * (n + 1) + col]))  pivot = row;
+        }
+        if (a[pivot * (n + 1) + col] == 0.0)  return; // Degenerate: keep the last coefficients
+        if (pivot != col) {
+            for (unsigned j = 0; j <= n; ++j)  std::swap(a[col * (n + 1) + j], a[pivot * (n + 1) + j]);
+        }
+        for (unsigned row = col + 1; row < n; ++row) {
+            double f = a[row * (n + 1) + col] / a[col * (n + 1) + col];
+            for (unsigned j = col; j <= n; ++j)  a[row * (n + 1) + j] -= f * a[col * (n + 1) + j];
+        }
+    }
+    for (unsigned i = n; i-- > 0; ) {
+        double sum = a[i * (n + 1) + n];
+        for (unsigned j = i + 1; j < n; ++j)  sum -= a[i * (n + 1) + j] * m_coeff[j];
+        m_coeff[i] = sum / a[i * (n + 1) + i];
+    }
+}
+
+double RollingFit::evaluate(const XtcData::TimeStamp& time) const
+{
+    // Horner's rule in the scaled time
+    double x   = _x(time.to_ns());
+    double val = 0.0;
+    for (unsigned i = m_coeff.size(); i-- > 0; ) {
+        val = val * x + m_coeff[i];
+    }
+    return val;
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "xtcdata/xtc/TimeStamp.hh"
+
+namespace Drp {
+
+// Least squares polynomial fit of a value against time over a window of the
+// most recent samples, for interpolating slowly sampled values onto the
+// timestamps of fast events.  Rather than refitting the whole window for
+// each new sample, it keeps running sums that are updated as samples enter
+// and leave the window, so that an update costs O(order) and a fit
+// O(order^3) independent of the window size:
+// - For straight lines, Welford's running means and co-moments, which
+//   stay accurate however long it runs.
+// - For higher orders, the power sums of the normal equations.
+// Time is measured from the oldest sample and scaled by the window's span,
+// and once per window the sums are recomputed from the samples, so that
+// neither rounding errors nor the distance from the reference build up.
+class RollingFit
+{
+public:
+    RollingFit(unsigned window, unsigned order);
+public:
+    void     reset();
+    void     add(const XtcData::TimeStamp& time, double value);
+    double   evaluate(const XtcData::TimeStamp& time) const;
+    bool     full() const     { return m_count == m_window; }
+    unsigned count() const    { return m_count; }
+    double   latest() const   { return m_count ? m_values[(m_next + m_window - 1) % m_window] : 0; }
+    const std::vector<double>& coefficients() const { return m_coeff; } // In scaled time
+private:
+    double   _x(uint64_t ns) const { return (int64_t(ns - m_ref) * 1.e-9) / m_span; }
+    void     _include(double x, double v, double sign);
+    void     _recompute();
+    void     _solve();
+private:
+    unsigned              m_window;
+    unsigned              m_order;
+    std::vector<uint64_t> m_times;      // ns, in a ring
+    std::vector<double>   m_values;
+    unsigned              m_next;       // Where the next sample goes
+    unsigned              m_count;
+    unsigned              m_sinceRecompute;
+    uint64_t              m_ref;        // ns of the oldest sample when last recomputed
+    double                m_span;       // s of the window when last recomputed
+    // Straight lines: Welford's running means and co-moments
+    double                m_meanX;
+    double                m_meanV;
+    double                m_cXX;
+    double                m_cXV;
+    // Higher orders: sums of x^k for k <= 2 * order and of v * x^k for k <= order
+    std::vector<double>   m_sumX;
+    std::vector<double>   m_sumXV;
+    std::vector<double>   m_coeff;      // In powers of the scaled time
+};
+
+}
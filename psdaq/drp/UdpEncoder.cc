@@ -17,14 +17,13 @@
 #include <cmath>
 #include <Python.h>
 #include <arpa/inet.h>
-#include <Eigen/Dense>
-#include <Eigen/QR>
 #include "DataDriver.h"
 #include "RunInfoDef.hh"
 #include "xtcdata/xtc/Damage.hh"
 #include "xtcdata/xtc/DescData.hh"
 #include "xtcdata/xtc/ShapesData.hh"
 #include "xtcdata/xtc/NamesLookup.hh"
+#include "xtcdata/xtc/TypedDef.hh"
 #include "psdaq/service/kwargs.hh"
 #include "psdaq/service/EbDgram.hh"
 #include "psdaq/eb/TebContributor.hh"
@@ -48,7 +47,13 @@ using ns_t = std::chrono::nanoseconds;
 int setrcvbuf(int socketFd, unsigned size);
 int createUdpSocket(int port);
 
-class EncoderDef:public XtcData::VarDef
+class EncoderDef:public XtcData::TypedDef<XtcData::Field<XtcData::Name::UINT32>,
+                                          XtcData::Field<XtcData::Name::UINT16>,
+                                          XtcData::Field<XtcData::Name::UINT32>,
+                                          XtcData::Field<XtcData::Name::UINT16>,
+                                          XtcData::Field<XtcData::Name::UINT16>,
+                                          XtcData::Field<XtcData::Name::UINT8>,
+                                          XtcData::Field<XtcData::Name::UINT8> >
 {
 public:
   enum index
@@ -62,17 +67,9 @@ public:
       error
     };
 
-  EncoderDef()
-  {
-      NameVec.push_back({"encoderValue", XtcData::Name::UINT32});
-      // frameCount is common to all channels
-      NameVec.push_back({"frameCount", XtcData::Name::UINT16});
-      NameVec.push_back({"timing", XtcData::Name::UINT32});
-      NameVec.push_back({"scale", XtcData::Name::UINT16});
-      NameVec.push_back({"scaleDenom", XtcData::Name::UINT16});
-      NameVec.push_back({"mode", XtcData::Name::UINT8});
-      NameVec.push_back({"error", XtcData::Name::UINT8});
-   }
+  // frameCount is common to all channels
+  EncoderDef() : TypedDef({"encoderValue", "frameCount", "timing", "scale",
+                           "scaleDenom", "mode", "error"}) {}
 } RawDef, InterpolatedDef;
 
 template<typename T>
@@ -549,75 +546,24 @@ Pds::EbDgram* Pgp::next(uint32_t& evtIndex)
 }
 
 
-static void _polyfit(unsigned i0,
-                     const std::vector<double> &t,
-                     const std::vector<double> &v,
-                     std::vector<double> &coeff)
-{
-    // Copy values into a time-ordered vector
-    std::vector<double> val(v.size());
-    for(unsigned i = 0; i < v.size(); i++) {
-        unsigned j = (i0 + i) % v.size();
-        val[i] = v[j];
-    }
-
-    // Create Matrix Placeholder of size n x k, n= number of datapoints, k = order of polynomial, for exame k = 3 for cubic polynomial
-    Eigen::MatrixXd T(t.size(), coeff.size());
-    Eigen::VectorXd V = Eigen::VectorXd::Map(&val.front(), val.size());
-    Eigen::VectorXd result;
-
-    // Populate the matrix
-    double t0 = t[i0 % t.size()];
-    for(size_t i = 0 ; i < t.size(); ++i) {
-        size_t k = (i0 + i) % t.size();
-        for(size_t j = 0; j < coeff.size(); ++j) {
-            T(i, j) = pow(t.at(k) - t0, j);
-        }
-    }
-    //std::cout<<T<<std::endl;
-
-    // Solve for linear least square fit
-    result = T.householderQr().solve(V);
-    for (unsigned k = 0; k < coeff.size(); k++) {
-        coeff[k] = result[k];
-    }
-}
-
 void Interpolator::update(XtcData::TimeStamp t, unsigned v)
 {
-    auto idx = _idx++;
-    _idx %= _t.size();
-
-    logging::debug("Interpolator::update: idx      %d,    t %u.%09u, v %u", idx, t.seconds(), t.nanoseconds(), v);
+    logging::debug("Interpolator::update: n %u, t %u.%09u, v %u", _fit.count(), t.seconds(), t.nanoseconds(), v);
 
-    _t[idx] = t.asDouble();
-    _v[idx] = double(v);
-
-    if (_t[_t.size() - 1] != 0.0) { // True when MAX_ENC_VALUES or more points were collected
-        _polyfit(_idx, _t, _v, _coeff);
-    }
+    _fit.add(t, double(v));
 }
 
 unsigned Interpolator::calculate(XtcData::TimeStamp ts, XtcData::Damage& damage) const
 {
     unsigned v;
-    if (_t[_t.size() - 1] != 0.0) { // True when arrays are full
-        // Sum up the terms of the polynomial
-        double val  = 0;
-        double tPwr = 1;
-        double t0   = _t[_idx % _t.size()];
-        double t    = ts.asDouble() - t0;
-        for(unsigned i = 0; i < _coeff.size(); ++i) {
-            val  += _coeff[i] * tPwr;
-            tPwr *= t;
-        }
-        v = unsigned(std::round(val));
+    if (_fit.full()) {                  // True when MAX_ENC_VALUES or more points were collected
+        v = unsigned(std::round(_fit.evaluate(ts)));
     } else {
-        v = unsigned(_v[_idx - 1]);   // Return the most recent value available
+        v = unsigned(_fit.latest());    // Return the most recent value available, if any
         damage.increase(XtcData::Damage::MissingData);
     }
 
-    logging::debug("Interpolator::calc:   idx %d, t %u.%09u, v %u", _idx, ts.seconds(), ts.nanoseconds(), v);
+    logging::debug("Interpolator::calc:   n %u, t %u.%09u, v %u", _fit.count(), ts.seconds(), ts.nanoseconds(), v);
 
     return v;
 }
@@ -685,6 +631,7 @@ void UdpEncoder::addNames(unsigned segment, XtcData::Xtc& xtc, const void* bufEn
                                                                  m_para->detName.c_str(), encoderRawAlg,
                                                                  m_para->detType.c_str(), m_para->serNo.c_str(), rawNamesId, segment);
     rawNames.add(xtc, bufEnd, RawDef);
+    EncoderDef::check(rawNames);
     m_namesLookup[rawNamesId] = XtcData::NameIndex(rawNames);
 
     if (m_interpolating) {
@@ -695,6 +642,7 @@ void UdpEncoder::addNames(unsigned segment, XtcData::Xtc& xtc, const void* bufEn
                                                                      m_para->detName.c_str(), encoderInterpolatedAlg,
                                                                      m_para->detType.c_str(), m_para->serNo.c_str(), interpolatedNamesId, segment);
         interpolatedNames.add(xtc, bufEnd, InterpolatedDef);
+        EncoderDef::check(interpolatedNames);
         m_namesLookup[interpolatedNamesId] = XtcData::NameIndex(interpolatedNames);
     }
 }
@@ -925,58 +873,31 @@ void UdpEncoder::_event(XtcData::Dgram& dgram, const void* const bufEnd, const e
     if (interpolatedValue != nullptr) {
         // interpolated
         XtcData::NamesId namesId1(nodeId, InterpolatedNamesIndex);
-        XtcData::CreateData interpolated(dgram.xtc, bufEnd, m_namesLookup, namesId1);
-
-        // ...encoderValue
-        interpolated.set_value(EncoderDef::encoderValue, *interpolatedValue);
-
-        // ...frameCount
-        interpolated.set_value(EncoderDef::frameCount, frame.header.frameCount);
-
-        // ...timing
-        interpolated.set_value(EncoderDef::timing, frame.channel[0].timing);
-
-        // ...scale
-        interpolated.set_value(EncoderDef::scale, frame.channel[0].scale);
-
-        // ...scaleDenom
-        interpolated.set_value(EncoderDef::scaleDenom, frame.channel[0].scaleDenom);
-
-        // ...mode
-        interpolated.set_value(EncoderDef::mode, frame.channel[0].mode);
-
-        // ...error
-        interpolated.set_value(EncoderDef::error, frame.channel[0].error);
+        _setEncoder(dgram, bufEnd, namesId1, frame, *interpolatedValue);
     }
 
     if (rawValue != nullptr) {
         // raw
         XtcData::NamesId namesId2(nodeId, RawNamesIndex);
-        XtcData::CreateData raw(dgram.xtc, bufEnd, m_namesLookup, namesId2);
-
-        // ...encoderValue
-        raw.set_value(EncoderDef::encoderValue, *rawValue);
-
-        // ...frameCount
-        raw.set_value(EncoderDef::frameCount, frame.header.frameCount);
-
-        // ...timing
-        raw.set_value(EncoderDef::timing, frame.channel[0].timing);
-
-        // ...scale
-        raw.set_value(EncoderDef::scale, frame.channel[0].scale);
-
-        // ...scaleDenom
-        raw.set_value(EncoderDef::scaleDenom, frame.channel[0].scaleDenom);
-
-        // ...mode
-        raw.set_value(EncoderDef::mode, frame.channel[0].mode);
-
-        // ...error
-        raw.set_value(EncoderDef::error, frame.channel[0].error);
+        _setEncoder(dgram, bufEnd, namesId2, frame, *rawValue);
     }
 }
 
+// the fields of EncoderDef are all scalars, so they are written at
+// offsets known at compile time
+void UdpEncoder::_setEncoder(XtcData::Dgram& dgram, const void* const bufEnd, XtcData::NamesId& namesId,
+                             const encoder_frame_t& frame, uint32_t encoderValue)
+{
+    XtcData::TypedCreateData<EncoderDef> cd(dgram.xtc, bufEnd, m_namesLookup, namesId);
+    cd.set<EncoderDef::encoderValue>(encoderValue);
+    cd.set<EncoderDef::frameCount>  (frame.header.frameCount);
+    cd.set<EncoderDef::timing>      (frame.channel[0].timing);
+    cd.set<EncoderDef::scale>       (frame.channel[0].scale);
+    cd.set<EncoderDef::scaleDenom>  (frame.channel[0].scaleDenom);
+    cd.set<EncoderDef::mode>        (frame.channel[0].mode);
+    cd.set<EncoderDef::error>       (frame.channel[0].error);
+}
+
 void UdpEncoder::_handleTransition(uint32_t pebbleIdx, Pds::EbDgram* pebbleDg)
 {
     // Find the transition dgram in the pool and initialize its header
@@ -1299,6 +1220,11 @@ void UdpApp::handlePhase1(const json& msg)
     reply(answer);
 }
 
+void UdpApp::handleChunkRollover(const json& msg)
+{
+    m_drp.chunkRollover(msg, m_det, [this](const json& warning) { reply(warning); });
+}
+
 void UdpApp::handleReset(const nlohmann::json& msg)
 {
     unsubscribePartition();    // ZMQ_UNSUBSCRIBE
@@ -1462,7 +1388,13 @@ int main(int argc, char* argv[])
             if (kwargs.first == "pebbleBufSize")  continue;  // DrpBase
             if (kwargs.first == "pebbleBufCount") continue;  // DrpBase
             if (kwargs.first == "batching")       continue;  // DrpBase
+            if (kwargs.first == "batchLatency")   continue;  // TebContributor
+            if (kwargs.first == "pebbleHugePages") continue;  // Placement
+            if (kwargs.first == "numaNode")       continue;  // Placement
+            if (kwargs.first == "pinEbReceiver")  continue;  // Placement
             if (kwargs.first == "directIO")       continue;  // DrpBase
+            if (kwargs.first == "recordUring")    continue;  // DrpBase
+            if (kwargs.first == "xtcIndex")       continue;  // DrpBase
             if (kwargs.first == "pva_addr")       continue;  // DrpBase
             if (kwargs.first == "match_tmo_ms")   continue;
             if (kwargs.first == "slowGroup")      continue;
@@ -11,6 +11,7 @@
 #include <vector>
 #include "DrpBase.hh"
 #include "XpmDetector.hh"
+#include "RollingFit.hh"
 #include "spscqueue.hh"
 #include "psdaq/service/Collection.hh"
 
@@ -116,24 +117,16 @@ private:
 class Interpolator
 {
 public:
-  Interpolator(unsigned n, unsigned o) : _idx(0), _t(n), _v(n), _coeff(o+1)
-  {
-    // check to make sure inputs are correct
-    assert(_t.size() == _v.size());
-    assert(_t.size() >= _coeff.size());
-  }
+  Interpolator(unsigned n, unsigned o) : _fit(n, o) {}
   ~Interpolator() {}
 
 public:
-  void reset() { _idx=0;  std::fill(_t.begin(), _t.end(), 0); }
+  void reset() { _fit.reset(); }
   void update(XtcData::TimeStamp t, unsigned v);
   unsigned calculate(XtcData::TimeStamp t, XtcData::Damage& damage) const;
 
 private:
-  unsigned            _idx;
-  std::vector<double> _t;
-  std::vector<double> _v;
-  std::vector<double> _coeff;
+  RollingFit _fit;
 };
 
 
@@ -153,6 +146,8 @@ public:
     enum { MajorVersion = 3, MinorVersion = 0, MicroVersion = 0 };
 private:
     void _event(XtcData::Dgram& dgram, const void* const bufEnd, const encoder_frame_t& frame, uint32_t *rawValue, uint32_t *interpolatedValue);
+    void _setEncoder(XtcData::Dgram& dgram, const void* const bufEnd, XtcData::NamesId& namesId,
+                     const encoder_frame_t& frame, uint32_t encoderValue);
     void _worker();
     void _timeout(const XtcData::TimeStamp& timestamp);
     void _process(Pds::EbDgram* dgram);
@@ -196,6 +191,7 @@ private:
     void handleConnect(const nlohmann::json& msg) override;
     void handleDisconnect(const nlohmann::json& msg) override;
     void handlePhase1(const nlohmann::json& msg) override;
+    void handleChunkRollover(const nlohmann::json& msg) override;
     void _unconfigure();
     void _disconnect();
     void _error(const std::string& which, const nlohmann::json& msg, const std::string& errorMsg);
@@ -0,0 +1,410 @@
+#include "UringFileWriter.hh"
+#include "FileWriter.hh"
+#include "psalg/utils/SysLog.hh"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <fcntl.h>
+#include <unistd.h>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+
+using logging = psalg::SysLog;
+
+using namespace Drp;
+
+static const unsigned QueueDepth  = 64;         // Writes in flight at most
+static const unsigned RingEntries = 2 * QueueDepth;
+static const size_t   MaxFixed    = 1ul << 30;  // Largest buffer io_uring registers
+
+static size_t roundUp(size_t size, size_t quantum)
+{
+    return quantum * ((size + quantum - 1) / quantum);
+}
+
+// User data of a request: kind, length and id
+static inline uint64_t tag(unsigned kind, size_t len, unsigned id)
+{
+    return (uint64_t(kind) << 62) | (uint64_t(len) << 31) | id;
+}
+
+static inline int _ioUringSetup(unsigned entries, io_uring_params* p)
+{
+    return syscall(__NR_io_uring_setup, entries, p);
+}
+
+static inline int _ioUringEnter(int fd, unsigned toSubmit, unsigned minComplete, unsigned flags)
+{
+    return syscall(__NR_io_uring_enter, fd, toSubmit, minComplete, flags, nullptr, 0);
+}
+
+static inline int _ioUringRegister(int fd, unsigned opcode, const void* arg, unsigned nArgs)
+{
+    return syscall(__NR_io_uring_register, fd, opcode, arg, nArgs);
+}
+
+size_t UringFileWriter::slotSize(size_t bufSize)
+{
+    // Room for the padding Xtc, which takes the datagram to the next block
+    return roundUp(bufSize + sizeof(XtcData::Xtc), BlockSize);
+}
+
+bool UringFileWriter::available()
+{
+    io_uring_params p;
+    memset(&p, 0, sizeof(p));
+    int fd = _ioUringSetup(1, &p);
+    if (fd < 0)  return false;
+    ::close(fd);
+    return true;
+}
+
+UringFileWriter::UringFileWriter(size_t maxDgramSize, size_t slotHead, unsigned nSlots,
+                                 std::function<void()> freeSlot) :
+    m_slotHead  (slotHead),
+    m_nSlots    (nSlots),
+    m_freeSlot  (freeSlot),
+    m_bounce    (4),
+    m_bounceSize(BlockSize + slotSize(maxDgramSize)),
+    m_bounceBusy(m_bounce.size(), false),
+    m_nextBounce(0),
+    m_fd        (0),
+    m_nextFd    (0),
+    m_pos       (0),
+    m_seq       (0),
+    m_retired   (0),
+    m_pending   (nSlots, 0),
+    m_released  (nSlots, false),
+    m_inFlight  (0),
+    m_nDirect   (0),
+    m_nBounced  (0),
+    m_nPadding  (0)
+{
+    if (slotHead >= BlockSize) {
+        logging::critical("UringFileWriter slot head of %zu bytes is not less than a block", slotHead);
+        throw "UringFileWriter slot head too large";
+    }
+
+    _setup(RingEntries);
+
+    for (auto& bounce : m_bounce) {
+        if (posix_memalign((void**)&bounce, BlockSize, m_bounceSize)) {
+            logging::critical("UringFileWriter posix_memalign: %m");
+            throw "UringFileWriter posix_memalign";
+        }
+        m_fixed.emplace_back(bounce, m_bounceSize);
+    }
+    registerRegion(nullptr, 0);
+
+    m_thread = std::thread(&UringFileWriter::_complete, this);
+}
+
+UringFileWriter::~UringFileWriter()
+{
+    if (m_fd > 0)  close();
+
+    _submit(Wake, 0, nullptr, 0, 0);
+    m_thread.join();
+
+    ::close(m_ring.fd);
+    munmap(m_ring.sqes, m_ring.sqesSize);
+    if (m_ring.cqMap != m_ring.sqMap)  munmap(m_ring.cqMap, m_ring.cqMapSize);
+    munmap(m_ring.sqMap, m_ring.sqMapSize);
+    for (auto bounce : m_bounce)  free(bounce);
+}
+
+void UringFileWriter::_setup(unsigned entries)
+{
+    io_uring_params p;
+    memset(&p, 0, sizeof(p));
+    m_ring.fd = _ioUringSetup(entries, &p);
+    if (m_ring.fd < 0) {
+        logging::critical("io_uring_setup failed: %m");
+        throw "io_uring_setup failed";
+    }
+
+    m_ring.sqMapSize = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    m_ring.cqMapSize = p.cq_off.cqes  + p.cq_entries * sizeof(io_uring_cqe);
+    bool single = p.features & IORING_FEAT_SINGLE_MMAP;
+    if (single)  m_ring.sqMapSize = m_ring.cqMapSize = std::max(m_ring.sqMapSize, m_ring.cqMapSize);
+    m_ring.sqMap = mmap(nullptr, m_ring.sqMapSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                        m_ring.fd, IORING_OFF_SQ_RING);
+    m_ring.cqMap = single ? m_ring.sqMap
+                          : mmap(nullptr, m_ring.cqMapSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                                 m_ring.fd, IORING_OFF_CQ_RING);
+    m_ring.sqesSize = p.sq_entries * sizeof(io_uring_sqe);
+    m_ring.sqes = (io_uring_sqe*)mmap(nullptr, m_ring.sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                                      m_ring.fd, IORING_OFF_SQES);
+    if (m_ring.sqMap == MAP_FAILED || m_ring.cqMap == MAP_FAILED || m_ring.sqes == MAP_FAILED) {
+        logging::critical("io_uring mmap failed: %m");
+        throw "io_uring mmap failed";
+    }
+
+    uint8_t* sq = (uint8_t*)m_ring.sqMap;
+    m_ring.sqHead  = (unsigned*)(sq + p.sq_off.head);
+    m_ring.sqTail  = (unsigned*)(sq + p.sq_off.tail);
+    m_ring.sqMask  = *(unsigned*)(sq + p.sq_off.ring_mask);
+    m_ring.sqArray = (unsigned*)(sq + p.sq_off.array);
+    uint8_t* cq = (uint8_t*)m_ring.cqMap;
+    m_ring.cqHead  = (unsigned*)(cq + p.cq_off.head);
+    m_ring.cqTail  = (unsigned*)(cq + p.cq_off.tail);
+    m_ring.cqMask  = *(unsigned*)(cq + p.cq_off.ring_mask);
+    m_ring.cqes    = (io_uring_cqe*)(cq + p.cq_off.cqes);
+}
+
+void UringFileWriter::registerRegion(void* base, size_t size)
+{
+    for (size_t offset = 0; offset < size; offset += MaxFixed) {
+        m_fixed.emplace_back((uint8_t*)base + offset, std::min(MaxFixed, size - offset));
+    }
+
+    if (m_fixed.size() > m_bounce.size()) {  // Something was registered before
+        _ioUringRegister(m_ring.fd, IORING_UNREGISTER_BUFFERS, nullptr, 0);
+    }
+    std::vector<iovec> iovs;
+    for (const auto& fixed : m_fixed) {
+        iovs.push_back({(void*)fixed.first, fixed.second});
+    }
+    if (_ioUringRegister(m_ring.fd, IORING_REGISTER_BUFFERS, iovs.data(), iovs.size()) < 0) {
+        logging::warning("io_uring buffer registration of %zu bytes failed, using unregistered buffers: %m",
+                         size);
+        m_fixed.clear();
+    }
+}
+
+int UringFileWriter::_fixedIndex(const uint8_t* buf, size_t len) const
+{
+    for (unsigned i = 0; i < m_fixed.size(); ++i) {
+        const auto& fixed = m_fixed[i];
+        if (buf >= fixed.first && buf + len <= fixed.first + fixed.second)  return i;
+    }
+    return -1;
+}
+
+int UringFileWriter::open(const std::string& fileName)
+{
+    m_fd  = openLocked(fileName, true);
+    m_pos = 0;
+    return m_fd == -1 ? -1 : 0;
+}
+
+int UringFileWriter::prepare(const std::string& fileName)
+{
+    if (m_nextFd > 0)  ::close(m_nextFd);   // Prepared before but not rolled over to
+    m_nextFd = openLocked(fileName, true);
+    return m_nextFd == -1 ? -1 : 0;
+}
+
+void UringFileWriter::rollover()
+{
+    // Only the writes still in flight to the current file are waited for
+    int fd = m_nextFd;
+    m_nextFd = 0;
+    close();
+    m_fd  = fd;
+    m_pos = 0;
+}
+
+int UringFileWriter::close()
+{
+    int rv = 0;
+    if (m_fd > 0) {
+        {
+            std::unique_lock<std::mutex> lock(m_lock);
+            m_cond.wait(lock, [this] { return m_inFlight.load(std::memory_order_relaxed) == 0; });
+        }
+
+        // The last datagram's padding runs into the block the next one
+        // would have started with: write that block and trim the file
+        uint64_t tail = m_pos % BlockSize;
+        if (tail) {
+            memset(m_bounce[0], 0, BlockSize);
+            logging::debug("Flushing the %lu byte tail to fd %d", tail, m_fd);
+            if (pwrite(m_fd, m_bounce[0], BlockSize, m_pos - tail) != ssize_t(BlockSize) ||
+                ftruncate(m_fd, m_pos) == -1) {
+                logging::error("Error writing the tail of fd %d: %m", m_fd);
+                rv = -1;
+            }
+        }
+        logging::debug("Closing fd %d", m_fd);
+        if (::close(m_fd) == -1)  rv = -1;
+    } else {
+        logging::warning("No file to close (m_fd=%d)", m_fd);
+    }
+    if (m_nextFd > 0) {                 // Prepared but not rolled over to
+        ::close(m_nextFd);
+        m_nextFd = 0;
+    }
+    if (rv == -1) {
+        // %m will be replaced by the string strerror(errno)
+        logging::error("Error closing fd %d: %m", m_fd);
+    } else {
+        m_fd = 0;
+    }
+    return rv;
+}
+
+// Extends the datagram, which is to start at pos in the file, with a padding
+// Xtc so that the next one starts slotHead bytes into a block
+size_t UringFileWriter::_pad(XtcData::Dgram* dgram, uint64_t pos) const
+{
+    size_t   size = sizeof(*dgram) + dgram->xtc.sizeofPayload();
+    uint64_t next = m_slotHead + roundUp(pos + size + sizeof(XtcData::Xtc) - m_slotHead, BlockSize);
+    size_t   pad  = next - pos - size;
+    auto padding = ::new((char*)dgram + size) XtcData::Xtc(XtcData::TypeId(XtcData::TypeId::Padding, 0));
+    padding->extent  = pad;
+    dgram->xtc.extent += pad;
+    return pad;
+}
+
+XtcData::Dgram* UringFileWriter::writeEvent(XtcData::Dgram* dgram, uint8_t* slot, size_t slotSize)
+{
+    size_t   size  = sizeof(*dgram) + dgram->xtc.sizeofPayload();
+    uint64_t pos   = m_pos;
+    size_t   phase = pos % BlockSize;   // slotHead, or 0 at the start of a file
+    size_t   len   = roundUp(size + sizeof(XtcData::Xtc), BlockSize);
+
+    if (slot && (uintptr_t(slot) % BlockSize == 0) && ((uint8_t*)dgram == slot + m_slotHead) &&
+        (phase == m_slotHead) && (len <= slotSize)) {
+        // Write the buffer as it is, from the slot head to the end of the padding
+        m_nPadding += _pad(dgram, pos);
+        {
+            std::lock_guard<std::mutex> lock(m_lock);
+            ++m_pending[m_seq % m_nSlots];
+        }
+        _submit(Slot, m_seq % m_nSlots, slot, len, pos - phase);
+        m_pos = pos + len;
+        ++m_nDirect;
+        return dgram;
+    }
+
+    // Copy it into a bounce buffer, at the same offset into the block as in the file
+    if (phase + size + sizeof(XtcData::Xtc) + BlockSize > m_bounceSize) {
+        logging::critical("Bounce buffer size %zu too small for dgram with size %zu", m_bounceSize, size);
+        throw "UringFileWriter buffer size too small";
+    }
+    unsigned id = m_nextBounce;
+    m_nextBounce = (m_nextBounce + 1) % m_bounce.size();
+    {
+        std::unique_lock<std::mutex> lock(m_lock);
+        m_cond.wait(lock, [this, id] { return !m_bounceBusy[id]; });
+        m_bounceBusy[id] = true;
+    }
+    auto copy = (XtcData::Dgram*)(m_bounce[id] + phase);
+    memcpy((void*)copy, dgram, size);
+    size_t pad = _pad(copy, pos);
+    m_nPadding += pad;
+    len = phase + size + pad - m_slotHead;
+    _submit(Bounce, id, m_bounce[id], len, pos - phase);
+    m_pos = pos + size + pad;
+    ++m_nBounced;
+    return copy;
+}
+
+void UringFileWriter::release()
+{
+    std::lock_guard<std::mutex> lock(m_lock);
+    m_released[m_seq % m_nSlots] = true;
+    ++m_seq;
+    _retire();
+}
+
+// Frees the events whose writes are done, in order, with m_lock held
+void UringFileWriter::_retire()
+{
+    while (m_retired != m_seq) {
+        unsigned i = m_retired % m_nSlots;
+        if (!m_released[i] || m_pending[i])  break;
+        m_released[i] = false;
+        m_freeSlot();
+        ++m_retired;
+    }
+}
+
+void UringFileWriter::_submit(Kind kind, unsigned id, const uint8_t* buf, size_t len, uint64_t offset)
+{
+    if (kind != Wake) {
+        std::unique_lock<std::mutex> lock(m_lock);
+        m_cond.wait(lock, [this] { return m_inFlight.load(std::memory_order_relaxed) < QueueDepth; });
+        m_inFlight.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // Only this thread touches the submission queue
+    unsigned tail = *m_ring.sqTail;
+    unsigned i    = tail & m_ring.sqMask;
+    io_uring_sqe* sqe = &m_ring.sqes[i];
+    memset(sqe, 0, sizeof(*sqe));
+    if (kind == Wake) {
+        sqe->opcode = IORING_OP_NOP;
+    } else {
+        int fixed = _fixedIndex(buf, len);
+        sqe->opcode    = fixed < 0 ? IORING_OP_WRITE : IORING_OP_WRITE_FIXED;
+        sqe->buf_index = fixed < 0 ? 0 : fixed;
+        sqe->fd        = m_fd;
+        sqe->addr      = (uintptr_t)buf;
+        sqe->len       = len;
+        sqe->off       = offset;
+    }
+    sqe->user_data = tag(kind, len, id);
+    m_ring.sqArray[i] = i;
+    __atomic_store_n(m_ring.sqTail, tail + 1, __ATOMIC_RELEASE);
+
+    while (_ioUringEnter(m_ring.fd, 1, 0, 0) < 0) {
+        if (errno != EINTR && errno != EAGAIN && errno != EBUSY) {
+            logging::critical("io_uring_enter failed: %m");
+            throw "File writing failed";
+        }
+    }
+}
+
+void UringFileWriter::_complete()
+{
+    logging::info("Recording completion thread is starting");
+
+    bool terminate = false;
+    while (!terminate) {
+        if (_ioUringEnter(m_ring.fd, 0, 1, IORING_ENTER_GETEVENTS) < 0 && errno != EINTR) {
+            logging::error("io_uring_enter failed: %m");
+        }
+
+        unsigned head = *m_ring.cqHead;
+        unsigned tail = __atomic_load_n(m_ring.cqTail, __ATOMIC_ACQUIRE);
+        if (head == tail)  continue;
+        std::lock_guard<std::mutex> lock(m_lock);
+        for (; head != tail; ++head) {
+            const io_uring_cqe& cqe = m_ring.cqes[head & m_ring.cqMask];
+            unsigned kind = cqe.user_data >> 62;
+            size_t   len  = (cqe.user_data >> 31) & 0x7fffffff;
+            unsigned id   = cqe.user_data & 0x7fffffff;
+            if (kind == Wake) {
+                terminate = true;
+                continue;
+            }
+            if (cqe.res < 0) {
+                errno = -cqe.res;
+                logging::critical("Recording write failed: %m");
+                throw "File writing failed";
+            }
+            if (size_t(cqe.res) != len) {
+                logging::critical("Recording write was short: %d of %zu bytes", cqe.res, len);
+                throw "File writing failed";
+            }
+            if (kind == Slot) {
+                --m_pending[id];
+                _retire();
+            } else {
+                m_bounceBusy[id] = false;
+            }
+            m_inFlight.fetch_sub(1, std::memory_order_relaxed);
+        }
+        __atomic_store_n(m_ring.cqHead, head, __ATOMIC_RELEASE);
+        m_cond.notify_all();
+    }
+
+    logging::info("Recording completion thread is exiting");
+}
@@ -0,0 +1,121 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "xtcdata/xtc/Dgram.hh"
+
+struct io_uring_sqe;
+struct io_uring_cqe;
+
+namespace Drp {
+
+// Records datagrams with O_DIRECT writes submitted through io_uring, straight
+// from the buffers they were built in, rather than copying them into staging
+// buffers as BufferedFileWriterMT does.  O_DIRECT needs block aligned memory,
+// file offsets and lengths, which the datagrams of an xtc2 file are not, so
+// each datagram is extended with a TypeId::Padding Xtc up to where the next
+// one can start on a block boundary.  Readers skip the padding like any Xtc
+// of a type they don't know, so the file stays a valid stream of datagrams.
+//
+// A buffer holds slotHead bytes before the datagram (the PulseId of an
+// EbDgram) which go to the file with it, as the end of the previous
+// datagram's padding.  Datagrams that aren't in such a buffer, or whose
+// buffer is not aligned or too small for the padding, are copied into a
+// bounce buffer instead.
+//
+// Buffers written from must stay put until the write completes.  The writer
+// keeps track of the events of a ring of nSlots, each begun by writeEvent()s
+// and ended by release(), and calls freeSlot() for each in order once its
+// writes are done, on either the caller's or the completion thread.
+class UringFileWriter
+{
+public:
+    static const size_t BlockSize = 4096;
+    // The buffer size needed for datagrams of up to bufSize bytes, slotHead included
+    static size_t slotSize(size_t bufSize);
+    // Whether io_uring can be used here
+    static bool available();
+public:
+    UringFileWriter(size_t maxDgramSize, size_t slotHead, unsigned nSlots,
+                    std::function<void()> freeSlot);
+    ~UringFileWriter();
+    // Registers a region holding buffers as fixed buffers, to save the
+    // kernel mapping the pages of each write
+    void registerRegion(void* base, size_t size);
+    int  open(const std::string& fileName);
+    int  close();
+    // Opens the file that rollover() switches to, ahead of time
+    int  prepare(const std::string& fileName);
+    // Finishes the current file and continues in the prepared one
+    void rollover();
+    // Writes the datagram, which is slotHead bytes into a buffer of slotSize
+    // bytes at slot, or anywhere when slot is null.  Returns the datagram as
+    // written, with its padding, which is a copy when it had to be bounced.
+    XtcData::Dgram* writeEvent(XtcData::Dgram* dgram, uint8_t* slot, size_t slotSize);
+    // Ends the current event
+    void release();
+public:
+    uint64_t inFlight() const { return m_inFlight.load(std::memory_order_relaxed); }
+    uint64_t nDirect()  const { return m_nDirect; }
+    uint64_t nBounced() const { return m_nBounced; }
+    uint64_t nPadding() const { return m_nPadding; }
+private:
+    enum Kind { Slot, Bounce, Wake };
+    struct Ring
+    {
+        int            fd;
+        void*          sqMap;
+        size_t         sqMapSize;
+        void*          cqMap;
+        size_t         cqMapSize;
+        io_uring_sqe*  sqes;
+        size_t         sqesSize;
+        unsigned*      sqHead;
+        unsigned*      sqTail;
+        unsigned       sqMask;
+        unsigned*      sqArray;
+        unsigned*      cqHead;
+        unsigned*      cqTail;
+        unsigned       cqMask;
+        io_uring_cqe*  cqes;
+    };
+private:
+    void     _setup(unsigned entries);
+    void     _submit(Kind kind, unsigned id, const uint8_t* buf, size_t len, uint64_t offset);
+    void     _complete();
+    void     _retire();
+    size_t   _pad(XtcData::Dgram* dgram, uint64_t pos) const;
+    int      _fixedIndex(const uint8_t* buf, size_t len) const;
+private:
+    size_t                  m_slotHead;
+    unsigned                m_nSlots;
+    std::function<void()>   m_freeSlot;
+    Ring                    m_ring;
+    std::vector<uint8_t*>   m_bounce;
+    size_t                  m_bounceSize;
+    std::vector<bool>       m_bounceBusy;
+    unsigned                m_nextBounce;
+    std::vector<std::pair<const uint8_t*, size_t> > m_fixed; // Registered buffers
+    int                     m_fd;
+    int                     m_nextFd;
+    uint64_t                m_pos;      // Where the next datagram starts
+    uint64_t                m_seq;      // The current event
+    uint64_t                m_retired;  // The oldest event not yet freed
+    std::vector<uint16_t>   m_pending;  // Writes in flight, per event
+    std::vector<bool>       m_released;
+    std::mutex              m_lock;
+    std::condition_variable m_cond;
+    std::atomic<uint64_t>   m_inFlight;
+    uint64_t                m_nDirect;
+    uint64_t                m_nBounced;
+    uint64_t                m_nPadding;
+    std::thread             m_thread;
+};
+
+}
@@ -25,6 +25,8 @@ namespace Drp {
 XpmDetector::XpmDetector(Parameters* para, MemPool* pool) :
     Detector(para, pool)
 {
+    if (pool->emulator())  return;      // No timing hardware to set up
+
     int fd = pool->fd();
 
     static const double flo[] = {115.,180.};
@@ -79,6 +81,11 @@ XpmDetector::XpmDetector(Parameters* para, MemPool* pool) :
 
 json XpmDetector::connectionInfo(const nlohmann::json& msg)
 {
+    if (m_pool->emulator()) {
+        // The DMA emulator stands in for the XPM too
+        return json({{"xpm_id", 0}, {"xpm_port", 0}});
+    }
+
     int fd = m_pool->fd();
 
     TEM* mem_pointer = (TEM*)0x00C20000;
@@ -162,6 +169,8 @@ void XpmDetector::connect(const json& connect_json, const std::string& collectio
     if (it != m_para->kwargs.end())
         m_length = stoi(it->second);
 
+    if (m_pool->emulator())  return;
+
     int fd = m_pool->fd();
     int links = m_para->laneMask;
 
@@ -194,6 +203,8 @@ unsigned XpmDetector::configure(const std::string& config_alias, XtcData::Xtc& x
 
 void XpmDetector::shutdown()
 {
+    if (m_pool->emulator())  return;
+
     int fd = m_pool->fd();
     int links = m_para->laneMask;
 
@@ -116,6 +116,8 @@ int main(int argc, char* argv[])
         if (kwargs.first == "ep_provider")       continue;  // PGPDetectorApp
         if (kwargs.first == "drp")               continue;  // PGPDetectorApp
         if (kwargs.first == "pythonScript")      continue;  // PGPDetectorApp
+        if (kwargs.first == "pyRingSlots")       continue;  // PGPDetectorApp
+        if (kwargs.first == "workStealing")      continue;  // PGPDetector
         if (kwargs.first == "sim_length")        continue;  // XpmDetector
         if (kwargs.first == "timebase")          continue;  // XpmDetector
         if (kwargs.first == "xpmpv")             continue;  // BEBDetector
@@ -124,8 +126,24 @@ int main(int argc, char* argv[])
         if (kwargs.first == "pebbleBufSize")     continue;  // DrpBase
         if (kwargs.first == "pebbleBufCount")    continue;  // DrpBase
         if (kwargs.first == "batching")          continue;  // DrpBase
+        if (kwargs.first == "batchLatency")      continue;  // TebContributor
+        if (kwargs.first == "pebbleHugePages")   continue;  // Placement
+        if (kwargs.first == "numaNode")          continue;  // Placement
+        if (kwargs.first == "pinReader")         continue;  // Placement
+        if (kwargs.first == "pinWorkers")        continue;  // Placement
+        if (kwargs.first == "pinCollector")      continue;  // Placement
+        if (kwargs.first == "pinEbReceiver")     continue;  // Placement
         if (kwargs.first == "directIO")          continue;  // DrpBase
+        if (kwargs.first == "recordUring")       continue;  // DrpBase
+        if (kwargs.first == "xtcIndex")          continue;  // DrpBase
         if (kwargs.first == "pva_addr")          continue;  // DrpBase
+        if (para.device == "emu") {
+            if (kwargs.first == "emuDmaCount")       continue;  // DmaEmulator
+            if (kwargs.first == "emuDmaSize")        continue;  // DmaEmulator
+            if (kwargs.first == "emuPayload")        continue;  // DmaEmulator
+            if (kwargs.first == "emuRate")           continue;  // DmaEmulator
+            if (kwargs.first == "emuFile")           continue;  // DmaEmulator
+        }
         if (para.detType == "opal") {
             if (kwargs.first == "simxtc")            continue;  // Opal
             if (kwargs.first == "simxtc2")           continue;  // Opal
@@ -8,7 +8,9 @@
 #include <mutex>
 #include <condition_variable>
 #include <string>
+#include <memory>
 #include "spscqueue.hh"
+#include "Placement.hh"
 
 #define PGP_MAX_LANES 8
 
@@ -18,6 +20,8 @@ namespace Pds {
 
 namespace Drp {
 
+class DmaEmulator;
+
 enum NamesIndex
 {
    BASE         = 0,
@@ -75,13 +79,15 @@ struct PGPEvent
 class Pebble
 {
 public:
+    Pebble() : m_size(0), m_bufferSize(0), m_buffer(nullptr) {}
     ~Pebble() {
         if (m_buffer) {
-            delete m_buffer;
+            Placement::release(m_buffer, m_size);
             m_buffer = nullptr;
         }
     }
-    void create(unsigned nL1Buffers, size_t l1BufSize, unsigned nTrBuffers, size_t trBufSize);
+    void create(unsigned nL1Buffers, size_t l1BufSize, unsigned nTrBuffers, size_t trBufSize,
+                Placement& placement);
 
     inline uint8_t* operator [] (unsigned index) {
         uint64_t offset = index*m_bufferSize;
@@ -109,6 +115,8 @@ public:
     unsigned nbuffers() const {return m_nbuffers;}
     size_t bufferSize() const {return pebble.bufferSize();}
     int fd() const {return m_fd;}
+    DmaEmulator* emulator() const {return m_emulator.get();}
+    const Placement& placement() const {return m_placement;}
     void shutdown();
     Pds::EbDgram* allocateTr();
     void freeTr(Pds::EbDgram* dgram) { m_transitionBuffers.push(dgram); }
@@ -127,6 +135,8 @@ private:
     unsigned m_nbuffers;
     unsigned m_dmaSize;
     int m_fd;
+    std::unique_ptr<DmaEmulator> m_emulator;
+    Placement m_placement;
     bool m_setMaskBytesDone;
     SPSCQueue<void*> m_transitionBuffers;
     std::atomic<uint64_t> m_dmaAllocs;
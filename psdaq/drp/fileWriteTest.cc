@@ -12,9 +12,14 @@
 #include <iostream>
 #include <string>
 #include <cassert>
+#include <cstring>
+#include <atomic>
+#include <thread>
 #include "psalg/utils/SysLog.hh"
 
 #include "FileWriter.hh"
+#include "UringFileWriter.hh"
+#include "xtcdata/xtc/XtcFileIterator.hh"
 
 using logging = psalg::SysLog;
 
@@ -319,6 +324,169 @@ long long option_8(const std::vector<uint64_t>& data,
     return std::chrono::duration_cast<std::chrono::microseconds>(endTime - startTime).count();
 }
 
+// A ring of buffers laid out like the pebble, each holding an 8 byte PulseId
+// followed by a datagram of dgramSize bytes
+class Slots
+{
+public:
+    static const size_t Head = sizeof(uint64_t);
+    Slots(unsigned count, size_t dgramSize) :
+      m_count(count), m_dgramSize(dgramSize),
+      m_slotSize(Drp::UringFileWriter::slotSize(Head + dgramSize)),
+      m_buffer(nullptr)
+    {
+      if (posix_memalign((void**)&m_buffer, Drp::UringFileWriter::BlockSize, count * m_slotSize))
+        throw "posix_memalign failed";
+      memset(m_buffer, 0x5a, count * m_slotSize);
+    }
+    ~Slots() { free(m_buffer); }
+    uint8_t* slot(uint64_t i) { return m_buffer + (i % m_count) * m_slotSize; }
+    XtcData::Dgram* dgram(uint64_t i)
+    {
+      // Rebuilt each time, as a writer may have padded it
+      auto dg = (XtcData::Dgram*)(slot(i) + Head);
+      *(uint64_t*)slot(i) = i;
+      dg->time = XtcData::TimeStamp(i);
+      dg->env  = XtcData::TransitionId::L1Accept << 24;
+      dg->xtc  = XtcData::Xtc(XtcData::TypeId(XtcData::TypeId::Parent, 0));
+      dg->xtc.extent += m_dgramSize - sizeof(*dg);
+      return dg;
+    }
+    unsigned count() const    { return m_count; }
+    size_t   slotSize() const { return m_slotSize; }
+    uint8_t* base() const     { return m_buffer; }
+private:
+    unsigned m_count;
+    size_t   m_dgramSize;
+    size_t   m_slotSize;
+    uint8_t* m_buffer;
+};
+
+// Counts the datagrams of a file, to check that it reads back
+static uint64_t countDgrams(const std::string& filename, size_t maxSize)
+{
+    int fd = ::open(filename.c_str(), O_RDONLY);
+    if (fd < 0)  return 0;
+    XtcData::XtcFileIterator iter(fd, maxSize);
+    uint64_t n = 0;
+    while (iter.next())  ++n;
+    ::close(fd);
+    return n;
+}
+
+// Records datagrams built in pebble-like slots for a while with
+// BufferedFileWriterMT, which copies them into its buffers
+long long option_9(const std::string& filename,
+                   size_t dgramSize,
+                   unsigned tmoS,
+                   size_t& totSize,
+                   uint64_t& nDgrams)
+{
+    // Filesystems that need O_DIRECT writes to be aligned fail the batches of
+    // datagrams of other sizes
+    const bool dio = dgramSize % Drp::UringFileWriter::BlockSize == 0;
+    if (!dio)  logging::info("BufferedFileWriterMT: without O_DIRECT for unaligned dgrams");
+    Slots slots(64, dgramSize);
+    Drp::BufferedFileWriterMT fileWriter(slots.slotSize(), dio);
+
+    unlink(filename.c_str());
+    if (fileWriter.open(filename) != 0)  throw "open failed";
+
+    totSize = 0;
+    nDgrams = 0;
+    auto tmo       = std::chrono::seconds(tmoS);
+    auto startTime = std::chrono::high_resolution_clock::now();
+    do
+    {
+      for (unsigned i = 0; i < 256; ++i, ++nDgrams)
+      {
+        auto dg = slots.dgram(nDgrams);
+        fileWriter.writeEvent(dg, dgramSize, dg->time);
+        totSize += dgramSize;
+      }
+    } while (std::chrono::high_resolution_clock::now() - startTime < tmo);
+    fileWriter.close();
+    auto endTime = std::chrono::high_resolution_clock::now();
+
+    return std::chrono::duration_cast<std::chrono::microseconds>(endTime - startTime).count();
+}
+
+// The same with UringFileWriter, which writes them from the slots, which are
+// freed in order as their writes complete
+long long option_10(const std::string& filename,
+                    size_t dgramSize,
+                    unsigned tmoS,
+                    size_t& totSize,
+                    uint64_t& nDgrams)
+{
+    Slots slots(64, dgramSize);
+    std::atomic<uint64_t> nFreed(0);
+    Drp::UringFileWriter fileWriter(Slots::Head + dgramSize, Slots::Head, slots.count(),
+                                    [&nFreed]() { nFreed.fetch_add(1, std::memory_order_release); });
+    fileWriter.registerRegion(slots.base(), slots.count() * slots.slotSize());
+
+    unlink(filename.c_str());
+    if (fileWriter.open(filename) != 0)  throw "open failed";
+
+    totSize = 0;
+    nDgrams = 0;
+    auto tmo       = std::chrono::seconds(tmoS);
+    auto startTime = std::chrono::high_resolution_clock::now();
+    do
+    {
+      for (unsigned i = 0; i < 256; ++i, ++nDgrams)
+      {
+        // Wait for a free slot, as MemPool::allocate() does
+        while (nDgrams - nFreed.load(std::memory_order_acquire) >= slots.count())
+          std::this_thread::yield();
+        auto dg = slots.dgram(nDgrams);
+        fileWriter.writeEvent(dg, slots.slot(nDgrams), slots.slotSize());
+        fileWriter.release();
+        totSize += dgramSize;
+      }
+    } while (std::chrono::high_resolution_clock::now() - startTime < tmo);
+    fileWriter.close();
+    auto endTime = std::chrono::high_resolution_clock::now();
+
+    logging::info("UringFileWriter: %lu direct, %lu bounced, %lu bytes of padding",
+                  fileWriter.nDirect(), fileWriter.nBounced(), fileWriter.nPadding());
+
+    return std::chrono::duration_cast<std::chrono::microseconds>(endTime - startTime).count();
+}
+
+static int compareWriters(const std::string& base, const std::string& mode,
+                          size_t dgramSize, unsigned durationS)
+{
+    int rc = 0;
+    for (auto which : {std::string("mt"), std::string("uring")})
+    {
+      if (mode != "cmp" && mode != which)  continue;
+      if (which == "uring" && !Drp::UringFileWriter::available())
+      {
+        std::cout << "io_uring is not available\n";
+        rc = 1;
+        continue;
+      }
+      std::string filename = base + (which == "mt" ? "9.xtc2" : "10.xtc2");
+      size_t   totSize;
+      uint64_t nDgrams;
+      auto dt = which == "mt"
+              ? option_9 (filename, dgramSize, durationS, totSize, nDgrams)
+              : option_10(filename, dgramSize, durationS, totSize, nDgrams);
+      uint64_t nRead = countDgrams(filename, 2 * Slots::Head + dgramSize + Drp::UringFileWriter::BlockSize);
+
+      std::cout << (which == "mt" ? "BufferedFileWriterMT" : "UringFileWriter     ") << ", "
+                << durationS << "S @ " << dgramSize << " B dgrams: "
+                << dt << " us, "
+                << double(totSize) / double(dt) << " MB/s, "
+                << double(nDgrams) / double(dt) << " MHz, "
+                << nRead << " of " << nDgrams << " dgrams read back"
+                << std::endl;
+      if (nRead != nDgrams)  rc = 1;
+    }
+    return rc;
+}
+
 
 int main(int argc, char* argv[])
 {
@@ -329,9 +497,11 @@ int main(int argc, char* argv[])
 //    unsigned count = 1;
     std::string base("/u1/claus/opt");
     unsigned verbose = 0;
+    std::string mode;
+    size_t dgramSize = 1 * MB;
 
     int c;
-    while((c = getopt(argc, argv, "B:n:r:m:b:t:v")) != EOF)
+    while((c = getopt(argc, argv, "B:n:r:m:b:t:M:s:v")) != EOF)
     {
         switch(c)
         {
@@ -341,6 +511,8 @@ int main(int argc, char* argv[])
           case 't':  durationS = std::stoi(optarg);       break;
 //          case 'm':  minRecSz  = std::stoi(optarg) * MB;  break;
           case 'b':  maxRecSz  = std::stoi(optarg) * MB;  break;
+          case 'M':  mode      = optarg;                  break;
+          case 's':  dgramSize = std::stoul(optarg);      break;
           case 'v':  ++verbose;                           break;
           default:
             printf("%s "
@@ -350,6 +522,8 @@ int main(int argc, char* argv[])
                    "[-t <duration (S)>]"
                    "[-m <min record size (MB)>]"
                    "[-b <max record size (MB)>]"
+                   "[-M <mt | uring | cmp: record dgrams with either writer or both>]"
+                   "[-s <dgram size (B) for -M>]"
                    "[-v]\n", argv[0]);
             return 1;
         }
@@ -360,6 +534,9 @@ int main(int argc, char* argv[])
         default: logging::init("tst", LOG_DEBUG);  break;
     }
 
+    if (!mode.empty())
+        return compareWriters(base, mode, dgramSize & ~size_t(3), durationS);
+
     //size_t totSize = repeat * maxRecSz;      // Total bytes per file
     //std::vector<uint64_t> data = GenerateData(count * totSize);
     std::vector<uint64_t> data(maxRecSz/8); // = GenerateData(maxRecSz);
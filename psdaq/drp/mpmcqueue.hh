@@ -0,0 +1,182 @@
+#ifndef MPMCQUEUE_H
+#define MPMCQUEUE_H
+
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <condition_variable>
+#include <cstdio>
+
+#include "psdaq/service/fast_monotonic_clock.hh"
+
+// Bounded lock-free multiple producer multiple consumer queue.  Each slot
+// carries a sequence number telling whether it is ready to be written or
+// read for the current lap, so that producers and consumers only contend on
+// a compare-exchange of their own index.  Consumers poll for a while before
+// blocking, like SPSCQueue::pop(), and producers only take the lock when a
+// consumer is known to be blocked.
+template <typename T>
+class MPMCQueue
+{
+    using us_t = std::chrono::microseconds;
+public:
+    MPMCQueue(int capacity) : m_terminate(false), m_waiters(0), m_cells(capacity),
+                              m_write_index(0), m_read_index(0)
+    {
+        if ((capacity & (capacity - 1)) != 0) {
+            fprintf(stderr, "MPMCQueue capacity must be a power of 2, got %d\n", capacity);
+            throw "MPMCQueue capacity must be a power of 2";
+        };
+        for (int i = 0; i < capacity; i++) {
+            m_cells[i].sequence.store(i, std::memory_order_relaxed);
+        }
+        m_buffer_mask = capacity - 1;
+    }
+
+    MPMCQueue(const MPMCQueue&) = delete;
+    void operator=(const MPMCQueue&) = delete;
+
+    // non blocking write to queue, false when full
+    bool try_push(const T& value)
+    {
+        Cell* cell;
+        int64_t index = m_write_index.load(std::memory_order_relaxed);
+        while (true) {
+            cell = &m_cells[index & m_buffer_mask];
+            int64_t diff = cell->sequence.load(std::memory_order_acquire) - index;
+            if (diff == 0) {
+                if (m_write_index.compare_exchange_weak(index, index + 1, std::memory_order_relaxed))
+                    break;
+            } else if (diff < 0) {
+                return false;
+            } else {
+                index = m_write_index.load(std::memory_order_relaxed);
+            }
+        }
+        cell->value = value;
+        cell->sequence.store(index + 1, std::memory_order_release);
+        // pairs with the waiter count increment in pop()
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (m_waiters.load(std::memory_order_relaxed)) {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_condition.notify_one();
+        }
+        return true;
+    }
+
+    // the queue is sized for everything in flight, so it is not expected to fill
+    void push(const T& value)
+    {
+        while (!try_push(value)) {
+            std::this_thread::yield();
+        }
+    }
+
+    // non blocking read from queue
+    bool try_pop(T& value)
+    {
+        Cell* cell;
+        int64_t index = m_read_index.load(std::memory_order_relaxed);
+        while (true) {
+            cell = &m_cells[index & m_buffer_mask];
+            int64_t diff = cell->sequence.load(std::memory_order_acquire) - (index + 1);
+            if (diff == 0) {
+                if (m_read_index.compare_exchange_weak(index, index + 1, std::memory_order_relaxed))
+                    break;
+            } else if (diff < 0) {
+                return false;
+            } else {
+                index = m_read_index.load(std::memory_order_relaxed);
+            }
+        }
+        value = cell->value;
+        cell->sequence.store(index + m_buffer_mask + 1, std::memory_order_release);
+        return true;
+    }
+
+    // blocking read from queue with polling for the 1st N us before blocking;
+    // returns false when the queue is shut down and empty, or as soon as
+    // interrupt() is true (it is checked again after each wakeAll())
+    template <typename Interrupt>
+    bool pop(T& value, Interrupt interrupt)
+    {
+        auto t0 = Pds::fast_monotonic_clock::now(CLOCK_MONOTONIC);
+        while (!try_pop(value)) {
+            if (interrupt() || m_terminate.load(std::memory_order_acquire)) {
+                return false;
+            }
+            auto t1 = Pds::fast_monotonic_clock::now(CLOCK_MONOTONIC);
+            if (std::chrono::duration_cast<us_t>(t1 - t0).count() > 1000) {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_waiters.fetch_add(1, std::memory_order_relaxed);
+                // pairs with the fence in try_push()
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                m_condition.wait(lock, [&] {
+                    return !is_empty() || m_terminate.load(std::memory_order_acquire) || interrupt();
+                });
+                m_waiters.fetch_sub(1, std::memory_order_relaxed);
+                t0 = Pds::fast_monotonic_clock::now(CLOCK_MONOTONIC);
+            }
+        }
+        return true;
+    }
+
+    bool pop(T& value)
+    {
+        return pop(value, [] { return false; });
+    }
+
+    // makes blocked consumers reevaluate their interrupt condition
+    void wakeAll()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_condition.notify_all();
+    }
+
+    bool is_empty()
+    {
+        int64_t index = m_read_index.load(std::memory_order_acquire);
+        return m_cells[index & m_buffer_mask].sequence.load(std::memory_order_acquire) - (index + 1) < 0;
+    }
+
+    int guess_size()
+    {
+        return m_write_index.load(std::memory_order_acquire) -
+               m_read_index.load(std::memory_order_acquire);
+    }
+
+    size_t size()
+    {
+        return m_cells.size();
+    }
+
+    void shutdown()
+    {
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_terminate.store(true, std::memory_order_release);
+        }
+        m_condition.notify_all();
+    }
+
+private:
+    struct Cell
+    {
+        std::atomic<int64_t> sequence;
+        T value;
+    };
+
+private:
+    std::mutex m_mutex;
+    std::condition_variable m_condition;
+    std::atomic<bool> m_terminate;
+    std::atomic<int> m_waiters;
+    int64_t m_buffer_mask;
+    std::vector<Cell> m_cells;
+    alignas(64) std::atomic<int64_t> m_write_index;
+    alignas(64) std::atomic<int64_t> m_read_index;
+    char _pad[64 - sizeof(std::atomic<int64_t>)];
+};
+
+#endif // MPMCQUEUE_H
@@ -1,13 +1,54 @@
+// Tests and benchmarks of the DRP queues:
+//   -t mpsc        8 producers push N entries into an MPSCQueue, which the
+//                  consumer writes to test.dat (the original test)
+//   -t throughput  entries per second from a producer to a consumer, for
+//                  SPSCQueue and for SPSCBulkQueue one at a time and in
+//                  bursts of -b
+//   -t latency     round trip time of an entry sent back and forth through
+//                  a pair of queues, of each kind
+//   -t steal       a reader hands batches to 4 workers through the shared
+//                  queue of PGPDetector's work stealing, broadcasting
+//                  transitions among them, while the workers take random
+//                  times over each; checks that every worker sees the
+//                  batches it takes and the transitions in the order sent
+//   -t all         throughput and latency (the default)
+// The producer and the consumer are pinned to the cores given with -p and
+// -c, so that running it for pairs of cores on the same and on different
+// sockets shows the effect of the cache line traffic.
+
 #include "mpscqueue.hh"
+#include "spscqueue.hh"
+#include "workerinput.hh"
+#include "psdaq/service/SPSCBulkQueue.hh"
+#include <algorithm>
 #include <chrono>
+#include <cstring>
 #include <fstream>
 #include <iostream>
+#include <random>
+#include <string>
 #include <thread>
+#include <getopt.h>
+#include <pthread.h>
 #include <unistd.h>
 #include <vector>
 
+using ns_t = std::chrono::nanoseconds;
+
 const int N = 1048576;
 
+static void pin(int core)
+{
+    if (core < 0)  return;
+    cpu_set_t cpuset;
+    CPU_ZERO(&cpuset);
+    CPU_SET(core, &cpuset);
+    int rc = pthread_setaffinity_np(pthread_self(), sizeof(cpuset), &cpuset);
+    if (rc) {
+        fprintf(stderr, "Error pinning to core %d: %s\n", core, strerror(rc));
+    }
+}
+
 void producer(MPSCQueue& queue, uint32_t* buffer, int rank)
 {
     int length = N / 8;
@@ -18,7 +59,7 @@ void producer(MPSCQueue& queue, uint32_t* buffer, int rank)
     }
 }
 
-int main()
+static int testMpsc()
 {
     int nworkers = 8;
 
@@ -43,3 +84,236 @@ int main()
     delete[] buffer;
     return 0;
 }
+
+// SPSCQueue doesn't check for a full queue, so the producer keeps it from
+// filling, as its users do by sizing it for everything in flight
+static bool pushOld(SPSCQueue<uint64_t>& queue, uint64_t value, size_t capacity)
+{
+    while (queue.guess_size() >= int(capacity) - 1)  std::this_thread::yield();
+    queue.push(value);
+    return true;
+}
+
+static double throughputOld(unsigned capacity, uint64_t count, int pCore, int cCore)
+{
+    SPSCQueue<uint64_t> queue(capacity);
+    uint64_t sum = 0;
+    std::thread consumer([&] {
+        pin(cCore);
+        uint64_t value;
+        for (uint64_t i = 0; i < count; i++) {
+            queue.pop(value);
+            sum += value;
+        }
+    });
+    pin(pCore);
+    auto t0 = std::chrono::steady_clock::now();
+    for (uint64_t i = 0; i < count; i++)  pushOld(queue, i, capacity);
+    consumer.join();
+    auto t1 = std::chrono::steady_clock::now();
+    if (sum != count * (count - 1) / 2)  fprintf(stderr, "SPSCQueue lost entries\n");
+    return double(count) / std::chrono::duration<double>(t1 - t0).count();
+}
+
+static double throughputNew(unsigned capacity, uint64_t count, unsigned burst, int pCore, int cCore)
+{
+    SPSCBulkQueue<uint64_t> queue(capacity);
+    uint64_t sum = 0;
+    std::thread consumer([&] {
+        pin(cCore);
+        std::vector<uint64_t> values(burst);
+        uint64_t i = 0;
+        while (i < count) {
+            size_t n = burst > 1 ? queue.pop_n(values.data(), burst)
+                                 : queue.pop(values[0]);
+            for (size_t j = 0; j < n; j++)  sum += values[j];
+            i += n;
+        }
+    });
+    pin(pCore);
+    std::vector<uint64_t> values(burst);
+    auto t0 = std::chrono::steady_clock::now();
+    for (uint64_t i = 0; i < count; i += burst) {
+        if (burst > 1) {
+            size_t n = std::min(uint64_t(burst), count - i);
+            for (size_t j = 0; j < n; j++)  values[j] = i + j;
+            queue.push_n(values.data(), n);
+        } else {
+            queue.push(i);
+        }
+    }
+    consumer.join();
+    auto t1 = std::chrono::steady_clock::now();
+    if (sum != count * (count - 1) / 2)  fprintf(stderr, "SPSCBulkQueue lost entries\n");
+    if (queue.full_count())  printf("  (SPSCBulkQueue was full %lu times)\n", queue.full_count());
+    return double(count) / std::chrono::duration<double>(t1 - t0).count();
+}
+
+// Sends an entry to the echo thread and waits for it to come back, count
+// times, and prints the median and the 99th percentile of the round trips
+template <typename Q>
+static void latency(const char* name, unsigned capacity, unsigned count, int pCore, int cCore)
+{
+    Q ping(capacity);
+    Q pong(capacity);
+    std::thread echo([&] {
+        pin(cCore);
+        uint64_t value;
+        for (unsigned i = 0; i < count; i++) {
+            ping.pop(value);
+            pong.push(value);
+        }
+    });
+    pin(pCore);
+    std::vector<int64_t> dt(count);
+    for (unsigned i = 0; i < count; i++) {
+        uint64_t value;
+        auto t0 = std::chrono::steady_clock::now();
+        ping.push(i);
+        pong.pop(value);
+        auto t1 = std::chrono::steady_clock::now();
+        dt[i] = std::chrono::duration_cast<ns_t>(t1 - t0).count();
+    }
+    echo.join();
+    std::sort(dt.begin(), dt.end());
+    printf("%-28s round trip: median %6ld ns, 99%% %6ld ns\n", name, dt[count / 2], dt[count * 99 / 100]);
+}
+
+static void testThroughput(unsigned capacity, uint64_t count, unsigned burst, int pCore, int cCore)
+{
+    printf("Throughput of %lu entries through queues of %u, cores %d -> %d:\n", count, capacity, pCore, cCore);
+    printf("  %-26s %8.2f M/s\n", "SPSCQueue", throughputOld(capacity, count, pCore, cCore) / 1e6);
+    printf("  %-26s %8.2f M/s\n", "SPSCBulkQueue", throughputNew(capacity, count, 1, pCore, cCore) / 1e6);
+    std::string bulk = "SPSCBulkQueue, bursts of " + std::to_string(burst);
+    printf("  %-26s %8.2f M/s\n", bulk.c_str(), throughputNew(capacity, count, burst, pCore, cCore) / 1e6);
+}
+
+static void testLatency(unsigned capacity, unsigned count, int pCore, int cCore)
+{
+    printf("Latency over %u round trips, cores %d <-> %d:\n", count, pCore, cCore);
+    latency<SPSCQueue<uint64_t> >    ("  SPSCQueue",     capacity, count, pCore, cCore);
+    latency<SPSCBulkQueue<uint64_t> >("  SPSCBulkQueue", capacity, count, pCore, cCore);
+}
+
+// The reader sends count batches, about one in 100 of them a transition that
+// is broadcast to all workers, as PGPDetector::reader() does with work
+// stealing.  Each worker records the order in which it gets its batches;
+// each must be in the order sent, every transition must reach every worker
+// and every other batch exactly one
+static int testSteal(uint64_t count)
+{
+    const unsigned nworkers = 4;
+    unsigned capacity = 1;
+    while (capacity < count)  capacity <<= 1;
+
+    MPMCQueue<Drp::Batch> shared(capacity);
+    std::vector<SPSCQueue<Drp::Batch> > own;
+    std::vector<std::atomic<uint64_t> > steals(nworkers);
+    std::vector<std::vector<uint32_t> > seen(nworkers);
+    for (unsigned i = 0; i < nworkers; i++) {
+        own.emplace_back(SPSCQueue<Drp::Batch>(capacity));
+        steals[i] = 0;
+    }
+
+    std::vector<std::thread> workers;
+    for (unsigned i = 0; i < nworkers; i++) {
+        workers.emplace_back([&, i] {
+            Drp::WorkerInput input(own[i], &shared, nworkers, i, steals[i]);
+            std::mt19937 rng(i + 1);
+            std::uniform_int_distribution<unsigned> delay(0, 999);
+            Drp::Batch batch;
+            while (input.pop(batch)) {
+                seen[i].push_back(batch.seq);
+                unsigned us = delay(rng);       // Mostly short, now and then long
+                if (us > 990)  std::this_thread::sleep_for(std::chrono::microseconds(us - 900));
+                else if (us > 900)  std::this_thread::yield();
+            }
+        });
+    }
+
+    std::mt19937 rng(0);
+    std::uniform_int_distribution<unsigned> pick(0, 99);
+    std::vector<uint8_t> transition(count, 0);
+    for (uint32_t seq = 0; seq < count; seq++) {
+        Drp::Batch batch{0, 1, seq};
+        if (pick(rng) == 0) {
+            transition[seq] = 1;
+            for (auto& queue : own)  queue.push(batch);
+            shared.wakeAll();
+        } else {
+            shared.push(batch);
+        }
+    }
+    while (!shared.is_empty())  std::this_thread::yield();
+    for (auto& queue : own) {
+        while (!queue.is_empty())  std::this_thread::yield();
+    }
+    shared.shutdown();
+    for (auto& queue : own)  queue.shutdown();
+    for (auto& worker : workers)  worker.join();
+
+    int rc = 0;
+    std::vector<unsigned> times(count, 0);
+    for (unsigned i = 0; i < nworkers; i++) {
+        for (size_t j = 0; j < seen[i].size(); j++) {
+            if (j && seen[i][j] <= seen[i][j - 1]) {
+                if (rc++ < 10) {
+                    fprintf(stderr, "Worker %u got %s %u after %s %u\n", i,
+                            transition[seen[i][j]]     ? "transition" : "batch", seen[i][j],
+                            transition[seen[i][j - 1]] ? "transition" : "batch", seen[i][j - 1]);
+                }
+            }
+            times[seen[i][j]]++;
+        }
+    }
+    for (uint32_t seq = 0; seq < count; seq++) {
+        if (times[seq] != (transition[seq] ? nworkers : 1)) {
+            if (rc++ < 10)  fprintf(stderr, "Batch %u was handled %u times\n", seq, times[seq]);
+        }
+    }
+
+    uint64_t stolen = 0;
+    for (auto& n : steals)  stolen += n;
+    printf("%lu batches to %u workers, %lu stolen: %s\n",
+           count, nworkers, stolen, rc ? "FAILED" : "passed");
+    return rc ? 1 : 0;
+}
+
+int main(int argc, char* argv[])
+{
+    std::string test("all");
+    unsigned capacity = 4096;
+    uint64_t count    = 10000000;
+    unsigned burst    = 32;
+    int      pCore    = -1;
+    int      cCore    = -1;
+
+    int c;
+    while((c = getopt(argc, argv, "t:q:n:b:p:c:h")) != EOF)
+    {
+        switch(c)
+        {
+          case 't':  test     = optarg;              break;
+          case 'q':  capacity = std::stoul(optarg);  break;
+          case 'n':  count    = std::stoull(optarg); break;
+          case 'b':  burst    = std::stoul(optarg);  break;
+          case 'p':  pCore    = std::stoi(optarg);   break;
+          case 'c':  cCore    = std::stoi(optarg);   break;
+          default:
+            printf("%s "
+                   "[-t <mpsc|steal|throughput|latency|all>] "
+                   "[-q <queue capacity>] "
+                   "[-n <entry count>] "
+                   "[-b <burst size>] "
+                   "[-p <producer core>] "
+                   "[-c <consumer core>]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    if (test == "mpsc")  return testMpsc();
+    if (test == "steal")  return testSteal(std::min(count, uint64_t(1000000)));
+    if (test == "throughput" || test == "all")  testThroughput(capacity, count, std::max(burst, 1u), pCore, cCore);
+    if (test == "latency"    || test == "all")  testLatency(capacity, std::min(count, uint64_t(100000)), pCore, cCore);
+    return 0;
+}
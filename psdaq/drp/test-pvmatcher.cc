@@ -0,0 +1,245 @@
+// Benchmark of matching events to PV updates, as PvDetector does, for PV
+// counts from 1 to 1000 (or those given with -m):
+//   scan     the original way, which for the oldest event walks the PVs it
+//            still needs, with a bit per PV
+//   matcher  PvMatcher, with the events of each batch of -b matched at once
+// Events come every -p ns and each PV updates every 1 to -u events, with
+// timestamps that are mostly those of an event and sometimes in between.
+// The updates arrive -l events after the event they go with.  Both ways must
+// come to the same number of matched, younger and discarded updates.
+
+#include "PvMatcher.hh"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <deque>
+#include <getopt.h>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace XtcData;
+using namespace Drp;
+
+namespace {
+
+struct Update
+{
+    uint64_t seq;                       // Event after which it arrives
+    unsigned id;
+    uint64_t time;
+};
+
+struct Results
+{
+    uint64_t nMatch;
+    uint64_t nYounger;
+    uint64_t nTooOld;
+    uint64_t nReleased;
+    double   seconds;
+};
+
+// The synthetic timeline, in order of arrival
+struct Timeline
+{
+    std::vector<uint64_t> evtTimes;
+    std::vector<Update>   updates;      // Sorted by seq
+};
+
+Timeline makeTimeline(unsigned nPvs, unsigned nEvents, uint64_t period, unsigned maxEvery, unsigned lag)
+{
+    Timeline timeline;
+    std::mt19937 rng(nPvs);
+    const uint64_t t0 = uint64_t(1000000000) << 32; // Clear of 0 and of TimeMax
+    for (unsigned i = 0; i < nEvents; ++i) {
+        timeline.evtTimes.push_back(TimeStamp().from_ns(i * period).value() + t0);
+    }
+    for (unsigned id = 0; id < nPvs; ++id) {
+        unsigned every = 1 + rng() % maxEvery;
+        for (unsigned i = rng() % every; i < nEvents; i += every) {
+            uint64_t ns = i * period + (rng() % 8 == 0 ? period / 2 : 0); // Some fall between events
+            timeline.updates.push_back({i + lag, id, TimeStamp().from_ns(ns).value() + t0});
+        }
+    }
+    std::stable_sort(timeline.updates.begin(), timeline.updates.end(),
+                     [](const Update& a, const Update& b) { return a.seq < b.seq; });
+    return timeline;
+}
+
+int compareTs(const TimeStamp& evtTime, const TimeStamp& pvTime)
+{
+    if (evtTime > pvTime)  return 1;
+    if (pvTime > evtTime)  return -1;
+    return 0;
+}
+
+// Stands in for PvDetector, with a queue of update times per PV
+class Detector final : public PvMatcher::Client
+{
+public:
+    Detector(unsigned nPvs) : pvQueues(nPvs), results{} {}
+    int  compare(const TimeStamp& evtTime, const TimeStamp& pvTime) override { return compareTs(evtTime, pvTime); }
+    bool pvTime(unsigned id, TimeStamp& time) override
+    {
+        if (pvQueues[id].empty())  return false;
+        time = pvQueues[id].front();
+        return true;
+    }
+    void tEvtEqPv(unsigned id, uint32_t index) override  { pvQueues[id].pop_front();  ++results.nMatch; }
+    void tEvtGtPv(unsigned id, uint32_t index) override  { pvQueues[id].pop_front();  ++results.nTooOld; }
+    void pvTimeout(unsigned id, const TimeStamp& timeout) override
+    {
+        if (!pvQueues[id].empty() && !(pvQueues[id].front() > timeout))  pvQueues[id].pop_front();
+    }
+    void release(uint32_t index, unsigned nYounger, bool timedOut) override
+    {
+        results.nYounger += nYounger;
+        ++results.nReleased;
+    }
+public:
+    std::vector<std::deque<TimeStamp>> pvQueues;
+    Results results;
+};
+
+Results runMatcher(const Timeline& timeline, unsigned nPvs, unsigned batch)
+{
+    Detector  det(nPvs);
+    PvMatcher matcher(1 << 16);
+    matcher.startup(nPvs);
+
+    auto t0 = std::chrono::steady_clock::now();
+    auto update = timeline.updates.begin();
+    const uint64_t nEvents = timeline.evtTimes.size();
+    for (uint64_t seq = 0; seq < nEvents; ++seq) {
+        matcher.push(seq, TimeStamp(timeline.evtTimes[seq]), true);
+        while (update != timeline.updates.end() && update->seq <= seq) {
+            det.pvQueues[update->id].push_back(TimeStamp(update->time));
+            matcher.ready(update->id);
+            ++update;
+        }
+        if ((seq + 1) % batch == 0)  matcher.match(det);
+    }
+    // Updates newer than all the events resolve the rest
+    for (unsigned id = 0; id < nPvs; ++id) {
+        det.pvQueues[id].push_back(TimeStamp(uint64_t(~0ull >> 1)));
+        matcher.ready(id);
+    }
+    matcher.match(det);
+    auto t1 = std::chrono::steady_clock::now();
+
+    det.results.seconds = std::chrono::duration<double>(t1 - t0).count();
+    return det.results;
+}
+
+// The matching PvDetector did before PvMatcher
+Results runScan(const Timeline& timeline, unsigned nPvs)
+{
+    struct Event
+    {
+        TimeStamp             time;
+        std::vector<uint64_t> remaining;
+    };
+    Detector det(nPvs);
+    std::deque<Event> events;
+    std::vector<uint64_t> contract((nPvs + 63) / 64, ~0ull);
+    if (nPvs % 64)  contract.back() = (1ull << (nPvs % 64)) - 1;
+
+    auto matchUp = [&]() {
+        while (!events.empty()) {
+            Event& evt = events.front();
+            bool remaining = false;
+            for (unsigned word = 0; word < evt.remaining.size(); ++word) {
+                uint64_t bits = evt.remaining[word];
+                while (bits) {
+                    unsigned id = word * 64 + __builtin_ctzll(bits);
+                    bits &= bits - 1;
+                    TimeStamp pvTime;
+                    if (!det.pvTime(id, pvTime))  continue;
+                    int result = compareTs(evt.time, pvTime);
+                    if      (result == 0) { det.tEvtEqPv(id, 0);  evt.remaining[word] &= ~(1ull << (id % 64)); }
+                    else if (result  < 0) { ++det.results.nYounger;  evt.remaining[word] &= ~(1ull << (id % 64)); }
+                    else                  { det.tEvtGtPv(id, 0); }
+                }
+                remaining |= evt.remaining[word] != 0;
+            }
+            if (remaining)  break;
+            ++det.results.nReleased;
+            events.pop_front();
+        }
+    };
+
+    auto t0 = std::chrono::steady_clock::now();
+    auto update = timeline.updates.begin();
+    const uint64_t nEvents = timeline.evtTimes.size();
+    for (uint64_t seq = 0; seq < nEvents; ++seq) {
+        events.push_back({TimeStamp(timeline.evtTimes[seq]), contract});
+        while (update != timeline.updates.end() && update->seq <= seq) {
+            det.pvQueues[update->id].push_back(TimeStamp(update->time));
+            ++update;
+        }
+        matchUp();
+    }
+    for (unsigned id = 0; id < nPvs; ++id) {
+        det.pvQueues[id].push_back(TimeStamp(uint64_t(~0ull >> 1)));
+    }
+    while (!events.empty())  matchUp(); // It discards one old update per PV per call
+    auto t1 = std::chrono::steady_clock::now();
+
+    det.results.seconds = std::chrono::duration<double>(t1 - t0).count();
+    return det.results;
+}
+
+}
+
+int main(int argc, char* argv[])
+{
+    std::vector<unsigned> pvCounts{1, 2, 5, 10, 20, 50, 100, 200, 500, 1000};
+    unsigned nEvents  = 100000;
+    uint64_t period   = 1000000000 / 120;
+    unsigned maxEvery = 10;
+    unsigned lag      = 2;
+    unsigned batch    = 16;
+
+    int c;
+    while((c = getopt(argc, argv, "m:n:p:u:l:b:h")) != EOF)
+    {
+        switch(c)
+        {
+          case 'm':  pvCounts = {unsigned(std::stoul(optarg))}; break;
+          case 'n':  nEvents  = std::stoul(optarg);  break;
+          case 'p':  period   = std::stoull(optarg); break;
+          case 'u':  maxEvery = std::stoul(optarg);  break;
+          case 'l':  lag      = std::stoul(optarg);  break;
+          case 'b':  batch    = std::stoul(optarg);  break;
+          default:
+            printf("%s "
+                   "[-m <PV count>] "
+                   "[-n <event count>] "
+                   "[-p <event period, ns>] "
+                   "[-u <most events between updates>] "
+                   "[-l <update lag, events>] "
+                   "[-b <events per match>]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    printf("%u events, updates every 1 to %u events arriving %u events late, matcher batches of %u\n",
+           nEvents, maxEvery, lag, batch);
+    printf("%6s %12s %12s %12s %10s %10s\n", "PVs", "matched", "younger", "too old", "scan ns", "matcher ns");
+    int rc = 0;
+    for (auto nPvs : pvCounts) {
+        Timeline timeline = makeTimeline(nPvs, nEvents, period, maxEvery, lag);
+        Results scan    = runScan(timeline, nPvs);
+        Results matcher = runMatcher(timeline, nPvs, std::max(batch, 1u));
+        printf("%6u %12lu %12lu %12lu %10.1f %10.1f\n", nPvs,
+               matcher.nMatch, matcher.nYounger, matcher.nTooOld,
+               scan.seconds * 1e9 / nEvents, matcher.seconds * 1e9 / nEvents);
+        if (scan.nMatch    != matcher.nMatch    || scan.nYounger  != matcher.nYounger ||
+            scan.nTooOld   != matcher.nTooOld   || scan.nReleased != matcher.nReleased) {
+            fprintf(stderr, "Mismatch for %u PVs: scan found %lu matched, %lu younger, %lu too old, %lu released\n",
+                    nPvs, scan.nMatch, scan.nYounger, scan.nTooOld, scan.nReleased);
+            rc = 1;
+        }
+    }
+    return rc;
+}
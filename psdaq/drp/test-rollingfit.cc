@@ -0,0 +1,207 @@
+// Accuracy test of RollingFit against the fit UdpEncoder's Interpolator did
+// before it, which refit the whole window with Eigen's Householder QR for
+// each new sample.  For each polynomial order and window size, samples of a
+// drifting polynomial plus noise come every -p ns with some jitter, and after
+// each one the fits extrapolate to a time before the next, as the
+// Interpolator does for events.  The reference is that QR fit on exact times;
+// the legacy fit is the same on times from TimeStamp::asDouble(), whose
+// resolution of about 0.1 us limits its own accuracy.  Reports the largest
+// differences from the reference relative to the values' scale, how often
+// the rounded RollingFit and legacy results differ and the times per update,
+// and fails if RollingFit is off by more than the tolerance of -t.
+
+#include "RollingFit.hh"
+#include <Eigen/Dense>
+#include <Eigen/QR>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <getopt.h>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace XtcData;
+using namespace Drp;
+
+namespace {
+
+// The Interpolator's fit before RollingFit, on times from TimeStamp::asDouble()
+// as it was, or on exact times relative to a given origin as the reference
+class Legacy
+{
+public:
+    Legacy(unsigned n, unsigned o, uint64_t origin=0) :
+        _origin(origin), _idx(0), _t(n), _v(n), _coeff(o+1) {}
+    void update(const TimeStamp& t, double v)
+    {
+        auto idx = _idx++;
+        _idx %= _t.size();
+        _t[idx] = _time(t);
+        _v[idx] = v;
+        if (_t[_t.size() - 1] != 0.0)  _polyfit();
+    }
+    double calculate(const TimeStamp& ts) const
+    {
+        double val  = 0;
+        double tPwr = 1;
+        double t    = _time(ts) - _t[_idx % _t.size()];
+        for (unsigned i = 0; i < _coeff.size(); ++i) {
+            val  += _coeff[i] * tPwr;
+            tPwr *= t;
+        }
+        return val;
+    }
+private:
+    double _time(const TimeStamp& t) const
+    {
+        return _origin ? (t.to_ns() - _origin) * 1.e-9 : t.asDouble();
+    }
+    void _polyfit()
+    {
+        std::vector<double> val(_v.size());
+        for (unsigned i = 0; i < _v.size(); i++)  val[i] = _v[(_idx + i) % _v.size()];
+        Eigen::MatrixXd T(_t.size(), _coeff.size());
+        Eigen::VectorXd V = Eigen::VectorXd::Map(&val.front(), val.size());
+        double t0 = _t[_idx % _t.size()];
+        for (size_t i = 0; i < _t.size(); ++i) {
+            size_t k = (_idx + i) % _t.size();
+            for (size_t j = 0; j < _coeff.size(); ++j)  T(i, j) = pow(_t[k] - t0, j);
+        }
+        Eigen::VectorXd result = T.householderQr().solve(V);
+        for (unsigned k = 0; k < _coeff.size(); k++)  _coeff[k] = result[k];
+    }
+private:
+    uint64_t            _origin;
+    unsigned            _idx;
+    std::vector<double> _t;
+    std::vector<double> _v;
+    std::vector<double> _coeff;
+};
+
+struct Results
+{
+    double   rollingError;              // Relative to the largest value
+    double   legacyError;
+    unsigned nRoundDiff;                // Rounded RollingFit vs legacy results
+    unsigned nCompared;
+    double   legacyNs;
+    double   rollingNs;
+};
+
+Results run(unsigned window, unsigned order, double noise, unsigned nSamples, uint64_t period)
+{
+    std::mt19937 rng(window * 16 + order);
+    std::normal_distribution<double> gauss(0.0, 1.0);
+    std::uniform_real_distribution<double> uniform(-1.0, 1.0);
+
+    // A polynomial in seconds whose coefficients drift, so the windows differ
+    std::vector<double> poly(order + 1);
+    for (unsigned k = 0; k <= order; ++k)  poly[k] = uniform(rng) * (k ? 1000.0 / k : 100000.0);
+    const uint64_t t0 = uint64_t(1000000000) * 1000000000; // Some time in 2001
+
+    std::vector<TimeStamp> times(nSamples);
+    std::vector<TimeStamp> evtTimes(nSamples);
+    std::vector<double>    values(nSamples);
+    for (unsigned i = 0; i < nSamples; ++i) {
+        uint64_t ns = t0 + i * period + int64_t(uniform(rng) * period / 10);
+        times[i].from_ns(ns);
+        evtTimes[i].from_ns(ns + uint64_t((0.5 + uniform(rng) / 2) * period));
+        double s = (ns - t0) * 1.e-9;
+        double v = 0;
+        for (unsigned k = order + 1; k-- > 0; )  v = v * s + poly[k];
+        values[i] = 200000.0 + v + noise * gauss(rng);
+        poly[0] += uniform(rng);
+    }
+
+    Legacy     legacy(window, order);
+    Legacy     exact (window, order, t0 - period);
+    RollingFit rolling(window, order);
+    std::vector<double> legacyVals(nSamples);
+    std::vector<double> exactVals(nSamples);
+    std::vector<double> rollingVals(nSamples);
+
+    for (unsigned i = 0; i < nSamples; ++i) {
+        exact.update(times[i], values[i]);
+        exactVals[i] = exact.calculate(evtTimes[i]);
+    }
+    auto tl0 = std::chrono::steady_clock::now();
+    for (unsigned i = 0; i < nSamples; ++i) {
+        legacy.update(times[i], values[i]);
+        legacyVals[i] = legacy.calculate(evtTimes[i]);
+    }
+    auto tl1 = std::chrono::steady_clock::now();
+    for (unsigned i = 0; i < nSamples; ++i) {
+        rolling.add(times[i], values[i]);
+        rollingVals[i] = rolling.evaluate(evtTimes[i]);
+    }
+    auto tr1 = std::chrono::steady_clock::now();
+
+    Results results{};
+    double scale = 1.0;
+    for (auto v : values)  scale = std::max(scale, std::fabs(v));
+    for (unsigned i = window - 1; i < nSamples; ++i) {
+        results.rollingError = std::max(results.rollingError, std::fabs(rollingVals[i] - exactVals[i]) / scale);
+        results.legacyError  = std::max(results.legacyError,  std::fabs(legacyVals[i]  - exactVals[i]) / scale);
+        if (std::round(rollingVals[i]) != std::round(legacyVals[i]))  ++results.nRoundDiff;
+        ++results.nCompared;
+    }
+    results.legacyNs  = std::chrono::duration<double, std::nano>(tl1 - tl0).count() / nSamples;
+    results.rollingNs = std::chrono::duration<double, std::nano>(tr1 - tl1).count() / nSamples;
+    return results;
+}
+
+}
+
+int main(int argc, char* argv[])
+{
+    std::vector<unsigned> windows{2, 3, 5, 10, 50, 200};
+    std::vector<unsigned> orders{0, 1, 2, 3};
+    std::vector<double>   noises{0.0, 1.0, 100.0};
+    unsigned nSamples  = 20000;
+    uint64_t period    = 1000000000 / 120;
+    double   tolerance = 1.e-9;
+
+    int c;
+    while((c = getopt(argc, argv, "w:o:n:p:t:h")) != EOF)
+    {
+        switch(c)
+        {
+          case 'w':  windows   = {unsigned(std::stoul(optarg))}; break;
+          case 'o':  orders    = {unsigned(std::stoul(optarg))}; break;
+          case 'n':  nSamples  = std::stoul(optarg);  break;
+          case 'p':  period    = std::stoull(optarg); break;
+          case 't':  tolerance = std::stod(optarg);   break;
+          default:
+            printf("%s "
+                   "[-w <window>] "
+                   "[-o <order>] "
+                   "[-n <sample count>] "
+                   "[-p <sample period, ns>] "
+                   "[-t <relative tolerance>]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    printf("%u samples every %lu ns, tolerance %g of the largest value\n", nSamples, period, tolerance);
+    printf("%6s %5s %6s %12s %12s %11s %10s %10s\n", "window", "order", "noise",
+           "rolling err", "legacy err", "rounded", "legacy ns", "rolling ns");
+    int rc = 0;
+    for (auto order : orders) {
+        for (auto window : windows) {
+            if (window < order + 1 || window > nSamples)  continue;
+            for (auto noise : noises) {
+                Results results = run(window, order, noise, nSamples, period);
+                printf("%6u %5u %6.0f %12.3g %12.3g %5u/%-5u %10.1f %10.1f\n", window, order, noise,
+                       results.rollingError, results.legacyError, results.nRoundDiff, results.nCompared,
+                       results.legacyNs, results.rollingNs);
+                if (results.rollingError > tolerance) {
+                    fprintf(stderr, "Error of %g over the tolerance for a window of %u and order %u\n",
+                            results.rollingError, window, order);
+                    rc = 1;
+                }
+            }
+        }
+    }
+    return rc;
+}
@@ -0,0 +1,98 @@
+#ifndef WORKERINPUT_H
+#define WORKERINPUT_H
+
+#include <atomic>
+#include <cstdint>
+
+#include "spscqueue.hh"
+#include "mpmcqueue.hh"
+
+namespace Drp {
+
+struct Batch
+{
+    uint32_t start;
+    uint32_t size;
+    uint32_t seq;                       // order in which the reader sent it
+};
+
+// Chooses the next batch a worker handles.  Without work stealing that is
+// simply the next one on the worker's own queue.  With it, transitions are
+// broadcast to every worker's own queue and all other batches go through a
+// queue shared by the workers, and each worker must still see its batches in
+// the order the reader sent them, so that no L1Accept reaches its Drp Python
+// after a later transition.
+//
+// The shared queue is looked at first: the reader pushed every batch older
+// than a broadcast transition to it before the broadcast, so while it is not
+// empty it may hold some, and those must be taken before the transition is
+// started.  Once it is empty they have all been taken, by whichever worker,
+// and each of those handles its batch before its own copy of the transition.
+// A batch taken from the shared queue that is newer than the transition at
+// the head of the worker's own queue is held until the transitions before it
+// have been handled.
+class WorkerInput
+{
+public:
+    WorkerInput(SPSCQueue<Batch>& own, MPMCQueue<Batch>* shared,
+                unsigned nworkers, unsigned threadNum, std::atomic<uint64_t>& steals) :
+        m_own(own), m_shared(shared), m_nworkers(nworkers), m_threadNum(threadNum),
+        m_steals(steals), m_holding(false)
+    {
+    }
+
+    // Returns false when the queues are shut down
+    bool pop(Batch& batch)
+    {
+        if (!m_shared)  return m_own.pop(batch);
+
+        Batch older;
+        if (m_holding) {
+            if (m_own.peek(older) && int32_t(older.seq - m_held.seq) < 0) {
+                m_own.try_pop(batch);
+            } else {
+                batch = m_held;
+                m_holding = false;
+            }
+            return true;
+        }
+
+        while (true) {
+            // The own queue is looked at first, so that the batches sent
+            // before what it holds are already on the shared queue
+            bool own = !m_own.is_empty();
+            if (m_shared->try_pop(batch))  return _took(batch);
+            if (own)  return m_own.try_pop(batch);
+            if (m_shared->pop(batch, [&]{ return !m_own.is_empty(); }))  return _took(batch);
+            if (m_own.is_empty())  return false; // Shut down
+        }
+    }
+
+private:
+    bool _took(Batch& batch)
+    {
+        if (batch.seq % m_nworkers != m_threadNum) {
+            m_steals.fetch_add(1, std::memory_order_relaxed);
+        }
+        Batch older;
+        if (m_own.peek(older) && int32_t(older.seq - batch.seq) < 0) {
+            m_held = batch;
+            m_holding = true;
+            m_own.try_pop(batch);
+        }
+        return true;
+    }
+
+private:
+    SPSCQueue<Batch>&      m_own;
+    MPMCQueue<Batch>*      m_shared;
+    unsigned               m_nworkers;
+    unsigned               m_threadNum;
+    std::atomic<uint64_t>& m_steals;
+    Batch                  m_held;
+    bool                   m_holding;
+};
+
+}
+
+#endif // WORKERINPUT_H
@@ -41,6 +41,9 @@ class ControlDef:
     STEPINFO = 253          # psdaq/drp/drp.hh
     PORT_BASE = 29980
     POSIX_TIME_AT_EPICS_EPOCH = 631152000
+    # pulses (about 1 s at 13 MHz / 14) between a chunk request and the
+    # rollover, so every DRP has its next file open before it is reached
+    CHUNK_ROLLOVER_LEAD = 928571
     #  name of simulated motor reserved for step value
     STEP_VALUE = 'step_value'
 
@@ -100,6 +103,10 @@ def chunkRequest_msg(offset):
     body = {'offset': offset}
     return create_msg('chunkRequest', body=body)
 
+def chunkRollover_msg(pulseId):
+    body = {'pulseId': pulseId}
+    return create_msg('chunkRollover', body=body)
+
 def progress_msg(transition, elapsed, total):
     body = {'transition': transition, 'elapsed': int(elapsed), 'total': int(total)}
     return create_msg('progress', body=body)
@@ -19,8 +19,8 @@ from threading import Thread, Event, Condition
 from copy import deepcopy
 import dgramCreate as dc
 from psdaq.control.ControlDef import ControlDef, create_msg, error_msg, warning_msg, step_msg, \
-                                  progress_msg, fileReport_msg, front_pub_port, step_pub_port, \
-                                  back_pub_port, front_rep_port, back_pull_port, fast_rep_port
+                                  progress_msg, fileReport_msg, chunkRollover_msg, front_pub_port, \
+                                  step_pub_port, back_pub_port, front_rep_port, back_pull_port, fast_rep_port
 
 report_keys = ['error', 'warning', 'fileReport']
 
@@ -517,6 +517,8 @@ class CollectionManager():
         self.fast_rep.bind('tcp://*:%d' % fast_rep_port(args.p))
         self.front_pub.bind('tcp://*:%d' % front_pub_port(args.p))
         self.slow_update_rate = args.S
+        self.chunk_rollover = args.chunk_rollover
+        self.rollover_pulse_id = 0
         self.fast_reply_rate = 10           # Hz
         self.slow_update_enabled = False    # setter: self.set_slow_update_enabled()
         self.threads_exit = Event()
@@ -1420,13 +1422,21 @@ class CollectionManager():
         logging.debug('handle_getstatus()')
         return self.status_msg()
 
-    # request chunking opportunity (Running->Paused->Running)
+    # request chunking opportunity (Running->Paused->Running), or with
+    # --chunk_rollover, have every drp switch chunks at a later pulse ID
     def handle_chunkrequest(self, body):
         logging.debug(f'handle_chunkrequest() in state {self.state}')
 
         retval = create_msg('ok')   # ok
 
-        if self.state == 'running':
+        if self.state == 'running' and self.chunk_rollover and 'pulseId' in body:
+            # the other drps' requests for the same chunk follow closely
+            if body['pulseId'] > self.rollover_pulse_id:
+                self.rollover_pulse_id = body['pulseId'] + ControlDef.CHUNK_ROLLOVER_LEAD
+                logging.info(f'chunk rollover at pulse ID 0x{self.rollover_pulse_id:014x}')
+                msg = chunkRollover_msg(self.rollover_pulse_id)
+                self.back_pub.send_multipart([b'partition', json.dumps(msg)])
+        elif self.state == 'running':
             answer = self.handle_trigger('disable')
             if 'err_info' in answer['body']:
                 retval = answer     # error
@@ -2341,6 +2351,7 @@ def main():
     parser.add_argument('-T', type=int, metavar='P2_TIMEOUT', default=12500, help='phase 2 timeout msec (default 12500)')
     parser.add_argument('--rollcall_timeout', type=int, default=30, help='rollcall timeout sec (default 30)')
     parser.add_argument('-s', metavar='STEP_GROUP', default=None, type=int, help='Readout group for scan step counts')
+    parser.add_argument('--chunk_rollover', action='store_true', help='switch data file chunks at a pulse ID instead of at a Disable/Enable')
     parser.add_argument('-v', action='store_true', help='be verbose')
     parser.add_argument('-V', metavar='LOGBOOK_FILE', default='/dev/null', help='run parameters file')
     parser.add_argument("--user", default="tstopr", help='HTTP authentication user')
@@ -1,6 +1,7 @@
 import sys
 import posix_ipc
 import logging
+from psdaq.drp.drp_ring import DrpRing
 logger = logging.getLogger(__name__)
 
 partition = int(sys.argv[1])
@@ -35,6 +36,11 @@ class IPCInfo:
             self.shm_res = posix_ipc.SharedMemory(f"/shmres_{keybase}_{worker_num}")
         except posix_ipc.Error as exp:
             assert(False)
+        # The rings are only there when the DRP was started with pyRingSlots
+        try:
+            self.ring = DrpRing(f"/shmring_{keybase}_{worker_num}")
+        except posix_ipc.ExistentialError:
+            self.ring = None
 
 class DrpInfo:
     def __init__(self, detector_name, detector_type, detector_id, detector_segment, worker_num,
@@ -0,0 +1,92 @@
+"""Python end of the message rings between a DRP worker and Drp Python.
+
+See Pds::Ipc::DrpRing in psdaq/service/IpcUtils.hh for the protocol and the
+layout of the shared memory, which this must follow.  Python reads the
+requests ('g' for an event, 's' to stop) the worker writes to the ToPython
+ring and answers on the FromPython ring once the result is in the slot.
+
+The 32-bit counters are read and written with plain loads and stores, which
+relies on the ordering of x86-64.  The futex system call orders the store
+of 'waiting' before the last check of the ring's head.
+"""
+
+import ctypes
+import mmap
+import platform
+import struct
+import time
+
+import posix_ipc
+
+MAGIC = 0x44525052
+DEPTH = 64
+HEADER_SIZE = 64
+RING_SIZE = 128 + 16 * DEPTH
+TO_PYTHON, FROM_PYTHON = 0, 1
+
+_header = struct.Struct("IIIIQ")        # magic, version, nSlots, reserved, slotSize
+_msg = struct.Struct("IIII")            # type, slot, size, reserved
+
+_SYS_futex = {"x86_64": 202, "aarch64": 98}[platform.machine()]
+_FUTEX_WAIT, _FUTEX_WAKE = 0, 1
+_libc = ctypes.CDLL(None, use_errno=True)
+_libc.syscall.restype = ctypes.c_long
+
+
+class _timespec(ctypes.Structure):
+    _fields_ = [("tv_sec", ctypes.c_long), ("tv_nsec", ctypes.c_long)]
+
+
+class DrpRing:
+    def __init__(self, name):
+        shm = posix_ipc.SharedMemory(name)
+        self._mm = mmap.mmap(shm.fd, shm.size)
+        shm.close_fd()
+        magic, version, self.n_slots, _, self.slot_size = _header.unpack_from(self._mm, 0)
+        if magic != MAGIC:
+            raise RuntimeError(f"{name} is not a Drp ring (magic {magic:#x})")
+        self._head, self._waiting, self._tail, self._msgs = [], [], [], []
+        for ring in (TO_PYTHON, FROM_PYTHON):
+            base = HEADER_SIZE + ring * RING_SIZE
+            self._head.append(ctypes.c_uint32.from_buffer(self._mm, base))
+            self._waiting.append(ctypes.c_uint32.from_buffer(self._mm, base + 4))
+            self._tail.append(ctypes.c_uint32.from_buffer(self._mm, base + 64))
+            self._msgs.append(base + 128)
+
+    def recv(self, timeout=None, spin=50e-6):
+        """Returns the next (type, slot, size) request, or None after timeout seconds"""
+        head, tail = self._head[TO_PYTHON], self._tail[TO_PYTHON]
+        t0 = time.monotonic()
+        while head.value == tail.value:
+            elapsed = time.monotonic() - t0
+            if elapsed < spin:
+                continue
+            if timeout is not None and elapsed >= timeout:
+                return None
+            wait = 0.1 if timeout is None else min(0.1, timeout - elapsed)
+            self._waiting[TO_PYTHON].value = 1
+            if head.value == tail.value:
+                self._futex_wait(head, tail.value, wait)
+            self._waiting[TO_PYTHON].value = 0
+        n = tail.value
+        mtype, slot, size, _ = _msg.unpack_from(self._mm, self._msgs[TO_PYTHON] + 16 * (n % DEPTH))
+        tail.value = (n + 1) & 0xffffffff
+        return chr(mtype), slot, size
+
+    def send(self, mtype, slot, size=0):
+        """Answers the request for slot; the worker never lets the ring fill"""
+        head = self._head[FROM_PYTHON]
+        n = head.value
+        _msg.pack_into(self._mm, self._msgs[FROM_PYTHON] + 16 * (n % DEPTH), ord(mtype), slot, size, 0)
+        head.value = (n + 1) & 0xffffffff
+        if self._waiting[FROM_PYTHON].value:
+            _libc.syscall(_SYS_futex, ctypes.byref(head), _FUTEX_WAKE, 1, None, None, 0)
+
+    def slot(self, buf, slot):
+        """The part of the input or result shared memory that holds slot"""
+        return memoryview(buf)[slot * self.slot_size:(slot + 1) * self.slot_size]
+
+    def _futex_wait(self, word, value, timeout):
+        ts = _timespec(int(timeout), int((timeout % 1) * 1e9))
+        _libc.syscall(_SYS_futex, ctypes.byref(word), _FUTEX_WAIT, ctypes.c_uint32(value),
+                      ctypes.byref(ts), None, 0)
@@ -0,0 +1,61 @@
+#include "BatchController.hh"
+
+#include "eb.hh"
+
+#include <algorithm>
+
+using namespace Pds::Eb;
+
+static const unsigned AVG_SHIFT    = 6;  // Average over ~64 events
+static const unsigned CHOOSE_EVERY = 64; // Events between choices of the batch size
+
+
+BatchController::BatchController(unsigned maxEntries, unsigned budgetUs) :
+  _maxEntries (maxEntries),
+  _budgetUs   (budgetUs),
+  _budgetTicks(uint64_t(budgetUs) * TICK_RATE / 1000000)
+{
+  reset();
+}
+
+void BatchController::reset()
+{
+  // Start with unbatched events, which cost the least latency, until the rate is known
+  _entries.store(enabled() ? 1 : _maxEntries, std::memory_order_relaxed);
+  _lastPid  = 0;
+  _avgTicks = 0;
+  _count    = 0;
+  _latency  = 0;
+}
+
+void BatchController::update(uint64_t pulseId)
+{
+  if (!enabled())  return;
+
+  if (_lastPid && (pulseId > _lastPid))
+  {
+    // Long gaps, e.g., from deadtime, are capped so the average recovers quickly
+    uint64_t dt = std::min(pulseId - _lastPid, uint64_t(MAX_LATENCY)) << 8;
+    if (_avgTicks)  _avgTicks = _avgTicks - (_avgTicks >> AVG_SHIFT) + (dt >> AVG_SHIFT);
+    else            _avgTicks = dt;
+  }
+  _lastPid = pulseId;
+
+  if ((++_count % CHOOSE_EVERY) == 0)  _choose();
+}
+
+void BatchController::_choose()
+{
+  // The number of events expected within the latency budget
+  uint64_t expected = (_budgetTicks << 8) / std::max(_avgTicks, uint64_t(1));
+
+  unsigned entries = 1;
+  while ((entries < _maxEntries) && (2 * entries <= expected))  entries *= 2;
+
+  _entries.store(entries, std::memory_order_relaxed);
+}
+
+void BatchController::posted(int64_t ageNs)
+{
+  _latency += (ageNs - _latency) / 16;
+}
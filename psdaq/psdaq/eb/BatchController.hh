@@ -0,0 +1,52 @@
+#ifndef Pds_Eb_BatchController_hh
+#define Pds_Eb_BatchController_hh
+
+#include <atomic>
+#include <cstdint>
+
+namespace Pds {
+  namespace Eb {
+
+    // Chooses how many entries a batch may collect before it is posted, from
+    // the event rate seen in the pulse IDs and a latency budget in us, given
+    // with the batchLatency kwarg.  Batches still end at the pulse ID
+    // boundaries of the batch duration, as the TEB expects, so the choice
+    // only ever closes them earlier: at low rates each event goes out on its
+    // own instead of waiting for the next event or a timeout, and at high
+    // rates a batch is closed once it holds as many events as are expected
+    // within the budget.  The number of entries is a power of 2 no larger
+    // than maxEntries.  Without a budget, batches are closed by pulse ID only.
+    //
+    // update() and posted() are called by the thread that posts batches, and
+    // entries() may be called from any thread, e.g., the DRP's PGP reader,
+    // which uses it to size the batches it hands to its workers.
+    class BatchController
+    {
+    public:
+      BatchController(unsigned maxEntries, unsigned budgetUs);
+    public:
+      void     reset();
+      void     update(uint64_t pulseId);
+      void     posted(int64_t ageNs);
+    public:
+      bool     enabled() const { return _budgetTicks != 0; }
+      unsigned entries() const { return _entries.load(std::memory_order_relaxed); }
+      bool     full(unsigned entries) const { return entries >= this->entries(); }
+      int64_t  latency() const { return _latency; } // Average batch age, in ns
+      unsigned budget()  const { return _budgetUs; }
+    private:
+      void     _choose();
+    private:
+      const unsigned        _maxEntries;
+      const unsigned        _budgetUs;
+      const uint64_t        _budgetTicks;
+      std::atomic<unsigned> _entries;
+      uint64_t              _lastPid;
+      uint64_t              _avgTicks;  // Average pulse IDs between events, << 8
+      uint64_t              _count;
+      int64_t               _latency;
+    };
+  };
+};
+
+#endif
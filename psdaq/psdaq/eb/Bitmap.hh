@@ -0,0 +1,125 @@
+#ifndef Pds_Eb_Bitmap_hh
+#define Pds_Eb_Bitmap_hh
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+namespace Pds {
+  namespace Eb {
+
+    // A fixed size list of bits, such as the IDs of an event's contributors,
+    // held in as many 64 bit words as it takes.  One word is handled exactly
+    // as a uint64_t would be.  Wider ones are handled a word at a time in
+    // loops of fixed length, which the compiler unrolls (and vectorises where
+    // it can), so that tests and updates don't branch on the data.
+    template <unsigned Bits>
+    class Bitmap
+    {
+      static_assert(Bits && !(Bits % 64), "Bitmap size must be a multiple of 64 bits");
+    public:
+      static constexpr unsigned Words = Bits / 64;
+    public:
+      constexpr Bitmap() : _w{} {}
+    public:
+      bool     test (unsigned bit) const { return (_w[_i(bit)] >> _b(bit)) & 1; }
+      Bitmap&  set  (unsigned bit)       { _w[_i(bit)] |=   1ull << _b(bit);  return *this; }
+      Bitmap&  reset(unsigned bit)       { _w[_i(bit)] &= ~(1ull << _b(bit)); return *this; }
+      bool     any  () const;
+      bool     none () const             { return !any(); }
+      unsigned count() const;
+      uint64_t word (unsigned i) const   { return _w[i]; }
+      template <typename Fn>
+      void     forEach(Fn fn) const;    // Calls fn(bit) for each set bit, lowest first
+      std::string hex() const;          // Most significant word first
+    public:
+      explicit operator bool() const     { return any(); }
+      Bitmap&  operator|=(const Bitmap& rhs);
+      Bitmap&  operator&=(const Bitmap& rhs);
+      Bitmap   operator~ () const;
+      bool     operator==(const Bitmap& rhs) const;
+      bool     operator!=(const Bitmap& rhs) const { return !(*this == rhs); }
+      friend Bitmap operator|(Bitmap lhs, const Bitmap& rhs) { return lhs |= rhs; }
+      friend Bitmap operator&(Bitmap lhs, const Bitmap& rhs) { return lhs &= rhs; }
+    private:
+      // A single word is addressed as a uint64_t would be: bit < 64 already
+      static constexpr unsigned _i(unsigned bit) { return Words == 1 ? 0   : bit >> 6; }
+      static constexpr unsigned _b(unsigned bit) { return Words == 1 ? bit : bit & 63; }
+    private:
+      uint64_t _w[Words];
+    };
+  };
+};
+
+
+template <unsigned Bits>
+inline bool Pds::Eb::Bitmap<Bits>::any() const
+{
+  uint64_t w = 0;
+  for (unsigned i = 0; i < Words; ++i)  w |= _w[i];
+  return w != 0;
+}
+
+template <unsigned Bits>
+inline unsigned Pds::Eb::Bitmap<Bits>::count() const
+{
+  unsigned n = 0;
+  for (unsigned i = 0; i < Words; ++i)  n += __builtin_popcountll(_w[i]);
+  return n;
+}
+
+template <unsigned Bits>
+template <typename Fn>
+inline void Pds::Eb::Bitmap<Bits>::forEach(Fn fn) const
+{
+  for (unsigned i = 0; i < Words; ++i)
+  {
+    uint64_t w = _w[i];
+    while (w)
+    {
+      fn(64 * i + __builtin_ctzll(w));
+      w &= w - 1;                       // Clear the lowest set bit
+    }
+  }
+}
+
+template <unsigned Bits>
+inline std::string Pds::Eb::Bitmap<Bits>::hex() const
+{
+  char buf[16 * Words + 1];
+  for (unsigned i = 0; i < Words; ++i)
+    snprintf(&buf[16 * i], 17, "%016lx", _w[Words - 1 - i]);
+  return std::string(buf);
+}
+
+template <unsigned Bits>
+inline Pds::Eb::Bitmap<Bits>& Pds::Eb::Bitmap<Bits>::operator|=(const Bitmap& rhs)
+{
+  for (unsigned i = 0; i < Words; ++i)  _w[i] |= rhs._w[i];
+  return *this;
+}
+
+template <unsigned Bits>
+inline Pds::Eb::Bitmap<Bits>& Pds::Eb::Bitmap<Bits>::operator&=(const Bitmap& rhs)
+{
+  for (unsigned i = 0; i < Words; ++i)  _w[i] &= rhs._w[i];
+  return *this;
+}
+
+template <unsigned Bits>
+inline Pds::Eb::Bitmap<Bits> Pds::Eb::Bitmap<Bits>::operator~() const
+{
+  Bitmap result;
+  for (unsigned i = 0; i < Words; ++i)  result._w[i] = ~_w[i];
+  return result;
+}
+
+template <unsigned Bits>
+inline bool Pds::Eb::Bitmap<Bits>::operator==(const Bitmap& rhs) const
+{
+  uint64_t d = 0;
+  for (unsigned i = 0; i < Words; ++i)  d |= _w[i] ^ rhs._w[i];
+  return d == 0;
+}
+
+#endif
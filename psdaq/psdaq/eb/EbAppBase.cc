@@ -21,7 +21,6 @@
 #include <time.h>
 #include <inttypes.h>
 #include <climits>
-#include <bitset>
 #include <atomic>
 #include <thread>
 #include <chrono>                       // Revisit: Temporary?
@@ -38,11 +37,18 @@ using MetricExporter_t = std::shared_ptr<MetricExporter>;
 using ms_t             = std::chrono::milliseconds;
 
 
+// Number of builder threads to shard the event builder over, if any
+static unsigned builderShards(const EbParams& prms)
+{
+  const auto it = prms.kwargs.find("eb_shards");
+  return it != prms.kwargs.end() ? std::stoul(it->second) : 0;
+}
+
 EbAppBase::EbAppBase(const EbParams&         prms,
                      const MetricExporter_t& exporter,
                      const std::string&      pfx,
                      const unsigned          msTimeout) :
-  EventBuilder (msTimeout, prms.verbose),
+  EventBuilder (msTimeout, prms.verbose, builderShards(prms)),
   _transport   (prms.verbose, prms.kwargs),
   _verbose     (prms.verbose),
   _lastPid     (0),
@@ -62,7 +68,11 @@ EbAppBase::EbAppBase(const EbParams&         prms,
   exporter->add("EB_BfInCt", labels, MetricType::Counter, [&](){ return _bufferCnt;           }); // Inbound
   exporter->add("EB_ToEvCt", labels, MetricType::Counter, [&](){ return  timeoutCnt();        });
   exporter->add("EB_FxUpCt", labels, MetricType::Counter, [&](){ return  fixupCnt();          });
-  exporter->add("EB_CbMsMk", labels, MetricType::Gauge,   [&](){ return  missing();           });
+  for (unsigned i = 0; i < ctrbs_t::Words; ++i) // Contributors 64*i to 64*i+63
+  {
+    std::string name = i ? "EB_CbMsMk" + std::to_string(i) : "EB_CbMsMk";
+    exporter->add(name,    labels, MetricType::Gauge,   [&, i](){ return  missing().word(i);   });
+  }
   exporter->add("EB_EvAge",  labels, MetricType::Gauge,   [&](){ return  eventAge();          });
   exporter->add("EB_dTime",  labels, MetricType::Gauge,   [&](){ return  ebTime();            });
 }
@@ -98,7 +108,7 @@ void EbAppBase::disconnect()
   _links.clear();
 
   _id           = -1;
-  _contract     .fill(0);
+  _contract     .fill(ctrbs_t());
   _bufRegSize   .clear();
   _maxBufSize   .clear();
   _maxTrSize    .clear();
@@ -129,7 +139,7 @@ int EbAppBase::startConnection(const std::string& ifAddr,
 int EbAppBase::connect(unsigned maxTrBuffers)
 {
   int      rc;
-  unsigned nCtrbs = std::bitset<64>(_prms.contributors).count();
+  unsigned nCtrbs = _prms.contributors.count();
   _links        .resize(nCtrbs);
   _region       .resize(nCtrbs);
   _regSize      .resize(nCtrbs);
@@ -257,9 +267,10 @@ int EbAppBase::process()
 {
   int rc;
 
-  // Pend for an input datagram and pass it to the event builder
+  // Pend for an input datagram and pass it to the event builder.  When
+  // sharded, come back often to deliver the events the builders finish.
   uint64_t  data;
-  const int msTmo = 100;
+  const int msTmo = shards() ? 1 : 100;
   if ( (rc = _transport.pend(&data, msTmo)) < 0)
   {
     if (rc == -FI_EAGAIN)
@@ -392,7 +403,7 @@ int EbAppBase::process()
   }
 
   // Tr space bufSize value is irrelevant since idg has EOL set in that case
-  if ((_idxSrcs & (1ull << src)) == 0)  data = 0;
+  if (!_idxSrcs.test(src))  data = 0;
   EventBuilder::process(idg, _maxBufSize[src], data, end);
 
   ++_bufferCnt;
@@ -428,12 +439,12 @@ void EbAppBase::trim(unsigned dst)
 {
   for (unsigned group = 0; group < _contract.size(); ++group)
   {
-    _contract[group]  &= ~(1 << dst);
+    _contract[group].reset(dst);
     //_receivers[group] &= ~(1 << dst);
   }
 }
 
-uint64_t EbAppBase::contract(const EbDgram* ctrb) const
+ctrbs_t EbAppBase::contract(const EbDgram* ctrb) const
 {
   // This method is called when the event is created, which happens when the event
   // builder recognizes the first contribution.  This contribution contains
@@ -443,7 +454,7 @@ uint64_t EbAppBase::contract(const EbDgram* ctrb) const
   // them together to provide the overall contract.  The list of contributors
   // participating in each readout group is provided at configuration time.
 
-  uint64_t contract = 0;
+  ctrbs_t  contract;
   uint16_t groups   = ctrb->readoutGroups();
 
   while (groups)
@@ -30,7 +30,7 @@ namespace Pds {
     class EbAppBase : public EventBuilder
     {
     public:
-      using u64arr_t         = std::array<uint64_t, NUM_READOUT_GROUPS>;
+      using ctrbarr_t        = EbParams::ctrbarr_t;
       using PromHisto_t      = std::shared_ptr<Pds::PromHistogram>;
       using MetricExporter_t = std::shared_ptr<Pds::MetricExporter>;
 
@@ -56,15 +56,16 @@ namespace Pds {
       void             trim(unsigned dst);
     protected:
       const std::vector<size_t>& bufferSizes() const;
+      int64_t          behind() const;  // ms since the input was last caught up with
     public:                            // For EventBuilder
       virtual void     fixup(Pds::Eb::EbEvent* event, unsigned srcId);
-      virtual uint64_t contract(const Pds::EbDgram* contrib) const;
+      virtual ctrbs_t  contract(const Pds::EbDgram* contrib) const;
     private:
       int              _linksConfigure(const EbParams&            prms,
                                        std::vector<EbLfSvrLink*>& links,
                                        const char*                name);
     private:                           // Arranged in order of access frequency
-      u64arr_t                  _contract;
+      ctrbarr_t                 _contract;
       Pds::Eb::EbLfServer       _transport;
       std::vector<EbLfSvrLink*> _links;
       std::vector<size_t>       _bufRegSize;
@@ -81,7 +82,7 @@ namespace Pds {
     private:
       std::vector<size_t>       _regSize;
       std::vector<void*>        _region;
-      uint64_t                  _idxSrcs;
+      ctrbs_t                   _idxSrcs;
       unsigned                  _id;
       MetricExporter_t          _exporter;
       const std::string         _pfx;
@@ -97,4 +98,11 @@ const std::vector<size_t>& Pds::Eb::EbAppBase::bufferSizes() const
   return _maxBufSize;
 }
 
+inline
+int64_t Pds::Eb::EbAppBase::behind() const
+{
+  auto now = Pds::fast_monotonic_clock::now();
+  return std::chrono::duration_cast<std::chrono::milliseconds>(now - _transport.drained()).count();
+}
+
 #endif
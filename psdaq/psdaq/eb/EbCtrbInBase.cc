@@ -549,6 +549,10 @@ void EbCtrbInBase::_deliver(TebContributor&     ctrb,
       }
       iPidPrv = iPid;
 
+      // Transition results carry the building TEB's share of future batches
+      if (!result->isEvent() && result->credit())
+        ctrb.credit(rPid, result->xtc.src.value(), result->credit());
+
       process(*result, idx++);
 
       ++_eventCount;
@@ -27,7 +27,7 @@ using namespace Pds::Eb;
 ** --
 */
 
-EbEvent::EbEvent(uint64_t            contract,
+EbEvent::EbEvent(const ctrbs_t&      contract,
                  EbEvent*            after,
                  const EbDgram*      cdg,
                  unsigned            immData,
@@ -36,24 +36,29 @@ EbEvent::EbEvent(uint64_t            contract,
   _t0      (t0),
   _immData (immData),                   // May be 0 (invalid), else valid
   _damage  (0),
+  _batch   (0),
+  _state   (Built),
+  _shard   (0),
   _last    (_contributions)
 {
   *_last++   = cdg;
 
   _size      = cdg->xtc.sizeofPayload();
 
-  _remaining = contract & ~(1ull << cdg->xtc.src.value());
-  if (_remaining == contract)           // Make sure some bit was taken down
+  const unsigned src = cdg->xtc.src.value();
+  if ((src >= MAX_DRPS) || !contract.test(src)) // Make sure some bit will be taken down
   {
-    fprintf(stderr, "%s:\n  Source %u isn't in contract %016lx "
+    fprintf(stderr, "%s:\n  Source %u isn't in contract %s "
             "for %s @ %p, PID %014lx, RoGs %04hx\n",
-            __PRETTY_FUNCTION__, cdg->xtc.src.value(), contract,
+            __PRETTY_FUNCTION__, src, contract.hex().c_str(),
             TransitionId::name(cdg->service()), cdg, cdg->pulseId(),
             cdg->readoutGroups());
     throw "Fatal: _remaining == contract";
   }
+  _remaining = contract;
+  _remaining.reset(src);
 
-  connect(after);
+  if (after)  connect(after);           // Else the sequencer links it in later
 }
 
 /*
@@ -79,17 +84,17 @@ EbEvent* EbEvent::_add(const EbDgram* cdg, unsigned immData)
 
   _size     += cdg->xtc.sizeofPayload();
 
-  uint64_t remaining = _remaining;
-  _remaining = remaining & ~(1ull << cdg->xtc.src.value());
-  if (_remaining == remaining)          // Make sure some bit was taken down
+  const unsigned src = cdg->xtc.src.value();
+  if ((src >= MAX_DRPS) || !_remaining.test(src)) // Make sure some bit will be taken down
   {
-    fprintf(stderr, "%s:\n  Source %u didn't affect remaining %016lx "
-            "for %s @ %p, PID %014lx, RoGs %04hx, contract %016lx\n",
-            __PRETTY_FUNCTION__, cdg->xtc.src.value(), remaining,
+    fprintf(stderr, "%s:\n  Source %u didn't affect remaining %s "
+            "for %s @ %p, PID %014lx, RoGs %04hx, contract %s\n",
+            __PRETTY_FUNCTION__, src, _remaining.hex().c_str(),
             TransitionId::name(cdg->service()), cdg, cdg->pulseId(),
-            cdg->readoutGroups(), _contract);
+            cdg->readoutGroups(), _contract.hex().c_str());
     throw "Fatal: _remaining == remaining";
   }
+  _remaining.reset(src);
 
   return this;
 }
@@ -113,8 +118,9 @@ void EbEvent::dump(int number)
   auto env = contrib->env;
   auto src = contrib->xtc.src.value();
 
-  printf("  Event #%2d @ %16p nxt %16p prv %16p seq %014lx ctl %02x env %08x sz %6zd src %2u rem %016lx req %016lx\n",
-         number, this, forward(), reverse(), sequence(), ctl, env, _size, src, _remaining, _contract);
+  printf("  Event #%2d @ %16p nxt %16p prv %16p seq %014lx ctl %02x env %08x sz %6zd src %2u rem %s req %s\n",
+         number, this, forward(), reverse(), sequence(), ctl, env, _size, src,
+         _remaining.hex().c_str(), _contract.hex().c_str());
 
   //printf("   Event #%d @ address %p has sequence %014lX\n",
   //       number, this, sequence());
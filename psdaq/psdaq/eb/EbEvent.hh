@@ -26,8 +26,8 @@ namespace Pds {
     public:
       PoolDeclare;
     public:
-      EbEvent(uint64_t            contract,
-              EbEvent*            after,
+      EbEvent(const ctrbs_t&      contract,
+              EbEvent*            after,    // Null when a builder thread makes it
               const Pds::EbDgram* ctrb,
               unsigned            immData,
               const time_point_t& t0);
@@ -36,8 +36,8 @@ namespace Pds {
       unsigned        immData()   const;
       uint64_t        sequence()  const;
       size_t          size()      const;
-      uint64_t        remaining() const;
-      uint64_t        contract()  const;
+      const ctrbs_t&  remaining() const;
+      const ctrbs_t&  contract()  const;
       XtcData::Damage damage()    const;
       void            damage(XtcData::Damage::Value);
     public:
@@ -48,16 +48,24 @@ namespace Pds {
       void     dump(int number);
     private:
       friend class EventBuilder;
+      // Who may touch the contributions when the EventBuilder is sharded
+      enum State : uint8_t { Built,     // The sequencer, or always when not sharded
+                             Building,  // A builder thread
+                             Revoking,  // A builder thread, which has been asked for it
+                             Revoked }; // The sequencer, which will fix it up
     private:
       EbEvent* _add(const Pds::EbDgram*, unsigned immData);
       void     _insert(const Pds::EbDgram*);
     private:
       size_t               _size;            // Total contribution size (in bytes)
-      uint64_t             _remaining;       // List of clients which have contributed
-      const uint64_t       _contract;        // -> potential list of contributors
+      ctrbs_t              _remaining;       // List of clients which have contributed
+      const ctrbs_t        _contract;        // -> potential list of contributors
       time_point_t         _t0;              // Starting time of timeout
       unsigned             _immData;         // A contribution's immediate data
       XtcData::Damage      _damage;          // Accumulate damage about this event
+      uint64_t             _batch;           // Sharded: the batch after which it was let go
+      State                _state;           // Sharded: who has it
+      uint8_t              _shard;           // Sharded: the builder thread that made it
       const Pds::EbDgram** _last;            // Pointer into the contributions array
       const Pds::EbDgram*  _contributions[]; // Array of contributions
     };
@@ -142,7 +150,7 @@ inline size_t Pds::Eb::EbEvent::size() const
 ** --
 */
 
-inline uint64_t Pds::Eb::EbEvent::contract() const
+inline const Pds::Eb::ctrbs_t& Pds::Eb::EbEvent::contract() const
 {
   return _contract;
 }
@@ -158,7 +166,7 @@ inline uint64_t Pds::Eb::EbEvent::contract() const
 ** --
 */
 
-inline uint64_t Pds::Eb::EbEvent::remaining() const
+inline const Pds::Eb::ctrbs_t& Pds::Eb::EbEvent::remaining() const
 {
   return _remaining;
 }
@@ -21,7 +21,9 @@ EbLfServer::EbLfServer(const unsigned& verbose) :
   _eq     (nullptr),
   _rxcq   (nullptr),
   _tmo    (0),                          // Start by polling
+  _wait   (0),
   _verbose(verbose),
+  _drained(fast_monotonic_clock::now()),
   _pending(0),
   _posting(0),
   _pep    (nullptr),
@@ -34,7 +36,9 @@ EbLfServer::EbLfServer(const unsigned&                           verbose,
   _eq     (nullptr),
   _rxcq   (nullptr),
   _tmo    (0),                          // Start by polling
+  _wait   (0),
   _verbose(verbose),
+  _drained(fast_monotonic_clock::now()),
   _pending(0),
   _posting(0),
   _pep    (nullptr),
@@ -281,10 +285,12 @@ int EbLfServer::pend(fi_cq_data_entry* cqEntry, int msTmo)
 
     if (rc == -FI_EAGAIN)
     {
+      auto t1{fast_monotonic_clock::now()};
+      _drained = t1;                    // Caught up with the input
+
       if (_tmo)  break;
 
       const ms_t tmo{msTmo};
-      auto       t1 {fast_monotonic_clock::now()};
 
       if (t1 - t0 > tmo)
       {
@@ -3,6 +3,8 @@
 
 #include "EbLfLink.hh"
 
+#include "psdaq/service/fast_monotonic_clock.hh"
+
 #include <stdint.h>
 #include <cstddef>
 #include <string>
@@ -42,16 +44,21 @@ namespace Pds {
       int  poll(uint64_t* data);
       int  pollEQ();
       int  setupMr(void* region, size_t size);
+      void wait(int msTmo) { _tmo = _wait = msTmo; } // 0 to poll (default)
     public:
       const uint64_t pending() const { return _pending; }
       const uint64_t posting() const { return _posting; }
+      const fast_monotonic_clock::time_point& drained() const { return _drained; }
     private:
       int _poll(fi_cq_data_entry*, uint64_t flags);
     private:                              // Arranged in order of access frequency
       Fabrics::EventQueue*      _eq;      // Event Queue
       Fabrics::CompletionQueue* _rxcq;    // Receive Completion Queue
       int                       _tmo;     // Timeout for polling or waiting
+      int                       _wait;    // Always wait, this long, if non-zero
       const unsigned&           _verbose; // Print some stuff if set
+      fast_monotonic_clock::time_point
+                                _drained; // When the Rx CQ was last found empty
     private:
       volatile uint64_t         _pending; // Flag set when currently pending
       volatile uint64_t         _posting; // Bit list of IDs currently posting
@@ -91,7 +98,8 @@ int Pds::Eb::EbLfServer::_poll(fi_cq_data_entry* cqEntry, uint64_t flags)
   else
   {
     rc = _rxcq->comp_wait(cqEntry, 1, _tmo);
-    if (rc > 0)  _tmo = 0;     // Switch to polling after successful completion
+    if (rc > 0)  _tmo = _wait; // Switch to polling after successful completion,
+                               // unless told to always wait
   }
 
   if (rc > 0)
@@ -5,10 +5,14 @@
 
 #include "psdaq/service/Task.hh"
 #include "xtcdata/xtc/Dgram.hh"
+#include "psdaq/service/SPSCBulkQueue.hh"
 
 #include <stdlib.h>
 #include <new>
 #include <chrono>
+#include <thread>
+#include <atomic>
+#include <algorithm>
 
 #define UNLIKELY(expr)  __builtin_expect(!!(expr), 0)
 #define LIKELY(expr)    __builtin_expect(!!(expr), 1)
@@ -22,24 +26,93 @@ using us_t = std::chrono::microseconds;
 
 static constexpr unsigned CLS = 64;     // Cache Line Size
 
+static constexpr unsigned WORK_DEPTH  = 4 * 1024;  // Per builder thread
+static constexpr unsigned NOTES_DEPTH = 64 * 1024; // Per builder thread
+
+
+// What the sequencer hands a builder thread
+struct EventBuilder::Work
+{
+  enum Kind { Batch, Revoke, Free };
+
+  Kind           kind;
+  unsigned       imm;
+  uint64_t       batch;                 // Sequence number of a Batch
+  const EbDgram* ctrb;                  // First contribution of a Batch
+  EbEvent*       event;                 // Event to Revoke or Free
+  size_t         size;
+  const void*    end;
+  time_point_t   t0;
+};
+
+// What a builder thread tells the sequencer
+struct EventBuilder::Note
+{
+  enum { New = 1, Built = 2, Mark = 4 }; // Built events are the sequencer's
+
+  unsigned kind;
+  EbEvent* event;
+  uint64_t batch;                       // Sequence number of a built (Mark) batch
+  unsigned src;                         // A Mark's contributor, and its timings,
+  int64_t  arrTime;                     // which only the sequencer records so
+  int64_t  ebTime;                      // that the exporter sees one writer
+};
+
+// A builder thread and the events it is making.  Its epochs, and thus the
+// events in it, are found by direct lookup: the epoch's key picks an entry,
+// and the pulse ID within the epoch picks the slot in it.
+struct EventBuilder::Shard
+{
+  Shard(unsigned id_, unsigned entries, uint64_t duration_, GenericPool& freelist_) :
+    id      (id_),
+    duration(duration_),
+    freelist(freelist_),
+    keys    (entries, 0),
+    live    (entries, 0),
+    slots   (entries * duration_, nullptr),
+    work    (WORK_DEPTH),
+    notes   (NOTES_DEPTH),
+    running (false)
+  {
+  }
+
+  const unsigned        id;
+  const uint64_t        duration;       // Of an epoch, in pulse ID ticks
+  GenericPool&          freelist;       // Freed only by this thread
+  std::vector<uint64_t> keys;           // Epoch each entry holds
+  std::vector<unsigned> live;           // Number of events being built per entry
+  std::vector<EbEvent*> slots;          // Events being built, per entry and pulse ID
+  SPSCBulkQueue<Work>   work;
+  SPSCBulkQueue<Note>   notes;
+  std::vector<Note>     backlog;        // Notes taken off while work was full
+  std::atomic<bool>     running;
+  std::thread           thread;
+};
+
 
 EventBuilder::EventBuilder(unsigned        timeout,
-                           const unsigned& verbose) :
+                           const unsigned& verbose,
+                           unsigned        shards) :
   _pending     (),
   _eventTimeout(uint64_t(timeout) * 1000000ul), // Convert to ns
   _tmoEvtCnt   (0),
   _fixupCnt    (0),
-  _missing     (0),
+  _missing     (),
   _epochOccCnt (0),
   _eventOccCnt (0),
   _age         (0),
   _ebTime      (0),
-  _verbose     (verbose)
+  _verbose     (verbose),
+  _nShards     (shards),
+  _dispatched  (0),
+  _built       (0),
+  _due         (nullptr)
 {
 }
 
 EventBuilder::~EventBuilder()
 {
+  _stopShards();
 }
 
 int EventBuilder::initialize(unsigned epochs,
@@ -53,6 +126,12 @@ int EventBuilder::initialize(unsigned epochs,
             __func__, duration);
     return 1;
   }
+  if (_nShards > UINT8_MAX)           // EbEvent::_shard holds the builder's index
+  {
+    fprintf(stderr, "%s:\n  Number of builder threads (%u) must be at most %u\n",
+            __func__, _nShards, UINT8_MAX);
+    return 1;
+  }
   _mask = ~PulseId(duration - 1).pulseId();
   _maxEntries = entries;
 
@@ -67,10 +146,44 @@ int EventBuilder::initialize(unsigned epochs,
   auto epSize = sizeof(EbEpoch) + entries * sizeof(EbEvent*);
   auto evSize = sizeof(EbEvent) + sources * sizeof(EbDgram*);
   _epochFreelist = std::make_unique<GenericPool>(epSize, nep, CLS);
-  _eventFreelist = std::make_unique<GenericPool>(evSize, nev, CLS);
 
   _epochLut.resize(nep, nullptr);
-  _eventLut.resize(nev, nullptr);
+
+  _stopShards();
+  _shards.clear();
+  _eventFreelists.clear();
+
+  if (!_nShards)
+  {
+    _eventFreelists.push_back(std::make_unique<GenericPool>(evSize, nev, CLS));
+
+    _eventLut.resize(nev, nullptr);
+  }
+  else
+  {
+    // Epochs are dealt out round robin, so each builder holds its share of
+    // them, plus slack for the one at either end of the window
+    auto nepShard = (nep + _nShards - 1) / _nShards + 2;
+    auto nevShard = nepShard * entries;
+    for (unsigned i = 0; i < _nShards; ++i)
+    {
+      _eventFreelists.push_back(std::make_unique<GenericPool>(evSize, nevShard, CLS));
+      _shards.push_back(std::make_unique<Shard>(i, nepShard, duration, *_eventFreelists.back()));
+    }
+
+    // Room to track as many batches as can be in the builders' queues
+    size_t marks = 1;
+    while (marks < 2 * _nShards * WORK_DEPTH)  marks <<= 1;
+    _marks.assign(marks, 0);
+    _dispatched = 0;
+    _built      = 0;
+    _due        = nullptr;
+    _completed.clear();
+
+    _startShards();
+
+    printf("*** EB Builder threads %u\n", _nShards);
+  }
 
   printf("*** EB Epoch list size %zu\n", _epochLut.size());
   printf("*** EB Event list size %zu\n", _eventLut.size());
@@ -82,11 +195,11 @@ int EventBuilder::initialize(unsigned epochs,
 
 void EventBuilder::resetCounters()
 {
-  if (_eventFreelist)  _eventFreelist->clearCounters();
+  for (auto& freelist : _eventFreelists)  freelist->clearCounters();
   if (_epochFreelist)  _epochFreelist->clearCounters();
   _tmoEvtCnt   = 0;
   _fixupCnt    = 0;
-  _missing     = 0;
+  _missing     = ctrbs_t();
   _epochOccCnt = 0;
   _eventOccCnt = 0;
   _age         = 0;
@@ -97,6 +210,10 @@ void EventBuilder::resetCounters()
 
 void EventBuilder::clear()
 {
+  // Stop the builder threads so that what they made can be freed from here
+  _stopShards();
+  _drain();
+
   const EbEpoch* const lastEpoch = _pending.empty();
   EbEpoch*             epoch     = _pending.forward();
 
@@ -111,9 +228,12 @@ void EventBuilder::clear()
 
       event->disconnect();
 
-      const uint64_t key   = event->sequence();
-      unsigned       index = _evIndex(key);
-      _eventLut[index] = nullptr;
+      if (!_nShards)
+      {
+        const uint64_t key   = event->sequence();
+        unsigned       index = _evIndex(key);
+        _eventLut[index] = nullptr;
+      }
 
       delete event;
 
@@ -128,6 +248,31 @@ void EventBuilder::clear()
 
   std::fill(_epochLut.begin(), _epochLut.end(), nullptr);
   std::fill(_eventLut.begin(), _eventLut.end(), nullptr);
+
+  if (_nShards && !_shards.empty())
+  {
+    for (auto& shard : _shards)
+    {
+      Work work;
+      while (shard->work.try_pop(work))  // Events retired after the thread stopped
+      {
+        if (work.kind == Work::Free)  delete work.event;
+      }
+      std::fill(shard->keys.begin(),  shard->keys.end(),  0);
+      std::fill(shard->live.begin(),  shard->live.end(),  0);
+      std::fill(shard->slots.begin(), shard->slots.end(), nullptr);
+      shard->backlog.clear();
+      shard->work.startup();
+      shard->notes.startup();
+    }
+    std::fill(_marks.begin(), _marks.end(), 0);
+    _dispatched = 0;
+    _built      = 0;
+    _due        = nullptr;
+    _completed.clear();
+
+    _startShards();
+  }
 }
 
 inline
@@ -142,6 +287,50 @@ unsigned EventBuilder::_evIndex(uint64_t key) const
   return key % _eventLut.size();
 }
 
+// The following three are trivially true, false and true when not sharded
+
+inline
+bool EventBuilder::_incomplete(const EbEvent* event) const
+{
+  // A builder may still be adding to the event, so don't look at _remaining
+  return (event->_state != EbEvent::Built) || event->_remaining.any();
+}
+
+// An incomplete event is fixed up whatever the due event is once it has been
+// asked for or, when sharded, once a newer event of the same contract has
+// completed, as that may have been in a batch flushed ahead of this one
+inline
+bool EventBuilder::_condemned(const EbEvent* event) const
+{
+  if (event->_state >= EbEvent::Revoking)  return true;
+
+  for (const auto& completed : _completed)
+  {
+    if (completed.first == event->_contract)
+      return completed.second > event->sequence();
+  }
+  return false;
+}
+
+// Whether an event may be fixed up and retired now.  When sharded, that's
+// once its builder has given it up and all batches up to the one after which
+// it did are built, so that no older event is yet to be made.
+inline
+bool EventBuilder::_claim(EbEvent* event)
+{
+  switch (event->_state)
+  {
+    case EbEvent::Building:
+      event->_state = EbEvent::Revoking;
+      _push(*_shards[event->_shard], {Work::Revoke, 0, _dispatched, nullptr, event});
+      return false;
+    case EbEvent::Revoking:
+      return false;
+    default:
+      return event->_batch <= _built;
+  }
+}
+
 EbEpoch* EventBuilder::_discard(EbEpoch* epoch)
 {
   EbEpoch* next = epoch->reverse();
@@ -226,7 +415,7 @@ EbEvent* EventBuilder::_event(EbEpoch*            epoch,
                               unsigned            imm,
                               const time_point_t& t0)
 {
-  void* buffer = _eventFreelist->alloc(sizeof(EbEvent));
+  void* buffer = _eventFreelists[0]->alloc(sizeof(EbEvent));
   if (LIKELY(buffer))
   {
     EbEvent* event = ::new(buffer) EbEvent(contract(ctrb),
@@ -245,7 +434,7 @@ EbEvent* EventBuilder::_event(EbEpoch*            epoch,
   fprintf(stderr, "%s:\n  Unable to allocate event: %15s %014lx\n",
           __PRETTY_FUNCTION__, TransitionId::name(ctrb->service()), ctrb->pulseId());
   printf("  eventFreelist:\n");
-  _eventFreelist->dump();
+  _eventFreelists[0]->dump();
   dump(1);
   while(1);                             // Hang so we can inspect
   abort();
@@ -293,19 +482,10 @@ void EventBuilder::_fixup(EbEvent*             event,
                           ns_t                 age,
                           const EbEvent* const due)
 {
-  uint64_t remaining = event->_remaining;
-  _missing = remaining;
+  _missing = event->_remaining;
 
   // remaining != 0 whenever _fixup() is called
-  do
-  {
-    unsigned srcId = __builtin_ffsl(remaining) - 1;
-
-    fixup(event, srcId);
-
-    remaining &= ~(1ull << srcId);
-  }
-  while (remaining);
+  event->_remaining.forEach([&](unsigned srcId) { fixup(event, srcId); });
 
   if (age < _eventTimeout)  ++_fixupCnt;
   else                      ++_tmoEvtCnt;
@@ -314,16 +494,16 @@ void EventBuilder::_fixup(EbEvent*             event,
   if (_fixupCnt + _tmoEvtCnt < 100)
   {
     const EbDgram* dg = event->creator();
-    printf("%-10s %15s %014lx, size %5zu, for  remaining %016lx, RoGs %04hx, contract %016lx, age %ld ms, tmo %ld ms\n",
+    printf("%-10s %15s %014lx, size %5zu, for  remaining %s, RoGs %04hx, contract %s, age %ld ms, tmo %ld ms\n",
            age < _eventTimeout ? "Fixed-up" : "Timed-out",
            TransitionId::name(dg->service()), event->sequence(), event->_size,
-           event->_remaining, dg->readoutGroups(), event->_contract,
+           event->_remaining.hex().c_str(), dg->readoutGroups(), event->_contract.hex().c_str(),
            std::chrono::duration_cast<ms_t>(age).count(),
            std::chrono::duration_cast<ms_t>(_eventTimeout).count());
     if (age < _eventTimeout)
-      printf("Flushed by %15s %014lx, size %5zu, with remaining %016lx, RoGs %04hx, contract %016lx\n",
+      printf("Flushed by %15s %014lx, size %5zu, with remaining %s, RoGs %04hx, contract %s\n",
              TransitionId::name(due->creator()->service()), due->sequence(),
-             due->_size, due->_remaining, dg->readoutGroups(), due->_contract);
+             due->_size, due->_remaining.hex().c_str(), dg->readoutGroups(), due->_contract.hex().c_str());
   }
 }
 
@@ -336,6 +516,15 @@ void EventBuilder::_retire(EbEpoch* epoch, EbEvent* event)
   auto age{fast_monotonic_clock::now(CLOCK_MONOTONIC) - event->_t0};
   _age = std::chrono::duration_cast<ns_t>(age).count();
 
+  if (_nShards)
+  {
+    if (event == _due)  _due = nullptr;
+
+    // Only the builder that made the event may return it to its freelist
+    _push(*_shards[event->_shard], {Work::Free, 0, 0, nullptr, event});
+    return;
+  }
+
   const uint64_t key   = event->sequence();
   unsigned       index = _evIndex(key);
   EbEvent*&      entry = _eventLut[index];
@@ -349,6 +538,7 @@ void EventBuilder::_flush(const EbEvent* const due)
   const EbEpoch* const lastEpoch = _pending.empty();
   EbEpoch*             epoch     = _pending.forward();
   auto                 now       = fast_monotonic_clock::now(CLOCK_MONOTONIC);
+  bool                 blocked   = false; // Sharded: an older event isn't ours yet
 
   _tLastFlush = now;
 
@@ -365,28 +555,35 @@ void EventBuilder::_flush(const EbEvent* const due)
       // Since EbEvents are created in time order, older incomplete events can
       // be fixed up and retired when a newer complete event in the same readout
       // group (RoG) is encountered.
-      if (event->_remaining)
+      if (_incomplete(event))
       {
         // The due event may be incomplete if progress is stalled in which case
         // events in the same RoG need to be be timed out
-        if ((event->_contract != due->_contract) || due->_remaining)
+        if (!_condemned(event) &&
+            ((event->_contract != due->_contract) || _incomplete(due)))
         {
           // Time out incomplete events
           if (age < _eventTimeout)  return;
         }
 
-        _fixup(event, age, due);
+        // When sharded, keep going past events that can't be retired yet to
+        // ask for the ones after them that need fixing up too, rather than
+        // one run of them per trip through the builders' queues
+        if (_claim(event) && !blocked)  _fixup(event, age, due);
+        else                            blocked = true;
       }
+      else if (!_claim(event))  blocked = true;
+
       if (event == due)
       {
-        _retire(epoch, event);
+        if (!blocked)  _retire(epoch, event);
 
         return;
       }
 
       EbEvent* next = event->forward();
 
-      _retire(epoch, event);
+      if (!blocked)  _retire(epoch, event);
 
       event = next;
     }
@@ -434,6 +631,17 @@ void EventBuilder::_tryFlush()
 
 void EventBuilder::expired()            // Periodically called upon a timeout
 {
+  if (_nShards)
+  {
+    // Deliver what the builders finished since contributions stopped, but
+    // leave the rest for when they have stopped for as long as when the
+    // caller only times out after that
+    _sequence();
+
+    const ms_t tmo{100};
+    if (fast_monotonic_clock::now(CLOCK_MONOTONIC) - _tLastBatch < tmo)  return;
+  }
+
   // Order matters: Wait one additional timeout period after _flush() has
   // emptied the EB of events before calling the application's flush().
   const EbEpoch* const lastEpoch = _pending.empty();
@@ -490,6 +698,13 @@ void EventBuilder::process(const EbDgram*    buffer,
 {
   auto t0{fast_monotonic_clock::now(CLOCK_MONOTONIC)};
 
+  if (_nShards)
+  {
+    _dispatch(buffer, size, immData, end, t0);
+    _sequence();
+    return;
+  }
+
   const EbDgram* ctrb  = buffer;
   unsigned       imm   = immData;
   EbEpoch*       epoch = _match(ctrb->pulseId());
@@ -500,7 +715,7 @@ void EventBuilder::process(const EbDgram*    buffer,
   {
     event = _insert(epoch, ctrb, event, imm, t0);
 
-    if (!event->_remaining)
+    if (event->_remaining.none())
     {
       if (due && (event->_contract != due->_contract))  _flush(due);
       due = event;
@@ -540,6 +755,301 @@ void EventBuilder::process(const EbDgram*    buffer,
   _ebTime       = std::chrono::duration_cast<ns_t>(t1 - t0).count();
 }
 
+/*
+** ++
+**
+**    When sharded, process() only hands each batch to the builder thread
+**    owning its epoch, and then sequences what the builders have done.
+**    A builder announces each event it makes, and hands it over to the
+**    sequencer when it is complete, or when the sequencer asks for it to be
+**    fixed up.  Either way the builder doesn't touch the event again, and the
+**    sequencer doesn't look at its contributions until then.  The sequencer
+**    puts the events into the epochs' pending lists and retires them in
+**    order with the same logic as above, but no event is retired before all
+**    batches handed out before the one it was completed or given up after
+**    have been built, so that all events older than it are in the lists.
+**    Requests to give up an event go through the same queue as the batches,
+**    so a contribution already on its way still completes it.
+**
+** --
+*/
+
+void EventBuilder::_startShards()
+{
+  for (auto& shard : _shards)
+  {
+    shard->running = true;
+    shard->thread  = std::thread([this, &shard = *shard] { _builder(shard); });
+  }
+}
+
+void EventBuilder::_stopShards()
+{
+  for (auto& shard : _shards)  shard->work.shutdown();
+
+  for (auto& shard : _shards)
+  {
+    // A builder may be waiting for room for its notes before it can finish
+    while (shard->running.load(std::memory_order_acquire))
+    {
+      _stash();
+      std::this_thread::yield();
+    }
+    if (shard->thread.joinable())  shard->thread.join();
+  }
+}
+
+inline
+unsigned EventBuilder::_shard(uint64_t key) const
+{
+  return (key >> __builtin_ctzl(_mask)) % _nShards;
+}
+
+inline
+unsigned EventBuilder::_entry(const Shard& shard, uint64_t key) const
+{
+  return ((key >> __builtin_ctzl(_mask)) / _nShards) % shard.keys.size();
+}
+
+void EventBuilder::_builder(Shard& shard)
+{
+  Work   work[16];
+  size_t n;
+
+  while ((n = shard.work.pop_n(work, 16)))
+  {
+    for (size_t i = 0; i < n; ++i)
+    {
+      switch (work[i].kind)
+      {
+        case Work::Batch:   _build (shard, work[i]);  break;
+        case Work::Revoke:  _revoke(shard, work[i]);  break;
+        case Work::Free:    delete work[i].event;     break;
+      }
+    }
+  }
+
+  shard.running.store(false, std::memory_order_release);
+}
+
+void EventBuilder::_build(Shard& shard, const Work& work)
+{
+  const EbDgram* ctrb  = work.ctrb;
+  unsigned       imm   = work.imm;
+  uint64_t       key   = ~0ul;
+  unsigned       entry = 0;
+  EbEvent*       event = nullptr;
+
+  for (unsigned i = 0; i < _maxEntries; ++i)
+  {
+    uint64_t pid = ctrb->pulseId();
+
+    // Batches don't span epochs, so this is normally done only once
+    if ((pid & _mask) != key)
+    {
+      key   = pid & _mask;
+      entry = _entry(shard, key);
+      if (shard.keys[entry] != key)
+      {
+        if (UNLIKELY(shard.live[entry]))
+        {
+          fprintf(stderr, "%s:\n  Epoch %014lx collides with %014lx, which has %u events being built\n",
+                  __PRETTY_FUNCTION__, key, shard.keys[entry], shard.live[entry]);
+          abort();
+        }
+        shard.keys[entry] = key;
+      }
+    }
+
+    EbEvent*& slot = shard.slots[entry * shard.duration + (pid - key)];
+    unsigned  kind = 0;
+    if (!slot)
+    {
+      void* buffer = shard.freelist.alloc(sizeof(EbEvent));
+      if (UNLIKELY(!buffer))
+      {
+        fprintf(stderr, "%s:\n  Unable to allocate event: %15s %014lx\n",
+                __PRETTY_FUNCTION__, TransitionId::name(ctrb->service()), pid);
+        printf("  eventFreelist %u:\n", shard.id);
+        shard.freelist.dump();
+        abort();
+      }
+      slot = ::new(buffer) EbEvent(contract(ctrb), nullptr, ctrb, imm, work.t0);
+      slot->_state = EbEvent::Building;
+      slot->_shard = shard.id;
+      ++shard.live[entry];
+      kind = Note::New;
+    }
+    else
+      slot->_add(ctrb, imm);
+
+    event = slot;
+    if (event->_remaining.none())
+    {
+      event->_batch = work.batch;
+      slot = nullptr;
+      --shard.live[entry];
+      kind |= Note::Built;
+    }
+    if (kind)  shard.notes.push({kind, event, 0});
+
+    if (ctrb->isEOL())  break;
+
+    ctrb = reinterpret_cast<const EbDgram*>(reinterpret_cast<const char*>(ctrb) + work.size);
+    imm++;
+    if ((ctrb > work.end) || (i == _maxEntries - 1))
+    {
+      fprintf(stderr, "%s:\n  Error: EOL not seen before buffer end, last pid %014lx, src %u\n"
+              "  buffer %p, end %p, ctrb %p, entry size, %zu, immData %08x, imm %08x, i %u\n",
+              __PRETTY_FUNCTION__, pid, event->creator()->xtc.src.value(),
+              work.ctrb, work.end, ctrb, work.size, work.imm, imm, i);
+    }
+  }
+
+  auto t1{fast_monotonic_clock::now(CLOCK_MONOTONIC)};
+  auto src = work.ctrb->xtc.src.value(); // Same for all ctrbs in a batch
+  shard.notes.push({Note::Mark, nullptr, work.batch, src,
+                    std::chrono::duration_cast<ns_t>(work.t0 - event->_t0).count(),
+                    std::chrono::duration_cast<ns_t>(t1 - work.t0).count()});
+}
+
+void EventBuilder::_revoke(Shard& shard, const Work& work)
+{
+  EbEvent*       event = work.event;
+  const uint64_t pid   = event->sequence();
+  const uint64_t key   = pid & _mask;
+  unsigned       entry = _entry(shard, key);
+  if (shard.keys[entry] != key)  return;
+
+  // If it's no longer in its slot, it was completed and is on its way
+  EbEvent*& slot = shard.slots[entry * shard.duration + (pid - key)];
+  if (slot != event)  return;
+
+  event->_batch = work.batch;
+  slot = nullptr;
+  --shard.live[entry];
+  shard.notes.push({Note::Built, event, 0});
+}
+
+// Take the builders' notes off their queues while waiting for room, so that
+// none of them is stuck waiting for room for them instead
+void EventBuilder::_push(Shard& shard, const Work& work)
+{
+  while (!shard.work.try_push(work))
+  {
+    _stash();
+    std::this_thread::yield();
+  }
+}
+
+void EventBuilder::_dispatch(const EbDgram*      ctrb,
+                             const size_t        size,
+                             unsigned            imm,
+                             const void* const   end,
+                             const time_point_t& t0)
+{
+  // Make sure there is room to keep track of the batch in _marks
+  while (_dispatched - _built >= _marks.size())
+  {
+    _drain();
+    std::this_thread::yield();
+  }
+
+  _tLastBatch = t0;
+
+  _push(*_shards[_shard(ctrb->pulseId())],
+        {Work::Batch, imm, ++_dispatched, ctrb, nullptr, size, end, t0});
+}
+
+void EventBuilder::_stash()
+{
+  for (auto& shard : _shards)
+  {
+    Note note;
+    while (shard->notes.try_pop(note))  shard->backlog.push_back(note);
+  }
+}
+
+void EventBuilder::_drain()
+{
+  Note notes[64];
+
+  for (auto& shard : _shards)
+  {
+    for (const auto& note : shard->backlog)  _note(note);
+    shard->backlog.clear();
+
+    size_t n;
+    while ((n = shard->notes.try_pop_n(notes, 64)))
+    {
+      for (size_t i = 0; i < n; ++i)  _note(notes[i]);
+    }
+  }
+}
+
+void EventBuilder::_note(const Note& note)
+{
+  if (note.kind == Note::Mark)
+  {
+    _arrTime[note.src] = note.arrTime;
+    _ebTime            = note.ebTime;
+
+    // Advance over the built batches that have none unbuilt before them
+    const auto mask = _marks.size() - 1;
+    _marks[note.batch & mask] = 1;
+    while (_marks[(_built + 1) & mask])
+    {
+      _marks[++_built & mask] = 0;
+    }
+    return;
+  }
+
+  EbEvent* event = note.event;
+
+  if (note.kind & Note::New)  _place(event);
+
+  if (note.kind & Note::Built)
+  {
+    if (event->_remaining)              // Given up when asked for
+    {
+      event->_state = EbEvent::Revoked;
+      return;
+    }
+    event->_state = EbEvent::Built;
+
+    const uint64_t pid = event->sequence();
+    auto it = std::find_if(_completed.begin(), _completed.end(),
+                           [&](const std::pair<ctrbs_t, uint64_t>& completed)
+                           { return completed.first == event->_contract; });
+    if      (it == _completed.end())  _completed.emplace_back(event->_contract, pid);
+    else if (pid > it->second)        it->second = pid;
+
+    if (!_due || (pid > _due->sequence()))  _due = event;
+  }
+}
+
+// Events mostly turn up in order, so look for where it goes from the end
+void EventBuilder::_place(EbEvent* event)
+{
+  const uint64_t       key   = event->sequence();
+  EbEpoch*             epoch = _match(key);
+  const EbEvent* const empty = epoch->pending.empty();
+  EbEvent*             after = epoch->pending.reverse();
+
+  while ((after != empty) && (after->sequence() > key))
+    after = after->reverse();
+
+  event->connect(after);
+}
+
+void EventBuilder::_sequence()
+{
+  _drain();
+
+  if (_due)  _flush(_due);   // Attempt to flush everything up to the due event
+  else       _tryFlush();    // Periodically flush when no events are completing
+}
+
 /*
 ** ++
 **
@@ -568,6 +1078,9 @@ void EventBuilder::dump(unsigned detail) const
   printf("Event Builder epoch pool:\n");
   _epochFreelist->dump();
 
-  printf("Event Builder event pool:\n");
-  _eventFreelist->dump();
+  for (const auto& freelist : _eventFreelists)
+  {
+    printf("Event Builder event pool:\n");
+    freelist->dump();
+  }
 }
@@ -2,8 +2,11 @@
 #define Pds_Eb_EventBuilder_hh
 
 #include <stdint.h>
+#include <memory>
 #include <vector>
 
+#include "eb.hh"
+
 #include "psdaq/service/LinkedList.hh"
 #include "psdaq/service/GenericPool.hh"
 #include "psdaq/service/fast_monotonic_clock.hh"
@@ -19,11 +22,19 @@ namespace Pds {
     class EbEpoch;
     class EbEvent;
 
+    // With shards > 0, the contributions are sorted into events by that many
+    // builder threads, each of which owns the epochs whose index modulo shards
+    // is its own.  The thread calling process() hands them the batches through
+    // lock-free queues, and is the sequencer: it learns of the events as they
+    // are made and completed, puts them in pulse ID order, and fixes them up,
+    // retires them and calls process(EbEvent*) for them as before, from the
+    // same thread.  contract() is called on the builder threads then.
     class EventBuilder
     {
     public:
       EventBuilder(unsigned        timeout,
-                   const unsigned& verbose);
+                   const unsigned& verbose,
+                   unsigned        shards = 0);
       virtual ~EventBuilder();
     protected:
       int                initialize(unsigned epochs,
@@ -34,7 +45,7 @@ namespace Pds {
       virtual void       flush() {}
       virtual void       fixup(EbEvent*, unsigned srcId)     = 0;
       virtual void       process(EbEvent*)                   = 0;
-      virtual uint64_t   contract(const Pds::EbDgram*) const = 0;
+      virtual ctrbs_t    contract(const Pds::EbDgram*) const = 0;
     public:
       void               expired();
     public:
@@ -43,6 +54,7 @@ namespace Pds {
                                  unsigned            imm,
                                  const void* const   end);
     public:
+      unsigned           shards() const { return _nShards; }
       void               resetCounters();
       void               clear();
       void               dump(unsigned detail) const;
@@ -55,7 +67,7 @@ namespace Pds {
       const uint64_t     eventPoolDepth() const; // Right: not a ref
       const uint64_t     timeoutCnt()     const;
       const uint64_t     fixupCnt()       const;
-      const uint64_t     missing()        const;
+      const ctrbs_t&     missing()        const;
       const int64_t      eventAge()       const;
       const int64_t      ebTime()         const;
       const int64_t      arrTime(unsigned src) const;
@@ -64,6 +76,10 @@ namespace Pds {
     public:
       using time_point_t = std::chrono::time_point<fast_monotonic_clock>;
       using ns_t         = std::chrono::nanoseconds;
+    private:
+      struct Work;
+      struct Note;
+      struct Shard;
     private:
       unsigned          _epIndex(uint64_t key) const;
       unsigned          _evIndex(uint64_t key) const;
@@ -87,6 +103,28 @@ namespace Pds {
       void              _flush(const EbEvent* const due);
       void              _flush();
       void              _tryFlush();
+    private:                            // Sharded
+      void              _startShards();
+      void              _stopShards();
+      unsigned          _shard(uint64_t key) const;
+      unsigned          _entry(const Shard&, uint64_t key) const;
+      void              _builder(Shard&);
+      void              _build(Shard&, const Work&);
+      void              _revoke(Shard&, const Work&);
+      void              _push(Shard&, const Work&);
+      void              _dispatch(const Pds::EbDgram*,
+                                  const size_t      bufSize,
+                                  unsigned          imm,
+                                  const void* const end,
+                                  const time_point_t&);
+      void              _stash();
+      void              _drain();
+      void              _note(const Note&);
+      void              _place(EbEvent*);
+      void              _sequence();
+      bool              _incomplete(const EbEvent*) const;
+      bool              _condemned(const EbEvent*) const;
+      bool              _claim(EbEvent*);
     private:
       LinkedList<EbEpoch>          _pending;       // Listhead, Epochs with events pending
       time_point_t                 _tLastFlush;    // Starting time of timeout
@@ -94,18 +132,29 @@ namespace Pds {
       unsigned                     _maxEntries;    // Maximum number of entries per buffer/batch
       std::unique_ptr<GenericPool> _epochFreelist; // Freelist for new epochs
       std::vector<EbEpoch*>        _epochLut;      // LUT of allocated epochs
-      std::unique_ptr<GenericPool> _eventFreelist; // Freelist for new events
+      std::vector<std::unique_ptr<GenericPool> >
+                                   _eventFreelists;// Freelist for new events, per shard
       std::vector<EbEvent*>        _eventLut;      // LUT of allocated events
       const ns_t                   _eventTimeout;  // Maximum event age in ms
       mutable uint64_t             _tmoEvtCnt;     // Count of timed out events
       mutable uint64_t             _fixupCnt;      // Count of flushed   events
-      mutable uint64_t             _missing;       // Bit list of missing contributors
+      mutable ctrbs_t              _missing;       // Bit list of missing contributors
       mutable int64_t              _epochOccCnt;   // Number of epochs in use
       mutable int64_t              _eventOccCnt;   // Number of events in use
       mutable int64_t              _age;           // Event age
       mutable int64_t              _ebTime;        // Processing time
       std::vector<int64_t>         _arrTime;       // Contribution arrival time
       const unsigned&              _verbose;       // Print progress info
+    private:                                       // Sharded
+      const unsigned               _nShards;       // Number of builder threads
+      std::vector<std::unique_ptr<Shard> > _shards;
+      uint64_t                     _dispatched;    // Last batch handed to a builder
+      uint64_t                     _built;         // All batches up to this one are built
+      std::vector<uint8_t>         _marks;         // Batches built beyond _built
+      EbEvent*                     _due;           // Most recent complete event
+      std::vector<std::pair<ctrbs_t, uint64_t> >
+                                   _completed;     // Last complete pulse ID by contract
+      time_point_t                 _tLastBatch;    // When contributions last arrived
     };
   };
 };
@@ -130,12 +179,16 @@ inline const int64_t Pds::Eb::EventBuilder::epochOccCnt() const
 
 inline const uint64_t Pds::Eb::EventBuilder::eventAllocCnt() const
 {
-  return _eventFreelist ? _eventFreelist->numberofAllocs() : 0;
+  uint64_t cnt = 0;
+  for (const auto& freelist : _eventFreelists)  cnt += freelist->numberofAllocs();
+  return cnt;
 }
 
 inline const uint64_t Pds::Eb::EventBuilder::eventFreeCnt() const
 {
-  return _eventFreelist ? _eventFreelist->numberofFrees() : 0;
+  uint64_t cnt = 0;
+  for (const auto& freelist : _eventFreelists)  cnt += freelist->numberofFrees();
+  return cnt;
 }
 
 inline const int64_t Pds::Eb::EventBuilder::eventOccCnt() const
@@ -149,7 +202,9 @@ inline const uint64_t Pds::Eb::EventBuilder::eventPoolDepth() const
 {
   // Return a copy of the value instead of a reference
   // since it is nominally called only once by MetricExporter
-  return _eventFreelist ? _eventFreelist->numberofObjects() : 0;
+  uint64_t depth = 0;
+  for (const auto& freelist : _eventFreelists)  depth += freelist->numberofObjects();
+  return depth;
 }
 
 inline const uint64_t Pds::Eb::EventBuilder::timeoutCnt() const
@@ -162,7 +217,7 @@ inline const uint64_t Pds::Eb::EventBuilder::fixupCnt() const
   return _fixupCnt;
 }
 
-inline const uint64_t Pds::Eb::EventBuilder::missing() const
+inline const Pds::Eb::ctrbs_t& Pds::Eb::EventBuilder::missing() const
 {
   return _missing;
 }
@@ -32,7 +32,8 @@ namespace Pds {
         Pds::EbDgram(dgram, XtcData::Dgram(dgram, XtcData::Xtc(XtcData::TypeId(XtcData::TypeId::Data, 0),
                                                                XtcData::Src(id, XtcData::Level::Event)))),
         _data(0),
-        _monBufNo(0)
+        _monBufNo(0),
+        _credit(0)
       {
         xtc.extent += sizeof(ResultDgram) - sizeof(Pds::EbDgram);
       }
@@ -49,9 +50,12 @@ namespace Pds {
       uint32_t data()     const { return  _data; }
       void     monBufNo(uint32_t monBufNo_) { _monBufNo = monBufNo_; }
       uint32_t monBufNo() const { return _monBufNo; }
+      void     credit(uint32_t credit_) { _credit = credit_; } // See TebSchedule
+      uint32_t credit()   const { return _credit; }
     private:
       uint32_t _data;
       uint32_t _monBufNo;
+      uint32_t _credit;
     };
   };
 };
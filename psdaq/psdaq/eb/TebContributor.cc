@@ -43,11 +43,18 @@ using ms_t    = std::chrono::milliseconds;
 // This causes no harm, but is extra work.
 const std::chrono::microseconds BATCH_TIMEOUT{11000};
 
+// The latency budget for batches in us, 0 to batch by pulse ID only
+static unsigned batchLatency(const TebCtrbParams& prms)
+{
+  auto it = prms.kwargs.find("batchLatency");
+  return it != prms.kwargs.end() ? std::stoul(it->second) : 0;
+}
 
 TebContributor::TebContributor(const TebCtrbParams&                   prms,
                                unsigned                               numBuffers,
                                const std::shared_ptr<MetricExporter>& exporter) :
   _prms       (prms),
+  _batchCtl   (prms.maxEntries, batchLatency(prms)),
   _transport  (prms.verbose, prms.kwargs),
   _id         (-1),
   _numEbs     (0),
@@ -77,6 +84,11 @@ TebContributor::TebContributor(const TebCtrbParams&                   prms,
   exporter->add("TCtbO_Lat",   labels, MetricType::Gauge,   [&](){ return _latency;             });
   exporter->add("TCtbO_BtAge", labels, MetricType::Gauge,   [&](){ return _age;                 });
   exporter->add("TCtbO_BtEnt", labels, MetricType::Gauge,   [&](){ return _entries;             });
+  exporter->add("TCtbO_BtTgt", labels, MetricType::Gauge,   [&](){ return _batchCtl.entries();  });
+  exporter->add("TCtbO_BtLat", labels, MetricType::Gauge,   [&](){ return _batchCtl.latency();  });
+  for (unsigned teb = 0; teb < MAX_TEBS; ++teb)
+    exporter->add("TCtbO_TebCr" + std::to_string(teb), labels, MetricType::Gauge,
+                  [&, teb](){ return _schedule.credit(teb); });
 }
 
 TebContributor::~TebContributor()
@@ -98,6 +110,12 @@ void TebContributor::startup(EbCtrbInBase& in)
 {
   _batch.start = nullptr;
   _batch.end   = nullptr;
+  _batchCtl.reset();
+
+  // Every DRP starts out with the same schedule, before any results arrive
+  _schedule.reset(_numEbs);
+  _trPids.clear();
+  _credits.clear();
 
   resetCounters();
   in.resetCounters();
@@ -238,6 +256,8 @@ void TebContributor::process(const EbDgram* dgram)
     // On wrapping, post the batch at the end of the region, if any
     if (dgram == _batMan.batchRegion())  _flush();
 
+    if (dgram->isEvent())  _batchCtl.update(dgram->pulseId());
+
     auto svc     = dgram->service();
     bool doFlush = ((svc != TransitionId::L1Accept) &&
                     (svc != TransitionId::SlowUpdate));
@@ -254,6 +274,13 @@ void TebContributor::process(const EbDgram* dgram)
       }
       else                              // Create a new batch
         _batch = {dgram, contractor};   // Start a new batch with dgram
+
+      // Post early when the batch holds as many events as fit in the latency budget
+      if (_batchCtl.enabled() && _batchCtl.full(_batch.entries))
+      {
+        _post(_batch);
+        _batch.start = nullptr;         // Start a new batch
+      }
     }
     else
     {
@@ -291,7 +318,11 @@ void TebContributor::process(const EbDgram* dgram)
     // currently have in-progress.
     if (!dgram->isEvent())           // Also capture the most recent SlowUpdate
     {
-      if (contractor)  _post(dgram); // Post, if contributor is providing trigger input
+      if (contractor)                // Post, if contributor is providing trigger input
+      {
+        _post(dgram);
+        if (_numEbs > 1)  _trPids.push_back(dgram->pulseId()); // Result bears a credit
+      }
     }
   }
   else                        // Common RoG didn't trigger: bypass the TEB(s)
@@ -315,6 +346,7 @@ void TebContributor::_post(const Batch& batch)
   using ns_t = std::chrono::nanoseconds;
   auto age   = Pds::fast_monotonic_clock::now(CLOCK_MONOTONIC) - batch.tStart;
   _age       = std::chrono::duration_cast<ns_t>(age).count();
+  _batchCtl.posted(_age);
 
   batch.end->setEOL();        // Avoid race: terminate before adding batch to pending list
   _pending.push(batch.start); // Get the batch on the queue before any corresponding result can show up
@@ -327,7 +359,7 @@ void TebContributor::_post(const Batch& batch)
   if (batch.contractor) // Send to TEB if contributor is providing trigger input
   {
     uint64_t     pid    = batch.start->pulseId();
-    unsigned     dst    = (pid / _prms.maxEntries) % _numEbs;
+    unsigned     dst    = _teb(pid);
     EbLfCltLink* link   = _links[dst];
     unsigned     offset = link->lclOfs(batch.start);
     uint32_t     idx    = offset / _prms.maxInputSize;
@@ -410,6 +442,59 @@ void TebContributor::_post(const Batch& batch)
   ++_batchCount;                        // Count all batches handled
 }
 
+// Called on the receiver thread with the credit the TEB that built a
+// transition granted itself in its result
+void TebContributor::credit(uint64_t pid, unsigned teb, unsigned credits)
+{
+  if (_numEbs == 1)  return;            // Nothing to schedule: _teb() won't look
+
+  std::lock_guard<std::mutex> lock(_creditLock);
+  _credits[pid] = {teb, credits};
+}
+
+// Returns the TEB to send the batch starting with pid to.  Every DRP must
+// choose the same one, so the credits granted with a transition's result are
+// applied starting with the first batch TEB_CREDIT_LAG_MS after it, by which
+// time all DRPs will have received them.  Should one still be outstanding, it
+// is waited for, which holds back this DRP's events as a TEB that is slow to
+// produce results would anyway.  Going on without it would send batches to
+// TEBs other than those the other DRPs chose, so events could never be built.
+unsigned TebContributor::_teb(uint64_t pid)
+{
+  const uint64_t lag   = uint64_t(TEB_CREDIT_LAG_MS) * TICK_RATE / 1000;
+  const uint64_t epoch = pid / _prms.maxEntries;
+
+  while (!_trPids.empty() && ((_trPids.front() + lag) / _prms.maxEntries <= epoch))
+  {
+    auto trPid = _trPids.front();
+    auto t0    = Pds::fast_monotonic_clock::now(CLOCK_MONOTONIC);
+    while (true)
+    {
+      {
+        std::lock_guard<std::mutex> lock(_creditLock);
+        auto it = _credits.find(trPid);
+        if (it != _credits.end())
+        {
+          _schedule.credit(it->second.first, it->second.second);
+          _credits.erase(_credits.begin(), ++it); // Along with any stale ones
+          break;
+        }
+      }
+      auto now = Pds::fast_monotonic_clock::now(CLOCK_MONOTONIC);
+      if (now - t0 > ms_t(EB_TMO_MS))
+      {
+        logging::critical("%s:\n  No TEB credit received for transition %014lx",
+                          __PRETTY_FUNCTION__, trPid);
+        abort();
+      }
+      std::this_thread::sleep_for(ms_t(1));
+    }
+    _trPids.pop_front();
+  }
+
+  return _schedule.teb(epoch);
+}
+
 // This is the same as in MebContributor as we have no good common place for it
 // The posting side is EbAppBase::post(const EbDgram* const* begin, const EbDgram** const end)
 static int _getTrBufIdx(EbLfLink* lnk, TebContributor::listU32_t& lst, uint32_t& idx)
@@ -463,7 +548,7 @@ void TebContributor::_post(const EbDgram* dgram)
   //dgram->setEOL();                      // Terminate the "batch" of 1 entry
 
   uint64_t pid = dgram->pulseId();
-  unsigned dst = (pid / _prms.maxEntries) % _numEbs;
+  unsigned dst = _teb(pid);
   size_t   sz  = sizeof(*dgram) + dgram->xtc.sizeofPayload();
   bool     print = false;
 
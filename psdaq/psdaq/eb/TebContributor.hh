@@ -6,7 +6,9 @@
 #include "psdaq/service/EbDgram.hh"
 
 #include "BatchManager.hh"
+#include "BatchController.hh"
 #include "EbLfClient.hh"
+#include "TebSchedule.hh"
 #include "drp/spscqueue.hh"
 #include "psdaq/service/fast_monotonic_clock.hh"
 
@@ -16,6 +18,9 @@
 #include <atomic>
 #include <thread>
 #include <list>
+#include <deque>
+#include <map>
+#include <mutex>
 
 
 namespace Pds {
@@ -61,17 +66,21 @@ namespace Pds {
       void*       fetch(unsigned index);
       void        process(unsigned index);
       bool        timeout();
+      void        credit(uint64_t pid, unsigned teb, unsigned credits);
     public:
       BatchQueue& pending()  { return _pending; }
+      const BatchController& batchController() const { return _batchCtl; }
     private:
       void       _flush();
       void       _post(const Pds::EbDgram* nonEvent);
       void       _post(const Batch& batch);
+      unsigned   _teb(uint64_t pid);
     public:
       using listU32_t = std::list<uint32_t>;
     private:
       const TebCtrbParams&      _prms;
       BatchManager              _batMan;
+      BatchController           _batchCtl;
       EbLfClient                _transport;
       std::vector<EbLfCltLink*> _links;
       std::vector<listU32_t >   _trBuffers;
@@ -80,6 +89,11 @@ namespace Pds {
       BatchQueue                _pending; // Time ordered list of completed batches
       Batch                     _batch;
       uint64_t                  _previousPid;
+      TebSchedule               _schedule;
+      std::deque<uint64_t>      _trPids;  // Transitions whose credits aren't applied yet
+      std::map<uint64_t, std::pair<unsigned, unsigned> >
+                                _credits; // Credits received, by transition pulse ID
+      std::mutex                _creditLock;
     private:
       mutable uint64_t          _eventCount;
       mutable uint64_t          _batchCount;
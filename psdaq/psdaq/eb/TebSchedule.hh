@@ -0,0 +1,87 @@
+#ifndef Pds_Eb_TebSchedule_hh
+#define Pds_Eb_TebSchedule_hh
+
+#include "eb.hh"
+
+#include <cstdint>
+#include <array>
+#include <vector>
+
+
+namespace Pds {
+  namespace Eb {
+
+    // Which TEB builds each batch.  Every DRP must pick the same one, so this
+    // is a function of nothing but the batch's epoch (its pulse ID divided by
+    // the batch duration) and the credits the TEBs have granted, which the
+    // DRPs change at the same epochs.  The TEBs are dealt out over a cycle of
+    // as many epochs as there are credits, each one getting as many epochs as
+    // it has credits, spread as evenly through the cycle as they can be.
+    // With all credits equal, this is the plain epoch modulo number of TEBs.
+    class TebSchedule
+    {
+    public:
+      TebSchedule() : _numEbs(0) { }
+    public:
+      void     reset(unsigned numEbs);  // Gives each TEB MAX_CREDITS
+      bool     credit(unsigned teb, unsigned credits); // T if it changed
+      unsigned credit(unsigned teb) const { return _credits[teb]; }
+      unsigned teb(uint64_t epoch) const { return _cycle[epoch % _cycle.size()]; }
+    private:
+      void     _deal();
+    private:
+      unsigned                           _numEbs;
+      std::array<unsigned, MAX_TEBS>     _credits;
+      std::vector<uint8_t>               _cycle;
+    };
+  };
+};
+
+
+inline
+void Pds::Eb::TebSchedule::reset(unsigned numEbs)
+{
+  _numEbs = numEbs;
+  _credits.fill(0);
+  for (unsigned teb = 0; teb < _numEbs; ++teb)
+    _credits[teb] = MAX_CREDITS;
+  _deal();
+}
+
+inline
+bool Pds::Eb::TebSchedule::credit(unsigned teb, unsigned credits)
+{
+  if (credits < 1)            credits = 1; // Leave each TEB a share to report in
+  if (credits > MAX_CREDITS)  credits = MAX_CREDITS;
+  if ((teb >= _numEbs) || (credits == _credits[teb]))  return false;
+
+  _credits[teb] = credits;
+  _deal();
+  return true;
+}
+
+inline
+void Pds::Eb::TebSchedule::_deal()
+{
+  // Smooth weighted round robin: each step every TEB earns its credits, and
+  // the one that has earned the most (the lowest numbered on ties) gets the
+  // epoch and pays back the total
+  unsigned total = 0;
+  for (unsigned teb = 0; teb < _numEbs; ++teb)  total += _credits[teb];
+
+  std::array<int, MAX_TEBS> earned{};
+  _cycle.resize(total ? total : 1, 0);
+  for (unsigned i = 0; i < total; ++i)
+  {
+    unsigned best = 0;
+    for (unsigned teb = 0; teb < _numEbs; ++teb)
+    {
+      earned[teb] += _credits[teb];
+      if (earned[teb] > earned[best])  best = teb;
+    }
+    earned[best] -= total;
+    _cycle[i]     = best;
+  }
+}
+
+#endif
@@ -0,0 +1,230 @@
+#ifndef Pds_Eb_TrgPool_hh
+#define Pds_Eb_TrgPool_hh
+
+#include "psdaq/service/SPSCBulkQueue.hh"
+#include "psdaq/service/fast_monotonic_clock.hh"
+
+#include <cstdint>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <vector>
+
+
+namespace Pds {
+  namespace Eb {
+
+    // The ring of events a pool of worker threads evaluates the trigger for,
+    // and their bookkeeping, kept apart from the TEB so that it can be tested
+    // on its own.  Events are claimed and committed one at a time, in order,
+    // on one thread, which also gathers them back.  The committed events are
+    // handed out as chunks of up to maxChunk, which don't wrap around the end
+    // of the ring, round robin over the workers.  Each worker evaluates its
+    // chunks in order, so taking them back round robin too returns the events
+    // in the order they were committed.  The Item kept with each event is for
+    // the caller's use when it gets the event back.
+    template <class Event, class Item>
+    class TrgPool
+    {
+    public:
+      using Evaluate = std::function<void(Event* events, unsigned count)>;
+    public:
+      TrgPool(unsigned depth);          // A power of 2
+      ~TrgPool() { stop(); }
+    public:
+      void     start(unsigned workers, unsigned maxChunk, const Evaluate& evaluate);
+      void     stop();
+      bool     running()   const { return !_threads.empty(); }
+      uint64_t occupancy() const { return _head - _tail; }
+      int64_t  dt()        const { return _dt; } // Per event, of the last chunk gathered, in ns
+    public:
+      template <class Done>
+      unsigned claim(Done done);        // Returns the next slot, making room if need be
+      Event&   event(unsigned slot) { return _events[slot]; }
+      Item&    item (unsigned slot) { return _items [slot]; }
+      void     commit();                // Queues the event in the slot claimed
+      void     submit();                // Hands out the events committed so far
+      template <class Done>
+      bool     gather(bool wait, Done done); // T if any events came back
+      template <class Done>
+      void     drain(Done done);        // Waits for every event committed
+    private:
+      struct Chunk
+      {
+        unsigned first;
+        unsigned count;
+        int64_t  dt;                    // Evaluation time per event, in ns
+      };
+      using Queue = SPSCBulkQueue<Chunk>;
+    private:
+      void     _worker(unsigned id);
+    private:
+      const unsigned                      _depth;
+      unsigned                            _maxChunk;
+      Evaluate                            _evaluate;
+      std::vector<Event>                  _events;
+      std::vector<Item>                   _items;
+      std::vector<std::thread>            _threads;
+      std::vector<std::unique_ptr<Queue> > _work;     // Per worker, chunks to evaluate
+      std::vector<std::unique_ptr<Queue> > _done;     // Per worker, chunks evaluated
+      uint64_t                            _head;      // Next event to commit
+      uint64_t                            _tail;      // Oldest event not yet gathered
+      uint64_t                            _open;      // First event not yet submitted
+      uint64_t                            _chunkHead; // Next chunk to submit
+      uint64_t                            _chunkTail; // Oldest chunk not yet gathered
+      int64_t                             _dt;
+    };
+  };
+};
+
+
+template <class Event, class Item>
+inline
+Pds::Eb::TrgPool<Event, Item>::TrgPool(unsigned depth) :
+  _depth    (depth),
+  _maxChunk (1),
+  _head     (0),
+  _tail     (0),
+  _open     (0),
+  _chunkHead(0),
+  _chunkTail(0),
+  _dt       (0)
+{
+}
+
+template <class Event, class Item>
+inline
+void Pds::Eb::TrgPool<Event, Item>::start(unsigned        workers,
+                                          unsigned        maxChunk,
+                                          const Evaluate& evaluate)
+{
+  stop();
+
+  _maxChunk  = maxChunk ? maxChunk : 1;
+  _evaluate  = evaluate;
+  _head      = 0;
+  _tail      = 0;
+  _open      = 0;
+  _chunkHead = 0;
+  _chunkTail = 0;
+  _dt        = 0;
+
+  if (!workers)  return;
+
+  _events.resize(_depth);
+  _items .resize(_depth);
+
+  for (unsigned i = 0; i < workers; ++i)
+  {
+    _work.emplace_back(std::make_unique<Queue>(_depth));
+    _done.emplace_back(std::make_unique<Queue>(_depth));
+  }
+  for (unsigned i = 0; i < workers; ++i)
+    _threads.emplace_back(&TrgPool::_worker, this, i);
+}
+
+template <class Event, class Item>
+inline
+void Pds::Eb::TrgPool<Event, Item>::stop()
+{
+  for (auto& work : _work)  work->shutdown();
+  for (auto& thread : _threads)
+  {
+    if (thread.joinable())  thread.join();
+  }
+  _threads.clear();
+  _work.clear();
+  _done.clear();
+}
+
+template <class Event, class Item>
+inline
+void Pds::Eb::TrgPool<Event, Item>::_worker(unsigned id)
+{
+  auto& work = *_work[id];
+  auto& done = *_done[id];
+  Chunk chunk;
+
+  while (work.pop(chunk))
+  {
+    auto t0{fast_monotonic_clock::now(CLOCK_MONOTONIC)};
+    _evaluate(&_events[chunk.first], chunk.count);
+    auto t1{fast_monotonic_clock::now(CLOCK_MONOTONIC)};
+    chunk.dt = std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count() / chunk.count;
+
+    done.push(chunk);                   // Never full: it's as deep as the ring
+  }
+}
+
+template <class Event, class Item>
+template <class Done>
+inline
+unsigned Pds::Eb::TrgPool<Event, Item>::claim(Done done)
+{
+  if (_head - _tail == _depth)  drain(done); // Wait for room
+
+  return _head & (_depth - 1);
+}
+
+template <class Event, class Item>
+inline
+void Pds::Eb::TrgPool<Event, Item>::commit()
+{
+  // Chunks don't wrap around the end of the ring
+  ++_head;
+  if ((_head - _open == _maxChunk) || !(_head & (_depth - 1)))
+    submit();
+}
+
+template <class Event, class Item>
+inline
+void Pds::Eb::TrgPool<Event, Item>::submit()
+{
+  if (_head == _open)  return;
+
+  Chunk chunk{unsigned(_open & (_depth - 1)), unsigned(_head - _open), 0};
+  _work[_chunkHead++ % _work.size()]->push(chunk);
+  _open = _head;
+}
+
+template <class Event, class Item>
+template <class Done>
+inline
+bool Pds::Eb::TrgPool<Event, Item>::gather(bool wait, Done done)
+{
+  bool gathered = false;
+  while (_chunkTail != _chunkHead)
+  {
+    Chunk chunk;
+    if (!_done[_chunkTail % _done.size()]->try_pop(chunk))
+    {
+      if (!wait)  break;
+      std::this_thread::yield();
+      continue;
+    }
+    ++_chunkTail;
+    _dt      = chunk.dt;
+    gathered = true;
+
+    for (unsigned i = chunk.first; i < chunk.first + chunk.count; ++i)
+    {
+      done(_events[i], _items[i]);
+    }
+    _tail += chunk.count;
+  }
+  return gathered;
+}
+
+template <class Event, class Item>
+template <class Done>
+inline
+void Pds::Eb::TrgPool<Event, Item>::drain(Done done)
+{
+  if (_threads.empty())  return;
+
+  submit();
+  gather(true, done);
+}
+
+#endif
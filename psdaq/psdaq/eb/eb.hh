@@ -7,17 +7,25 @@
 #include <array>
 #include <map>
 
+#include "Bitmap.hh"
+
+#ifndef EB_MAX_DRPS
+#define EB_MAX_DRPS 64                  // Set by the build; see CMakeLists.txt
+#endif
 
 namespace Pds {
   namespace Eb {
 
+    const unsigned MAX_DRPS       = EB_MAX_DRPS; // Max # of Contributors
+    const unsigned DRP_ID_BITS    = __builtin_ctz(MAX_DRPS); // Bits in a DRP ID
+
     // The following are limited by the number of bits in a uint64_t
-    const unsigned MAX_DRPS       = 64;         // Max # of Contributors
     const unsigned MAX_TEBS       =  4;         // Max # of Event Builders
     const unsigned MAX_MEBS       =  4;         // Max # of Monitors
     const unsigned MAX_MRQS       = MAX_MEBS;   // Max # of Monitor Requestors
 
     const unsigned NUM_READOUT_GROUPS = 8;      // # of RoGs supported
+    const unsigned MAX_CREDITS    = 16;         // A TEB's share of batches when keeping up
 
     // On picking the following constants:
     // - Determine the contribution arrival time skew that needs to be
@@ -48,6 +56,9 @@ namespace Pds {
                                             // > EB_TMO * SlowUpdate rate
     const unsigned MEB_TR_BUFFERS = 24;     // # of MEB transition buffers
                                             // > EB_TMO * SlowUpdate rate
+    const unsigned TEB_CREDIT_LAG_MS = 1000;  // Credits a TEB grants with a
+                                            // transition apply this long after
+                                            // it, when all DRPs have them
 
     const unsigned MAX_ENTRIES    = 64;                        // <= BATCH_DURATION
     const uint64_t BATCH_DURATION = MAX_ENTRIES;               // >= MAX_ENTRIES; power of 2; beam pulse ticks (1 uS)
@@ -55,6 +66,8 @@ namespace Pds {
     const unsigned MAX_LATENCY    = 16 * 1024 * 1024;          // In beam pulse ticks (1 uS)
     const unsigned MAX_BATCHES    = MAX_LATENCY / MAX_ENTRIES; // Max # of batches in circulation
 
+    using ctrbs_t = Bitmap<MAX_DRPS>;   // ID bit list of contributors
+
     enum { VL_NONE, VL_DEFAULT, VL_BATCH, VL_EVENT, VL_DETAILED }; // Verbosity levels
 
     struct TebCtrbParams           // Used by TEB contributors (DRPs)
@@ -113,7 +126,7 @@ namespace Pds {
       using vecstr_t  = std::vector<std::string>;
       using vecsize_t = std::vector<size_t>;
       using vecuint_t = std::vector<unsigned>;
-      using u64arr_t  = std::array<uint64_t, NUM_READOUT_GROUPS>;
+      using ctrbarr_t = std::array<ctrbs_t, NUM_READOUT_GROUPS>;
       using kwmap_t   = std::map<std::string,std::string>;
 
       string_t  ifAddr;            // Network interface to use
@@ -124,10 +137,10 @@ namespace Pds {
       string_t  alias;             // Unique name passed on cmd line
       unsigned  id;                // EB instance identifier
       unsigned  rogs;              // Bit list of all readout groups in use
-      uint64_t  contributors;      // ID bit list of contributors
-      uint64_t  indexSources;      // Sources providing buffer index for Results
-      u64arr_t  contractors;       // Ctrbs providing Inputs  per readout group
-      u64arr_t  receivers;         // Ctrbs expecting Results per readout group
+      ctrbs_t   contributors;      // ID bit list of contributors
+      ctrbs_t   indexSources;      // Sources providing buffer index for Results
+      ctrbarr_t contractors;       // Ctrbs providing Inputs  per readout group
+      ctrbarr_t receivers;         // Ctrbs expecting Results per readout group
       vecstr_t  addrs;             // Contributor addresses
       vecstr_t  ports;             // Contributor ports
       vecsize_t maxTrSize;         // Max non-event EbDgram size for each Ctrb
@@ -145,6 +158,8 @@ namespace Pds {
     };
 
     // Sanity checks
+    static_assert((MAX_DRPS >= 64) && (MAX_DRPS <= 512) && ((MAX_DRPS & (MAX_DRPS - 1)) == 0),
+                  "MAX_DRPS must be one of 64, 128, 256 or 512");
     static_assert((BATCH_DURATION & (BATCH_DURATION - 1)) == 0, "BATCH_DURATION must be a power of 2");
     static_assert((MAX_BATCHES & (MAX_BATCHES - 1)) == 0, "MAX_BATCHES must be a power of 2");
     static_assert((EB_TMO_MS <= 1000ull * MAX_LATENCY/TICK_RATE), "EB_TMO_MS is too large");
@@ -7,6 +7,7 @@
 #include "EbLfServer.hh"
 
 #include "utilities.hh"
+#include "TrgPool.hh"
 
 #include "psdaq/trigger/Trigger.hh"
 #include "psdaq/trigger/utilities.hh"
@@ -28,7 +29,6 @@
 #include <cstring>
 #include <climits>                      // For HOST_NAME_MAX
 #include <csignal>
-#include <bitset>
 #include <atomic>
 #include <vector>
 #include <cassert>
@@ -37,6 +37,8 @@
 #include <exception>
 #include <algorithm>                    // For std::fill()
 #include <chrono>
+#include <thread>
+#include <memory>
 #include <Python.h>
 
 #include "rapidjson/document.h"
@@ -62,6 +64,8 @@ using us_t     = std::chrono::microseconds;
 static const int CORE_0 = -1;           // devXXX: 18, devXX:  7, accXX:  9
 static const int CORE_1 = -1;           // devXXX: 19, devXX: 19, accXX: 21
 
+static const unsigned TRG_DEPTH = 4096; // Events in the trigger workers' hands
+
 static struct sigaction      lIntAction;
 static volatile sig_atomic_t lRunning = 1;
 
@@ -93,14 +97,21 @@ namespace Pds {
 
     struct Batch
     {
-      Batch(const EbDgram* dgram, uint64_t dsts_, unsigned idx_) :
+      Batch(const EbDgram* dgram, const ctrbs_t& dsts_, unsigned idx_) :
         start(dgram), end(dgram), dsts(dsts_), idx(idx_) {};
       const EbDgram* start;
       const EbDgram* end;
-      uint64_t       dsts;
+      ctrbs_t        dsts;
       unsigned       idx;
     };
 
+    // Per event state kept while the trigger workers have it
+    struct TrgItem
+    {
+      ctrbs_t  dsts;
+      unsigned idx;
+    };
+
     class Teb : public EbAppBase
     {
     public:
@@ -122,9 +133,16 @@ namespace Pds {
     private:
       void     _queueMrqBuffers();
       void     _monitor(ResultDgram* rdg);
-      void     _tryPost(const EbDgram* dg, uint64_t dsts, unsigned idx);
+      void     _tryPost(const EbDgram* dg, const ctrbs_t& dsts, unsigned idx);
       void     _post(const Batch& batch);
-      uint64_t _receivers(unsigned rogs) const;
+      ctrbs_t  _receivers(unsigned rogs) const;
+      unsigned _grant();
+      void     _result(ResultDgram* rdg, const ctrbs_t& dsts, unsigned idx);
+    private:                            // Trigger worker pool
+      void     _trgStart(unsigned workers);
+      void     _trgQueue(ResultDgram* rdg, const EbEvent* event, const ctrbs_t& dsts, unsigned idx);
+      void     _trgGather(bool wait);
+      void     _trgDrain();
     private:
       std::vector<EbLfCltLink*>    _l3Links;
       EbLfServer                   _mrqTransport;
@@ -140,6 +158,14 @@ namespace Pds {
       unsigned                     _rogReserved[MAX_MRQS];
       uint64_t                     _lastMonPid;
       uint64_t                     _monThrottle;
+      unsigned                     _creditOcc;   // Events in hand up to which full credit is given
+      unsigned                     _creditLat;   // Time in ms behind the input up to which full credit is given
+      unsigned                     _credit;      // Most recently granted credit
+    private:
+      unsigned                     _trgWorkers;  // Requested number of trigger threads
+      TrgPool<Trigger::Event, TrgItem>
+                                   _trgPool;     // Events being evaluated
+      std::vector<const EbDgram*>  _trgCtrbs;    // Their contributions, MAX_DRPS each
     private:
       unsigned                     _wrtCounter;
       uint64_t                     _pidPrv;
@@ -200,13 +226,18 @@ Teb::Teb(const EbParams&         prms,
          const MetricExporter_t& exporter) :
   EbAppBase     (prms, exporter, "TEB", EB_TMO_MS),
   _mrqTransport (prms.verbose, prms.kwargs),
-  _batch        {nullptr, 0, 0},
+  _batch        {nullptr, ctrbs_t(), 0},
   //_trimmed      (0),
   _trigger      (nullptr),
   _iMeb         (0),
   _rogReserved  {0, 0, 0, 0},
   _lastMonPid   (0),
   _monThrottle  (0),
+  _creditOcc    (1024),
+  _creditLat    (100),
+  _credit       (MAX_CREDITS),
+  _trgWorkers   (0),
+  _trgPool      (TRG_DEPTH),
   _pidPrv       (0),
   _eventCount   (0),
   _trCount      (0),
@@ -227,6 +258,18 @@ Teb::Teb(const EbParams&         prms,
   if (_prms.kwargs.find("mon_throttle") != _prms.kwargs.end())
     _monThrottle = std::stoul(const_cast<EbParams&>(_prms).kwargs["mon_throttle"]);
 
+  // Evaluate the trigger on this many threads rather than on the EB's
+  if (_prms.kwargs.find("trg_workers") != _prms.kwargs.end())
+    _trgWorkers = std::stoul(const_cast<EbParams&>(_prms).kwargs["trg_workers"]);
+
+  // Holding up to this many events being built or triggered earns full credit
+  if (_prms.kwargs.find("credit_occ") != _prms.kwargs.end())
+    _creditOcc = std::max(1ul, std::stoul(const_cast<EbParams&>(_prms).kwargs["credit_occ"]));
+
+  // Falling behind the input by up to this many ms earns full credit
+  if (_prms.kwargs.find("credit_lat") != _prms.kwargs.end())
+    _creditLat = std::max(1ul, std::stoul(const_cast<EbParams&>(_prms).kwargs["credit_lat"]));
+
   std::map<std::string, std::string> labels{{"instrument", prms.instrument},
                                             {"partition", std::to_string(prms.partition)},
                                             {"detname", prms.alias},
@@ -249,6 +292,8 @@ Teb::Teb(const EbParams&         prms,
   exporter->add("TEB_EvtLat", labels, MetricType::Gauge,   [&](){ return _latency;               });
   exporter->add("TEB_trg_dt", labels, MetricType::Gauge,   [&](){ return _trgTime;               });
   exporter->add("TEB_BtEnt",  labels, MetricType::Gauge,   [&](){ return _entries;               });
+  exporter->add("TEB_TrgQDp", labels, MetricType::Gauge,   [&](){ return _trgPool.occupancy();  });
+  exporter->add("TEB_Credit", labels, MetricType::Gauge,   [&](){ return _credit;                });
 }
 
 int Teb::resetCounters()
@@ -291,6 +336,8 @@ void Teb::disconnect()
 
 void Teb::unconfigure()
 {
+  _trgPool.stop();
+
   if (!_l3Links.empty())              // Avoid dumping again if already done
     _batMan.dump();
   _batMan.shutdown();
@@ -412,6 +459,15 @@ int Teb::configure(Trigger* trigger,
     return rc;
   }
 
+  auto workers = _trgWorkers;
+  if ((workers > 1) && !_trigger->concurrent())
+  {
+    logging::warning("Trigger can't be called concurrently: using 1 trigger worker rather than %u",
+                     workers);
+    workers = 1;
+  }
+  _trgStart(workers);
+
   return 0;
 }
 
@@ -437,7 +493,7 @@ void Teb::run()
 
   _batch.start = nullptr;
   _batch.end   = nullptr;
-  _batch.dsts  = 0;
+  _batch.dsts  = ctrbs_t();
   _batch.idx   = 0;
 
   for (auto& monBufList : _monBufLists)
@@ -449,6 +505,15 @@ void Teb::run()
   while (lRunning)
   {
     rc = EbAppBase::process();
+
+    // Hand the trigger workers the events the batch completed, and pass on
+    // the results of those they're done with
+    if (_trgPool.running())
+    {
+      _trgPool.submit();
+      _trgGather(false);
+    }
+
     if (rc < 0)
     {
       if (rc == -FI_EAGAIN)
@@ -548,8 +613,8 @@ void Teb::process(EbEvent* event)
   {
     event->damage(Damage::OutOfOrder);
 
-    logging::critical("%s:\n  Pulse ID did not advance: %014lx <= %014lx, rem %016lx, imm %08x, svc %u, ts %u.%09u",
-                      __PRETTY_FUNCTION__, pid, _pidPrv, event->remaining(), imm, dgram->service(), dgram->time.seconds(), dgram->time.nanoseconds());
+    logging::critical("%s:\n  Pulse ID did not advance: %014lx <= %014lx, rem %s, imm %08x, svc %u, ts %u.%09u",
+                      __PRETTY_FUNCTION__, pid, _pidPrv, event->remaining().hex().c_str(), imm, dgram->service(), dgram->time.seconds(), dgram->time.nanoseconds());
 
     if (event->remaining())             // I.e., this event was fixed up
     {
@@ -588,48 +653,40 @@ void Teb::process(EbEvent* event)
 
     rdg->xtc.damage.increase(event->damage().value());
 
-    if (rdg->isEvent())
+    // Avoid sending Results to contributors that failed to supply Input
+    ctrbs_t dsts = _receivers(dgram->readoutGroups()) & ~event->remaining();
+
+    if (rdg->isEvent() && _trgPool.running())
     {
-      // Present event contributions to "user" code for building a result datagram
-      auto t0{fast_monotonic_clock::now(CLOCK_MONOTONIC)};
-      _trigger->event(event->begin(), event->end(), *rdg); // Consume
-      auto t1{fast_monotonic_clock::now(CLOCK_MONOTONIC)};
-      _trgTime = std::chrono::duration_cast<ns_t>(t1 - t0).count();
-
-      // Handle prescale
-      rdg->prescale(!rdg->persist() && !_wrtCounter--);
-      if (rdg->prescale())
-      {
-        _wrtCounter = _prescale;        // Rearm
+      // The workers present the contributions to the trigger, and the
+      // result is finished when they're done
+      _trgQueue(rdg, event, dsts, idx);
+    }
+    else
+    {
+      // Grant this TEB its share of the batches the DRPs will send
+      unsigned credit = rdg->isEvent() ? 0 : _grant();
 
-        _prescaleCount++;
-      }
+      _trgDrain();                      // Results must go out in order
 
-      if (rdg->persist())  _writeCount++;
-      if (rdg->monitor())  _monitor(rdg);
-    }
+      if (rdg->isEvent())
+      {
+        // Present event contributions to "user" code for building a result datagram
+        auto t0{fast_monotonic_clock::now(CLOCK_MONOTONIC)};
+        _trigger->event(event->begin(), event->end(), *rdg); // Consume
+        auto t1{fast_monotonic_clock::now(CLOCK_MONOTONIC)};
+        _trgTime = std::chrono::duration_cast<ns_t>(t1 - t0).count();
+      }
 
-    // Avoid sending Results to contributors that failed to supply Input
-    uint64_t dsts = _receivers(dgram->readoutGroups()) & ~event->remaining();
+      if (!rdg->isEvent())  rdg->credit(credit);
 
-    if (UNLIKELY(_prms.verbose >= VL_EVENT)) // || rdg->monitor()))
-    {
-      const char* svc = TransitionId::name(rdg->service());
-      uint64_t    pid = rdg->pulseId();
-      unsigned    ctl = rdg->control();
-      size_t      sz  = sizeof(rdg) + rdg->xtc.sizeofPayload();
-      unsigned    src = rdg->xtc.src.value();
-      unsigned    env = rdg->env;
-      uint32_t*   pld = reinterpret_cast<uint32_t*>(rdg->xtc.payload());
-      printf("TEB processed %15s result [%8u] @ "
-             "%16p, ctl %02x, pid %014lx, env %08x, sz %6zd, src %2u, dsts %016lx, res [%08x, %08x]\n",
-             svc, idx, rdg, ctl, pid, env, sz, src, dsts, pld[0], pld[1]);
+      _result(rdg, dsts, idx);
     }
-
-    _tryPost(rdg, dsts, idx);
   }
   else if (ImmData::flg(imm) == ImmData::NoResponse_Transition) // "Non-selected" TEB case
   {
+    _trgDrain();                        // Results must go out before the batch is flushed
+
     // Only transitions are sent to "non-selected" TEBs.
     // "Non-selected" TEBs don't respond to any dgrams they receive, but
     // responses prepared for dgrams they received when they were a "selected"
@@ -671,9 +728,9 @@ void Teb::process(EbEvent* event)
   else
   {
     logging::error("%s:\n  Wrong flags %u in immediate data: "
-                   "pid %014lx, rem %016lx, con %016lx, imm %08x, svc %u, env %08x",
+                   "pid %014lx, rem %s, con %s, imm %08x, svc %u, env %08x",
                    __PRETTY_FUNCTION__, ImmData::flg(imm),
-                   pid, event->remaining(), event->contract(), imm, dgram->service(), dgram->env);
+                   pid, event->remaining().hex().c_str(), event->contract().hex().c_str(), imm, dgram->service(), dgram->env);
   }
 
   if (!dgram->isEvent() || (dgram->pulseId() - _latPid > 13000000/14)) {
@@ -686,12 +743,115 @@ void Teb::process(EbEvent* event)
   }
 }
 
+// Finishes the result of an event once the trigger has been evaluated
+void Teb::_result(ResultDgram* rdg, const ctrbs_t& dsts, unsigned idx)
+{
+  if (rdg->isEvent())
+  {
+    // Handle prescale
+    rdg->prescale(!rdg->persist() && !_wrtCounter--);
+    if (rdg->prescale())
+    {
+      _wrtCounter = _prescale;          // Rearm
+
+      _prescaleCount++;
+    }
+
+    if (rdg->persist())  _writeCount++;
+    if (rdg->monitor())  _monitor(rdg);
+  }
+
+  if (UNLIKELY(_prms.verbose >= VL_EVENT)) // || rdg->monitor()))
+  {
+    const char* svc = TransitionId::name(rdg->service());
+    uint64_t    pid = rdg->pulseId();
+    unsigned    ctl = rdg->control();
+    size_t      sz  = sizeof(rdg) + rdg->xtc.sizeofPayload();
+    unsigned    src = rdg->xtc.src.value();
+    unsigned    env = rdg->env;
+    uint32_t*   pld = reinterpret_cast<uint32_t*>(rdg->xtc.payload());
+    printf("TEB processed %15s result [%8u] @ "
+           "%16p, ctl %02x, pid %014lx, env %08x, sz %6zd, src %2u, dsts %s, res [%08x, %08x]\n",
+           svc, idx, rdg, ctl, pid, env, sz, src, dsts.hex().c_str(), pld[0], pld[1]);
+  }
+
+  _tryPost(rdg, dsts, idx);
+}
+
+/*
+** ++
+**
+**   With trg_workers set, the trigger is evaluated on that many threads
+**   rather than on the EB's, so that a slow trigger holds up only the
+**   results, not the building of the events after it.  process() copies the
+**   contribution pointers of each event into a ring, since the EB frees the
+**   event when process() returns; the contributions themselves stay put
+**   until the contributors receive the result.  The events a received batch
+**   completes are handed out as a chunk, round robin over the workers, each
+**   of which calls the trigger's batch event() for it.  Since each worker
+**   finishes its chunks in order, taking them back round robin too puts the
+**   results back in pulse ID order, and everything after the trigger is done
+**   on the EB's thread as before.  Results that don't involve the trigger
+**   wait for those queued ahead of them.
+**
+** --
+*/
+
+void Teb::_trgStart(unsigned workers)
+{
+  _trgCtrbs.resize(workers ? TRG_DEPTH * MAX_DRPS : 0);
+
+  _trgPool.start(workers, _prms.maxEntries,
+                 [this](Trigger::Event* events, unsigned count)
+                 { _trigger->event(events, count); });
+
+  if (workers)  logging::info("Evaluating the trigger on %u worker threads", workers);
+}
+
+void Teb::_trgQueue(ResultDgram*   rdg,
+                    const EbEvent* event,
+                    const ctrbs_t& dsts,
+                    unsigned       idx)
+{
+  unsigned slot = _trgPool.claim([this](Trigger::Event& event, TrgItem& item)
+                                 { _result(event.result, item.dsts, item.idx); });
+
+  const EbDgram**       ctrbs = &_trgCtrbs[slot * MAX_DRPS];
+  const EbDgram**       end   = ctrbs;
+  const EbDgram* const* ctrb  = event->begin();
+  while (ctrb != event->end())  *end++ = *ctrb++;
+
+  _trgPool.event(slot) = {ctrbs, end, rdg};
+  _trgPool.item (slot) = {dsts, idx};
+  _trgPool.commit();
+}
+
+void Teb::_trgGather(bool wait)
+{
+  auto result = [this](Trigger::Event& event, TrgItem& item)
+                { _result(event.result, item.dsts, item.idx); };
+
+  if (_trgPool.gather(wait, result))
+    _trgTime = _trgPool.dt();           // Written only on the EB's thread
+}
+
+// Waits for the trigger workers to finish all they've been given
+void Teb::_trgDrain()
+{
+  if (!_trgPool.running())  return;
+
+  _trgPool.submit();
+  _trgGather(true);
+}
+
 // Called by EB  on timeout when it is empty of events
 // to flush out any in-progress batch
 void Teb::flush()
 {
   //printf("TEB::flush: start %p, end %p\n", _batch.start, _batch.end);
 
+  _trgDrain();
+
   if (_batch.start)
   {
     //printf("TEB::flush:    posting %014lx - %014lx\n",
@@ -703,17 +863,25 @@ void Teb::flush()
   }
 }
 
-void Teb::_tryPost(const EbDgram* dgram, uint64_t dsts, unsigned eventIdx)
+void Teb::_tryPost(const EbDgram* dgram, const ctrbs_t& dsts, unsigned eventIdx)
 {
-  // On wrapping, post the batch at the end of the region, if any
-  if (dgram == _batMan.batchRegion())  flush();
+  // On wrapping, post the batch at the end of the region, if any.  This
+  // doesn't use flush(), which waits for the trigger workers, since this may
+  // be called while gathering their results.
+  if ((dgram == _batMan.batchRegion()) && _batch.start)
+  {
+    _post(_batch);
+
+    _batch.start = nullptr;             // Start a new batch
+  }
 
   // The batch start is the first dgram seen
   if (!_batch.start)  _batch = {dgram, dsts, eventIdx};
 
+  // SlowUpdates are flushed too, so that the credits their results carry
+  // reach the DRPs when no events are flowing to push them out
   TransitionId::Value svc     = dgram->service();
-  bool                flush   = ((svc != TransitionId::L1Accept) &&
-                                 (svc != TransitionId::SlowUpdate));
+  bool                flush   = svc != TransitionId::L1Accept;
   bool                expired = _batMan.expired(       dgram->pulseId(),
                                                 _batch.start->pulseId());
 
@@ -724,9 +892,9 @@ void Teb::_tryPost(const EbDgram* dgram, uint64_t dsts, unsigned eventIdx)
   }
   else
   {
-    // Combining a flushing dgram (i.e., a non-SlowUpdate transition) into an
-    // expired batch can lead to downstream problems since the transition's
-    // pulseId may fall outside the batch duration (epoch)
+    // Combining a flushing dgram (i.e., a transition) into an expired batch
+    // can lead to downstream problems since the transition's pulseId may
+    // fall outside the batch duration (epoch)
     if (expired)                        // Post just the batch
     {
       _post(_batch);                    // The batch end is the previous Dgram
@@ -753,7 +921,7 @@ void Teb::_post(const Batch& batch)
                      reinterpret_cast<const char*>(batch.start)) + maxResultSize;
   unsigned offset = batch.idx * maxResultSize;
   uint64_t data   = ImmData::value(ImmData::NoResponse_Buffer, _prms.id, batch.idx);
-  uint64_t destns = batch.dsts; // & ~_trimmed;
+  const ctrbs_t& destns = batch.dsts; // & ~_trimmed;
   _entries = extent / maxResultSize;
 
   batch.end->setEOL();                  // Terminate the batch
@@ -779,21 +947,18 @@ void Teb::_post(const Batch& batch)
   {
     uint64_t pid = batch.start->pulseId();
     printf("TEB posts          %9lu result  [%8u] @ "
-           "%16p,         pid %014lx, ofs %08x, sz %6zd, dst %016lx\n",
-           _batchCount, batch.idx, batch.start, pid, offset, extent, destns);
+           "%16p,         pid %014lx, ofs %08x, sz %6zd, dst %s\n",
+           _batchCount, batch.idx, batch.start, pid, offset, extent, destns.hex().c_str());
   }
 
   // uint64_t pid = batch.start->pulseId();
   // *_tb++ = {_batchCount, batch.idx, batch.start, pid, offset, extent, destns};
   // if (_tb == _tbEnd)  _tb = _tbStart;
 
-  while (destns)
+  destns.forEach([&](unsigned dst)
   {
-    unsigned     dst  = __builtin_ffsl(destns) - 1;
     EbLfCltLink* link = _l3Links[dst];
 
-    destns &= ~(1ull << dst);
-
     if (UNLIKELY(_prms.verbose >= VL_BATCH))
     {
       void* rmtAdx = (void*)link->rmtAdx(offset);
@@ -820,12 +985,36 @@ void Teb::_post(const Batch& batch)
       //printf("%s:  link->post() to %u returned %d, trimmed = %016lx\n",
       //       __PRETTY_FUNCTION__, dst, rc, _trimmed);
     }
-  }
+  });
 
   ++_batchCount;
 }
 
-uint64_t Teb::_receivers(unsigned groups) const
+// A TEB keeping up with the DRPs is given full credit.  One falling behind
+// is given less, in proportion to the worse of two measures of its backlog,
+// so that it is sent fewer batches:
+// - the events it holds, still being built or waiting on the trigger
+//   workers, beyond _creditOcc, and
+// - how long it has gone without catching up with its input, beyond
+//   _creditLat ms, which sees a slow trigger run on the EB's thread, whose
+//   backlog waits in the completion queue rather than as events.
+// Both are measured here rather than from the transition's timestamp, which
+// a DRP's or the network's delays would age the same on every TEB, and clock
+// skew between nodes would distort.  This is called before the trigger
+// workers are drained, so that what they hold is counted.
+unsigned Teb::_grant()
+{
+  uint64_t occ = eventAllocCnt() - eventFreeCnt() + _trgPool.occupancy();
+  uint64_t lat = std::max(behind(), int64_t(0));
+
+  uint64_t occCredit = MAX_CREDITS * uint64_t(_creditOcc) / std::max(occ, uint64_t(_creditOcc));
+  uint64_t latCredit = MAX_CREDITS * uint64_t(_creditLat) / std::max(lat, uint64_t(_creditLat));
+  _credit = std::max(uint64_t(1), std::min(occCredit, latCredit));
+
+  return _credit;
+}
+
+ctrbs_t Teb::_receivers(unsigned groups) const
 {
   // This method is called when the event is processed, which happens when the
   // event builder has built the event.  The supplied contribution contains
@@ -837,7 +1026,7 @@ uint64_t Teb::_receivers(unsigned groups) const
   // time.  The set of receivers may be larger than the set of coontributors
   // to a given event.
 
-  uint64_t receivers = 0;
+  ctrbs_t receivers;
 
   while (groups)
   {
@@ -990,7 +1179,7 @@ void TebApp::_buildContract(const Document& top)
   const json& body = _connectMsg["body"];
 
   bool buildAll = top.HasMember("buildAll") && top["buildAll"].GetInt()==1;
-  _prms.contractors.fill(0);
+  _prms.contractors.fill(ctrbs_t());
 
   std::string buildDets("---");
   if (top.HasMember("buildDets"))
@@ -1006,7 +1195,7 @@ void TebApp::_buildContract(const Document& top)
     if (buildAll || buildDets.find(detName))
     {
       unsigned group(it.value()["det_info"]["readout"]);
-      _prms.contractors[group] |= 1ull << drpId;
+      _prms.contractors[group].set(drpId);
     }
   }
 }
@@ -1153,16 +1342,16 @@ int TebApp::_parseConnectionParams(const json& body)
     rc = 1;
   }
 
-  _prms.contributors = 0;
+  _prms.contributors = ctrbs_t();
   _prms.addrs.clear();
   _prms.ports.clear();
 
   _prms.rogs = 0;
-  _prms.contractors.fill(0);
-  _prms.receivers.fill(0);
+  _prms.contractors.fill(ctrbs_t());
+  _prms.receivers.fill(ctrbs_t());
 
   _prms.maxBuffers   = 0;               // Save the largest value
-  _prms.indexSources = 0ull;            // DRP(s) with the largest DMA index range
+  _prms.indexSources = ctrbs_t();       // DRP(s) with the largest DMA index range
   _prms.numBuffers.resize(MAX_DRPS, 0); // Number of buffers on each DRP
   _prms.drps.resize(MAX_DRPS);          // DRP aliases
 
@@ -1174,8 +1363,9 @@ int TebApp::_parseConnectionParams(const json& body)
     {
       logging::error("DRP ID %d is out of range 0 - %u", drpId, MAX_DRPS - 1);
       rc = 1;
+      continue;
     }
-    _prms.contributors |= 1ull << drpId;
+    _prms.contributors.set(drpId);
     _prms.drps[drpId]   = it.value()["proc_info"]["alias"];
 
     _prms.addrs.push_back(it.value()["connect_info"]["nic_ip"]);
@@ -1188,8 +1378,8 @@ int TebApp::_parseConnectionParams(const json& body)
       rc = 1;
     }
     _prms.rogs             |= 1 << rog;
-    _prms.contractors[rog] |= 1ull << drpId; // Possibly overridden during Configure
-    _prms.receivers[rog]   |= 1ull << drpId; // All contributors receive results
+    _prms.contractors[rog].set(drpId);  // Possibly overridden during Configure
+    _prms.receivers[rog]  .set(drpId);  // All contributors receive results
 
     // The Common RoG governs the index into the Results region.
     // Its range must be >= that of any secondary RoG.
@@ -1200,14 +1390,14 @@ int TebApp::_parseConnectionParams(const json& body)
       if (rog == _prms.partition)
       {
         _prms.maxBuffers   = numBuffers;
-        _prms.indexSources = 1ull << drpId;
+        _prms.indexSources = ctrbs_t().set(drpId);
       }
       else if (numBuffers > maxBuffers)
         maxBuffers = numBuffers;
     }
     else if (numBuffers == _prms.maxBuffers)
       if (rog == _prms.partition) // Disallow non-common RoG DRPs in indexSources
-        _prms.indexSources |= 1ull << drpId;
+        _prms.indexSources.set(drpId);
   }
   _prms.drps.shrink_to_fit();
 
@@ -1218,6 +1408,14 @@ int TebApp::_parseConnectionParams(const json& body)
     rc = 1;
   }
 
+  // The buffer index shares the immediate data word with the DRP ID
+  if (_prms.maxBuffers > ImmData::MaxIdx + 1u)
+  {
+    logging::error("maxBuffers (%u) exceeds the %u buffer indices available with %u DRPs",
+                   _prms.maxBuffers, ImmData::MaxIdx + 1u, MAX_DRPS);
+    rc = 1;
+  }
+
   // Disallow non-common RoG DRPs from having more buffers than the common one
   // because the buffer index based on the common RoG DRPs won't be able to
   // reach the higher buffer numbers.  Can't use an index based on the largest
@@ -1266,14 +1464,14 @@ int TebApp::_parseConnectionParams(const json& body)
   return rc;
 }
 
-static void _printGroups(unsigned groups, const EbAppBase::u64arr_t& array)
+static void _printGroups(unsigned groups, const EbAppBase::ctrbarr_t& array)
 {
   while (groups)
   {
     unsigned group = __builtin_ffs(groups) - 1;
     groups &= ~(1 << group);
 
-    printf("%u: 0x%016lx  ", group, array[group]);
+    printf("%u: 0x%s  ", group, array[group].hex().c_str());
   }
   printf("\n");
 }
@@ -1286,8 +1484,8 @@ void TebApp::_printParams(const EbParams& prms, Trigger* trigger) const
   printf("  Instrument:                   %s\n",                 prms.instrument.c_str());
   printf("  Partition:                    %u\n",                 prms.partition);
   printf("  Alias:                        %s\n",                 prms.alias.c_str());
-  printf("  Bit list of contributors:     0x%016lx, cnt: %zu\n", prms.contributors,
-                                                                 std::bitset<64>(prms.contributors).count());
+  printf("  Bit list of contributors:     0x%s, cnt: %u\n",    prms.contributors.hex().c_str(),
+                                                                 prms.contributors.count());
   printf("  Readout group contractors:    ");                    _printGroups(prms.rogs, prms.contractors);
   printf("  Readout group receivers:      ");                    _printGroups(prms.rogs, prms.receivers);
   printf("  Number of MEB requestors:     %u\n",                 prms.numMrqs);
@@ -1422,8 +1620,12 @@ int main(int argc, char **argv)
     if (kwargs.first == "ep_fabric")    continue;
     if (kwargs.first == "ep_domain")    continue;
     if (kwargs.first == "ep_provider")  continue;
+    if (kwargs.first == "eb_shards")    continue;
     if (kwargs.first == "script_path")  continue;
     if (kwargs.first == "mon_throttle") continue;
+    if (kwargs.first == "trg_workers")  continue;
+    if (kwargs.first == "credit_occ")   continue;
+    if (kwargs.first == "credit_lat")   continue;
     logging::critical("Unrecognized kwarg '%s=%s'",
                       kwargs.first.c_str(), kwargs.second.c_str());
     return 1;
@@ -0,0 +1,251 @@
+// This program times the contract bookkeeping the EventBuilder does for each
+// event, as done with the uint64_t it used to be and with the Bitmap ctrbs_t
+// now is, at the widths EB_MAX_DRPS can be built for.  Each event's contract
+// is made from those of its readout groups, its contributions are taken off
+// the remaining list, in a random order, with a check that each was expected
+// and a completion check after each, and those that were dropped are fixed
+// up by walking what remains.  Every width must give the same checksum.
+//
+// The events are few enough to stay in cache, so that the bookkeeping rather
+// than memory is timed, and are run through each width in turn, repeatedly,
+// keeping the best time of each, so that the widths see the same conditions.
+
+#include "Bitmap.hh"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <vector>
+
+using namespace Pds::Eb;
+
+static const unsigned NUM_RO_GROUPS = 8;
+
+static const unsigned default_ctrbs  = 64;
+static const unsigned default_events = 10000;
+static const double   default_drop   = 0.001;
+static const unsigned default_reps   = 500;
+
+namespace
+{
+  struct Event
+  {
+    uint16_t groups;
+    unsigned first;                     // Of its contributions' IDs in srcs
+    unsigned count;
+  };
+
+  struct Input
+  {
+    std::vector<uint64_t> groups;       // Contract of each readout group
+    std::vector<Event>    events;
+    std::vector<uint8_t>  srcs;         // Contributions, in arrival order
+  };
+}
+
+
+// The uint64_t version, as EbAppBase, EbEvent and EventBuilder had it
+static uint64_t _run(const Input& in, const uint64_t* groupContract)
+{
+  uint64_t sum = 0;
+  for (const auto& event : in.events)
+  {
+    uint64_t contract = 0;
+    uint16_t groups   = event.groups;
+    while (groups)
+    {
+      unsigned group = __builtin_ffs(groups) - 1;
+      groups &= ~(1 << group);
+
+      contract |= groupContract[group];
+    }
+
+    uint64_t remaining = contract;
+    for (unsigned i = 0; i < event.count; ++i)
+    {
+      unsigned src = in.srcs[event.first + i];
+      uint64_t rem = remaining;
+      remaining = rem & ~(1ull << src);
+      if (remaining == rem)  abort();
+      if (!remaining)  ++sum;           // Complete
+    }
+
+    while (remaining)
+    {
+      unsigned srcId = __builtin_ffsl(remaining) - 1;
+      sum += srcId;
+      remaining &= ~(1ull << srcId);
+    }
+  }
+  return sum;
+}
+
+// The ctrbs_t version, as they have it now
+template <unsigned Bits>
+static uint64_t _run(const Input& in, const Bitmap<Bits>* groupContract)
+{
+  uint64_t sum = 0;
+  for (const auto& event : in.events)
+  {
+    Bitmap<Bits> contract;
+    uint16_t     groups = event.groups;
+    while (groups)
+    {
+      unsigned group = __builtin_ffs(groups) - 1;
+      groups &= ~(1 << group);
+
+      contract |= groupContract[group];
+    }
+
+    Bitmap<Bits> remaining = contract;
+    for (unsigned i = 0; i < event.count; ++i)
+    {
+      unsigned src = in.srcs[event.first + i];
+      if (!remaining.test(src))  abort();
+      remaining.reset(src);
+      if (remaining.none())  ++sum;     // Complete
+    }
+
+    remaining.forEach([&](unsigned srcId) { sum += srcId; });
+  }
+  return sum;
+}
+
+namespace
+{
+  struct Timing
+  {
+    const char* name;
+    double      best;
+    uint64_t    sum;
+  };
+}
+
+template <typename T>
+static void _time(Timing& timing, const Input& in, const T* groupContract)
+{
+  auto t0 = std::chrono::steady_clock::now();
+  timing.sum = _run(in, groupContract);
+  auto t1 = std::chrono::steady_clock::now();
+  double ns = std::chrono::duration<double, std::nano>(t1 - t0).count();
+  if (ns < timing.best)  timing.best = ns;
+}
+
+template <unsigned Bits>
+static void _widen(Bitmap<Bits>* groupContract, const Input& in)
+{
+  for (unsigned group = 0; group < NUM_RO_GROUPS; ++group)
+    for (unsigned src = 0; src < 64; ++src)
+      if (in.groups[group] & (1ull << src))  groupContract[group].set(src);
+}
+
+
+void usage(char* progname)
+{
+  printf("\n<Parameters> or [Options]:\n"
+         "  %-22s %s (default: %u)\n"
+         "  %-22s %s (default: %u)\n"
+         "  %-22s %s (default: %g)\n"
+         "  %-22s %s (default: %u)\n",
+         "-c <contributors>",      "Number of contributors (<= 64)",       default_ctrbs,
+         "-n <events>",            "Number of events",                     default_events,
+         "-d <probability>",       "Chance of dropping each contribution", default_drop,
+         "-r <repetitions>",       "Number of timings to take the best of", default_reps);
+  printf("\nUsage: %s [-h] [-c <contributors>] [-n <events>] [-d <probability>] [-r <repetitions>]\n",
+         progname);
+}
+
+
+int main(int argc, char **argv)
+{
+  unsigned nCtrbs  = default_ctrbs;
+  unsigned nEvents = default_events;
+  double   pDrop   = default_drop;
+  unsigned nReps   = default_reps;
+  int      op;
+
+  while ((op = getopt(argc, argv, "h?c:n:d:r:")) != -1)
+  {
+    switch (op)
+    {
+      case 'c':  nCtrbs  = atoi(optarg);  break;
+      case 'n':  nEvents = atoi(optarg);  break;
+      case 'd':  pDrop   = atof(optarg);  break;
+      case 'r':  nReps   = atoi(optarg);  break;
+      case '?':
+      case 'h':
+      default:
+        usage(argv[0]);
+        return 1;
+    }
+  }
+  if (!nCtrbs || (nCtrbs > 64))
+  {
+    fprintf(stderr, "Number of contributors must be 1 - 64\n");
+    return 1;
+  }
+
+  std::mt19937                           rng(1);
+  std::uniform_real_distribution<double> uniform(0.0, 1.0);
+
+  // Readout group 0 is common to all contributors; the rest share them out
+  Input in;
+  in.groups.resize(NUM_RO_GROUPS, 0);
+  for (unsigned src = 0; src < nCtrbs; ++src)
+  {
+    in.groups[0]                             |= 1ull << src;
+    in.groups[1 + src % (NUM_RO_GROUPS - 1)] |= 1ull << src;
+  }
+
+  // Mostly common readout group events, with some for the others thrown in
+  std::vector<uint8_t> srcs;
+  for (unsigned i = 0; i < nEvents; ++i)
+  {
+    uint16_t groups = uniform(rng) < 0.9 ? 1 : 1 << unsigned(uniform(rng) * NUM_RO_GROUPS) % NUM_RO_GROUPS;
+    uint64_t contract = 0;
+    for (unsigned group = 0; group < NUM_RO_GROUPS; ++group)
+      if (groups & (1 << group))  contract |= in.groups[group];
+
+    srcs.clear();
+    for (unsigned src = 0; src < nCtrbs; ++src)
+      if ((contract & (1ull << src)) && !(uniform(rng) < pDrop))  srcs.push_back(src);
+    std::shuffle(srcs.begin(), srcs.end(), rng);
+
+    in.events.push_back({groups, unsigned(in.srcs.size()), unsigned(srcs.size())});
+    in.srcs.insert(in.srcs.end(), srcs.begin(), srcs.end());
+  }
+  printf("%u contributors, %zu events, %zu contributions\n",
+         nCtrbs, in.events.size(), in.srcs.size());
+
+  Bitmap< 64> contract64 [NUM_RO_GROUPS];  _widen(contract64,  in);
+  Bitmap<128> contract128[NUM_RO_GROUPS];  _widen(contract128, in);
+  Bitmap<256> contract256[NUM_RO_GROUPS];  _widen(contract256, in);
+  Bitmap<512> contract512[NUM_RO_GROUPS];  _widen(contract512, in);
+
+  Timing timings[] = { { "uint64_t",    1e30, 0 },
+                       { "Bitmap<64>",  1e30, 0 },
+                       { "Bitmap<128>", 1e30, 0 },
+                       { "Bitmap<256>", 1e30, 0 },
+                       { "Bitmap<512>", 1e30, 0 } };
+  for (unsigned rep = 0; rep < nReps; ++rep)
+  {
+    _time(timings[0], in, in.groups.data());
+    _time(timings[1], in, contract64);
+    _time(timings[2], in, contract128);
+    _time(timings[3], in, contract256);
+    _time(timings[4], in, contract512);
+  }
+
+  int rc = 0;
+  for (const auto& timing : timings)
+  {
+    printf("%-12s %8.2f ns/event  %8.3f ns/contribution  checksum %lu\n", timing.name,
+           timing.best / in.events.size(), timing.best / in.srcs.size(), timing.sum);
+    if (timing.sum != timings[0].sum)  rc = 1;
+  }
+
+  return rc;
+}
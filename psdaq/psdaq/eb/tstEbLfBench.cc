@@ -0,0 +1,609 @@
+// This program benchmarks the EbLf transport the way the event builders use
+// it.  Each of <links> contributor threads posts batch sized buffers with
+// EbLfCltLink::post(), as the DRPs do, into its own region on a server, which
+// pends for them with EbLfServer::pend(), as the TEB does, and returns each
+// buffer's index, as the TEB does for transition buffers.  A contributor
+// keeps up to <window> buffers in flight and times each from being posted to
+// its index coming back.  The server checks each buffer holds what was
+// written to it.
+//
+// Every combination of the given buffer sizes, link counts, windows and modes
+// is run in turn, with both sides in this process.  In 'poll' mode the server
+// and contributors spin on their completion queues; in 'wait' mode they block
+// in comp_wait().  Latency percentiles, message rate and bandwidth are printed
+// and, with -o, appended to a file as one JSON object per line, so that runs
+// can be compared over time.  The exit status is non-zero if any run fails or
+// any buffer arrives corrupted.
+//
+// The tcp provider is used unless another is asked for, so that this runs
+// on any Linux box, e.g.:
+//   tstEbLfBench -s 256,16384,262144 -l 1,4,16 -o eblf.json
+//   tstEbLfBench -k ep_provider=sockets -m wait
+
+#include "EbLfServer.hh"
+#include "EbLfClient.hh"
+
+#include "utilities.hh"
+
+#include "psdaq/service/kwargs.hh"
+#include "psdaq/service/fast_monotonic_clock.hh"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <cerrno>
+#include <climits>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+using namespace Pds;
+using namespace Pds::Fabrics;
+using namespace Pds::Eb;
+
+using kwmap_t = std::map<std::string,std::string>;
+using ns_t    = std::chrono::nanoseconds;
+
+static const unsigned port_base       = 55000; // Each run uses the next port up
+static const char*    default_sizes   = "256,4096,65536";
+static const char*    default_links   = "1,4";
+static const char*    default_windows = "1,16";
+static const char*    default_modes   = "poll,wait";
+static const unsigned default_iters   = 10000;
+static const unsigned default_buffers = 64;
+static const char*    default_addr    = "127.0.0.1";
+static const char*    default_prov    = "tcp";
+static const int      default_core    = -1;
+static const int      ms_tmo          = 5000;  // Time out when nothing arrives
+
+
+namespace
+{
+  struct Config
+  {
+    size_t   size;                      // Bytes per buffer
+    unsigned links;                     // Number of contributors
+    unsigned window;                    // Buffers in flight per contributor
+    bool     wait;                      // comp_wait() rather than poll
+  };
+
+  struct Result
+  {
+    uint64_t msgs;
+    uint64_t errors;                    // Buffers that arrived corrupted
+    double   secs;
+    double   rate;                      // Buffers per second
+    double   bw;                        // MB per second
+    double   lat[7];                    // min, 50%, 90%, 99%, 99.9%, max, mean in us
+    int      rc;
+  };
+
+  // State shared between the server and the contributors of one run
+  struct Run
+  {
+    Run(unsigned links) : ready(0), go(false), failed(false), lat(links) {}
+
+    std::atomic<unsigned>              ready;  // Contributors connected
+    std::atomic<bool>                  go;     // Start posting
+    std::atomic<bool>                  failed; // Give up
+    std::vector<std::vector<int64_t> > lat;    // Per contributor, in ns
+  };
+}
+
+
+static std::vector<unsigned> _parseList(const char* list)
+{
+  std::vector<unsigned> values;
+  std::string           str(list);
+  size_t                pos = 0;
+  while (pos < str.size())
+  {
+    size_t end = str.find(',', pos);
+    if (end == std::string::npos)  end = str.size();
+    if (end > pos)  values.push_back(std::stoul(str.substr(pos, end - pos), nullptr, 0));
+    pos = end + 1;
+  }
+  return values;
+}
+
+static size_t _stride(size_t size)      // Keep buffers cache line aligned
+{
+  return (size + 63) & ~size_t(63);
+}
+
+static int contributor(const std::string& addr,
+                       const std::string& port,
+                       unsigned           id,
+                       const Config&      cfg,
+                       unsigned           iters,
+                       unsigned           nBuffers,
+                       int                core,
+                       const kwmap_t&     kwargs,
+                       unsigned           verbose,
+                       Run&               run)
+{
+  if (core != -1)  pinThread(pthread_self(), core);
+
+  size_t stride  = _stride(cfg.size);
+  size_t regSize = roundUpSize(nBuffers * stride);
+  void*  region  = allocRegion(regSize);
+  if (!region)
+  {
+    fprintf(stderr, "%s:\n  No memory found for a region of size %zd\n",
+            __PRETTY_FUNCTION__, regSize);
+    run.failed = true;
+    return -FI_ENOMEM;
+  }
+  memset(region, 0xa5, regSize);
+
+  EbLfClient                clt(verbose, kwargs);
+  std::vector<EbLfCltLink*> links(1);   // Indexed by server ID, which is 0
+  std::vector<std::string>  addrs{addr};
+  std::vector<std::string>  ports{port};
+  int rc = linksConnect(clt, links, addrs, ports, id, "Srv");
+  if (!rc)  rc = linksConfigure(links, region, regSize, "Srv");
+  if (rc)
+  {
+    fprintf(stderr, "%s:\n  Contributor %u failed to connect: rc %d\n",
+            __PRETTY_FUNCTION__, id, rc);
+    run.failed = true;
+    clt.disconnect(links[0]);
+    free(region);
+    return rc;
+  }
+  auto link = links[0];
+
+  ++run.ready;
+  while (!run.go && !run.failed)  std::this_thread::yield();
+
+  std::vector<Pds::fast_monotonic_clock::time_point> tPost(nBuffers);
+  auto&    lat    = run.lat[id];
+  uint64_t posted = 0;
+  uint64_t acked  = 0;
+  auto     tLast  = Pds::fast_monotonic_clock::now();
+  lat.reserve(iters);
+  while ((acked < iters) && !run.failed)
+  {
+    while ((posted < iters) && (posted - acked < cfg.window))
+    {
+      unsigned idx    = posted % nBuffers;
+      size_t   offset = idx * stride;
+      auto     buf    = static_cast<char*>(region) + offset;
+      uint32_t data   = ImmData::value(ImmData::Response_Buffer, id, idx);
+      *reinterpret_cast<uint64_t*>(buf) = posted; // For the server to check
+
+      tPost[idx] = Pds::fast_monotonic_clock::now();
+      if ( (rc = link->post(buf, cfg.size, offset, data)) )
+      {
+        fprintf(stderr, "%s:\n  Contributor %u failed to post buffer %lu: rc %d\n",
+                __PRETTY_FUNCTION__, id, posted, rc);
+        run.failed = true;
+        break;
+      }
+      ++posted;
+    }
+    if (rc)  break;
+
+    uint64_t imm;
+    rc = cfg.wait ? link->poll(&imm, ms_tmo) : link->poll(&imm);
+    auto now = Pds::fast_monotonic_clock::now();
+    if (rc == -FI_EAGAIN)
+    {
+      rc = 0;
+      if (now - tLast < std::chrono::milliseconds(ms_tmo))  continue;
+      fprintf(stderr, "%s:\n  Contributor %u timed out with %lu of %lu buffers returned\n",
+              __PRETTY_FUNCTION__, id, acked, posted);
+      rc = -FI_ETIMEDOUT;
+      run.failed = true;
+      break;
+    }
+    if (rc < 0)
+    {
+      fprintf(stderr, "%s:\n  Contributor %u failed polling for a buffer: rc %d\n",
+              __PRETTY_FUNCTION__, id, rc);
+      run.failed = true;
+      break;
+    }
+    tLast = now;
+
+    unsigned idx = ImmData::idx(imm);
+    lat.push_back(std::chrono::duration_cast<ns_t>(now - tPost[idx]).count());
+    ++acked;
+  }
+
+  clt.disconnect(link);
+  free(region);
+
+  return rc;
+}
+
+static int server(const std::string& addr,
+                  std::string&       port,
+                  const Config&      cfg,
+                  unsigned           iters,
+                  unsigned           nBuffers,
+                  const kwmap_t&     kwargs,
+                  unsigned           verbose,
+                  Run&               run,
+                  Result&            result)
+{
+  EbLfServer                srv(verbose, kwargs);
+  std::vector<EbLfSvrLink*> links(cfg.links);
+  std::vector<void*>        regions(cfg.links, nullptr);
+  const unsigned            id = 0;
+
+  int rc = linksStart(srv, addr, port, cfg.links, "Ctrb");
+  if (!rc)  rc = linksConnect(srv, links, id, "Ctrb");
+  for (unsigned i = 0; !rc && (i < links.size()); ++i)
+  {
+    size_t regSize;
+    if ( (rc = links[i]->prepare(&regSize, "Ctrb")) )  break;
+    regions[i] = allocRegion(regSize);
+    if (!regions[i])
+    {
+      fprintf(stderr, "%s:\n  No memory found for region %u of size %zd\n",
+              __PRETTY_FUNCTION__, i, regSize);
+      rc = -FI_ENOMEM;
+      break;
+    }
+    rc = links[i]->setupMr(regions[i], regSize, "Ctrb");
+  }
+  if (rc)
+  {
+    fprintf(stderr, "%s:\n  Server failed to connect: rc %d\n",
+            __PRETTY_FUNCTION__, rc);
+    run.failed = true;
+  }
+
+  while ((run.ready < cfg.links) && !run.failed)  std::this_thread::yield();
+
+  if (cfg.wait)  srv.wait(ms_tmo);
+
+  size_t                stride = _stride(cfg.size);
+  std::vector<uint64_t> expect(cfg.links, 0);
+  uint64_t              total  = uint64_t(iters) * cfg.links;
+  uint64_t              count  = 0;
+
+  auto t0 = std::chrono::steady_clock::now();
+  run.go  = true;
+
+  while ((count < total) && !run.failed)
+  {
+    uint64_t data;
+    rc = srv.pend(&data, ms_tmo);
+    if (rc == -FI_EAGAIN)               // Nothing arrived for ms_tmo
+    {
+      fprintf(stderr, "%s:\n  Server timed out with %lu of %lu buffers received\n",
+              __PRETTY_FUNCTION__, count, total);
+      rc = -FI_ETIMEDOUT;
+      run.failed = true;
+      break;
+    }
+    if (rc < 0)
+    {
+      fprintf(stderr, "%s:\n  Server failed pending for a buffer: rc %d\n",
+              __PRETTY_FUNCTION__, rc);
+      run.failed = true;
+      break;
+    }
+    rc = 0;
+
+    unsigned src = ImmData::src(data);
+    unsigned idx = ImmData::idx(data);
+    if ((src >= links.size()) || (idx >= nBuffers))
+    {
+      fprintf(stderr, "%s:\n  Bad immediate data %08lx\n", __PRETTY_FUNCTION__, data);
+      ++result.errors;
+      continue;
+    }
+
+    auto buf = static_cast<char*>(regions[src]) + idx * stride;
+    if (*reinterpret_cast<uint64_t*>(buf) != expect[src])
+    {
+      if (verbose)
+        fprintf(stderr, "Buffer %u from contributor %u holds %lu rather than %lu\n",
+                idx, src, *reinterpret_cast<uint64_t*>(buf), expect[src]);
+      ++result.errors;
+    }
+    ++expect[src];
+    ++count;
+
+    uint32_t ack = ImmData::value(ImmData::NoResponse_Buffer, id, idx);
+    if ( (rc = links[src]->post(ack)) )
+    {
+      fprintf(stderr, "%s:\n  Server failed to return buffer %u to contributor %u: rc %d\n",
+              __PRETTY_FUNCTION__, idx, src, rc);
+      run.failed = true;
+      break;
+    }
+  }
+  auto t1 = std::chrono::steady_clock::now();
+
+  result.msgs = count;
+  result.secs = std::chrono::duration<double>(t1 - t0).count();
+
+  for (unsigned i = 0; i < links.size(); ++i)
+  {
+    if (links[i])  srv.disconnect(links[i]);
+    free(regions[i]);
+  }
+
+  return rc;
+}
+
+static int bench(const std::string& addr,
+                 unsigned           port,
+                 const Config&      cfg,
+                 unsigned           iters,
+                 unsigned           nBuffers,
+                 int                core,
+                 const kwmap_t&     kwargs,
+                 unsigned           verbose,
+                 Result&            result)
+{
+  Run         run(cfg.links);
+  std::string srvPort(std::to_string(port));
+  result = {};
+
+  if (core != -1)  pinThread(pthread_self(), core);
+
+  std::vector<std::thread> threads;
+  std::vector<int>         rcs(cfg.links, 0);
+  for (unsigned id = 0; id < cfg.links; ++id)
+  {
+    int ctrbCore = core != -1 ? core + 1 + id : -1;
+    threads.emplace_back([&, id, ctrbCore]
+                         { rcs[id] = contributor(addr, srvPort, id, cfg, iters, nBuffers,
+                                                 ctrbCore, kwargs, verbose, run); });
+  }
+
+  int rc = server(addr, srvPort, cfg, iters, nBuffers, kwargs, verbose, run, result);
+
+  for (auto& thread : threads)  thread.join();
+  for (auto ctrbRc : rcs)  if (!rc)  rc = ctrbRc;
+  if (!rc && run.failed)  rc = -FI_EOTHER;
+  result.rc = rc;
+
+  std::vector<int64_t> lat;
+  for (const auto& ctrbLat : run.lat)
+    lat.insert(lat.end(), ctrbLat.begin(), ctrbLat.end());
+  if (!lat.empty())
+  {
+    std::sort(lat.begin(), lat.end());
+    auto pct = [&](double p) { return lat[std::min(lat.size() - 1, size_t(p * lat.size()))] / 1000.; };
+    double sum = 0;
+    for (auto l : lat)  sum += l;
+    result.lat[0] = lat.front() / 1000.;
+    result.lat[1] = pct(0.50);
+    result.lat[2] = pct(0.90);
+    result.lat[3] = pct(0.99);
+    result.lat[4] = pct(0.999);
+    result.lat[5] = lat.back() / 1000.;
+    result.lat[6] = sum / lat.size() / 1000.;
+  }
+  if (result.secs > 0)
+  {
+    result.rate = result.msgs / result.secs;
+    result.bw   = result.msgs * cfg.size / result.secs / 1e6;
+  }
+
+  return rc;
+}
+
+static void _record(FILE*          file,
+                    const char*    stamp,
+                    const char*    host,
+                    const char*    provider,
+                    const Config&  cfg,
+                    unsigned       iters,
+                    unsigned       nBuffers,
+                    const Result&  result)
+{
+  fprintf(file, "{\"bench\": \"tstEbLfBench\", \"time\": \"%s\", \"host\": \"%s\", "
+          "\"provider\": \"%s\", \"size\": %zu, \"links\": %u, \"window\": %u, "
+          "\"mode\": \"%s\", \"iters\": %u, \"buffers\": %u, \"msgs\": %lu, "
+          "\"secs\": %.6f, \"rate_hz\": %.1f, \"bw_MBps\": %.3f, "
+          "\"lat_us\": {\"min\": %.3f, \"p50\": %.3f, \"p90\": %.3f, \"p99\": %.3f, "
+          "\"p999\": %.3f, \"max\": %.3f, \"mean\": %.3f}, \"errors\": %lu, \"rc\": %d}\n",
+          stamp, host, provider, cfg.size, cfg.links, cfg.window,
+          cfg.wait ? "wait" : "poll", iters, nBuffers, result.msgs,
+          result.secs, result.rate, result.bw,
+          result.lat[0], result.lat[1], result.lat[2], result.lat[3],
+          result.lat[4], result.lat[5], result.lat[6], result.errors, result.rc);
+  fflush(file);
+}
+
+
+static void usage(char *name, char *desc)
+{
+  if (desc)
+    fprintf(stderr, "%s\n\n", desc);
+
+  fprintf(stderr, "Usage:\n");
+  fprintf(stderr, "  %s [OPTIONS]\n", name);
+
+  fprintf(stderr, "\nWhere:\n"
+                  "  <list>, below, is a comma separated list of values, each of\n"
+                  "  which is run with every value of the other lists\n");
+
+  fprintf(stderr, "\nOptions:\n");
+
+  fprintf(stderr, " %-20s %s (default: %s)\n",      "-A <interface_addr>",
+          "IP address of the interface to use",     default_addr);
+  fprintf(stderr, " %-20s %s (default: %d)\n",      "-P <port>",
+          "Base port number",                       port_base);
+
+  fprintf(stderr, " %-20s %s (default: %s)\n",      "-s <list>",
+          "Buffer (batch) sizes in bytes",          default_sizes);
+  fprintf(stderr, " %-20s %s (default: %s)\n",      "-l <list>",
+          "Numbers of links (contributors)",        default_links);
+  fprintf(stderr, " %-20s %s (default: %s)\n",      "-w <list>",
+          "Buffers in flight per link",             default_windows);
+  fprintf(stderr, " %-20s %s (default: %s)\n",      "-m <list>",
+          "Completion modes: poll, wait",           default_modes);
+  fprintf(stderr, " %-20s %s (default: %d)\n",      "-n <iters>",
+          "Buffers posted per link per run",        default_iters);
+  fprintf(stderr, " %-20s %s (default: %d)\n",      "-b <buffers>",
+          "Buffers in each link's region",          default_buffers);
+  fprintf(stderr, " %-20s %s (default: %d)\n",      "-c <core>",
+          "CPU core for the server, links follow",  default_core);
+  fprintf(stderr, " %-20s %s\n",                    "-o <file>",
+          "Append results to file as JSON lines");
+  fprintf(stderr, " %-20s %s (default: ep_provider=%s)\n", "-k <key=value>",
+          "Keyword arguments",                      default_prov);
+  fprintf(stderr, " %-20s %s\n",                    "-v",
+          "Verbose flag");
+
+  fprintf(stderr, " %-20s %s\n", "-h", "display this help output");
+}
+
+int main(int argc, char **argv)
+{
+  int         op, rc   = 0;
+  std::string ifAddr   = default_addr;
+  unsigned    portBase = port_base;
+  const char* sizes    = default_sizes;
+  const char* nLinks   = default_links;
+  const char* windows  = default_windows;
+  std::string modes    = default_modes;
+  unsigned    iters    = default_iters;
+  unsigned    nBuffers = default_buffers;
+  int         core     = default_core;
+  const char* outFile  = nullptr;
+  unsigned    verbose  = 0;
+  std::string kwargs_str;
+  kwmap_t     kwargs;
+
+  while ((op = getopt(argc, argv, "h?A:P:s:l:w:m:n:b:c:o:k:v")) != -1)
+  {
+    switch (op)
+    {
+      case 'A':  ifAddr     = optarg;                      break;
+      case 'P':  portBase   = atoi(optarg);                break;
+      case 's':  sizes      = optarg;                      break;
+      case 'l':  nLinks     = optarg;                      break;
+      case 'w':  windows    = optarg;                      break;
+      case 'm':  modes      = optarg;                      break;
+      case 'n':  iters      = atoi(optarg);                break;
+      case 'b':  nBuffers   = atoi(optarg);                break;
+      case 'c':  core       = atoi(optarg);                break;
+      case 'o':  outFile    = optarg;                      break;
+      case 'k':  kwargs_str = kwargs_str.empty()
+                            ? optarg
+                            : kwargs_str + ", " + optarg;  break;
+      case 'v':  ++verbose;                                break;
+      case '?':
+      case 'h':
+      default:
+        usage(argv[0], (char*)"Benchmark of the EbLf transport's batch posting path");
+        return 1;
+    }
+  }
+
+  get_kwargs(kwargs_str, kwargs);
+  for (const auto& kwargs : kwargs)
+  {
+    if (kwargs.first == "ep_fabric")    continue;
+    if (kwargs.first == "ep_domain")    continue;
+    if (kwargs.first == "ep_provider")  continue;
+    fprintf(stderr, "Unrecognized kwarg '%s=%s'\n",
+            kwargs.first.c_str(), kwargs.second.c_str());
+    return 1;
+  }
+  if (kwargs.find("ep_provider") == kwargs.end())  kwargs["ep_provider"] = default_prov;
+
+  std::vector<Config> configs;
+  std::vector<bool>   waits;
+  if (modes.find("poll") != std::string::npos)  waits.push_back(false);
+  if (modes.find("wait") != std::string::npos)  waits.push_back(true);
+  for (auto size : _parseList(sizes))
+    for (auto links : _parseList(nLinks))
+      for (auto window : _parseList(windows))
+        for (auto wait : waits)
+          configs.push_back({size, links, window, wait});
+
+  for (const auto& cfg : configs)
+  {
+    if (cfg.size < sizeof(uint64_t))
+    {
+      fprintf(stderr, "Buffer size %zu is smaller than %zu\n", cfg.size, sizeof(uint64_t));
+      return 1;
+    }
+    if (!cfg.links || (cfg.links > ImmData::MaxSrc + 1u))
+    {
+      fprintf(stderr, "Number of links %u is out of range 1 - %u\n", cfg.links, ImmData::MaxSrc + 1u);
+      return 1;
+    }
+    if (!cfg.window || (cfg.window > nBuffers))
+    {
+      fprintf(stderr, "Window %u is out of range 1 - %u (-b)\n", cfg.window, nBuffers);
+      return 1;
+    }
+  }
+  if (configs.empty())
+  {
+    fprintf(stderr, "Nothing to run\n");
+    return 1;
+  }
+  if (nBuffers > ImmData::MaxIdx + 1u)
+  {
+    fprintf(stderr, "Number of buffers %u is out of range 1 - %u\n", nBuffers, ImmData::MaxIdx + 1u);
+    return 1;
+  }
+  if (portBase + configs.size() > USHRT_MAX)
+  {
+    fprintf(stderr, "Ports %u - %zu are out of range 0 - %u\n",
+            portBase, portBase + configs.size() - 1, USHRT_MAX);
+    return 1;
+  }
+
+  FILE* file = nullptr;
+  if (outFile)
+  {
+    file = fopen(outFile, "a");
+    if (!file)
+    {
+      fprintf(stderr, "Failed to open '%s': %s\n", outFile, strerror(errno));
+      return 1;
+    }
+  }
+
+  char host[HOST_NAME_MAX + 1] = "";
+  gethostname(host, sizeof(host));
+  char   stamp[32];
+  time_t now = time(nullptr);
+  strftime(stamp, sizeof(stamp), "%Y-%m-%dT%H:%M:%SZ", gmtime(&now));
+  const char* provider = kwargs["ep_provider"].c_str();
+
+  printf("%s on %s, provider %s, %u buffers of each size per link, %u per link per run\n",
+         stamp, host, provider, nBuffers, iters);
+  printf("%8s %5s %6s %4s %9s %10s %10s %9s %9s %9s %9s %9s %6s\n",
+         "size", "links", "window", "mode", "secs", "rate (Hz)", "bw (MB/s)",
+         "min (us)", "50%", "99%", "99.9%", "max", "errors");
+
+  for (unsigned i = 0; i < configs.size(); ++i)
+  {
+    const auto& cfg = configs[i];
+    Result      result;
+    int         runRc = bench(ifAddr, portBase + i, cfg, iters, nBuffers, core, kwargs, verbose, result);
+
+    printf("%8zu %5u %6u %4s %9.3f %10.0f %10.2f %9.2f %9.2f %9.2f %9.2f %9.2f %6lu%s\n",
+           cfg.size, cfg.links, cfg.window, cfg.wait ? "wait" : "poll",
+           result.secs, result.rate, result.bw,
+           result.lat[0], result.lat[1], result.lat[3], result.lat[4], result.lat[5],
+           result.errors, runRc ? "  FAILED" : "");
+    if (file)  _record(file, stamp, host, provider, cfg, iters, nBuffers, result);
+
+    if (!rc)  rc = runRc ? runRc : (result.errors ? 1 : 0);
+  }
+
+  if (file)  fclose(file);
+
+  return rc ? 1 : 0;
+}
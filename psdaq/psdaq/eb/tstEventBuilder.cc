@@ -0,0 +1,265 @@
+// This program checks that the EventBuilder delivers the same events whether
+// it builds them on the thread calling process() or shards the building over
+// builder threads.  Contributions from a number of sources in two readout
+// groups are batched per source and epoch, some of them dropped, and the
+// batches fed to the builder in an order that keeps each source's in time
+// order but skews the sources against each other, as the transport does.
+// Each configuration must deliver every event once, in pulse ID order, with
+// all its contributions, and damaged if and only if one was dropped.
+
+#include "EventBuilder.hh"
+#include "EbEvent.hh"
+
+#include "psdaq/service/EbDgram.hh"
+#include "xtcdata/xtc/Dgram.hh"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <chrono>
+#include <map>
+#include <memory>
+#include <random>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace XtcData;
+using namespace Pds;
+using namespace Pds::Eb;
+
+using ms_t = std::chrono::milliseconds;
+
+static const unsigned NSRC    = 8;      // Contributors
+static const unsigned ENTRIES = 8;      // Batch size and epoch duration
+static const size_t   SIZE    = 64;     // Of a contribution in a batch
+static const uint64_t rogContract[2] = { 0x3f, 0xf0 };
+
+static const unsigned default_events  = 100000;
+static const double   default_drop    = 0.001;
+static const unsigned default_seed    = 1;
+static const unsigned default_timeout = 1000; // ms
+static const unsigned default_shards  = 4;
+
+
+static ctrbs_t _contract(unsigned rogs)
+{
+  ctrbs_t contract;
+  for (unsigned rog = 0; rog < 2; ++rog)
+    for (unsigned src = 0; src < NSRC; ++src)
+      if ((rogs & (1 << rog)) && (rogContract[rog] & (1ull << src)))  contract.set(src);
+  return contract;
+}
+
+namespace
+{
+  struct Delivered
+  {
+    uint64_t pid;
+    unsigned nCtrbs;
+    bool     damaged;
+  };
+
+  class TstEb : public EventBuilder
+  {
+  public:
+    TstEb(unsigned timeout, unsigned shards) :
+      EventBuilder(timeout, _verbose, shards),
+      _verbose(0)
+    {
+    }
+  public:
+    int initialize(unsigned epochs)
+    {
+      return EventBuilder::initialize(epochs, ENTRIES, NSRC, ENTRIES);
+    }
+  public:
+    void fixup(EbEvent* event, unsigned srcId) override
+    {
+      event->damage(Damage::DroppedContribution);
+    }
+    void process(EbEvent* event) override
+    {
+      _delivered.push_back({event->sequence(),
+                            unsigned(event->end() - event->begin()),
+                            event->damage().value() != 0});
+    }
+    ctrbs_t contract(const EbDgram* ctrb) const override
+    {
+      return _contract(ctrb->readoutGroups());
+    }
+  public:
+    const std::vector<Delivered>& delivered() const { return _delivered; }
+  private:
+    unsigned               _verbose;
+    std::vector<Delivered> _delivered;
+  };
+
+  struct Batch
+  {
+    const EbDgram* start;
+    const void*    end;
+  };
+}
+
+
+void usage(char* progname)
+{
+  printf("\n<Parameters> or [Options]:\n"
+         "  %-22s %s (default: %u)\n"
+         "  %-22s %s (default: %g)\n"
+         "  %-22s %s (default: %u)\n"
+         "  %-22s %s (default: %u)\n"
+         "  %-22s %s (default: %u)\n",
+         "-n <events>",            "Number of events",                     default_events,
+         "-d <probability>",       "Chance of dropping each contribution", default_drop,
+         "-s <seed>",              "Random number generator seed",         default_seed,
+         "-t <timeout>",           "Event timeout, in ms",                 default_timeout,
+         "-b <builder threads>",   "Most builder threads to try",          default_shards);
+  printf("\nUsage: %s [-h] [-n <events>] [-d <probability>] [-s <seed>] [-t <timeout>] [-b <builder threads>]\n",
+         progname);
+}
+
+
+int main(int argc, char **argv)
+{
+  unsigned nEvents = default_events;
+  double   pDrop   = default_drop;
+  unsigned seed    = default_seed;
+  unsigned timeout = default_timeout;
+  unsigned nShards = default_shards;
+  int      op;
+
+  while ((op = getopt(argc, argv, "h?n:d:s:t:b:")) != -1)
+  {
+    switch (op)
+    {
+      case 'n':  nEvents = atoi(optarg);  break;
+      case 'd':  pDrop   = atof(optarg);  break;
+      case 's':  seed    = atoi(optarg);  break;
+      case 't':  timeout = atoi(optarg);  break;
+      case 'b':  nShards = atoi(optarg);  break;
+      case '?':
+      case 'h':
+      default:
+        usage(argv[0]);
+        return 1;
+    }
+  }
+
+  std::mt19937                           rng(seed);
+  std::uniform_real_distribution<double> uniform(0.0, 1.0);
+
+  // Events at irregular pulse IDs, each for one or both readout groups
+  std::vector<std::pair<uint64_t, unsigned> > events;
+  uint64_t pid = 0x1000;
+  for (unsigned i = 0; i < nEvents; ++i)
+  {
+    pid += 1 + (uniform(rng) < 0.3 ? unsigned(uniform(rng) * 5) : 0);
+    events.emplace_back(pid, 1 + unsigned(uniform(rng) * 3) % 3);
+  }
+
+  // Each source's batches, one per epoch it contributes to
+  std::vector<std::vector<Batch> > batches(NSRC);
+  std::vector<std::unique_ptr<char[]> > buffers;
+  std::map<uint64_t, unsigned> expected;  // Contributions per pulse ID
+  std::set<uint64_t>           dropped;
+  for (unsigned src = 0; src < NSRC; ++src)
+  {
+    size_t i = 0;
+    while (i < events.size())
+    {
+      const uint64_t epoch = events[i].first & ~uint64_t(ENTRIES - 1);
+      buffers.emplace_back(new char[ENTRIES * SIZE]);
+      char*    buffer = buffers.back().get();
+      unsigned n      = 0;
+      EbDgram* last   = nullptr;
+      for (; (i < events.size()) && ((events[i].first & ~uint64_t(ENTRIES - 1)) == epoch); ++i)
+      {
+        const uint64_t pid  = events[i].first;
+        const unsigned rogs = events[i].second;
+        if (!_contract(rogs).test(src))  continue;
+        if (uniform(rng) < pDrop)
+        {
+          dropped.insert(pid);
+          continue;
+        }
+        Transition tr(Dgram::Event, TransitionId::L1Accept, TimeStamp(pid, 0), rogs);
+        Dgram      dg(tr, Xtc(TypeId(TypeId::Parent, 0), Src(src)));
+        last = ::new(buffer + n++ * SIZE) EbDgram(PulseId(pid), dg);
+        expected[pid]++;
+      }
+      if (!n)  continue;
+      last->setEOL();
+      batches[src].push_back({(const EbDgram*)buffer, buffer + ENTRIES * SIZE});
+    }
+  }
+
+  // Interleave the sources' batches at random
+  std::vector<Batch>  feed;
+  std::vector<size_t> next(NSRC, 0);
+  size_t              total = 0;
+  for (const auto& srcBatches : batches)  total += srcBatches.size();
+  while (feed.size() < total)
+  {
+    unsigned src = unsigned(uniform(rng) * NSRC) % NSRC;
+    if (next[src] < batches[src].size())  feed.push_back(batches[src][next[src]++]);
+  }
+  printf("%zu events, %zu with dropped contributions, in %zu batches\n",
+         expected.size(), dropped.size(), feed.size());
+
+  int rc = 0;
+  for (unsigned shards = 0; shards <= nShards; ++shards)
+  {
+    TstEb eb(timeout, shards);
+    if (eb.initialize(4096))  return 1;
+
+    auto t0 = std::chrono::steady_clock::now();
+    for (const auto& batch : feed)
+    {
+      eb.EventBuilder::process(batch.start, SIZE, 0, batch.end);
+    }
+    auto t1 = std::chrono::steady_clock::now();
+
+    // Let the builder finish up, timing out what can't be completed
+    auto tEnd = t1 + 2 * ms_t(timeout) + ms_t(1000);
+    while ((eb.delivered().size() < expected.size()) && (std::chrono::steady_clock::now() < tEnd))
+    {
+      eb.expired();
+      std::this_thread::sleep_for(std::chrono::microseconds(200));
+    }
+    auto t2 = std::chrono::steady_clock::now();
+
+    const auto& delivered = eb.delivered();
+    unsigned    nBad      = 0;
+    for (size_t i = 0; i < delivered.size(); ++i)
+    {
+      const auto& event = delivered[i];
+      if (i && (event.pid <= delivered[i - 1].pid))
+      {
+        if (nBad++ < 5)  printf("  Event %014lx delivered after %014lx\n", event.pid, delivered[i - 1].pid);
+      }
+      else if ((event.nCtrbs != expected[event.pid]) || (event.damaged != (dropped.count(event.pid) != 0)))
+      {
+        if (nBad++ < 5)  printf("  Event %014lx has %u contributions of %u, damaged %d\n",
+                                event.pid, event.nCtrbs, expected[event.pid], event.damaged);
+      }
+    }
+    printf("%u builder threads: %zu of %zu events delivered, %u bad, %lu fixed up, %lu timed out, "
+           "fed in %.1f ms, built in %.1f ms\n",
+           shards, delivered.size(), expected.size(), nBad, eb.fixupCnt(), eb.timeoutCnt(),
+           std::chrono::duration<double, std::milli>(t1 - t0).count(),
+           std::chrono::duration<double, std::milli>(t2 - t0).count());
+    if (nBad || (delivered.size() != expected.size()))  rc = 1;
+
+    eb.clear();
+    if (eb.eventOccCnt())
+    {
+      printf("  %ld events left allocated\n", eb.eventOccCnt());
+      rc = 1;
+    }
+  }
+
+  return rc;
+}
@@ -0,0 +1,157 @@
+// This program checks the TebSchedule the DRPs use to choose the TEB for
+// each batch.  With equal credits it must be the plain epoch modulo number
+// of TEBs the DRPs used before.  With other credits, every cycle must give
+// each TEB as many epochs as it has credits, spread through the cycle so
+// that no TEB gets more than a batch ahead of or behind its share, and the
+// credits must be clamped to 1 - MAX_CREDITS.  The weighted cases are drawn
+// at random, from the seed given.
+
+#include "TebSchedule.hh"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <cmath>
+#include <random>
+
+using namespace Pds::Eb;
+
+static const unsigned default_cases = 10000;
+static const unsigned default_seed  = 1;
+
+static unsigned _errors = 0;
+
+#define CHECK(cond, ...)                                                \
+  do {                                                                  \
+    if (!(cond))                                                        \
+    {                                                                   \
+      fprintf(stderr, "%s:%d: ", __FILE__, __LINE__);                   \
+      fprintf(stderr, __VA_ARGS__);                                     \
+      fprintf(stderr, "\n");                                            \
+      if (++_errors > 20)  exit(1);                                     \
+    }                                                                   \
+  } while (0)
+
+
+static void _checkEqual()
+{
+  TebSchedule schedule;
+  for (unsigned numEbs = 1; numEbs <= MAX_TEBS; ++numEbs)
+  {
+    schedule.reset(numEbs);
+    for (uint64_t epoch = 0; epoch < 100000; ++epoch)
+      CHECK(schedule.teb(epoch) == epoch % numEbs,
+            "%u TEBs: epoch %lu went to TEB %u", numEbs, epoch, schedule.teb(epoch));
+
+    // Epochs come from pulse IDs, which are large
+    uint64_t epoch = 0x00ffffffffffffffull / 64;
+    for (unsigned i = 0; i < 1000; ++i, ++epoch)
+      CHECK(schedule.teb(epoch) == epoch % numEbs,
+            "%u TEBs: epoch %014lx went to TEB %u", numEbs, epoch, schedule.teb(epoch));
+  }
+}
+
+static void _checkClamp()
+{
+  TebSchedule schedule;
+  schedule.reset(2);
+
+  CHECK(!schedule.credit(0, MAX_CREDITS), "Unchanged credit reported as a change");
+  CHECK( schedule.credit(0, 0),           "Zero credit not taken");
+  CHECK( schedule.credit(0) == 1,         "Zero credit gave %u, not 1", schedule.credit(0));
+  CHECK( schedule.credit(1, 1),           "Small credit not taken");
+  CHECK( schedule.credit(1, 1000),        "Large credit not taken");
+  CHECK( schedule.credit(1) == MAX_CREDITS, "Large credit gave %u, not %u",
+         schedule.credit(1), MAX_CREDITS);
+  CHECK(!schedule.credit(2, 1),           "Credit taken for a TEB beyond numEbs");
+
+  // 2:1 is dealt out as 0, 1, 0
+  schedule.reset(2);
+  schedule.credit(1, MAX_CREDITS / 2);
+  const unsigned expect[] = { 0, 1, 0 };
+  for (unsigned epoch = 0; epoch < 3 * 16; ++epoch)
+    CHECK(schedule.teb(epoch) == expect[epoch % 3],
+          "2:1: epoch %u went to TEB %u, not %u", epoch, schedule.teb(epoch), expect[epoch % 3]);
+}
+
+static void _checkWeighted(const TebSchedule& schedule, unsigned numEbs)
+{
+  unsigned total = 0;
+  for (unsigned teb = 0; teb < numEbs; ++teb)  total += schedule.credit(teb);
+
+  // Over two cycles, each epoch must go where the one a cycle on does
+  unsigned count[MAX_TEBS] = {};
+  for (uint64_t epoch = 0; epoch < 2 * total; ++epoch)
+  {
+    unsigned teb = schedule.teb(epoch);
+    CHECK(teb < numEbs, "Epoch %lu went to TEB %u of %u", epoch, teb, numEbs);
+    if (teb >= numEbs)  return;
+    CHECK(teb == schedule.teb(epoch + total),
+          "Epoch %lu went to TEB %u, but %lu to %u", epoch, teb,
+          epoch + total, schedule.teb(epoch + total));
+
+    ++count[teb];
+    for (unsigned i = 0; i < numEbs; ++i)
+    {
+      double share = double(epoch + 1) * schedule.credit(i) / total;
+      CHECK(std::fabs(count[i] - share) < 1.0,
+            "TEB %u has had %u of %lu epochs rather than %.2f", i, count[i], epoch + 1, share);
+    }
+  }
+  for (unsigned teb = 0; teb < numEbs; ++teb)
+    CHECK(count[teb] == 2 * schedule.credit(teb),
+          "TEB %u got %u epochs of 2 cycles for %u credits", teb, count[teb], schedule.credit(teb));
+}
+
+
+void usage(char* progname)
+{
+  printf("\n<Parameters> or [Options]:\n"
+         "  %-22s %s (default: %u)\n"
+         "  %-22s %s (default: %u)\n",
+         "-n <cases>",             "Number of random credit cases", default_cases,
+         "-s <seed>",              "Random number seed",            default_seed);
+  printf("\nUsage: %s [-h] [-n <cases>] [-s <seed>]\n", progname);
+}
+
+
+int main(int argc, char **argv)
+{
+  unsigned nCases = default_cases;
+  unsigned seed   = default_seed;
+  int      op;
+
+  while ((op = getopt(argc, argv, "h?n:s:")) != -1)
+  {
+    switch (op)
+    {
+      case 'n':  nCases = atoi(optarg);  break;
+      case 's':  seed   = atoi(optarg);  break;
+      case '?':
+      case 'h':
+      default:
+        usage(argv[0]);
+        return 1;
+    }
+  }
+
+  _checkEqual();
+  _checkClamp();
+
+  std::mt19937                            rng(seed);
+  std::uniform_int_distribution<unsigned> tebs(2, MAX_TEBS);
+  std::uniform_int_distribution<unsigned> credits(0, MAX_CREDITS + 1);
+  TebSchedule                             schedule;
+  for (unsigned i = 0; i < nCases; ++i)
+  {
+    unsigned numEbs = tebs(rng);
+    schedule.reset(numEbs);
+    for (unsigned teb = 0; teb < numEbs; ++teb)
+      schedule.credit(teb, credits(rng));
+    _checkWeighted(schedule, numEbs);
+  }
+
+  printf("%u random cases: %s\n", nCases, _errors ? "FAILED" : "passed");
+
+  return _errors ? 1 : 0;
+}
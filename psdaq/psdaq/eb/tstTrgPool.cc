@@ -0,0 +1,177 @@
+// This program checks the TrgPool the TEB evaluates its trigger on with
+// trg_workers set.  Events are committed to a small ring, so that chunks are
+// cut short at its end and the ring fills, and are gathered back now and
+// then, as the TEB does after each batch.  Every so often the pool is
+// drained, as the TEB does before a transition, and must then be empty.  The
+// workers take a random time over each chunk.  Every event must come back
+// once, in the order committed, with the result its worker gave it, for each
+// number of workers tried.
+
+#include "TrgPool.hh"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <random>
+
+using namespace Pds::Eb;
+
+static const unsigned default_events = 50000;
+static const unsigned default_depth  = 64;
+static const unsigned default_chunk  = 5;
+static const unsigned default_seed   = 1;
+
+static unsigned _errors = 0;
+
+#define CHECK(cond, ...)                                                \
+  do {                                                                  \
+    if (!(cond))                                                        \
+    {                                                                   \
+      fprintf(stderr, "%s:%d: ", __FILE__, __LINE__);                   \
+      fprintf(stderr, __VA_ARGS__);                                     \
+      fprintf(stderr, "\n");                                            \
+      if (++_errors > 20)  exit(1);                                     \
+    }                                                                   \
+  } while (0)
+
+namespace
+{
+  struct Event
+  {
+    uint64_t seq;
+    uint64_t result;
+  };
+
+  struct Item
+  {
+    uint64_t seq;
+  };
+}
+
+static uint64_t _result(uint64_t seq)
+{
+  return seq * 0x9e3779b97f4a7c15ull + 1;
+}
+
+static void _run(unsigned workers, unsigned nEvents, unsigned depth,
+                     unsigned maxChunk, unsigned seed)
+{
+  TrgPool<Event, Item> pool(depth);
+
+  pool.start(workers, maxChunk, [](Event* events, unsigned count)
+  {
+    thread_local std::mt19937                            rng(std::hash<std::thread::id>()(std::this_thread::get_id()));
+    thread_local std::uniform_int_distribution<unsigned> delay(0, 99);
+    for (unsigned i = 0; i < count; ++i)
+      events[i].result = _result(events[i].seq);
+    unsigned us = delay(rng);           // Mostly quick, now and then slow
+    if      (us > 97)  std::this_thread::sleep_for(std::chrono::microseconds(us));
+    else if (us > 80)  std::this_thread::yield();
+  });
+
+  unsigned errors = _errors;
+  uint64_t next   = 0;                  // Next event expected back
+  auto done = [&](Event& event, Item& item)
+  {
+    CHECK((item.seq == next) && (event.seq == next),
+          "%u workers: got event %lu (item %lu) rather than %lu",
+          workers, event.seq, item.seq, next);
+    CHECK(event.result == _result(event.seq),
+          "%u workers: event %lu has the wrong result", workers, event.seq);
+    next = item.seq + 1;
+  };
+
+  std::mt19937                            rng(seed);
+  std::uniform_int_distribution<unsigned> pick(0, 999);
+  unsigned                                drains = 0;
+  for (uint64_t seq = 0; seq < nEvents; ++seq)
+  {
+    unsigned slot = pool.claim(done);
+    pool.event(slot) = {seq, 0};
+    pool.item (slot) = {seq};
+    pool.commit();
+
+    unsigned p = pick(rng);
+    if (p < 2)                          // A transition
+    {
+      pool.drain(done);
+      ++drains;
+      CHECK((pool.occupancy() == 0) && (next == seq + 1),
+            "%u workers: %lu events left after draining at %lu, next is %lu",
+            workers, pool.occupancy(), seq, next);
+    }
+    else if (p < 200)                   // The end of a batch
+    {
+      pool.submit();
+      pool.gather(false, done);
+    }
+  }
+  pool.drain(done);
+  pool.stop();
+
+  CHECK(next == nEvents, "%u workers: %lu of %u events came back", workers, next, nEvents);
+
+  printf("%u workers: %u events, %u drains: %s\n",
+         workers, nEvents, drains, _errors != errors ? "FAILED" : "passed");
+}
+
+
+void usage(char* progname)
+{
+  printf("\n<Parameters> or [Options]:\n"
+         "  %-22s %s (default: %u)\n"
+         "  %-22s %s (default: %u)\n"
+         "  %-22s %s (default: %u)\n"
+         "  %-22s %s (default: %s)\n"
+         "  %-22s %s (default: %u)\n",
+         "-n <events>",            "Number of events",                default_events,
+         "-d <depth>",             "Ring depth (a power of 2)",       default_depth,
+         "-c <chunk>",             "Largest chunk of events",         default_chunk,
+         "-w <workers>",           "Number of workers",               "1 - 4 and 7",
+         "-s <seed>",              "Random number seed",              default_seed);
+  printf("\nUsage: %s [-h] [-n <events>] [-d <depth>] [-c <chunk>] [-w <workers>] [-s <seed>]\n",
+         progname);
+}
+
+
+int main(int argc, char **argv)
+{
+  unsigned nEvents  = default_events;
+  unsigned depth    = default_depth;
+  unsigned maxChunk = default_chunk;
+  unsigned seed     = default_seed;
+  unsigned workers  = 0;
+  int      op;
+
+  while ((op = getopt(argc, argv, "h?n:d:c:w:s:")) != -1)
+  {
+    switch (op)
+    {
+      case 'n':  nEvents  = atoi(optarg);  break;
+      case 'd':  depth    = atoi(optarg);  break;
+      case 'c':  maxChunk = atoi(optarg);  break;
+      case 'w':  workers  = atoi(optarg);  break;
+      case 's':  seed     = atoi(optarg);  break;
+      case '?':
+      case 'h':
+      default:
+        usage(argv[0]);
+        return 1;
+    }
+  }
+  if (!depth || (depth & (depth - 1)))
+  {
+    fprintf(stderr, "Ring depth must be a power of 2\n");
+    return 1;
+  }
+
+  if (workers)
+    _run(workers, nEvents, depth, maxChunk, seed);
+  else
+  {
+    for (unsigned w : { 1, 2, 3, 4, 7 })
+      _run(w, nEvents, depth, maxChunk, seed);
+  }
+
+  return _errors ? 1 : 0;
+}
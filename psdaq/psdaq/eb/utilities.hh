@@ -10,6 +10,8 @@
 
 #include "rapidjson/document.h"
 
+#include "eb.hh"                        // DRP_ID_BITS
+
 namespace Pds
 {
   namespace Eb
@@ -22,8 +24,8 @@ namespace Pds
     {
     private:
       enum { v_flg = 30, k_flg =  2 };  // Modifier flags (see Flags enum below)
-      enum { v_src = 24, k_src =  6 };  // Limit to 64 Ctrbs
-      enum { v_idx =  0, k_idx = 24 };  // Multiplied by pulseId tick gives time range
+      enum { k_src = DRP_ID_BITS, v_src = v_flg - k_src }; // Limit to MAX_DRPS Ctrbs
+      enum { v_idx =  0, k_idx = v_src };  // Multiplied by pulseId tick gives time range
     private:
       enum { m_flg = ((1 << k_flg) - 1), s_flg = (m_flg << v_flg) };
       enum { m_src = ((1 << k_src) - 1), s_src = (m_src << v_src) };
@@ -21,7 +21,6 @@
 #include <unistd.h>                     // For getopt(), gethostname()
 #include <string.h>
 #include <vector>
-#include <bitset>
 #include <iostream>
 #include <sstream>
 #include <atomic>
@@ -48,7 +47,6 @@ using namespace Pds::Eb;
 
 using json     = nlohmann::json;
 using logging  = psalg::SysLog;
-using u64arr_t = std::array<uint64_t, NUM_READOUT_GROUPS>;
 using tp_t     = std::chrono::system_clock::time_point;
 using ms_t     = std::chrono::milliseconds;
 using ns_t     = std::chrono::nanoseconds;
@@ -494,7 +492,7 @@ int Meb::connect()
 int Meb::configure()
 {
   // Create pool for transferring events to MyXtcMonitorServer
-  unsigned entries = std::bitset<64>(_prms.contributors).count();
+  unsigned entries = _prms.contributors.count();
   size_t   size    = sizeof(Dgram) + entries * sizeof(Dgram*);
   _pool = std::make_unique<GenericPool>(size, 1 + _prms.numEvBuffers); // +1 for Transitions
 
@@ -576,8 +574,8 @@ void Meb::process(EbEvent* event)
   {
     event->damage(Damage::OutOfOrder);
 
-    logging::critical("%s:\n  Pulse ID did not advance: %014lx <= %014lx, rem %08lx, prm %08x, svc %u, ts %u.%09u",
-                      __PRETTY_FUNCTION__, pid, _pidPrv, event->remaining(), event->immData(), dgram->service(), dgram->time.seconds(), dgram->time.nanoseconds());
+    logging::critical("%s:\n  Pulse ID did not advance: %014lx <= %014lx, rem %s, prm %08x, svc %u, ts %u.%09u",
+                      __PRETTY_FUNCTION__, pid, _pidPrv, event->remaining().hex().c_str(), event->immData(), dgram->service(), dgram->time.seconds(), dgram->time.nanoseconds());
 
     if (event->remaining())             // I.e., this event was fixed up
     {
@@ -906,13 +904,13 @@ int MebApp::_parseConnectionParams(const json& body)
 
   size_t maxTrSize     = 0;
   size_t maxBufferSize = 0;
-  _prms.contributors   = 0;
+  _prms.contributors   = ctrbs_t();
   _prms.maxBufferSize  = 0;
   _prms.maxTrSize.resize(body["drp"].size());
 
   _prms.rogs = 0;
-  _prms.contractors.fill(0);
-  _prms.receivers.fill(0);
+  _prms.contractors.fill(ctrbs_t());
+  _prms.receivers.fill(ctrbs_t());
 
   _prms.maxEntries = 1;                  // No batching: each event stands alone
   _prms.maxBuffers = _prms.numEvBuffers; // For EbAppBase
@@ -927,7 +925,7 @@ int MebApp::_parseConnectionParams(const json& body)
       logging::error("DRP ID %u is out of range 0 - %u", drpId, MAX_DRPS - 1);
       return 1;
     }
-    _prms.contributors |= 1ul << drpId;
+    _prms.contributors.set(drpId);
     _prms.drps[drpId]   = it.value()["proc_info"]["alias"];
 
     _prms.addrs.push_back(it.value()["connect_info"]["nic_ip"]);
@@ -940,11 +938,11 @@ int MebApp::_parseConnectionParams(const json& body)
       return 1;
     }
     _prms.rogs             |= 1 << rog;
-    _prms.contractors[rog] |= 1ul << drpId;
-    _prms.receivers[rog]    = 0;      // Unused by MEB
+    _prms.contractors[rog].set(drpId);
+    _prms.receivers[rog]    = ctrbs_t(); // Unused by MEB
 
     _prms.numBuffers[drpId] = _prms.maxBuffers;
-    _prms.indexSources      = ULLONG_MAX; // All DRPs provide an index in immData
+    _prms.indexSources      = ~ctrbs_t(); // All DRPs provide an index in immData
 
     _prms.maxTrSize[drpId] = size_t(it.value()["connect_info"]["max_tr_size"]);
     maxTrSize             += _prms.maxTrSize[drpId];
@@ -990,14 +988,14 @@ int MebApp::_parseConnectionParams(const json& body)
 }
 
 static
-void _printGroups(unsigned groups, const u64arr_t& array)
+void _printGroups(unsigned groups, const EbParams::ctrbarr_t& array)
 {
   while (groups)
   {
     unsigned group = __builtin_ffs(groups) - 1;
     groups &= ~(1 << group);
 
-    printf("%u: 0x%016lx  ", group, array[group]);
+    printf("%u: 0x%s  ", group, array[group].hex().c_str());
   }
   printf("\n");
 }
@@ -1010,8 +1008,8 @@ void MebApp::_printParams(const MebParams& prms) const
   printf("  Instrument:                 %s\n",                 prms.instrument.c_str());
   printf("  Partition:                  %u\n",                 prms.partition);
   printf("  Alias:                      %s\n",                 prms.alias.c_str());
-  printf("  Bit list of contributors:   0x%016lx, cnt: %zu\n", prms.contributors,
-                                                               std::bitset<64>(prms.contributors).count());
+  printf("  Bit list of contributors:   0x%s, cnt: %u\n",    prms.contributors.hex().c_str(),
+                                                               prms.contributors.count());
   printf("  Readout group contractors:  ");                    _printGroups(prms.rogs, prms.contractors);
   printf("  # of TEB requestees:        %zu\n",                prms.addrs.size());
   printf("  Buffer duration:            %u\n",                 prms.maxEntries);
@@ -1170,6 +1168,7 @@ int main(int argc, char** argv)
     if (kwargs.first == "ep_fabric")    continue;
     if (kwargs.first == "ep_domain")    continue;
     if (kwargs.first == "ep_provider")  continue;
+    if (kwargs.first == "eb_shards")    continue;
     logging::critical("Unrecognized kwarg '%s=%s'",
                       kwargs.first.c_str(), kwargs.second.c_str());
     return 1;
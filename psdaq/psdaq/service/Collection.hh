@@ -66,6 +66,7 @@ protected:
     virtual void handleConnect(const nlohmann::json& msg) = 0;
     virtual void handleDisconnect(const nlohmann::json& msg) {};
     virtual void handlePhase1(const nlohmann::json& msg) {};
+    virtual void handleChunkRollover(const nlohmann::json& msg) {};
     virtual void handleReset(const nlohmann::json& msg) = 0;
     void reply(const nlohmann::json& msg);
     size_t getId() const {return m_id;}
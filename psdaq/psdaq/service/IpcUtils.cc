@@ -5,8 +5,11 @@
 #include <unistd.h>
 #include <fcntl.h>
 #include <time.h>
+#include <linux/futex.h>
+#include <sys/syscall.h>
 #include <chrono>
 #include <cerrno>
+#include <thread>
 #include <string>
 #include "psalg/utils/SysLog.hh"
 #include "IpcUtils.hh"
@@ -32,7 +35,7 @@ int attachDrpShMem(std::string key, int& shmId, size_t size, void*& data, bool w
 
     int prot;
     if (write == true) {
-        prot = PROT_WRITE;
+        prot = PROT_READ | PROT_WRITE;
     } else {
         prot = PROT_READ;
     }
@@ -123,4 +126,86 @@ int cleanupDrpMq(std::string key, int mqId)
     return rc;
 }
 
+static long futexWait(std::atomic<uint32_t>* addr, uint32_t val, unsigned msTmo)
+{
+    struct timespec t;
+    t.tv_sec  = msTmo / 1000;
+    t.tv_nsec = (msTmo % 1000) * 1000000;
+    // Not FUTEX_PRIVATE_FLAG: the word is shared with another process
+    return syscall(SYS_futex, addr, FUTEX_WAIT, val, &t, nullptr, 0);
+}
+
+static long futexWake(std::atomic<uint32_t>* addr)
+{
+    return syscall(SYS_futex, addr, FUTEX_WAKE, 1, nullptr, nullptr, 0);
+}
+
+DrpRing::DrpRing(unsigned nSlots, size_t slotSize) :
+    m_magic   (0),
+    m_version (1),
+    m_nSlots  (nSlots),
+    m_reserved(0),
+    m_slotSize(slotSize)
+{
+    reset();
+    std::atomic_thread_fence(std::memory_order_release);
+    m_magic = Magic;
+}
+
+void DrpRing::reset()
+{
+    for (auto& ring : m_rings) {
+        ring.head.store(0, std::memory_order_relaxed);
+        ring.waiting.store(0, std::memory_order_relaxed);
+        ring.tail.store(0, std::memory_order_relaxed);
+    }
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+}
+
+int DrpRing::send(const DrpRingMsg& msg)
+{
+    Ring& ring = m_rings[ToPython];
+    uint32_t head = ring.head.load(std::memory_order_relaxed);
+    while (head - ring.tail.load(std::memory_order_acquire) >= Depth) {
+        std::this_thread::yield();      // Not expected: Python has more than Depth messages
+    }
+    ring.msgs[head % Depth] = msg;
+    ring.head.store(head + 1, std::memory_order_release);
+    // Pairs with the reader setting waiting before checking head a last time
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (ring.waiting.load(std::memory_order_relaxed)) {
+        if (futexWake(&ring.head) == -1)  return -1;
+    }
+    return 0;
+}
+
+int DrpRing::recv(DrpRingMsg& msg, unsigned msTmo)
+{
+    Ring& ring = m_rings[FromPython];
+    uint32_t tail = ring.tail.load(std::memory_order_relaxed);
+    auto t0 = std::chrono::steady_clock::now();
+    unsigned spins = 0;
+    uint32_t head;
+    while ((head = ring.head.load(std::memory_order_acquire)) == tail) {
+        if (++spins < 10000)  continue;
+        auto elapsed = std::chrono::duration_cast<ms_t>(std::chrono::steady_clock::now() - t0).count();
+        if (elapsed >= msTmo) {
+            logging::debug("Ring message receiving timed out");
+            errno = ETIMEDOUT;
+            return -1;
+        }
+        ring.waiting.store(1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        // Sleep at most 1 ms at a time in case a wakeup is missed, since the
+        // Python writer can't issue the fence send() relies on
+        if (ring.head.load(std::memory_order_acquire) == tail) {
+            futexWait(&ring.head, tail, 1);
+        }
+        ring.waiting.store(0, std::memory_order_relaxed);
+    }
+    msg = ring.msgs[tail % Depth];
+    ring.tail.store(tail + 1, std::memory_order_release);
+    return 0;
+}
+
 }
@@ -3,6 +3,10 @@
 #define IPCUTILS_H
 
 #include <sys/ipc.h>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
 
 namespace Pds {
 
@@ -18,6 +22,60 @@ int drpRecv(int mqId, char *msg, size_t msgsize, unsigned msTmo);
 int cleanupDrpShmMem(std::string key, int shmId);
 int cleanupDrpMq(std::string key, int mqId);
 
+// Message rings between a DRP worker and its Python process, placed in a
+// shared memory segment of their own.  The input and result shared memory
+// are divided into slots and each message names the slot of a dgram: the
+// worker posts 'g' (event) or 's' (stop) requests on one ring and Python
+// answers on the other once the slot's result is written, so that several
+// events can be in flight without a system call per message.  A reader
+// finding its ring empty spins briefly and then sleeps on a futex on the
+// ring's head, which the writer only wakes when the reader says it sleeps.
+// The layout is shared with psdaq/drp/drp_ring.py and must not change
+// without it.
+struct DrpRingMsg
+{
+    uint32_t type;                      // 'g' or 's'
+    uint32_t slot;
+    uint32_t size;                      // of the dgram in the slot
+    uint32_t reserved;
+};
+
+class DrpRing
+{
+public:
+    enum { Magic = 0x44525052 };        // "DRPR"
+    enum { Depth = 64 };                // messages per ring, more than slots in flight
+    enum Dir { ToPython, FromPython };
+
+    DrpRing(unsigned nSlots, size_t slotSize);
+
+    unsigned nSlots()   const { return m_nSlots; }
+    size_t   slotSize() const { return m_slotSize; }
+    bool     valid()    const { return m_magic == Magic; }
+
+    int  send(const DrpRingMsg& msg);   // to Python, never blocks as Depth > nSlots
+    int  recv(DrpRingMsg& msg, unsigned msTmo); // from Python, -1 with ETIMEDOUT on timeout
+    void reset();                       // only when neither side is using the rings
+private:
+    struct Ring
+    {
+        alignas(64) std::atomic<uint32_t> head;    // written by the writer
+        std::atomic<uint32_t>             waiting; // set by a sleeping reader
+        alignas(64) std::atomic<uint32_t> tail;    // written by the reader
+        alignas(64) DrpRingMsg            msgs[Depth];
+    };
+private:
+    uint32_t m_magic;
+    uint32_t m_version;
+    uint32_t m_nSlots;
+    uint32_t m_reserved;
+    uint64_t m_slotSize;
+    alignas(64) Ring m_rings[2];
+};
+
+static_assert(sizeof(DrpRingMsg) == 16, "DrpRingMsg layout is shared with Python");
+static_assert(sizeof(DrpRing) == 64 + 2 * (128 + 16 * DrpRing::Depth), "DrpRing layout is shared with Python");
+
 }
 
 }
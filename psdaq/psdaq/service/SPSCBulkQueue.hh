@@ -0,0 +1,248 @@
+#ifndef SPSCBULKQUEUE_H
+#define SPSCBULKQUEUE_H
+
+#include <atomic>
+#include <climits>
+#include <cstdint>
+#include <cstdio>
+#include <thread>
+#include <vector>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "psdaq/service/fast_monotonic_clock.hh"
+
+// Bounded single producer single consumer queue, a drop-in for the DRP's
+// SPSCQueue (drp/spscqueue.hh), with the following differences:
+// - The producer's and the consumer's indices are on cache lines of their
+//   own, each next to a cached copy of the other side's index, so that the
+//   shared index is only read when the cached one says the queue is full
+//   (producer) or empty (consumer).
+// - push() checks for a full queue and waits for room rather than
+//   overwriting entries, and try_push() tells when it would have to.
+// - push_n() and pop_n() move several entries with one index update.
+// - A consumer that has polled for a while sleeps on a futex on the write
+//   index, and only the push that follows it going to sleep, i.e. the
+//   empty to non-empty edge, makes the system call.  There is no mutex.
+// The indices are 32 bits wide for the futex, so they wrap; the capacity
+// must be a power of 2 no larger than 2^31.
+template <typename T>
+class SPSCBulkQueue
+{
+    using us_t = std::chrono::microseconds;
+public:
+    SPSCBulkQueue(int capacity) : m_ring_buffer(capacity), m_nFull(0)
+    {
+        if (capacity <= 0 || (capacity & (capacity - 1)) != 0) {
+            fprintf(stderr, "SPSCBulkQueue capacity must be a power of 2, got %d\n", capacity);
+            throw "SPSCBulkQueue capacity must be a power of 2";
+        };
+        m_capacity = capacity;
+        m_buffer_mask = capacity - 1;
+        startup();
+    }
+
+    SPSCBulkQueue(const SPSCBulkQueue&) = delete;
+    void operator=(const SPSCBulkQueue&) = delete;
+
+    // non blocking write to queue, false when full
+    bool try_push(const T& value)
+    {
+        return try_push_n(&value, 1) == 1;
+    }
+
+    // write to queue, waiting for room when it is full; false after shutdown()
+    bool push(const T& value)
+    {
+        return push_n(&value, 1) == 1;
+    }
+
+    // non blocking write of up to count values, returns the number written
+    size_t try_push_n(const T* values, size_t count)
+    {
+        uint32_t index = m_p.write_index.load(std::memory_order_relaxed);
+        uint32_t room  = m_capacity - (index - m_p.read_cache);
+        if (room < count) {
+            m_p.read_cache = m_c.read_index.load(std::memory_order_acquire);
+            room = m_capacity - (index - m_p.read_cache);
+            if (room == 0)  return 0;
+        }
+        if (count > room)  count = room;
+        for (size_t i = 0; i < count; i++) {
+            m_ring_buffer[(index + i) & m_buffer_mask] = values[i];
+        }
+        _publish(index + count);
+        return count;
+    }
+
+    // write of count values, waiting for room when the queue is full;
+    // returns fewer than count only after shutdown()
+    size_t push_n(const T* values, size_t count)
+    {
+        size_t n = try_push_n(values, count);
+        if (n < count) {
+            m_nFull.fetch_add(1, std::memory_order_relaxed);
+            while (n < count) {
+                if (m_terminate.load(std::memory_order_acquire))  break;
+                std::this_thread::yield();
+                n += try_push_n(values + n, count - n);
+            }
+        }
+        return n;
+    }
+
+    // non blocking read from queue
+    bool try_pop(T& value)
+    {
+        return try_pop_n(&value, 1) == 1;
+    }
+
+    // non blocking read of up to count values, returns the number read
+    size_t try_pop_n(T* values, size_t count)
+    {
+        uint32_t index = m_c.read_index.load(std::memory_order_relaxed);
+        uint32_t avail = m_c.write_cache - index;
+        if (avail < count) {
+            m_c.write_cache = m_p.write_index.load(std::memory_order_acquire);
+            avail = m_c.write_cache - index;
+            if (avail == 0)  return 0;
+        }
+        if (count > avail)  count = avail;
+        for (size_t i = 0; i < count; i++) {
+            values[i] = m_ring_buffer[(index + i) & m_buffer_mask];
+        }
+        m_c.read_index.store(index + count, std::memory_order_release);
+        return count;
+    }
+
+    // blocking read from queue with polling for the 1st N us before blocking;
+    // false when the queue is shut down and empty
+    bool pop(T& value)
+    {
+        return pop_n(&value, 1) == 1;
+    }
+
+    // blocking read of at least one and up to count values, returns the
+    // number read, which is 0 only when the queue is shut down and empty
+    size_t pop_n(T* values, size_t count)
+    {
+        auto t0 = Pds::fast_monotonic_clock::now(CLOCK_MONOTONIC);
+        size_t n;
+        while ((n = try_pop_n(values, count)) == 0) {
+            if (m_terminate.load(std::memory_order_acquire)) {
+                return try_pop_n(values, count);
+            }
+            auto t1 = Pds::fast_monotonic_clock::now(CLOCK_MONOTONIC);
+            if (std::chrono::duration_cast<us_t>(t1 - t0).count() > 1000) {
+                _wait();
+                t0 = Pds::fast_monotonic_clock::now(CLOCK_MONOTONIC);
+            }
+        }
+        return n;
+    }
+
+    bool is_empty()
+    {
+        return m_c.read_index.load(std::memory_order_acquire) ==
+               m_p.write_index.load(std::memory_order_acquire);
+    }
+
+    int guess_size()
+    {
+        return m_p.write_index.load(std::memory_order_acquire) -
+               m_c.read_index.load(std::memory_order_acquire);
+    }
+
+    size_t size()
+    {
+        return m_ring_buffer.size();
+    }
+
+    // number of times push() or push_n() found the queue full
+    uint64_t full_count() const
+    {
+        return m_nFull.load(std::memory_order_relaxed);
+    }
+
+    void shutdown()
+    {
+        m_terminate.store(true, std::memory_order_seq_cst);
+        _futex(FUTEX_WAKE_PRIVATE, INT_MAX);
+    }
+
+    void startup()
+    {
+        m_terminate.store(false);
+        m_p.write_index.store(0);
+        m_p.read_cache = 0;
+        m_c.read_index.store(0);
+        m_c.write_cache = 0;
+        m_waiting.store(0);
+    }
+
+private:
+    void _publish(uint32_t next)
+    {
+        // The seq_cst store and load order the index update before the
+        // check of m_waiting, as the consumer orders them the other way
+        // round, so that either it sees the entry or the producer sees it
+        // waiting.  On x86 this makes the store an xchg, not a store plus
+        // mfence.
+        m_p.write_index.store(next, std::memory_order_seq_cst);
+        if (m_waiting.load(std::memory_order_seq_cst) &&
+            m_waiting.exchange(0, std::memory_order_acq_rel)) {
+            _futex(FUTEX_WAKE_PRIVATE, 1);
+        }
+    }
+
+    void _wait()
+    {
+        uint32_t index = m_c.read_index.load(std::memory_order_relaxed);
+        m_waiting.store(1, std::memory_order_seq_cst);
+        if (m_p.write_index.load(std::memory_order_seq_cst) == index &&
+            !m_terminate.load(std::memory_order_acquire)) {
+            // The timeout is only a backstop
+            struct timespec tmo = {0, 100000000};
+            _futex(FUTEX_WAIT_PRIVATE, index, &tmo);
+        }
+        m_waiting.store(0, std::memory_order_relaxed);
+    }
+
+    long _futex(int op, uint32_t value, const struct timespec* tmo = nullptr)
+    {
+        return syscall(SYS_futex, reinterpret_cast<uint32_t*>(&m_p.write_index), op, value, tmo, nullptr, 0);
+    }
+
+private:
+    // The producer's side, which goes on a cache line of its own
+    struct Producer
+    {
+        std::atomic<uint32_t> write_index;
+        uint32_t read_cache;            // Last value of read_index seen
+    };
+    // The consumer's side
+    struct Consumer
+    {
+        std::atomic<uint32_t> read_index;
+        uint32_t write_cache;           // Last value of write_index seen
+    };
+    static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t), "futex needs a plain 32 bit word");
+
+    // Padded apart rather than aligned, since new doesn't align to 64 in C++14
+    char _pad0[64];
+    Producer m_p;
+    char _pad1[64 - sizeof(Producer)];
+    Consumer m_c;
+    char _pad2[64 - sizeof(Consumer)];
+    std::atomic<uint32_t> m_waiting;    // Consumer is (about to be) in futex wait
+    std::atomic<bool> m_terminate;
+    uint32_t m_capacity;
+    uint32_t m_buffer_mask;
+    std::vector<T> m_ring_buffer;
+    std::atomic<uint64_t> m_nFull;
+    char _pad3[64];
+};
+
+#endif // SPSCBULKQUEUE_H
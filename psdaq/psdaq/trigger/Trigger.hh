@@ -17,6 +17,14 @@ namespace Pds {
 
     class Trigger
     {
+    public:
+      // An event's contributions and the result to fill in for it
+      struct Event
+      {
+        const Pds::EbDgram* const* start;
+        const Pds::EbDgram**       end;
+        Pds::Eb::ResultDgram*      result;
+      };
     public:
       virtual ~Trigger() {}
     public:
@@ -31,6 +39,17 @@ namespace Pds {
       virtual void     event(const Pds::EbDgram* const* start,
                              const Pds::EbDgram**       end,
                              Pds::Eb::ResultDgram&      result) = 0;
+      // Handles a run of events in pulse ID order, so that a trigger can work
+      // across them at once.  By default, it's event() for each in turn.
+      virtual void     event(const Event* events,
+                             unsigned     count)
+      {
+        for (unsigned i = 0; i < count; ++i)
+          event(events[i].start, events[i].end, *events[i].result);
+      }
+      // Whether event() may be called from several threads at once, each
+      // with its own events, so that the TEB can share them out
+      virtual bool     concurrent() const { return false; }
       virtual void     shutdown() {};
     public:
       static size_t size() { return sizeof(Pds::Eb::ResultDgram); }
@@ -21,6 +21,7 @@ namespace Pds {
       void event(const Pds::EbDgram* const* start,
                  const Pds::EbDgram**       end,
                  Pds::Eb::ResultDgram&      result) override;
+      bool concurrent() const override { return true; } // Keeps no state per event
     };
   };
 };
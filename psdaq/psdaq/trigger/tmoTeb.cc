@@ -22,6 +22,7 @@ namespace Pds {
       void event(const Pds::EbDgram* const* start,
                  const Pds::EbDgram**       end,
                  Pds::Eb::ResultDgram&      result) override;
+      bool concurrent() const override { return true; } // Keeps no state per event
     private:
       uint32_t _wrtValue;
       uint32_t _monValue;
@@ -0,0 +1,224 @@
+#include "xtcdata/xtc/ShapesData.hh"
+#include "xtcdata/xtc/DescData.hh"
+#include "xtcdata/xtc/VarDef.hh"
+#include "xtcdata/xtc/NamesLookup.hh"
+
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <vector>
+
+using namespace XtcData;
+
+//
+// Microbenchmark of DescData construction and value access, comparing the
+// layout precomputed in NameIndex with the previous per-event computation
+// of the offset table (reproduced in LegacyOffsets below), and of field
+// lookup by name through nameMap() and through the NameIndex hash table
+//
+
+#define BUFSIZE 0x100000
+
+class BenchDef : public VarDef
+{
+public:
+    BenchDef(unsigned nScalars, unsigned nArrays)
+    {
+        static char names[256][16];
+        unsigned n = 0;
+        for (unsigned i = 0; i < nScalars + nArrays; i++, n++) {
+            snprintf(names[n], sizeof(names[n]), "field%u", n);
+            // spread the arrays among the scalars
+            if (nArrays && (i % ((nScalars + nArrays) / nArrays) == 0) && arrays < nArrays) {
+                NameVec.push_back({names[n], Name::UINT16, 1});
+                arrays++;
+            } else {
+                NameVec.push_back({names[n], Name::UINT32});
+            }
+        }
+    }
+    unsigned arrays = 0;
+};
+
+// The offset table as computed by DescData for every event before the
+// layout was cached in NameIndex
+class LegacyOffsets
+{
+public:
+    LegacyOffsets(ShapesData& shapesdata, NameIndex& nameindex) :
+        _offset(nameindex.names().num()+1)
+    {
+        Names& names = nameindex.names();
+        _offset[0]=0;
+        unsigned numentries = names.num();
+        unsigned shapeIndex = 0;
+        for (unsigned i=0; i<numentries-1; i++) {
+            Name& name = names.get(i);
+            if (name.rank()==0) _offset[i+1]=_offset[i]+Name::get_element_size(name.type());
+            else {
+                unsigned size = shapesdata.shapes().get(shapeIndex).size(name);
+                _offset[i+1]=_offset[i]+size;
+                shapeIndex++;
+            }
+        }
+    }
+    std::vector<unsigned> _offset;
+};
+
+static void bench(unsigned nScalars, unsigned nArrays, unsigned iterations)
+{
+    char* buf = new char[BUFSIZE];
+    const void* bufEnd = buf + BUFSIZE;
+    Xtc& parent = *new(buf, bufEnd) Xtc(TypeId(TypeId::Parent, 0));
+
+    BenchDef def(nScalars, nArrays);
+    Alg alg("bench", 0, 0, 0);
+    NamesId namesId(0, 0);
+    Names& names = *new(parent, bufEnd) Names(bufEnd, "bench", alg, "bench", "", namesId);
+    names.add(parent, bufEnd, def);
+    NamesLookup namesLookup;
+    namesLookup[namesId] = NameIndex(names);
+
+    CreateData cd(parent, bufEnd, namesLookup, namesId);
+    for (unsigned i = 0; i < names.num(); i++) {
+        if (names.get(i).rank() == 0) cd.set_value<uint32_t>(i, i);
+        else {
+            unsigned shape[MaxRank] = {4 + i};
+            Array<uint16_t> a = cd.allocate<uint16_t>(i, shape);
+            for (unsigned j = 0; j < shape[0]; j++) a(j) = j;
+        }
+    }
+    ShapesData& shapesdata = cd.shapesdata();
+    NameIndex& nameindex = namesLookup[namesId];
+    unsigned last = names.num() - 1;
+    while (names.get(last).rank()) last--;
+
+    uint64_t sum = 0;
+    auto t0 = std::chrono::steady_clock::now();
+    for (unsigned n = 0; n < iterations; n++) {
+        DescData descdata(shapesdata, nameindex);
+        sum += descdata.get_value<uint32_t>(last);
+    }
+    auto t1 = std::chrono::steady_clock::now();
+    for (unsigned n = 0; n < iterations; n++) {
+        LegacyOffsets legacy(shapesdata, nameindex);
+        sum += *(uint32_t*)(shapesdata.data().payload() + legacy._offset[last]);
+    }
+    auto t2 = std::chrono::steady_clock::now();
+
+    double tNew = std::chrono::duration<double, std::nano>(t1 - t0).count() / iterations;
+    double tOld = std::chrono::duration<double, std::nano>(t2 - t1).count() / iterations;
+    printf("%3u scalars %3u arrays: cached layout %7.1f ns  per-event layout %7.1f ns  speedup %5.2f  (%lu)\n",
+           nScalars, def.arrays, tNew, tOld, tOld / tNew, (unsigned long)(sum & 1));
+    delete[] buf;
+}
+
+// Makes the compiler forget what p points to
+template <typename T>
+static inline void opaque(T*& p)
+{
+    asm volatile("" : "+r"(p));
+}
+
+// Makes the compiler compute v
+static inline void sink(int v)
+{
+    asm volatile("" : : "r"(v));
+}
+
+static void benchLookup(unsigned nScalars, unsigned iterations)
+{
+    char* buf = new char[BUFSIZE];
+    const void* bufEnd = buf + BUFSIZE;
+    Xtc& parent = *new(buf, bufEnd) Xtc(TypeId(TypeId::Parent, 0));
+
+    BenchDef def(nScalars, 0);
+    Alg alg("bench", 0, 0, 0);
+    NamesId namesId(0, 0);
+    Names& names = *new(parent, bufEnd) Names(bufEnd, "bench", alg, "bench", "", namesId);
+    names.add(parent, bufEnd, def);
+    NameIndex nameindex(names);
+
+    // check the two lookups agree before timing them
+    for (unsigned i = 0; i < names.num(); i++) {
+        const char* name = names.get(i).name();
+        if (nameindex.find(name) != (int)nameindex.nameMap()[name] ||
+            nameindex.find("field", name+5) != (int)i) {
+            printf("*** lookup mismatch for %s\n", name);
+            abort();
+        }
+    }
+    if (nameindex.find("nosuchfield") != -1) {
+        printf("*** lookup of a missing name succeeded\n");
+        abort();
+    }
+
+    // Each lookup's inputs are hidden from the compiler and its result is
+    // consumed, so that none can be hoisted out of the loops or dropped
+    const char* name = names.get(names.num() / 2).name();
+    IndexMap* nameMap = &nameindex.nameMap();
+    NameIndex* index = &nameindex;
+    uint64_t sum = 0;
+    auto t0 = std::chrono::steady_clock::now();
+    for (unsigned n = 0; n < iterations; n++) {
+        opaque(nameMap);
+        sink(nameMap->find(name)->second);
+    }
+    auto t1 = std::chrono::steady_clock::now();
+    for (unsigned n = 0; n < iterations; n++) {
+        opaque(index);
+        sink(index->find(name));
+    }
+    auto t2 = std::chrono::steady_clock::now();
+    static constexpr NameKey key("field1");
+    for (unsigned n = 0; n < iterations; n++) {
+        opaque(index);
+        sink(index->find(key));
+    }
+    auto t3 = std::chrono::steady_clock::now();
+    sum = index->find(key) + index->find(name);
+
+    double tMap  = std::chrono::duration<double, std::nano>(t1 - t0).count() / iterations;
+    double tHash = std::chrono::duration<double, std::nano>(t2 - t1).count() / iterations;
+    double tKey  = std::chrono::duration<double, std::nano>(t3 - t2).count() / iterations;
+    printf("%3u names: nameMap %6.1f ns  hash %6.1f ns  constexpr key %6.1f ns  (%lu)\n",
+           nScalars, tMap, tHash, tKey, (unsigned long)(sum & 1));
+    delete[] buf;
+}
+
+void usage(char* progname)
+{
+    fprintf(stderr, "Usage: %s [-n <iterations>] [-h]\n", progname);
+}
+
+int main(int argc, char* argv[])
+{
+    int c;
+    unsigned iterations = 1000000;
+
+    while ((c = getopt(argc, argv, "hn:")) != -1) {
+        switch (c) {
+        case 'h':
+            usage(argv[0]);
+            exit(0);
+        case 'n':
+            iterations = atoi(optarg);
+            break;
+        default:
+            usage(argv[0]);
+            exit(2);
+        }
+    }
+
+    bench(  4,  0, iterations);
+    bench( 16,  0, iterations);
+    bench( 64,  0, iterations);
+    bench( 16,  2, iterations);
+    bench( 64,  8, iterations);
+    bench(128, 32, iterations);
+    benchLookup(  8, iterations);
+    benchLookup( 64, iterations);
+    benchLookup(160, iterations);
+    return 0;
+}
@@ -12,7 +12,7 @@ using namespace XtcData;
 
 void usage(char* progname)
 {
-    fprintf(stderr, "Usage: %s -i <xtc filename> -o <xtc filename> [-h]\n", progname);
+    fprintf(stderr, "Usage: %s -i <xtc filename> -o <xtc filename> [-M] [-h]\n", progname);
 }
 
 void writedgram(Dgram* dg, unsigned& count, FILE* outFile) {
@@ -34,8 +34,9 @@ int main(int argc, char* argv[])
     char* inname = 0;
     unsigned nevents = 0;
     int parseErr = 0;
+    bool useMmap = false;
 
-    while ((c = getopt(argc, argv, "hi:o:")) != -1) {
+    while ((c = getopt(argc, argv, "hi:o:M")) != -1) {
         switch (c) {
         case 'h':
             usage(argv[0]);
@@ -46,6 +47,9 @@ int main(int argc, char* argv[])
         case 'o':
             outname = optarg;
             break;
+        case 'M':
+            useMmap = true;
+            break;
         default:
             parseErr++;
         }
@@ -66,7 +70,7 @@ int main(int argc, char* argv[])
         exit(2);
     }
 
-    XtcFileIterator iter(fd, 0x4000000);
+    XtcFileIterator iter(fd, 0x4000000, useMmap);
     Dgram* dg;
     bool configDone = false;
     bool bigDone = false;
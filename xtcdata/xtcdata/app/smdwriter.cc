@@ -264,13 +264,14 @@ int main(int argc, char* argv[])
     int parseErr = 0;
     size_t n_events = 0;
     int n_mod = 0;
+    bool useMmap = false;
     char outname[MAX_FNAME_LEN];
     strncpy(outname, "smd.xtc2", MAX_FNAME_LEN);
     auto usage = [](const char* progname) {
-        fprintf(stderr, "Usage: %s -f <filename> [-h]\n", progname);
+        fprintf(stderr, "Usage: %s -f <filename> [-M] [-h]\n", progname);
     };
 
-    while ((c = getopt(argc, argv, "ht:n:m:f:o:")) != -1) {
+    while ((c = getopt(argc, argv, "ht:n:m:f:o:M")) != -1) {
     switch (c) {
       case 'h':
         usage(argv[0]);
@@ -291,6 +292,9 @@ int main(int argc, char* argv[])
       case 'o':
         strncpy(outname, optarg, MAX_FNAME_LEN);
         break;
+      case 'M':
+        useMmap = true;
+        break;
       default:
         parseErr++;
     }
@@ -309,7 +313,7 @@ int main(int argc, char* argv[])
     exit(2);
     }
 
-    XtcFileIterator iter(fd, BUFSIZE);
+    XtcFileIterator iter(fd, BUFSIZE, useMmap);
     Dgram* dgIn;
 
     // Prepare output smd.xtc2 file
@@ -0,0 +1,112 @@
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <unistd.h>
+#include <cinttypes>
+
+#include "xtcdata/xtc/XtcFileIterator.hh"
+#include "xtcdata/xtc/XtcIndex.hh"
+
+using namespace XtcData;
+using std::string;
+
+//
+// Builds the sidecar index of an xtc2 file, or uses an existing index to
+// look up datagrams by event number or by timestamp
+//
+
+static void show(const char* what, Dgram* dg)
+{
+    if (!dg) {
+        printf("%s: not found\n", what);
+        return;
+    }
+    printf("%s: %s transition: time 0x%8.8x.0x%8.8x, env 0x%08x, payloadSize %d\n",
+           what, TransitionId::name(dg->service()), dg->time.seconds(),
+           dg->time.nanoseconds(), dg->env, dg->xtc.sizeofPayload());
+}
+
+void usage(char* progname)
+{
+    fprintf(stderr, "Usage: %s -f <filename> [-o <index filename>] [-e <event>] [-t <sec.nsec>] [-h]\n"
+                    "  Without -e or -t the index is built and written to <filename>.idx or -o\n", progname);
+}
+
+int main(int argc, char* argv[])
+{
+    int c;
+    string xtcname;
+    string idxname;
+    int parseErr = 0;
+    long event = -1;
+    const char* timestr = 0;
+
+    while ((c = getopt(argc, argv, "hf:o:e:t:")) != -1) {
+        switch (c) {
+        case 'h':
+            usage(argv[0]);
+            exit(0);
+        case 'f':
+            xtcname = optarg;
+            break;
+        case 'o':
+            idxname = optarg;
+            break;
+        case 'e':
+            event = atol(optarg);
+            break;
+        case 't':
+            timestr = optarg;
+            break;
+        default:
+            parseErr++;
+        }
+    }
+
+    if (xtcname.empty() || parseErr) {
+        usage(argv[0]);
+        exit(2);
+    }
+    if (idxname.empty()) idxname = XtcIndex::sidecarName(xtcname);
+
+    int fd = open(xtcname.c_str(), O_RDONLY);
+    if (fd < 0) {
+        fprintf(stderr, "Unable to open file '%s'\n", xtcname.c_str());
+        exit(2);
+    }
+
+    if (event < 0 && !timestr) {
+        XtcIndexWriter writer;
+        if (writer.open(idxname)) exit(2);
+        XtcFileIterator iter(fd, 0x4000000, true);
+        uint64_t offset = 0;
+        unsigned ndg = 0;
+        Dgram* dg;
+        while ((dg = iter.next())) {
+            writer.add(*dg, offset);
+            offset += sizeof(*dg) + dg->xtc.sizeofPayload();
+            ndg++;
+        }
+        writer.close();
+        printf("Indexed %u datagrams (%" PRIu64 " bytes) into '%s'\n", ndg, offset, idxname.c_str());
+    } else {
+        XtcIndexedReader reader(fd, 0x4000000);
+        if (reader.loadIndex(idxname)) {
+            printf("No index '%s', scanning the file\n", idxname.c_str());
+            reader.buildIndex();
+        }
+        printf("%zu datagrams, %zu events\n", reader.numEntries(), reader.numEvents());
+        if (event >= 0) {
+            show("event", reader.event(event));
+        }
+        if (timestr) {
+            unsigned sec = 0, nsec = 0;
+            sscanf(timestr, "%u.%u", &sec, &nsec);
+            show("time", reader.find(TimeStamp(sec, nsec)));
+        }
+    }
+
+    ::close(fd);
+    return 0;
+}
@@ -0,0 +1,103 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+#include "xtcdata/xtc/XtcMultiFileReader.hh"
+
+using namespace XtcData;
+using std::string;
+
+//
+// Builds the events of a run offline by merging the xtc2 files of all its
+// DRPs (and their chunks) on the datagram timestamps
+//
+
+void usage(char* progname)
+{
+    fprintf(stderr, "Usage: %s [-o <output filename>] [-j <threads>] [-r <read ahead>] [-M] [-v] [-h] <filename>...\n"
+                    "  Chunks of a stream (<name>-cNNN.xtc2) are read in sequence\n", progname);
+}
+
+int main(int argc, char* argv[])
+{
+    int c;
+    const char* outname = 0;
+    unsigned nThreads = 4;
+    unsigned readAhead = 64;
+    bool useMmap = false;
+    bool verbose = false;
+    int parseErr = 0;
+
+    while ((c = getopt(argc, argv, "ho:j:r:Mv")) != -1) {
+        switch (c) {
+        case 'h':
+            usage(argv[0]);
+            exit(0);
+        case 'o':
+            outname = optarg;
+            break;
+        case 'j':
+            nThreads = atoi(optarg);
+            break;
+        case 'r':
+            readAhead = atoi(optarg);
+            break;
+        case 'M':
+            useMmap = true;
+            break;
+        case 'v':
+            verbose = true;
+            break;
+        default:
+            parseErr++;
+        }
+    }
+
+    std::vector<string> files(argv+optind, argv+argc);
+    if (files.empty() || parseErr) {
+        usage(argv[0]);
+        exit(2);
+    }
+
+    FILE* out = 0;
+    if (outname) {
+        out = fopen(outname, "w");
+        if (!out) {
+            fprintf(stderr, "Unable to open file '%s'\n", outname);
+            exit(2);
+        }
+    }
+
+    std::vector<XtcMultiFileReader::Chunks> streams = XtcMultiFileReader::streams(files);
+    for (unsigned i = 0; i < streams.size(); i++) {
+        printf("stream %u: %s (%zu chunks)\n", i, streams[i][0].c_str(), streams[i].size());
+    }
+
+    unsigned long nEvents[TransitionId::NumberOf] = {};
+    unsigned long nPartial = 0;
+    XtcMultiFileReader reader(streams, 0x4000000, nThreads, readAhead, useMmap);
+    Dgram* dg;
+    while ((dg = reader.next())) {
+        nEvents[dg->service()]++;
+        bool partial = reader.contributors().size() != reader.nStreams();
+        if (partial)  nPartial++;
+        if (verbose) {
+            printf("%s transition: time 0x%8.8x.0x%8.8x, env 0x%08x, payloadSize %d, %zu contributions\n",
+                   TransitionId::name(dg->service()), dg->time.seconds(), dg->time.nanoseconds(),
+                   dg->env, dg->xtc.sizeofPayload(), reader.contributors().size());
+        }
+        if (out && fwrite(dg, sizeof(*dg) + dg->xtc.sizeofPayload(), 1, out) != 1) {
+            fprintf(stderr, "Error writing to output file '%s'\n", outname);
+            exit(1);
+        }
+    }
+    if (out)  fclose(out);
+
+    for (unsigned i = 0; i < TransitionId::NumberOf; i++) {
+        if (nEvents[i])  printf("%-16s %lu\n", TransitionId::name(TransitionId::Value(i)), nEvents[i]);
+    }
+    printf("%lu datagrams lacked contributions from some streams\n", nPartial);
+    return 0;
+}
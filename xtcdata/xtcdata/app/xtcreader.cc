@@ -237,7 +237,7 @@ private:
 
 void usage(char* progname)
 {
-    fprintf(stderr, "Usage: %s -f <filename> [-d] [-n <nEvents>] [-w <nWords>] [-h]\n", progname);
+    fprintf(stderr, "Usage: %s -f <filename> [-d] [-n <nEvents>] [-w <nWords>] [-M] [-h]\n", progname);
 }
 
 int main(int argc, char* argv[])
@@ -250,8 +250,9 @@ int main(int argc, char* argv[])
     bool debugprint = false;
     unsigned numWords = 3;
     bool printTimeAsUnsignedLong = false;
+    bool useMmap = false;
 
-    while ((c = getopt(argc, argv, "hf:n:dw:c:T")) != -1) {
+    while ((c = getopt(argc, argv, "hf:n:dw:c:TM")) != -1) {
         switch (c) {
         case 'h':
             usage(argv[0]);
@@ -274,6 +275,9 @@ int main(int argc, char* argv[])
         case 'T':
             printTimeAsUnsignedLong = true;
             break;
+        case 'M':
+            useMmap = true;
+            break;
         default:
             parseErr++;
         }
@@ -314,11 +318,11 @@ int main(int argc, char* argv[])
 
     }
 
-    XtcFileIterator iter(fd, 0x4000000);
+    XtcFileIterator iter(fd, 0x4000000, useMmap);
     unsigned nevent=0;
     dg = iter.next();
-    const void* bufEnd = ((char*)dg) + 0x4000000;
     while (dg) {
+        const void* bufEnd = ((char*)dg) + iter.size();
         if (nevent>=neventreq) break;
         nevent++;
         printf("event %d, %11s transition: ",
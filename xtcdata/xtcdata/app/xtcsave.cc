@@ -11,7 +11,7 @@ using namespace XtcData;
 
 void usage(char* progname)
 {
-    fprintf(stderr, "Usage: %s -i <xtc filename> -o <xtc filename> -n nevents [-h]\n", progname);
+    fprintf(stderr, "Usage: %s -i <xtc filename> -o <xtc filename> -n nevents [-M] [-h]\n", progname);
 }
 
 int main(int argc, char* argv[])
@@ -21,8 +21,9 @@ int main(int argc, char* argv[])
     char* inname = 0;
     unsigned nevents = 0;
     int parseErr = 0;
+    bool useMmap = false;
 
-    while ((c = getopt(argc, argv, "hi:o:n:")) != -1) {
+    while ((c = getopt(argc, argv, "hi:o:n:M")) != -1) {
         switch (c) {
         case 'h':
             usage(argv[0]);
@@ -36,6 +37,9 @@ int main(int argc, char* argv[])
         case 'n':
             nevents = atoi(optarg);
             break;
+        case 'M':
+            useMmap = true;
+            break;
         default:
             parseErr++;
         }
@@ -55,7 +59,7 @@ int main(int argc, char* argv[])
     }
     printf("fd: %d\n", fd);
 
-    XtcFileIterator iter(fd, 0x4000000);
+    XtcFileIterator iter(fd, 0x4000000, useMmap);
     Dgram* dg;
     for (unsigned i = 0; i < nevents; i++) {
         dg = iter.next();
@@ -0,0 +1,206 @@
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <cinttypes>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "xtcdata/xtc/Dgram.hh"
+#include "xtcdata/xtc/XtcIterator.hh"
+
+using namespace XtcData;
+
+//
+// Scans an xtc2 file and reports corrupt datagrams instead of aborting.
+// Datagrams whose header is not plausible are skipped by resynchronising
+// on the next plausible header; datagrams whose header is sound but whose
+// contents are corrupt are reported with the offending xtc.  With -o the
+// salvaged datagrams are written to a new file, those with corrupt contents
+// being marked with the Corrupted damage so that readers skip them.
+//
+
+class XtcValidator : public XtcIterator
+{
+public:
+    enum { Stop, Continue };
+    XtcValidator() : XtcIterator() { validate(true); }
+
+    int process(Xtc* xtc, const void* bufEnd)
+    {
+        switch (xtc->contains.id()) {
+        case (TypeId::Parent):
+        case (TypeId::ShapesData): {
+            iterate(xtc, bufEnd);
+            break;
+        }
+        default:
+            break;
+        }
+        return Continue;
+    }
+};
+
+static size_t maxDgramSize = 0x4000000;
+// transitions more than this far from the last good one are not plausible
+// when resynchronising
+static const unsigned MaxTimeJump = 24*3600;
+
+static bool plausible(const Dgram* dg, size_t avail)
+{
+    if (avail < sizeof(Dgram)) return false;
+    TransitionId::Value tid = dg->service();
+    if (tid >= TransitionId::NumberOf || tid == TransitionId::Unused_11) return false;
+    if (dg->xtc.contains.id() != TypeId::Parent) return false;
+    if (dg->xtc.extent < sizeof(Xtc)) return false;
+    size_t size = sizeof(*dg) + dg->xtc.sizeofPayload();
+    return size <= maxDgramSize && size <= avail;
+}
+
+// A candidate found while resynchronising must also be followed by a
+// plausible header, or by the end of the file, and be close in time to
+// the last good datagram
+static bool plausibleResync(const char* p, size_t avail, const TimeStamp& lastTime)
+{
+    const Dgram* dg = (const Dgram*)p;
+    if (!plausible(dg, avail)) return false;
+    if (!lastTime.isZero()) {
+        unsigned sec = dg->time.seconds();
+        unsigned last = lastTime.seconds();
+        if ((sec > last ? sec - last : last - sec) > MaxTimeJump) return false;
+    }
+    size_t size = sizeof(*dg) + dg->xtc.sizeofPayload();
+    return size == avail || plausible((const Dgram*)(p + size), avail - size);
+}
+
+void usage(char* progname)
+{
+    fprintf(stderr, "Usage: %s -f <filename> [-o <salvaged filename>] [-m <maxDgramSize>] [-q] [-h]\n", progname);
+}
+
+int main(int argc, char* argv[])
+{
+    int c;
+    char* xtcname = 0;
+    char* outname = 0;
+    bool quiet = false;
+    int parseErr = 0;
+
+    while ((c = getopt(argc, argv, "hf:o:m:q")) != -1) {
+        switch (c) {
+        case 'h':
+            usage(argv[0]);
+            exit(0);
+        case 'f':
+            xtcname = optarg;
+            break;
+        case 'o':
+            outname = optarg;
+            break;
+        case 'm':
+            maxDgramSize = strtoul(optarg, NULL, 0);
+            break;
+        case 'q':
+            quiet = true;
+            break;
+        default:
+            parseErr++;
+        }
+    }
+
+    if (!xtcname || parseErr) {
+        usage(argv[0]);
+        exit(2);
+    }
+
+    int fd = open(xtcname, O_RDONLY);
+    if (fd < 0) {
+        fprintf(stderr, "Unable to open file '%s'\n", xtcname);
+        exit(2);
+    }
+    struct stat st;
+    if (fstat(fd, &st) || st.st_size == 0) {
+        fprintf(stderr, "Unable to stat file '%s' or file empty\n", xtcname);
+        exit(2);
+    }
+    size_t fileSize = st.st_size;
+    // private and writable so that salvaged datagrams can be marked, without
+    // reserving swap for the whole file, of which few pages are ever written
+    char* map = (char*)mmap(0, fileSize, PROT_READ | PROT_WRITE,
+                            MAP_PRIVATE | MAP_NORESERVE, fd, 0);
+    if (map == MAP_FAILED) {
+        perror("mmap");
+        exit(2);
+    }
+    madvise(map, fileSize, MADV_SEQUENTIAL);
+
+    FILE* outFile = 0;
+    if (outname) {
+        outFile = fopen(outname, "w");
+        if (!outFile) {
+            fprintf(stderr, "Unable to open output file '%s'\n", outname);
+            exit(2);
+        }
+    }
+
+    XtcValidator validator;
+    TimeStamp lastTime(0, 0);
+    uint64_t ngood = 0, ncorrupt = 0, nresync = 0, skipped = 0;
+    size_t offset = 0;
+
+    while (offset < fileSize) {
+        Dgram* dg = (Dgram*)(map + offset);
+        size_t avail = fileSize - offset;
+        if (!plausible(dg, avail)) {
+            // resynchronise on the next plausible header, datagrams are
+            // 4-byte aligned in the file
+            size_t next = offset + 4;
+            while (next + sizeof(Dgram) <= fileSize &&
+                   !plausibleResync(map + next, fileSize - next, lastTime)) next += 4;
+            if (next + sizeof(Dgram) > fileSize) next = fileSize;
+            printf("offset 0x%zx: bad datagram header, skipped %zu bytes\n", offset, next - offset);
+            skipped += next - offset;
+            nresync++;
+            offset = next;
+            continue;
+        }
+
+        size_t size = sizeof(*dg) + dg->xtc.sizeofPayload();
+        validator.clearErrors();
+        validator.iterate(&dg->xtc, (char*)dg + size);
+        const std::vector<XtcError>& errors = validator.errors();
+        if (errors.empty()) {
+            ngood++;
+            lastTime = dg->time;
+            if (!quiet) {
+                printf("offset 0x%zx: %s transition: time %d.%09d, extent %d\n",
+                       offset, TransitionId::name(dg->service()),
+                       dg->time.seconds(), dg->time.nanoseconds(), dg->xtc.extent);
+            }
+        } else {
+            ncorrupt++;
+            size_t xtcOffset = offset + ((char*)&dg->xtc - (char*)dg);
+            for (const XtcError& err : errors) {
+                printf("offset 0x%zx: %s transition: corrupt xtc at offset 0x%zx, depth %u, extent %u: %s\n",
+                       offset, TransitionId::name(dg->service()),
+                       xtcOffset + err.offset, err.depth, err.extent, XtcError::name(err.reason));
+            }
+            dg->xtc.damage.increase(Damage::Corrupted);
+        }
+        if (outFile && fwrite(dg, size, 1, outFile) != 1) {
+            printf("Error writing to output xtc file.\n");
+            exit(2);
+        }
+        offset += size;
+    }
+
+    printf("%" PRIu64 " good datagrams, %" PRIu64 " with corrupt contents, "
+           "%" PRIu64 " resynchronisations skipping %" PRIu64 " bytes\n",
+           ngood, ncorrupt, nresync, skipped);
+
+    if (outFile) fclose(outFile);
+    munmap(map, fileSize);
+    ::close(fd);
+    return (ncorrupt || nresync) ? 1 : 0;
+}
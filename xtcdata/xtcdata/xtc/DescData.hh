@@ -29,28 +29,27 @@ class DescData {
 public:
     // reading an existing ShapesData
     DescData(ShapesData& shapesdata, NameIndex& nameindex) :
-        _offset(nameindex.names().num()+1),
         _shapesdata(shapesdata),
         _nameindex(nameindex),
-        _numarrays(0)
+        _numarrays(0),
+        _layout(nameindex.layout())
     {
         Names& names = _nameindex.names();
-        _unused(names);
-        _offset[0]=0;
         _numentries = names.num();
-        unsigned shapeIndex = 0;
-        for (unsigned i=0; i<_numentries-1; i++) {
-            Name& name = names.get(i);
-            if (name.rank()==0) _offset[i+1]=_offset[i]+Name::get_element_size(name.type());
-            else {
-                // Since we are enforcing consecutive shapes, there's no need for this map lookup
-                //unsigned shapeIndex = _nameindex.shapeMap()[name.name()];
-                unsigned size = _shapesdata.shapes().get(shapeIndex).size(name);
-                _offset[i+1]=_offset[i]+size;
-                _numarrays++;
-                shapeIndex++;
+        // the scalar part of the offsets is precomputed in the NameIndex:
+        // only the sizes of the arrays that precede the last entry, which
+        // depend on this event's shapes, remain to be summed up
+        unsigned numarrays = _numentries ? _layout[_numentries-1].arrayIndex : 0;
+        unsigned* arrayOffset = _initArrayOffset(numarrays);
+        if (numarrays) {
+            // Since we are enforcing consecutive shapes, there's no need for a map lookup
+            Shapes& shapes = _shapesdata.shapes();
+            const unsigned* arrayNames = _nameindex.arrayNames();
+            for (unsigned k=0; k<numarrays; k++) {
+                arrayOffset[k+1]=arrayOffset[k]+shapes.get(k).size(names.get(arrayNames[k]));
             }
         }
+        _numarrays = numarrays;
     }
 
     ~DescData() {}
@@ -122,9 +121,9 @@ public:
     Array<T> get_array(unsigned index)
     {
         Name& name = _nameindex.names().get(index);
-        uint32_t *shape = this->shape(name);
+        uint32_t *shape = this->shape(index);
         Data& data = _shapesdata.data();
-        T* ptr = reinterpret_cast<T*>(data.payload() + _offset[index]);
+        T* ptr = reinterpret_cast<T*>(data.payload() + _offsetOf(index));
 
         // Create an Array<T> struct at the memory address of ptr
         Array<T> arrT(ptr, shape, name.rank());
@@ -132,18 +131,37 @@ public:
     };
 
     // a slower interface to access some data, because
-    // it looks it up in the nameMap.
+    // it looks the name up in the NameIndex hash table.
+    // Prefer resolving the index once with NameIndex::find().
+    template <class T>
+    T get_value(const NameKey& key)
+    {
+        int index = _nameindex.find(key);
+        if (index < 0) {
+            printf("*** %s:%d: failed to find name %s\n",__FILE__,__LINE__,key.name);
+            abort();
+        }
+
+        return get_value<T>(unsigned(index));
+    }
+
     template <class T>
     T get_value(const char* name)
     {
-        IndexMap& nameMap = _nameindex.nameMap();
-        if (nameMap.find(name) == nameMap.end()) {
-            printf("*** %s:%d: failed to find name %s\n",__FILE__,__LINE__,name);
+        return get_value<T>(NameKey(name));
+    }
+
+    // look up the field named by the concatenation of prefix and suffix
+    template <class T>
+    T get_value(const char* prefix, const char* suffix)
+    {
+        int index = _nameindex.find(prefix, suffix);
+        if (index < 0) {
+            printf("*** %s:%d: failed to find name %s%s\n",__FILE__,__LINE__,prefix,suffix);
             abort();
         }
-        unsigned index = nameMap[name];
 
-        return get_value<T>(index);
+        return get_value<T>(unsigned(index));
     }
 
     template <class T>
@@ -156,20 +174,29 @@ public:
         Data& data = _shapesdata.data();
         Name& name = _nameindex.names().get(index);
 
-        T val = *reinterpret_cast<T*>(data.payload() + _offset[index]);
+        T val = *reinterpret_cast<T*>(data.payload() + _offsetOf(index));
         checkType(val, name);
         return val;
     }
 
     // void* address(unsigned index) {
     //     Data& data = _shapesdata.data();
-    //     return data.payload() + _offset[index];
+    //     return data.payload() + _offsetOf(index);
     // }
 
-    uint32_t* shape(Name& name) {
+    uint32_t* shape(unsigned index) {
         Shapes& shapes = _shapesdata.shapes();
-        unsigned shapeIndex = _nameindex.shapeMap()[name.name()];
-        return shapes.get(shapeIndex).shape();
+        return shapes.get(_layout[index].arrayIndex).shape();
+    }
+
+    uint32_t* shape(Name& name) {
+        // names handed out by our NameIndex map directly to their index
+        Names& names = _nameindex.names();
+        Name* first = &names.get(0);
+        if (&name >= first && &name < first+names.num()) return shape(unsigned(&name-first));
+        int index = _nameindex.find(name.name());
+        if (index < 0) return _shapesdata.shapes().get(_nameindex.shapeMap()[name.name()]).shape();
+        return shape(unsigned(index));
     }
 
     NameIndex&  nameindex()  {return _nameindex;}
@@ -178,26 +205,24 @@ public:
 protected:
     // creating a new ShapesData to be filled in
     DescData(NameIndex& nameindex, Xtc& parent, const void* bufEnd, NamesId& namesId) :
-        _offset(nameindex.names().num()+1),
         _shapesdata(*new (parent, bufEnd) ShapesData(namesId)),
         _nameindex(nameindex),
-        _numarrays(0)
+        _numarrays(0),
+        _layout(nameindex.layout())
     {
         Names& names = _nameindex.names();
-        _unused(names);
-        _offset[0]=0;
+        _initArrayOffset(names.numArrays());
         _numentries=0;
     }
 
     DescData(NameIndex& nameindex, Xtc& parent, const void* bufEnd, VarDef& V, NamesId& namesId) :
-        _offset(nameindex.names().num()+1),
         _shapesdata(*new (parent, bufEnd) ShapesData(namesId)),
         _nameindex(nameindex),
-        _numarrays(0)
+        _numarrays(0),
+        _layout(nameindex.layout())
     {
         Names& names = _nameindex.names();
-        _unused(names);
-        _offset[0]=0;
+        _initArrayOffset(names.numArrays());
         _numentries=0;
     }
     void set_array_shape(unsigned index, unsigned shapeIndex, const unsigned shape[MaxRank]) {
@@ -221,11 +246,33 @@ protected:
     }
 
 
-    std::vector<unsigned> _offset;
+    // the running sum of the array sizes lives in _arrayOffsetBuf, unless
+    // there are too many arrays, to avoid a heap allocation per event
+    enum { MaxInlineArrays = 16 };
+    unsigned* _initArrayOffset(unsigned numarrays) {
+        unsigned* arrayOffset = _arrayOffsetBuf;
+        if (numarrays > MaxInlineArrays) {
+            _arrayOffsetVec.resize(numarrays+1);
+            arrayOffset = _arrayOffsetVec.data();
+        }
+        arrayOffset[0]=0;
+        return arrayOffset;
+    }
+    unsigned* _arrayOffset() {
+        return _arrayOffsetVec.empty() ? _arrayOffsetBuf : _arrayOffsetVec.data();
+    }
+    unsigned _offsetOf(unsigned index) {
+        const NameLayout& layout = _layout[index];
+        return layout.scalarOffset + _arrayOffset()[layout.arrayIndex];
+    }
+
     ShapesData& _shapesdata;
     unsigned    _numentries;
     NameIndex&  _nameindex;
     unsigned    _numarrays;
+    const NameLayout* _layout;
+    unsigned    _arrayOffsetBuf[MaxInlineArrays+1];
+    std::vector<unsigned> _arrayOffsetVec;
 };
 
 class DescribedData : public DescData {
@@ -340,11 +387,10 @@ public:
         Name& name = _nameindex.names().get(index);
 
         checkType(val, name);
-        T* ptr = reinterpret_cast<T*>(data.payload() + _offset[index]);
+        T* ptr = reinterpret_cast<T*>(data.payload() + _offsetOf(index));
         *ptr = val;
         data.alloc(sizeof(T), _shapesdata, _parent, _bufEnd);
         _numentries++;
-        _offset[_numentries]=_offset[_numentries-1]+Name::get_element_size(name.type());
     }
 
     void* get_ptr()
@@ -364,10 +410,28 @@ public:
         Names& names = _nameindex.names();
         Name& namecl = names.get(index);
         unsigned size = _shapesdata.shapes().get(shapeIndex).size(namecl);
-        _offset[_numentries]=_offset[_numentries-1]+size;
+        unsigned* arrayOffset = _arrayOffset();
+        arrayOffset[shapeIndex+1]=arrayOffset[shapeIndex]+size;
         _shapesdata.data().alloc(size,_shapesdata,_parent,_bufEnd);
     }
 
+protected:
+    // allocates the first num entries, all scalars taking size bytes, in
+    // one go and returns where they start (used by TypedCreateData)
+    void* alloc_scalars(unsigned num, unsigned size)
+    {
+        if (_numentries || num > _nameindex.names().num() ||
+            _layout[num].arrayIndex || _layout[num].scalarOffset != size) {
+            printf("*** %s:%d: %d scalars of %d bytes do not match the names\n",__FILE__,__LINE__,num,size);
+            abort();
+        }
+        Data& data = _shapesdata.data();
+        void* ptr = data.payload();
+        data.alloc(size, _shapesdata, _parent, _bufEnd);
+        _numentries = num;
+        return ptr;
+    }
+
 private:
     Xtc&        _parent;
     const void* _bufEnd;
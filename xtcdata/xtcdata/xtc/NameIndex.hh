@@ -4,12 +4,40 @@
 #include "xtcdata/xtc/ShapesData.hh"
 
 #include <map>
+#include <string.h>
+#include <vector>
 
 typedef std::map<std::string, unsigned> IndexMap;
 
 namespace XtcData
 {
 
+// Precomputed layout of the data described by a Names.  For each entry
+// it holds the bytes taken by the scalars that precede it and the number
+// of arrays that precede it, so the offset of an entry in the data is the
+// scalar part plus the sizes of the preceding arrays, which are the only
+// part that depends on the shapes of a given event.
+class NameLayout {
+public:
+    unsigned scalarOffset;
+    unsigned arrayIndex;
+};
+
+// A field name together with its FNV-1a hash.  The constructor is
+// constexpr, so keys for names known at compile time are hashed by the
+// compiler, e.g.
+//     static constexpr XtcData::NameKey x0Key("fex.sig.roi.x0");
+class NameKey {
+public:
+    constexpr NameKey(const char* name_) : name(name_), hash(hashOf(name_)) {}
+    static constexpr uint32_t hashOf(const char* s, uint32_t h = 2166136261u) {
+        return *s ? hashOf(s+1, (h ^ uint8_t(*s)) * 16777619u) : h;
+    }
+public:
+    const char* name;
+    uint32_t    hash;
+};
+
 class NameIndex {
 public:
     // default constructor, used by NamesLookup std::map for keys
@@ -27,6 +55,8 @@ public:
                 iarray++;
             }
         }
+        _init_layout();
+        _init_hash();
     }
     NameIndex(const NameIndex& old) {
         if (old._names) {
@@ -36,6 +66,10 @@ public:
         }
         _shapeMap = old._shapeMap;
         _nameMap = old._nameMap;
+        _layout = old._layout;
+        _arrayNames = old._arrayNames;
+        _hashes = old._hashes;
+        _hashTable = old._hashTable;
     }
     NameIndex& operator=(const NameIndex& rhs) {
         if (_names) free(_names);
@@ -47,6 +81,10 @@ public:
         }
         _shapeMap = rhs._shapeMap;
         _nameMap = rhs._nameMap;
+        _layout = rhs._layout;
+        _arrayNames = rhs._arrayNames;
+        _hashes = rhs._hashes;
+        _hashTable = rhs._hashTable;
         return *this;
     }
     ~NameIndex() {if (_names) free(_names);}
@@ -78,7 +116,69 @@ public:
         return *_names;
     }
     bool      exists()   {return _names!=0;}
+    // one entry per Name plus one for the end of the data
+    const NameLayout* layout()     const {return _layout.data();}
+    // the Name index of each array, in shape order
+    const unsigned*   arrayNames() const {return _arrayNames.data();}
+
+    // Allocation-free alternatives to nameMap(): return the index of the
+    // named field, which stays valid for the lifetime of the Names, or -1
+    // if there is no such field.  The two-argument form looks up the
+    // concatenation of prefix and suffix without building it.
+    int find(const NameKey& key) {
+        if (_hashTable.empty()) return -1;
+        unsigned mask = _hashTable.size()-1;
+        for (unsigned slot = key.hash & mask; _hashTable[slot]; slot = (slot+1) & mask) {
+            unsigned i = _hashTable[slot]-1;
+            if (_hashes[i]==key.hash && strcmp(_names->get(i).name(), key.name)==0) return i;
+        }
+        return -1;
+    }
+    int find(const char* prefix, const char* suffix) {
+        if (_hashTable.empty()) return -1;
+        uint32_t hash = NameKey::hashOf(suffix, NameKey::hashOf(prefix));
+        size_t len = strlen(prefix);
+        unsigned mask = _hashTable.size()-1;
+        for (unsigned slot = hash & mask; _hashTable[slot]; slot = (slot+1) & mask) {
+            unsigned i = _hashTable[slot]-1;
+            const char* name = _names->get(i).name();
+            if (_hashes[i]==hash && strncmp(name, prefix, len)==0 && strcmp(name+len, suffix)==0) return i;
+        }
+        return -1;
+    }
 private:
+    // open-addressing table, at most half full, holding Name index + 1
+    void _init_hash() {
+        unsigned num = _names->num();
+        unsigned size = 2;
+        while (size < 2*num) size <<= 1;
+        _hashTable.assign(size, 0);
+        _hashes.resize(num);
+        for (unsigned i=0; i<num; i++) {
+            const char* name = _names->get(i).name();
+            _hashes[i] = NameKey::hashOf(name);
+            unsigned slot = _hashes[i] & (size-1);
+            // as with nameMap, a repeated name refers to its last occurrence
+            while (_hashTable[slot] && strcmp(_names->get(_hashTable[slot]-1).name(), name)!=0)
+                slot = (slot+1) & (size-1);
+            _hashTable[slot] = i+1;
+        }
+    }
+    void _init_layout() {
+        unsigned num = _names->num();
+        _layout.resize(num+1);
+        _arrayNames.clear();
+        unsigned scalarOffset = 0;
+        for (unsigned i=0; i<num; i++) {
+            _layout[i].scalarOffset = scalarOffset;
+            _layout[i].arrayIndex   = _arrayNames.size();
+            Name& name = _names->get(i);
+            if (name.rank()==0) scalarOffset += Name::get_element_size(name.type());
+            else                _arrayNames.push_back(i);
+        }
+        _layout[num].scalarOffset = scalarOffset;
+        _layout[num].arrayIndex   = _arrayNames.size();
+    }
     void _init_names(Names& names) {
         _names = (Names*)malloc(names.extent);
         std::memcpy((void*)_names, (const void*)&names, names.extent);
@@ -86,6 +186,10 @@ private:
     Names*   _names;
     IndexMap _shapeMap;
     IndexMap _nameMap;
+    std::vector<NameLayout> _layout;
+    std::vector<unsigned>   _arrayNames;
+    std::vector<uint32_t>   _hashes;
+    std::vector<uint32_t>   _hashTable;
 };
 
 }
@@ -4,7 +4,10 @@
 #include "xtcdata/xtc/NameIndex.hh"
 #include "xtcdata/xtc/NamesId.hh"
 
-#include <unordered_map>
+#include <memory>
+#include <unordered_map>      // still provided to users of this header
+#include <utility>
+#include <vector>
 
 namespace XtcData{
 
@@ -13,11 +16,117 @@ namespace XtcData{
 // ShapesData xtc that shows up every event. The Names and ShapesData
 // xtc's each get a unique identifier that can be used to associate
 // the two (the NamesId class which is put in the xtc Src field).
-// This identifier is used as a key in the map below.  An earlier
-// implementation was done with std::vector, to avoid the map key
-// search, but used alot of memory (see NamesId::NumberOf)
+// This identifier is used as a key in the lookup below.  An earlier
+// implementation was done with a flat std::vector, to avoid the map key
+// search, but used alot of memory (see NamesId::NumberOf), and a later
+// one with std::unordered_map.  This one is a two-level table: a page of
+// NamesPerNode slots is allocated only for the nodeIds actually seen, so
+// a lookup is two array indexes with no hashing while the memory stays
+// proportional to the number of nodes.  The interface is the subset of
+// std::unordered_map that the code uses; entries are never moved once
+// created, so references to them stay valid, and iteration is in
+// NamesId order.
 
-typedef std::unordered_map<unsigned,NameIndex> NamesLookup;
+class NamesLookup
+{
+public:
+    typedef unsigned                             key_type;
+    typedef NameIndex                            mapped_type;
+    typedef std::pair<const unsigned, NameIndex> value_type;
+
+    enum { NamesPerNode = 1<<8 };                // bits of NamesId::namesId()
+    enum { NumberOfNodes = NamesId::NumberOf/NamesPerNode };
+
+    template <class Lookup, class Value>
+    class Iter
+    {
+    public:
+        Iter(Lookup* lookup, unsigned key) : _lookup(lookup), _key(lookup->_nextKey(key)) {}
+        Value& operator* () const { return *_lookup->_entry(_key); }
+        Value* operator->() const { return  _lookup->_entry(_key); }
+        Iter&  operator++()       { _key = _lookup->_nextKey(_key+1); return *this; }
+        Iter   operator++(int)    { Iter it(*this); ++*this; return it; }
+        bool   operator==(const Iter& rhs) const { return _key == rhs._key; }
+        bool   operator!=(const Iter& rhs) const { return _key != rhs._key; }
+    private:
+        Lookup*  _lookup;
+        unsigned _key;
+    };
+    typedef Iter<NamesLookup, value_type>             iterator;
+    typedef Iter<const NamesLookup, const value_type> const_iterator;
+
+public:
+    NamesLookup() : _size(0) {}
+    NamesLookup(const NamesLookup& rhs) : _size(0) { *this = rhs; }
+    NamesLookup& operator=(const NamesLookup& rhs) {
+        if (this != &rhs) {
+            clear();
+            for (const value_type& entry : rhs) (*this)[entry.first] = entry.second;
+        }
+        return *this;
+    }
+
+    NameIndex& operator[](unsigned key) {
+        value_type* entry = _entry(key);
+        if (entry) return entry->second;
+        return _insert(key)->second;
+    }
+    size_t count(unsigned key) const { return _entry(key) ? 1 : 0; }
+    iterator       find(unsigned key)       { return _entry(key) ? iterator(this, key) : end(); }
+    const_iterator find(unsigned key) const { return _entry(key) ? const_iterator(this, key) : end(); }
+    size_t erase(unsigned key) {
+        if (!_entry(key)) return 0;
+        _pages[key/NamesPerNode]->slots[key%NamesPerNode].reset();
+        _size--;
+        return 1;
+    }
+    void   clear()       { _pages.clear(); _size = 0; }
+    size_t size()  const { return _size; }
+    bool   empty() const { return _size == 0; }
+
+    iterator       begin()       { return iterator(this, 0); }
+    iterator       end()         { return iterator(this, NamesId::NumberOf); }
+    const_iterator begin() const { return const_iterator(this, 0); }
+    const_iterator end()   const { return const_iterator(this, NamesId::NumberOf); }
+
+private:
+    struct Page {
+        std::unique_ptr<value_type> slots[NamesPerNode];
+    };
+
+    value_type* _entry(unsigned key) const {
+        unsigned node = key/NamesPerNode;
+        if (node >= _pages.size() || !_pages[node]) return 0;
+        return _pages[node]->slots[key%NamesPerNode].get();
+    }
+    value_type* _insert(unsigned key) {
+        unsigned node = key/NamesPerNode;
+        if (node >= NumberOfNodes) {
+            printf("*** %s:%d: NamesId 0x%x out of range\n",__FILE__,__LINE__,key);
+            throw "NamesLookup.hh: NamesId out of range";
+        }
+        if (node >= _pages.size()) _pages.resize(node+1);
+        if (!_pages[node]) _pages[node].reset(new Page);
+        std::unique_ptr<value_type>& slot = _pages[node]->slots[key%NamesPerNode];
+        slot.reset(new value_type(key, NameIndex()));
+        _size++;
+        return slot.get();
+    }
+    // the first key from key onwards that has an entry, or NumberOf
+    unsigned _nextKey(unsigned key) const {
+        for (unsigned node = key/NamesPerNode; node < _pages.size(); node++, key = node*NamesPerNode) {
+            if (!_pages[node]) continue;
+            for (unsigned i = key%NamesPerNode; i < NamesPerNode; i++) {
+                if (_pages[node]->slots[i]) return node*NamesPerNode + i;
+            }
+        }
+        return NamesId::NumberOf;
+    }
+
+private:
+    std::vector<std::unique_ptr<Page> > _pages;
+    size_t _size;
+};
 
 };
 
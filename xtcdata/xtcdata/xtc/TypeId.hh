@@ -12,8 +12,10 @@ public:
     /*
      * Notice: New enum values should be appended to the end of the enum list, since
      *   the old values have already been recorded in the existing xtc files.
+     * Padding fills a datagram out to an aligned size for direct I/O; its
+     *   payload is meaningless and iterators skip it like any unknown type.
      */
-    enum Type { Parent, ShapesData, Shapes, Data, Names, NumberOf };
+    enum Type { Parent, ShapesData, Shapes, Data, Names, Padding, NumberOf };
 
     TypeId()
     {
@@ -0,0 +1,183 @@
+#ifndef XtcData_TypedDef_hh
+#define XtcData_TypedDef_hh
+
+#include "xtcdata/xtc/DescData.hh"
+#include "xtcdata/xtc/ShapesData.hh"
+#include "xtcdata/xtc/VarDef.hh"
+
+#include <initializer_list>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// A VarDef whose field types are part of its C++ type, so that the
+// scalars leading the data (those before the first array) can be set and
+// read at offsets computed by the compiler, without the run-time type
+// checks and offset bookkeeping of CreateData::set_value().  For example
+//
+//   class EncoderDef : public TypedDef<Field<Name::UINT32>,    // encoderValue
+//                                      Field<Name::UINT16>>    // frameCount
+//   {
+//   public:
+//       enum index { encoderValue, frameCount };
+//       EncoderDef() : TypedDef({"encoderValue", "frameCount"}) {}
+//   };
+//
+//   names.add(xtc, bufEnd, encoderDef);         // at configure, as usual
+//   EncoderDef::check(names);                   // once, for the names made
+//
+//   TypedCreateData<EncoderDef> cd(xtc, bufEnd, namesLookup, namesId);
+//   cd.set<EncoderDef::encoderValue>(value);    // every event
+//
+// Fields following the first array are filled in with the usual
+// CreateData methods once the leading scalars are set.
+
+namespace XtcData
+{
+
+// the C++ type stored for each Name::DataType, see element_sizes in ShapesData.cc
+template <Name::DataType Type> struct NameDataType;
+template <> struct NameDataType<Name::UINT8>    { typedef uint8_t  type; };
+template <> struct NameDataType<Name::UINT16>   { typedef uint16_t type; };
+template <> struct NameDataType<Name::UINT32>   { typedef uint32_t type; };
+template <> struct NameDataType<Name::UINT64>   { typedef uint64_t type; };
+template <> struct NameDataType<Name::INT8>     { typedef int8_t   type; };
+template <> struct NameDataType<Name::INT16>    { typedef int16_t  type; };
+template <> struct NameDataType<Name::INT32>    { typedef int32_t  type; };
+template <> struct NameDataType<Name::INT64>    { typedef int64_t  type; };
+template <> struct NameDataType<Name::FLOAT>    { typedef float    type; };
+template <> struct NameDataType<Name::DOUBLE>   { typedef double   type; };
+template <> struct NameDataType<Name::CHARSTR>  { typedef char     type; };
+template <> struct NameDataType<Name::ENUMVAL>  { typedef int32_t  type; };
+template <> struct NameDataType<Name::ENUMDICT> { typedef int32_t  type; };
+
+template <Name::DataType Type, int Rank=0>
+struct Field
+{
+    static const Name::DataType type = Type;
+    static const int            rank = Rank;
+    typedef typename NameDataType<Type>::type value_type;
+};
+
+namespace TypedDefDetail
+{
+    // the I-th field
+    template <unsigned I, class... Fields> struct At;
+    template <class F0, class... Fields> struct At<0, F0, Fields...> {
+        typedef F0 type;
+    };
+    template <unsigned I, class F0, class... Fields> struct At<I, F0, Fields...> {
+        typedef typename At<I-1, Fields...>::type type;
+    };
+
+    // the offset of the I-th field, which must be preceded by scalars only
+    template <unsigned I, class... Fields> struct Offset {
+        static const unsigned value = 0;
+    };
+    template <unsigned I, class F0, class... Fields> struct Offset<I, F0, Fields...> {
+        static_assert(I == 0 || F0::rank == 0, "field offset is not a compile-time constant after an array");
+        static const unsigned value = I ? sizeof(typename F0::value_type) + Offset<I ? I-1 : 0, Fields...>::value : 0;
+    };
+
+    // the number of scalars before the first array
+    template <class... Fields> struct Scalars {
+        static const unsigned value = 0;
+    };
+    template <class F0, class... Fields> struct Scalars<F0, Fields...> {
+        static const unsigned value = F0::rank == 0 ? 1 + Scalars<Fields...>::value : 0;
+    };
+
+    // checks the types of fields I and up against the names, as set_value() does
+    template <unsigned I, unsigned N, class Def> struct CheckTypes {
+        static void check(Names& names) {
+            DescData::checkType(typename Def::template Type<I>(), names.get(I));
+            CheckTypes<I+1, N, Def>::check(names);
+        }
+    };
+    template <unsigned N, class Def> struct CheckTypes<N, N, Def> {
+        static void check(Names&) {}
+    };
+}
+
+template <class... Fields>
+class TypedDef : public VarDef
+{
+public:
+    enum { NumFields  = sizeof...(Fields) };
+    enum { NumScalars = TypedDefDetail::Scalars<Fields...>::value };
+    enum { ScalarSize = TypedDefDetail::Offset<NumScalars, Fields...>::value };
+
+    template <unsigned I> using Type = typename TypedDefDetail::At<I, Fields...>::type::value_type;
+
+    template <unsigned I> static constexpr unsigned offset() {
+        return TypedDefDetail::Offset<I, Fields...>::value;
+    }
+
+    TypedDef(std::initializer_list<const char*> names)
+    {
+        static const Name::DataType types[] = { Fields::type... };
+        static const int            ranks[] = { Fields::rank... };
+        if (names.size() != NumFields) {
+            printf("*** %s:%d: %zu names given for %d fields\n",__FILE__,__LINE__,names.size(),int(NumFields));
+            abort();
+        }
+        unsigned i = 0;
+        for (const char* name : names) {
+            NameVec.push_back(Name(name, types[i], ranks[i]));
+            i++;
+        }
+    }
+
+    // checks that the names have the types of the def's fields, as
+    // set_value() would for each one; call it once, where the names are
+    // made, since TypedCreateData doesn't check them for every event
+    static void check(Names& names)
+    {
+        if (names.num() != NumFields) {
+            printf("*** %s:%d: %d names for %d fields\n",__FILE__,__LINE__,names.num(),int(NumFields));
+            abort();
+        }
+        TypedDefDetail::CheckTypes<0, NumFields, TypedDef>::check(names);
+    }
+
+    // reads one of the leading scalars of data described by this def
+    template <unsigned I>
+    static Type<I> get(DescData& descdata)
+    {
+        static_assert(I < NumScalars, "only the scalars before the first array have a fixed offset");
+        Type<I> val;
+        memcpy(&val, descdata.shapesdata().data().payload() + offset<I>(), sizeof(val));
+        return val;
+    }
+};
+
+// Creates the data described by a TypedDef.  The leading scalars are
+// allocated in one go by the constructor and may then be set in any order.
+// The names are those TypedDef::check() passed at configure.
+template <class Def>
+class TypedCreateData : public CreateData
+{
+public:
+    template <unsigned I> using Type = typename Def::template Type<I>;
+
+    TypedCreateData(Xtc& parent, const void* bufEnd, NamesLookup& namesLookup, NamesId& namesId) :
+        CreateData(parent, bufEnd, namesLookup, namesId),
+        _payload((uint8_t*)alloc_scalars(Def::NumScalars, Def::ScalarSize))
+    {
+    }
+
+    template <unsigned I>
+    void set(Type<I> val)
+    {
+        static_assert(I < Def::NumScalars, "only the scalars before the first array have a fixed offset");
+        memcpy(_payload + Def::template offset<I>(), &val, sizeof(val));
+    }
+
+private:
+    uint8_t* _payload;
+};
+
+}
+
+#endif
@@ -8,19 +8,40 @@
 namespace XtcData
 {
 
+//
+// By default each datagram is read into a private buffer of maxDgramSize
+// bytes, which is reused by the following call to next().  With useMmap set
+// the file is instead mapped into memory and next() returns pointers straight
+// into the mapping, avoiding the read() syscalls and the payload copy.  The
+// mapping is private, so datagrams may still be modified in place without
+// touching the file.  Readahead is requested in windows ahead of the current
+// position and, for large files, pages already consumed are released.  The
+// mmap mode applies to complete files; when the fd cannot be mapped (pipes,
+// empty files) the iterator falls back to the read() mode.
+//
 class XtcFileIterator
 {
 public:
-    XtcFileIterator(int fd, size_t maxDgramSize);
+    XtcFileIterator(int fd, size_t maxDgramSize, bool useMmap=false);
     ~XtcFileIterator();
     Dgram* next();
     void rewind();
     size_t size() const { return _maxDgramSize; }
+    bool mapped() const { return _map != 0; }
+
+private:
+    Dgram* _nextMapped();
+    void _advise();
 
 private:
     int _fd;
     size_t _maxDgramSize;
     char* _buf;
+    char* _map;            // mmap mode only
+    size_t _mapSize;
+    size_t _offset;        // offset of the next datagram in the mapping
+    size_t _adviseEnd;     // end of the region for which readahead was requested
+    size_t _releaseEnd;    // end of the region already released
 };
 }
 
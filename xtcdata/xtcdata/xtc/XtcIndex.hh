@@ -0,0 +1,111 @@
+#ifndef XtcData_XtcIndex_hh
+#define XtcData_XtcIndex_hh
+
+#include "xtcdata/xtc/Dgram.hh"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+namespace XtcData
+{
+
+//
+// Sidecar index for an xtc2 file: a small header followed by one fixed size
+// entry per datagram, in file order.  The index is written next to the data
+// file with an ".idx" suffix, either by the DAQ while recording or afterwards
+// by the xtcindex tool.  Since entries are appended as datagrams are written,
+// the number of entries is derived from the file size.
+//
+class XtcIndex
+{
+public:
+    enum { Magic = 0x58444958 };        // "XIDX"
+    enum { Version = 1 };
+
+#pragma pack(push,4)
+    class Header
+    {
+    public:
+        Header() : magic(Magic), version(Version), entrySize(sizeof(Entry)), reserved(0) {}
+        bool valid() const { return magic == Magic && version == Version && entrySize == sizeof(Entry); }
+    public:
+        uint32_t magic;
+        uint32_t version;
+        uint32_t entrySize;
+        uint32_t reserved;
+    };
+
+    class Entry
+    {
+    public:
+        Entry() {}
+        Entry(const Dgram& dg, uint64_t offset_) :
+            time(dg.time.value()), offset(offset_),
+            size(sizeof(dg) + dg.xtc.sizeofPayload()), env(dg.env) {}
+        TransitionId::Value service() const { return TransitionId::Value((env>>24)&0xf); }
+    public:
+        uint64_t time;                  // TimeStamp::value() of the datagram
+        uint64_t offset;                // byte offset of the datagram in the file
+        uint32_t size;                  // size of the datagram, header included
+        uint32_t env;
+    };
+#pragma pack(pop)
+
+    static std::string sidecarName(const std::string& xtcName) { return xtcName + ".idx"; }
+};
+
+// Writes a sidecar index with buffered stdio, for offline use
+class XtcIndexWriter
+{
+public:
+    XtcIndexWriter();
+    ~XtcIndexWriter();
+    int open(const std::string& fileName);
+    int close();
+    void add(const Dgram& dg, uint64_t offset);
+private:
+    FILE* _file;
+};
+
+//
+// Random access to the datagrams of an xtc2 file through its index.
+// Datagrams are fetched with a single pread() into a buffer of maxDgramSize
+// bytes which is reused by the next lookup.  If no sidecar exists the index
+// is built in memory by walking the datagram headers of the file.
+//
+class XtcIndexedReader
+{
+public:
+    XtcIndexedReader(int fd, size_t maxDgramSize);
+    ~XtcIndexedReader();
+    int loadIndex(const std::string& indexName);
+    int buildIndex();
+    size_t numEntries() const { return _entries.size(); }
+    size_t numEvents() const { return _events.size(); }
+    const XtcIndex::Entry& entry(size_t i) const { return _entries[i]; }
+    const std::vector<XtcIndex::Entry>& entries() const { return _entries; }
+    // the i-th datagram of the file, of any transition type
+    Dgram* dgram(size_t i);
+    // the n-th L1Accept of the file
+    Dgram* event(size_t n);
+    // the datagram with exactly this timestamp, or 0 if there is none
+    Dgram* find(const TimeStamp& time);
+    // position, in time order, of the first entry with a timestamp not less
+    // than time; this is the entry number for files written in time order
+    size_t lowerBound(const TimeStamp& time) const;
+private:
+    void _indexEntries();
+private:
+    int _fd;
+    size_t _maxDgramSize;
+    char* _buf;
+    std::vector<XtcIndex::Entry> _entries;
+    std::vector<uint32_t> _events;      // entries that are L1Accepts
+    std::vector<uint32_t> _byTime;      // entries ordered by time, if not in file order
+};
+
+}
+
+#endif
@@ -34,16 +34,44 @@
 ** --
 */
 
+#include <stddef.h>
+#include <vector>
+
 namespace XtcData
 {
 
 class Xtc;
 
+/*
+** ++
+**
+**    Description of a corrupt "Xtc" met while iterating in validating mode:
+**    the byte offset of the offending "Xtc" from the outermost "Xtc" given
+**    to iterate(), its nesting depth (0 for the children of that "Xtc"),
+**    and why it was rejected.
+**
+** --
+*/
+
+class XtcError
+{
+public:
+    enum Reason { Overrun, SmallExtent, ParentOverrun, NumberOf };
+    XtcError(ptrdiff_t offset_, unsigned depth_, Reason reason_, unsigned extent_) :
+        offset(offset_), depth(depth_), reason(reason_), extent(extent_) {}
+    static const char* name(Reason reason);
+public:
+    ptrdiff_t offset;
+    unsigned  depth;
+    Reason    reason;
+    unsigned  extent;   // extent of the offending Xtc, as found (0 if its header is cut short)
+};
+
 class XtcIterator
 {
 public:
     XtcIterator(Xtc* root, const void* bufEnd);
-    XtcIterator()
+    XtcIterator() : _validate(false), _depth(0), _base(0)
     {
     }
     virtual ~XtcIterator()
@@ -58,9 +86,24 @@ public:
     void iterate(Xtc*, const void* bufEnd);
     const Xtc* root() const;
 
+public:
+    // In validating mode a corrupt "Xtc" ends the iteration of its parent
+    // and is recorded in errors() instead of aborting the process
+    void validate(bool enable) { _validate = enable; }
+    bool validating() const { return _validate; }
+    const std::vector<XtcError>& errors() const { return _errors; }
+    void clearErrors() { _errors.clear(); }
+
+private:
+    bool _corrupt(const Xtc* xtc, XtcError::Reason reason, unsigned extent);
+
 private:
     Xtc* _root; // Collection to process in the absence of an argument...
     const void* _bufEnd;
+    bool _validate;
+    unsigned _depth;
+    const Xtc* _base;   // outermost Xtc of the current iteration
+    std::vector<XtcError> _errors;
 };
 }
 
@@ -74,7 +117,8 @@ private:
 ** --
 */
 
-inline XtcData::XtcIterator::XtcIterator(Xtc* root, const void* bufEnd) : _root(root), _bufEnd(bufEnd)
+inline XtcData::XtcIterator::XtcIterator(Xtc* root, const void* bufEnd) :
+    _root(root), _bufEnd(bufEnd), _validate(false), _depth(0), _base(0)
 {
 }
 
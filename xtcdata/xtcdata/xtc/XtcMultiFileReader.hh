@@ -0,0 +1,75 @@
+#ifndef XtcData_XtcMultiFileReader_hh
+#define XtcData_XtcMultiFileReader_hh
+
+#include "xtcdata/xtc/Dgram.hh"
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace XtcData
+{
+
+//
+// Offline event building: merges the xtc2 files written by the DRPs of a
+// run into events, as the TEB does online.  Each stream is the sequence of
+// chunk files written by one DRP (streams() groups the "-cNNN" chunks of a
+// list of files).  A pool of threads reads ahead on all streams into
+// bounded queues while next() does a k-way merge of the stream heads on the
+// datagram timestamp.  Streams without a datagram for a timestamp simply
+// do not contribute to that event, see contributors().  The payloads of the
+// contributions are concatenated under a single Dgram, with the header of
+// the first contribution and the damage of all of them.
+//
+class XtcMultiFileReader
+{
+public:
+    typedef std::vector<std::string> Chunks;
+
+    XtcMultiFileReader(const std::vector<Chunks>& streams, size_t maxDgramSize,
+                       unsigned nThreads=4, unsigned readAhead=64, bool useMmap=false);
+    ~XtcMultiFileReader();
+
+    // the next combined datagram, valid until the following call, or 0 at the end
+    Dgram* next();
+    unsigned nStreams() const { return _streams.size(); }
+    // indices of the streams that contributed to the last datagram
+    const std::vector<unsigned>& contributors() const { return _contributors; }
+    // their contributions, also valid until the following call
+    const Dgram* contribution(unsigned i) const;
+
+    // groups the chunk files ("<name>-cNNN.xtc2") of each stream, in chunk order
+    static std::vector<Chunks> streams(const std::vector<std::string>& files);
+
+private:
+    class Stream;
+    void _worker();
+    bool _head(Stream& stream);
+    void _schedule(Stream& stream);
+
+private:
+    typedef std::pair<uint64_t, unsigned> HeapEntry;   // timestamp, stream
+    size_t                      _maxDgramSize;
+    unsigned                    _readAhead;
+    bool                        _useMmap;
+    std::vector<Stream*>        _streams;
+    std::priority_queue<HeapEntry, std::vector<HeapEntry>, std::greater<HeapEntry> > _heap;
+    std::vector<unsigned>       _contributors;
+    std::vector<char>           _buf;
+    std::mutex                  _mutex;
+    std::condition_variable     _taskCv;                // work for the pool
+    std::condition_variable     _readyCv;               // data for next()
+    std::deque<Stream*>         _tasks;
+    std::vector<std::thread>    _threads;
+    bool                        _stop;
+};
+
+}
+
+#endif
@@ -2,7 +2,7 @@
 
 #include "xtcdata/xtc/DescData.hh"
 #include "xtcdata/xtc/TypeId.hh"
-#include "xtcdata/xtc/VarDef.hh"
+#include "xtcdata/xtc/TypedDef.hh"
 #include "xtcdata/xtc/XtcIterator.hh"
 
 #include <iostream>
@@ -12,7 +12,8 @@
 using namespace XtcData;
 using namespace std;
 
-class SmdDef:public VarDef
+class SmdDef:public TypedDef<Field<Name::UINT64>,
+                             Field<Name::UINT64> >
 {
 public:
   enum index
@@ -21,12 +22,9 @@ public:
       intDgramSize
     };
 
-   SmdDef()
-   {
-     NameVec.push_back({"intOffset", Name::UINT64});
-     NameVec.push_back({"intDgramSize", Name::UINT64});
-   }
-} SmdDef;
+   SmdDef() : TypedDef({"intOffset", "intDgramSize"}) {}
+};
+static SmdDef smdDef;
 
 class CheckNamesIdIter : public XtcIterator
 {
@@ -69,7 +67,8 @@ void addNames(Xtc& parent, const void* bufEnd, NamesLookup& namesLookup, NamesId
     checkNamesId.iterate(&parent, bufEnd);
 
     Names& offsetNames = *new(parent, bufEnd) Names(bufEnd, "smdinfo", alg, "offset", "", namesId);
-    offsetNames.add(parent,bufEnd,SmdDef);
+    offsetNames.add(parent,bufEnd,smdDef);
+    SmdDef::check(offsetNames);
     namesLookup[namesId] = NameIndex(offsetNames);
 }
 
@@ -94,9 +93,9 @@ Dgram* Smd::generate(Dgram* dgIn, void* buf, const void* bufEnd, uint64_t offset
         dgOut.env = dgIn->env;
         dgOut.xtc = {{TypeId::Parent, 0}};
 
-        CreateData createSmd(dgOut.xtc, bufEnd, namesLookup, namesId);
-        createSmd.set_value(SmdDef::intOffset, offset);
-        createSmd.set_value(SmdDef::intDgramSize, size);
+        TypedCreateData<SmdDef> createSmd(dgOut.xtc, bufEnd, namesLookup, namesId);
+        createSmd.set<SmdDef::intOffset>(offset);
+        createSmd.set<SmdDef::intDgramSize>(size);
 
         if (offset < 0) {
             cout << "Error offset value (offset=" << offset << ")" << endl;
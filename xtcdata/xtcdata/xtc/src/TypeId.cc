@@ -22,7 +22,7 @@ TypeId::TypeId(const char* s) : _value(NumberOf)
 
 const char* TypeId::name(Type type)
 {
-    static const char* _names[NumberOf] = { "Parent", "ShapesData", "Shapes", "Data", "Names" };
+    static const char* _names[NumberOf] = { "Parent", "ShapesData", "Shapes", "Data", "Names", "Padding" };
     const char* p = (type < NumberOf ? _names[type] : "-Invalid-");
     if (!p) p = "-Unnamed-";
     return p;
@@ -1,23 +1,53 @@
-
 #include "xtcdata/xtc/XtcFileIterator.hh"
 #include <new>
 #include <stdio.h>
 #include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 using namespace XtcData;
 
-XtcFileIterator::XtcFileIterator(int fd, size_t maxDgramSize)
-: _fd(fd), _maxDgramSize(maxDgramSize), _buf(new char[maxDgramSize])
+// Size of the readahead windows requested with MADV_WILLNEED
+static const size_t AdviseWindow = 0x4000000;
+// Files larger than this have the pages already consumed released so that
+// a long sequential pass does not pin the whole file in memory
+static const size_t ReleaseThreshold = 0x40000000;
+
+XtcFileIterator::XtcFileIterator(int fd, size_t maxDgramSize, bool useMmap)
+: _fd(fd), _maxDgramSize(maxDgramSize), _buf(0), _map(0), _mapSize(0),
+  _offset(0), _adviseEnd(0), _releaseEnd(0)
 {
+    if (useMmap) {
+        struct stat st;
+        if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+            // Writable, since callers may modify the datagrams returned, but
+            // without reserving swap for the whole file: only pages actually
+            // written are ever copied
+            void* p = ::mmap(0, st.st_size, PROT_READ | PROT_WRITE,
+                             MAP_PRIVATE | MAP_NORESERVE, fd, 0);
+            if (p != MAP_FAILED) {
+                _map = (char*)p;
+                _mapSize = st.st_size;
+                madvise(_map, _mapSize, MADV_SEQUENTIAL);
+                _advise();
+            } else {
+                perror("XtcFileIterator: mmap failed, falling back to read()");
+            }
+        }
+    }
+    if (!_map) _buf = new char[maxDgramSize];
 }
 
 XtcFileIterator::~XtcFileIterator()
 {
+    if (_map) ::munmap(_map, _mapSize);
     delete[] _buf;
 }
 
 Dgram* XtcFileIterator::next()
 {
+    if (_map) return _nextMapped();
+
     Dgram& dg = *(Dgram*)_buf;
     if (::read(_fd, &dg, sizeof(dg)) == 0) return 0;
     size_t payloadSize = dg.xtc.sizeofPayload();
@@ -33,7 +63,61 @@ Dgram* XtcFileIterator::next()
     return sz != (ssize_t)payloadSize ? 0 : &dg;
 }
 
+Dgram* XtcFileIterator::_nextMapped()
+{
+    if (_offset + sizeof(Dgram) > _mapSize) {
+        if (_offset != _mapSize) {
+            printf("XtcFileIterator::next incomplete header at offset %zu\n", _offset);
+        }
+        return 0;
+    }
+    Dgram* dg = (Dgram*)(_map + _offset);
+    size_t dgSize = sizeof(*dg) + dg->xtc.sizeofPayload();
+    if (dgSize > _maxDgramSize) {
+        printf("Datagram size %zu larger than maximum: %zu\n", dgSize, _maxDgramSize);
+        return 0;
+    }
+    if (_offset + dgSize > _mapSize) {
+        printf("XtcFileIterator::next read incomplete payload %d/%d\n",
+               (int)(_mapSize - _offset - sizeof(*dg)), (int)dg->xtc.sizeofPayload());
+        return 0;
+    }
+
+    // The previously returned datagram is no longer in use, so everything
+    // before this one may be released
+    if (_mapSize > ReleaseThreshold && _offset - _releaseEnd >= AdviseWindow) {
+        size_t pageSize = sysconf(_SC_PAGESIZE);
+        size_t end = _offset & ~(pageSize - 1);
+        madvise(_map + _releaseEnd, end - _releaseEnd, MADV_DONTNEED);
+        _releaseEnd = end;
+    }
+
+    _offset += dgSize;
+    if (_offset + AdviseWindow / 2 > _adviseEnd) _advise();
+
+    return dg;
+}
+
+void XtcFileIterator::_advise()
+{
+    if (_adviseEnd >= _mapSize) return;
+    size_t pageSize = sysconf(_SC_PAGESIZE);
+    size_t begin = _offset > _adviseEnd ? _offset : _adviseEnd;
+    begin &= ~(pageSize - 1);             // madvise() needs a page aligned address
+    size_t end = _offset + AdviseWindow;
+    if (end > _mapSize) end = _mapSize;
+    if (end > begin) madvise(_map + begin, end - begin, MADV_WILLNEED);
+    _adviseEnd = end;
+}
+
 void XtcFileIterator::rewind()
 {
+    if (_map) {
+        _offset = 0;
+        _adviseEnd = 0;
+        _releaseEnd = 0;
+        _advise();
+        return;
+    }
     lseek(_fd, 0, SEEK_SET);
 }
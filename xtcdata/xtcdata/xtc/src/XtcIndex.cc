@@ -0,0 +1,177 @@
+#include "xtcdata/xtc/XtcIndex.hh"
+
+#include <algorithm>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace XtcData;
+
+XtcIndexWriter::XtcIndexWriter() : _file(0)
+{
+}
+
+XtcIndexWriter::~XtcIndexWriter()
+{
+    close();
+}
+
+int XtcIndexWriter::open(const std::string& fileName)
+{
+    _file = fopen(fileName.c_str(), "w");
+    if (!_file) {
+        printf("XtcIndexWriter: unable to open file '%s'\n", fileName.c_str());
+        return -1;
+    }
+    XtcIndex::Header header;
+    if (fwrite(&header, sizeof(header), 1, _file) != 1) {
+        printf("XtcIndexWriter: error writing header\n");
+        return -1;
+    }
+    return 0;
+}
+
+int XtcIndexWriter::close()
+{
+    int rv = 0;
+    if (_file) {
+        rv = fclose(_file);
+        _file = 0;
+    }
+    return rv;
+}
+
+void XtcIndexWriter::add(const Dgram& dg, uint64_t offset)
+{
+    XtcIndex::Entry entry(dg, offset);
+    if (fwrite(&entry, sizeof(entry), 1, _file) != 1) {
+        printf("XtcIndexWriter: error writing entry\n");
+    }
+}
+
+XtcIndexedReader::XtcIndexedReader(int fd, size_t maxDgramSize) :
+    _fd(fd), _maxDgramSize(maxDgramSize), _buf(new char[maxDgramSize])
+{
+}
+
+XtcIndexedReader::~XtcIndexedReader()
+{
+    delete[] _buf;
+}
+
+int XtcIndexedReader::loadIndex(const std::string& indexName)
+{
+    int fd = open(indexName.c_str(), O_RDONLY);
+    if (fd < 0) return -1;
+
+    int rv = -1;
+    struct stat st;
+    XtcIndex::Header header;
+    if (fstat(fd, &st) == 0 &&
+        ::pread(fd, &header, sizeof(header), 0) == (ssize_t)sizeof(header) &&
+        header.valid()) {
+        size_t n = (st.st_size - sizeof(header)) / sizeof(XtcIndex::Entry);
+        size_t bytes = n * sizeof(XtcIndex::Entry);
+        _entries.resize(n);
+        if (::pread(fd, _entries.data(), bytes, sizeof(header)) == (ssize_t)bytes) {
+            rv = 0;
+        } else {
+            printf("XtcIndexedReader: incomplete index file '%s'\n", indexName.c_str());
+            _entries.clear();
+        }
+    } else {
+        printf("XtcIndexedReader: invalid index file '%s'\n", indexName.c_str());
+    }
+    ::close(fd);
+
+    if (rv == 0) _indexEntries();
+    return rv;
+}
+
+int XtcIndexedReader::buildIndex()
+{
+    _entries.clear();
+    uint64_t offset = 0;
+    Dgram dg;
+    ssize_t sz;
+    while ((sz = ::pread(_fd, &dg, sizeof(dg), offset)) == (ssize_t)sizeof(dg)) {
+        XtcIndex::Entry entry(dg, offset);
+        if (entry.size > _maxDgramSize) {
+            printf("XtcIndexedReader: datagram size %u at offset %lu larger than maximum: %zu\n",
+                   entry.size, offset, _maxDgramSize);
+            break;
+        }
+        _entries.push_back(entry);
+        offset += entry.size;
+    }
+    // drop a trailing datagram truncated by an incomplete write
+    struct stat st;
+    if (!_entries.empty() && fstat(_fd, &st) == 0) {
+        const XtcIndex::Entry& last = _entries.back();
+        if (last.offset + last.size > (uint64_t)st.st_size) _entries.pop_back();
+    }
+    _indexEntries();
+    return sz < 0 ? -1 : 0;
+}
+
+void XtcIndexedReader::_indexEntries()
+{
+    _events.clear();
+    _byTime.clear();
+    bool sorted = true;
+    for (unsigned i = 0; i < _entries.size(); i++) {
+        if (_entries[i].service() == TransitionId::L1Accept) _events.push_back(i);
+        if (i && _entries[i].time < _entries[i-1].time) sorted = false;
+    }
+    if (!sorted) {
+        _byTime.resize(_entries.size());
+        for (unsigned i = 0; i < _byTime.size(); i++) _byTime[i] = i;
+        const std::vector<XtcIndex::Entry>& entries = _entries;
+        std::stable_sort(_byTime.begin(), _byTime.end(),
+                         [&entries](uint32_t a, uint32_t b) { return entries[a].time < entries[b].time; });
+    }
+}
+
+Dgram* XtcIndexedReader::dgram(size_t i)
+{
+    if (i >= _entries.size()) return 0;
+    const XtcIndex::Entry& entry = _entries[i];
+    if (entry.size > _maxDgramSize) {
+        printf("Datagram size %u larger than maximum: %zu\n", entry.size, _maxDgramSize);
+        return 0;
+    }
+    ssize_t sz = ::pread(_fd, _buf, entry.size, entry.offset);
+    if (sz != (ssize_t)entry.size) {
+        printf("XtcIndexedReader::dgram read incomplete datagram %d/%d\n", (int)sz, (int)entry.size);
+        return 0;
+    }
+    return (Dgram*)_buf;
+}
+
+Dgram* XtcIndexedReader::event(size_t n)
+{
+    return n < _events.size() ? dgram(_events[n]) : 0;
+}
+
+size_t XtcIndexedReader::lowerBound(const TimeStamp& time) const
+{
+    uint64_t t = time.value();
+    size_t lo = 0;
+    size_t hi = _entries.size();
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        const XtcIndex::Entry& e = _entries[_byTime.empty() ? mid : _byTime[mid]];
+        if (e.time < t) lo = mid + 1;
+        else            hi = mid;
+    }
+    return lo;
+}
+
+Dgram* XtcIndexedReader::find(const TimeStamp& time)
+{
+    size_t pos = lowerBound(time);
+    if (pos == _entries.size()) return 0;
+    size_t i = _byTime.empty() ? pos : _byTime[pos];
+    if (_entries[i].time != time.value()) return 0;
+    return dgram(i);
+}
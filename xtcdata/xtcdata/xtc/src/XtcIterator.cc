@@ -41,19 +41,51 @@ void XtcIterator::iterate(Xtc* root, const void* bufEnd)
 {
     if (root->damage.value() & (1 << Damage::Corrupted)) return;
 
+    if (_depth == 0) _base = root;
+    // restores the depth however the iteration ends, process() may throw
+    struct DepthGuard {
+        DepthGuard(unsigned& depth) : _d(depth) { _d++; }
+        ~DepthGuard() { _d--; }
+        unsigned& _d;
+    } depthGuard(_depth);
+
     Xtc* xtc = (Xtc*)root->payload();
     int remaining = root->sizeofPayload();
 
     while (remaining > 0) {
         if (bufEnd && UNLIKELY(xtc >= (Xtc*)bufEnd)) {
             // protect against buffer overrun
+            if (_corrupt(xtc, XtcError::Overrun, 0)) break;
             printf("*** %s:%d: corrupt xtc, would overrun buffer\n",__FILE__,__LINE__);
             abort();
         }
+        if (_validate) {
+            // the header must be there before its extent can be read
+            if ((unsigned)remaining < sizeof(Xtc)) {
+                _corrupt(xtc, XtcError::ParentOverrun, 0);
+                break;
+            }
+            if (bufEnd && (const char*)(xtc + 1) > (const char*)bufEnd) {
+                _corrupt(xtc, XtcError::Overrun, 0);
+                break;
+            }
+        }
         if (xtc->extent < sizeof(Xtc)) {
+            if (_corrupt(xtc, XtcError::SmallExtent, xtc->extent)) break;
             printf("*** %s:%d: corrupt xtc with too small extent: %d\n",__FILE__,__LINE__,xtc->extent);
             abort();
         }
+        if (_validate) {
+            // checks that the legacy mode leaves to the process() methods
+            if (xtc->extent > (unsigned)remaining) {
+                _corrupt(xtc, XtcError::ParentOverrun, xtc->extent);
+                break;
+            }
+            if (bufEnd && (const char*)xtc->next() > (const char*)bufEnd) {
+                _corrupt(xtc, XtcError::Overrun, xtc->extent);
+                break;
+            }
+        }
         if (!process(xtc, bufEnd)) break;
         remaining -= xtc->sizeofPayload() + sizeof(Xtc);
         xtc = xtc->next();
@@ -61,3 +93,29 @@ void XtcIterator::iterate(Xtc* root, const void* bufEnd)
 
     return;
 }
+
+/*
+ ** ++
+ **
+ **   Record a corrupt "Xtc" in validating mode.  Returns false when not
+ **   validating, in which case the caller aborts.
+ **
+ ** --
+ */
+
+bool XtcIterator::_corrupt(const Xtc* xtc, XtcError::Reason reason, unsigned extent)
+{
+    if (!_validate) return false;
+    _errors.push_back(XtcError((const char*)xtc - (const char*)_base, _depth - 1, reason, extent));
+    return true;
+}
+
+const char* XtcError::name(Reason reason)
+{
+    static const char* _names[] = {
+        "overrun of the buffer",
+        "extent smaller than an Xtc header",
+        "extent larger than the parent's payload"
+    };
+    return reason < NumberOf ? _names[reason] : "-Invalid-";
+}
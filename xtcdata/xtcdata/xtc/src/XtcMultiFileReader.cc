@@ -0,0 +1,220 @@
+#include "xtcdata/xtc/XtcMultiFileReader.hh"
+#include "xtcdata/xtc/XtcFileIterator.hh"
+
+#include <algorithm>
+#include <ctype.h>
+#include <fcntl.h>
+#include <new>
+#include <string.h>
+#include <unistd.h>
+
+using namespace XtcData;
+
+class XtcMultiFileReader::Stream
+{
+public:
+    Stream(const Chunks& files_) : files(files_), nextFile(0), fd(-1), iter(0),
+                                   eof(false), scheduled(false) {}
+    ~Stream() { close(); }
+
+    // reads the next datagram into buf, moving on to the next chunk at the
+    // end of a file; only called by the worker that holds the stream
+    bool read(std::vector<char>& buf, size_t maxDgramSize, bool useMmap)
+    {
+        while (true) {
+            if (!iter) {
+                if (nextFile == files.size()) return false;
+                const std::string& name = files[nextFile++];
+                fd = ::open(name.c_str(), O_RDONLY);
+                if (fd < 0) {
+                    printf("*** %s:%d: unable to open file '%s'\n",__FILE__,__LINE__,name.c_str());
+                    continue;
+                }
+                iter = new XtcFileIterator(fd, maxDgramSize, useMmap);
+            }
+            Dgram* dg = iter->next();
+            if (dg) {
+                size_t size = sizeof(*dg) + dg->xtc.sizeofPayload();
+                buf.resize(size);
+                memcpy(buf.data(), dg, size);
+                return true;
+            }
+            close();
+        }
+    }
+
+    void close()
+    {
+        delete iter;
+        iter = 0;
+        if (fd >= 0) ::close(fd);
+        fd = -1;
+    }
+
+    const Dgram* dgram() const { return (const Dgram*)head.data(); }
+
+public:
+    Chunks                          files;
+    unsigned                        nextFile;
+    int                             fd;
+    XtcFileIterator*                iter;
+    std::deque<std::vector<char> >  ready;      // read ahead, under the reader's mutex
+    std::vector<std::vector<char> > spare;      // recycled buffers, idem
+    std::vector<char>               head;       // being merged, owned by next()
+    bool                            eof;
+    bool                            scheduled;  // queued or being filled by a worker
+};
+
+XtcMultiFileReader::XtcMultiFileReader(const std::vector<Chunks>& streams, size_t maxDgramSize,
+                                       unsigned nThreads, unsigned readAhead, bool useMmap) :
+    _maxDgramSize(maxDgramSize),
+    _readAhead(std::max(readAhead, 2u)),
+    _useMmap(useMmap),
+    _stop(false)
+{
+    for (unsigned i = 0; i < streams.size(); i++) {
+        _streams.push_back(new Stream(streams[i]));
+        // the first call to next() fetches the head of every stream
+        _contributors.push_back(i);
+    }
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        for (Stream* stream : _streams)  _schedule(*stream);
+    }
+    nThreads = std::max(1u, std::min(nThreads, unsigned(_streams.size())));
+    for (unsigned i = 0; i < nThreads; i++) {
+        _threads.emplace_back(&XtcMultiFileReader::_worker, this);
+    }
+}
+
+XtcMultiFileReader::~XtcMultiFileReader()
+{
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _stop = true;
+    }
+    _taskCv.notify_all();
+    for (std::thread& thread : _threads)  thread.join();
+    for (Stream* stream : _streams)  delete stream;
+}
+
+// must be called with the mutex held
+void XtcMultiFileReader::_schedule(Stream& stream)
+{
+    if (stream.scheduled || stream.eof)  return;
+    stream.scheduled = true;
+    _tasks.push_back(&stream);
+    _taskCv.notify_one();
+}
+
+void XtcMultiFileReader::_worker()
+{
+    std::unique_lock<std::mutex> lock(_mutex);
+    while (true) {
+        _taskCv.wait(lock, [this]{ return _stop || !_tasks.empty(); });
+        if (_stop)  return;
+        Stream& stream = *_tasks.front();
+        _tasks.pop_front();
+        while (!_stop && stream.ready.size() < _readAhead) {
+            std::vector<char> buf;
+            if (!stream.spare.empty()) {
+                buf.swap(stream.spare.back());
+                stream.spare.pop_back();
+            }
+            lock.unlock();
+            bool ok = stream.read(buf, _maxDgramSize, _useMmap);
+            lock.lock();
+            if (!ok) {
+                stream.eof = true;
+                break;
+            }
+            stream.ready.push_back(std::vector<char>());
+            stream.ready.back().swap(buf);
+            if (stream.ready.size() == 1)  _readyCv.notify_all();
+        }
+        stream.scheduled = false;
+        _readyCv.notify_all();
+    }
+}
+
+// moves the next datagram of a stream to its head, false at the end of it
+bool XtcMultiFileReader::_head(Stream& stream)
+{
+    std::unique_lock<std::mutex> lock(_mutex);
+    if (!stream.head.empty()) {
+        stream.spare.push_back(std::vector<char>());
+        stream.spare.back().swap(stream.head);
+    }
+    if (stream.ready.empty()) {
+        _schedule(stream);
+        _readyCv.wait(lock, [&stream]{ return !stream.ready.empty() || stream.eof; });
+        if (stream.ready.empty())  return false;
+    }
+    stream.head.swap(stream.ready.front());
+    stream.ready.pop_front();
+    if (stream.ready.size() <= _readAhead/2)  _schedule(stream);
+    return true;
+}
+
+Dgram* XtcMultiFileReader::next()
+{
+    // the contributions to the previous datagram are replaced by the
+    // following datagram of their stream
+    for (unsigned i : _contributors) {
+        Stream& stream = *_streams[i];
+        if (_head(stream))  _heap.push(HeapEntry(stream.dgram()->time.value(), i));
+    }
+    _contributors.clear();
+    if (_heap.empty())  return 0;
+
+    // entries of equal time pop in stream order
+    uint64_t time = _heap.top().first;
+    size_t size = sizeof(Dgram);
+    while (!_heap.empty() && _heap.top().first == time) {
+        unsigned i = _heap.top().second;
+        _heap.pop();
+        _contributors.push_back(i);
+        size += _streams[i]->dgram()->xtc.sizeofPayload();
+    }
+
+    if (_buf.size() < size)  _buf.resize(size);
+    Dgram& dg = *new (_buf.data()) Dgram(*contribution(0));
+    dg.xtc.extent = sizeof(Xtc);
+    for (unsigned i = 0; i < _contributors.size(); i++) {
+        const Xtc& xtc = contribution(i)->xtc;
+        // the payload is raw bytes, not an Xtc, past the end of dg.xtc
+        memcpy((void*)dg.xtc.next(), xtc.payload(), xtc.sizeofPayload());
+        dg.xtc.extent += xtc.sizeofPayload();
+        dg.xtc.damage.increase(xtc.damage.value());
+    }
+    return &dg;
+}
+
+const Dgram* XtcMultiFileReader::contribution(unsigned i) const
+{
+    return _streams[_contributors[i]]->dgram();
+}
+
+std::vector<XtcMultiFileReader::Chunks> XtcMultiFileReader::streams(const std::vector<std::string>& files)
+{
+    std::vector<std::string> keys;
+    std::vector<Chunks> result;
+    for (const std::string& file : files) {
+        // the stream name is the file name without its "-cNNN" chunk number
+        std::string key = file;
+        size_t pos = file.rfind("-c");
+        if (pos != std::string::npos) {
+            size_t end = pos+2;
+            while (end < file.size() && isdigit(file[end]))  end++;
+            if (end > pos+2)  key = file.substr(0, pos) + file.substr(end);
+        }
+        unsigned k = std::find(keys.begin(), keys.end(), key) - keys.begin();
+        if (k == keys.size()) {
+            keys.push_back(key);
+            result.push_back(Chunks());
+        }
+        result[k].push_back(file);
+    }
+    for (Chunks& chunks : result)  std::sort(chunks.begin(), chunks.end());
+    return result;
+}